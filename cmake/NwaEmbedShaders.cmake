@@ -0,0 +1,96 @@
+# nwa_embed_shaders (<target> [NAMESPACE <name>] [STRIP] [COMPRESS] [COMPILE_OPTIONS <option>...] SHADERS <file>...)
+#
+# Compiles GLSL (shader.vert, shader.frag, ...) and HLSL (<name>.<stage>.hlsl) to SPIR-V at build
+# time with glslc or glslangValidator of the Vulkan SDK, .spv files are taken as they are. The
+# target gets <NAMESPACE>.h on its include path: one array per shader and a constexpr index of
+# NWA::VulkanShaderBlob, read through NWA::VulkanShaderLibrary. A shader is named after its file
+# without the .spv or .hlsl extension, dots replaced by underscores: shader.vert -> shader_vert.
+#
+# STRIP drops the debug instructions (names, sources, lines), COMPRESS stores LZ blobs that are
+# decompressed on first use. Needs find_package (Vulkan) first, for the compilers.
+
+set (NWA_EMBED_SHADERS_TOOL_SOURCE ${CMAKE_CURRENT_LIST_DIR}/../tools/EmbedShaders/Main.cpp)
+
+function (nwa_embed_shaders target)
+    cmake_parse_arguments (ARG "STRIP;COMPRESS" "NAMESPACE" "SHADERS;COMPILE_OPTIONS" ${ARGN})
+
+    if (NOT ARG_NAMESPACE)
+        set (ARG_NAMESPACE ${target}Shaders)
+    endif ()
+
+    # Host tool, shared by every target embedding shaders
+    if (NOT TARGET nwa_embed_shaders_tool)
+        add_executable          (nwa_embed_shaders_tool ${NWA_EMBED_SHADERS_TOOL_SOURCE})
+        set_target_properties   (nwa_embed_shaders_tool PROPERTIES OUTPUT_NAME EmbedShaders CXX_STANDARD 20)
+    endif ()
+
+    set (OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/nwa_shaders/${target})
+    set (HEADER ${OUTPUT_DIR}/${ARG_NAMESPACE}.h)
+    file (MAKE_DIRECTORY ${OUTPUT_DIR})
+
+    set (BLOB_ARGS)
+    set (SPIRV_FILES)
+
+    foreach (SHADER ${ARG_SHADERS})
+        get_filename_component (SHADER_PATH ${SHADER} ABSOLUTE)
+        get_filename_component (SHADER_FILE ${SHADER} NAME)
+
+        string (REGEX REPLACE "\\.(spv|hlsl)$" "" BLOB_NAME ${SHADER_FILE})
+        string (MAKE_C_IDENTIFIER ${BLOB_NAME} BLOB_NAME)
+
+        if (SHADER_FILE MATCHES "\\.spv$")
+            set (SPIRV ${SHADER_PATH})
+        else ()
+            set (SPIRV ${OUTPUT_DIR}/${SHADER_FILE}.spv)
+
+            if (SHADER_FILE MATCHES "\\.([a-z]+)\\.hlsl$")
+                set (STAGE ${CMAKE_MATCH_1})
+                if (Vulkan_GLSLC_EXECUTABLE)
+                    set (COMPILE_COMMAND ${Vulkan_GLSLC_EXECUTABLE} -x hlsl -fshader-stage=${STAGE} -fentry-point=main ${ARG_COMPILE_OPTIONS} -o ${SPIRV} ${SHADER_PATH})
+                elseif (Vulkan_GLSLANG_VALIDATOR_EXECUTABLE)
+                    set (COMPILE_COMMAND ${Vulkan_GLSLANG_VALIDATOR_EXECUTABLE} -V -D -S ${STAGE} -e main ${ARG_COMPILE_OPTIONS} -o ${SPIRV} ${SHADER_PATH})
+                endif ()
+            else ()
+                if (Vulkan_GLSLC_EXECUTABLE)
+                    set (COMPILE_COMMAND ${Vulkan_GLSLC_EXECUTABLE} ${ARG_COMPILE_OPTIONS} -o ${SPIRV} ${SHADER_PATH})
+                elseif (Vulkan_GLSLANG_VALIDATOR_EXECUTABLE)
+                    set (COMPILE_COMMAND ${Vulkan_GLSLANG_VALIDATOR_EXECUTABLE} -V ${ARG_COMPILE_OPTIONS} -o ${SPIRV} ${SHADER_PATH})
+                endif ()
+            endif ()
+
+            if (NOT COMPILE_COMMAND)
+                message (FATAL_ERROR "nwa_embed_shaders: ${SHADER_FILE} needs glslc or glslangValidator from the Vulkan SDK")
+            endif ()
+
+            add_custom_command (
+                OUTPUT  ${SPIRV}
+                COMMAND ${COMPILE_COMMAND}
+                DEPENDS ${SHADER_PATH}
+                COMMENT "Compiling ${SHADER_FILE} to SPIR-V"
+                VERBATIM)
+
+            unset (COMPILE_COMMAND)
+        endif ()
+
+        list (APPEND BLOB_ARGS ${BLOB_NAME}=${SPIRV})
+        list (APPEND SPIRV_FILES ${SPIRV})
+    endforeach ()
+
+    set (TOOL_FLAGS)
+    if (ARG_STRIP)
+        list (APPEND TOOL_FLAGS --strip)
+    endif ()
+    if (ARG_COMPRESS)
+        list (APPEND TOOL_FLAGS --compress)
+    endif ()
+
+    add_custom_command (
+        OUTPUT  ${HEADER}
+        COMMAND nwa_embed_shaders_tool --output ${HEADER} --namespace ${ARG_NAMESPACE} ${TOOL_FLAGS} ${BLOB_ARGS}
+        DEPENDS nwa_embed_shaders_tool ${SPIRV_FILES}
+        COMMENT "Embedding shaders of ${target}"
+        VERBATIM)
+
+    target_sources              (${target} PRIVATE ${HEADER})
+    target_include_directories  (${target} PRIVATE ${OUTPUT_DIR})
+endfunction ()
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Window.h"
+#include "Utility.h"
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <deque>
+
+namespace NWA
+{
+    struct GLDispatchTable;
+
+    // Asynchronous back buffer read back through a ring of pixel pack buffers. Pixels
+    // are read right before SwapBuffer, mapped once their fence has signaled and handed
+    // to the callback on a worker thread. The render thread never waits: a frame is
+    // dropped when every buffer in the ring is still in use.
+    class FrameCapture : NonCopyable
+    {
+    public:
+        struct Frame
+        {
+            uint64_t frameIndex;
+            int width;
+            int height;
+            int stride;
+            // RGBA8, bottom-up rows, only valid during the callback
+            const std::byte* pixels;
+        };
+
+        using Callback = std::function<void(const Frame&)>;
+
+    public:
+        explicit FrameCapture(const Callback& callback, int ringSize = 3);
+        ~FrameCapture();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Capture on the window's SwapBuffer.
+        auto Attach(Window& window) -> void;
+        auto Detach() -> void;
+
+        // Capture the next frameCount frames, negative value for continuous capture.
+        auto RequestCapture(int frameCount = 1) -> void;
+        auto StopCapture() -> void;
+
+        auto Capture(int width, int height) -> void;
+        auto Poll() -> void;
+
+        auto GetCapturedFrameCount() const -> uint64_t;
+        auto GetDroppedFrameCount() const -> uint64_t;
+
+    private:
+        enum class SlotState: int
+        {
+            Free,
+            Pending,
+            Mapped,
+            Consumed,
+        };
+
+        struct Slot
+        {
+            unsigned int buffer = 0;
+            void* fence = nullptr;
+            std::size_t capacity = 0;
+            std::atomic<SlotState> state = SlotState::Free;
+            Frame frame {};
+        };
+
+    private:
+        auto WorkerLoop() -> void;
+        auto RecycleConsumedSlots() -> void;
+
+    private:
+        bool _valid;
+        Callback _callback;
+
+        // Ring
+        std::vector<Slot> _slots;
+        std::size_t _nextSlot;
+        std::deque<std::size_t> _pendingSlots;
+        int _remainingCaptures;
+        uint64_t _frameIndex;
+        std::atomic<uint64_t> _capturedFrames;
+        uint64_t _droppedFrames;
+
+        // Worker
+        std::thread _worker;
+        std::mutex _workerMutex;
+        std::condition_variable _workerCondition;
+        std::deque<std::size_t> _workerQueue;
+        bool _stopWorker;
+
+        // Attached window
+        Window* _pWindow;
+        int _swapCallbackId;
+
+        // Functions of the context current on construction
+        const GLDispatchTable* _pGL;
+    };
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Window.h"
+#include "Utility.h"
+#include <cstdint>
+#include <chrono>
+#include <functional>
+
+namespace NWA
+{
+    // Caps the frame rate by waiting for a fixed deadline right before present. The wait
+    // sleeps on a high resolution timer until spinThreshold before the deadline and spins
+    // the rest, which keeps wake up error in microseconds without burning a whole core.
+    class FramePacer : NonCopyable
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Statistics
+        {
+            uint64_t frameCount;
+            double targetMs;
+            double averageMs;
+            double minMs;
+            double maxMs;
+            // Standard deviation of frame time
+            double jitterMs;
+            // How late the wait returned after the deadline
+            double averageWakeErrorUs;
+            double maxWakeErrorUs;
+            uint64_t missedDeadlines;
+        };
+
+    public:
+        explicit FramePacer(double targetFrameRate = 60.0, std::chrono::microseconds spinThreshold = std::chrono::microseconds(1500));
+        ~FramePacer();
+
+    public:
+        // Zero or negative frame rate disables the limiter, statistics are still recorded.
+        auto SetTargetFrameRate(double targetFrameRate) -> void;
+        auto GetTargetFrameRate() const -> double;
+        auto SetSpinThreshold(std::chrono::microseconds spinThreshold) -> void;
+
+        // Called inputLead before the deadline, e.g. to pump window events as late as possible.
+        auto SetLateInputCallback(const std::function<void()>& f, std::chrono::microseconds inputLead = std::chrono::microseconds(1000)) -> void;
+
+        // Pace on the window's SwapBuffer.
+        auto Attach(Window& window) -> void;
+        auto Detach() -> void;
+
+        // Call right before present (SwapBuffer, vkQueuePresentKHR). VulkanSwapchain and
+        // VulkanPresenter call it themselves when given the pacer.
+        auto Wait() -> void;
+
+        auto GetStatistics() const -> Statistics;
+        auto ResetStatistics() -> void;
+
+    private:
+        auto WaitUntil(Clock::time_point deadline) -> void;
+        auto RecordFrame(Clock::time_point now, Clock::time_point deadline) -> void;
+
+    private:
+        Clock::duration _period;
+        Clock::duration _spinThreshold;
+        Clock::duration _inputLead;
+        std::function<void()> _lateInputCallback;
+
+        // Timeline
+        bool _started;
+        Clock::time_point _nextDeadline;
+        Clock::time_point _lastFrameTime;
+
+        // Running statistics (Welford)
+        uint64_t _frameCount;
+        double _meanMs;
+        double _m2;
+        double _minMs;
+        double _maxMs;
+        uint64_t _wakeCount;
+        double _totalWakeErrorUs;
+        double _maxWakeErrorUs;
+        uint64_t _missedDeadlines;
+
+        // High resolution waitable timer on Windows
+        void* _hTimer;
+
+        // Attached window
+        Window* _pWindow;
+        int _swapCallbackId;
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Window.h"
+#include "Utility.h"
+#include <cstdint>
+#include <vector>
+
+namespace NWA
+{
+    // Renders several windows with one shared OpenGL context. Switching drawables is
+    // skipped when the requested window is already current, and swapping never switches:
+    // EndWindow swaps a window right after it is drawn, while it is still current, Present
+    // swaps whatever was drawn and not ended yet. All windows must live on the thread that
+    // owns the context.
+    class GLContextManager : NonCopyable
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t makeCurrentCalls;
+            uint64_t skippedMakeCurrentCalls;
+            uint64_t presentedFrames;
+        };
+
+    public:
+        GLContextManager() = default;
+        ~GLContextManager();
+
+    public:
+        // Shared context is created with the first window added.
+        auto AddWindow(Window& window) -> bool;
+        auto RemoveWindow(Window& window) -> void;
+
+        auto MakeCurrent(const Window& window) -> bool;
+        // Swap a window done drawing. Swap callbacks reading the drawable (FrameCapture)
+        // need this, it is still current here.
+        auto EndWindow(const Window& window) -> void;
+        // Swap the windows drawn and not ended, without making them current.
+        auto Present() -> void;
+
+        auto GetContext() const -> Window::GLContextHandle;
+        auto GetStatistics() const -> Statistics;
+
+    private:
+        struct Drawable
+        {
+            Window* pWindow;
+            Window::DeviceContextHandle hDeviceContext;
+            bool drawn;
+        };
+
+    private:
+        auto FindDrawable(const Window& window) -> Drawable*;
+
+    private:
+        Window::GLContextHandle _hGLContext = nullptr;
+        std::vector<Drawable> _drawables;
+        Window::DeviceContextHandle _hCurrentDeviceContext = nullptr;
+        Statistics _statistics {};
+    };
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Window.h"
+#include "GpuZoneRecorder.h"
+#include "Utility.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace NWA
+{
+    struct GLDispatchTable;
+
+    // GPU time per zone measured with GL_TIMESTAMP queries. Results are read back
+    // latencyFrames frames later and dropped if still pending, so the profiler never
+    // waits on the GPU. Requires the OpenGL context to be current on construction.
+    class GLGpuProfiler : NonCopyable
+    {
+    public:
+        using ZoneStats = GpuZoneStats;
+
+        class ScopeZone : NonCopyable
+        {
+        public:
+            ScopeZone(GLGpuProfiler& profiler, const char* name)
+                : _profiler(profiler)
+            {
+                _profiler.BeginZone(name);
+            }
+
+            ~ScopeZone()
+            {
+                _profiler.EndZone();
+            }
+
+        private:
+            GLGpuProfiler& _profiler;
+        };
+
+    public:
+        explicit GLGpuProfiler(int latencyFrames = 3, int maxZonesPerFrame = 64, int rollingWindow = 120);
+        ~GLGpuProfiler();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Frame demarcation on the window's SwapBuffer.
+        auto Attach(Window& window) -> void;
+        auto Detach() -> void;
+
+        // Zone name must live until the frame is read back, string literal is expected.
+        auto BeginZone(const char* name) -> void;
+        auto EndZone() -> void;
+        auto EndFrame() -> void;
+
+        auto GetZoneStats() const -> std::vector<ZoneStats>;
+        auto GetDroppedFrameCount() const -> uint64_t;
+
+        auto SetTraceEnabled(bool enable, std::size_t maxEvents = 16384) -> void;
+        auto ExportTrace() const -> std::string;
+        auto ExportTrace(const std::string& path) const -> bool;
+
+    private:
+        struct ZoneRecord
+        {
+            const char* name;
+            int depth;
+        };
+
+        struct FrameSlot
+        {
+            std::vector<unsigned int> queries;
+            std::vector<ZoneRecord> zones;
+            unsigned int lastQuery = 0;
+            uint64_t frameIndex = 0;
+            bool pending = false;
+        };
+
+    private:
+        auto ResolveSlot(FrameSlot& slot) -> bool;
+
+    private:
+        bool _valid;
+        int _maxZonesPerFrame;
+
+        // Frames in flight
+        std::vector<FrameSlot> _frameSlots;
+        std::size_t _currentSlot;
+        uint64_t _frameIndex;
+        uint64_t _droppedFrames;
+        std::vector<int> _zoneStack;
+
+        // Results
+        GpuZoneRecorder _recorder;
+
+        // Attached window
+        Window* _pWindow;
+        int _swapCallbackId;
+
+        // Functions of the context current on construction
+        const GLDispatchTable* _pGL;
+    };
+}
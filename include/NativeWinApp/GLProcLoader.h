@@ -0,0 +1,131 @@
+#pragma once
+
+#include "OpenGLInclude.h"
+#include <cstdint>
+
+// Entry points resolved per context: X(function pointer type, name without gl prefix)
+#define NWA_GL_FUNCTIONS(X) \
+    /* OpenGL 1.1 */ \
+    X(decltype(&::glGetError), GetError) \
+    X(decltype(&::glGetIntegerv), GetIntegerv) \
+    X(decltype(&::glGetString), GetString) \
+    X(decltype(&::glEnable), Enable) \
+    X(decltype(&::glDisable), Disable) \
+    X(decltype(&::glViewport), Viewport) \
+    X(decltype(&::glClearColor), ClearColor) \
+    X(decltype(&::glClear), Clear) \
+    X(decltype(&::glDrawArrays), DrawArrays) \
+    X(decltype(&::glDrawElements), DrawElements) \
+    X(decltype(&::glPixelStorei), PixelStorei) \
+    X(decltype(&::glReadPixels), ReadPixels) \
+    X(decltype(&::glGenTextures), GenTextures) \
+    X(decltype(&::glDeleteTextures), DeleteTextures) \
+    X(decltype(&::glBindTexture), BindTexture) \
+    X(decltype(&::glTexImage2D), TexImage2D) \
+    X(decltype(&::glTexParameteri), TexParameteri) \
+    X(decltype(&::glFlush), Flush) \
+    X(decltype(&::glFinish), Finish) \
+    /* State */ \
+    X(PFNGLGETSTRINGIPROC, GetStringi) \
+    X(PFNGLGETINTEGER64VPROC, GetInteger64v) \
+    /* Query */ \
+    X(PFNGLGENQUERIESPROC, GenQueries) \
+    X(PFNGLDELETEQUERIESPROC, DeleteQueries) \
+    X(PFNGLQUERYCOUNTERPROC, QueryCounter) \
+    X(PFNGLGETQUERYOBJECTIVPROC, GetQueryObjectiv) \
+    X(PFNGLGETQUERYOBJECTUI64VPROC, GetQueryObjectui64v) \
+    /* Buffer */ \
+    X(PFNGLGENBUFFERSPROC, GenBuffers) \
+    X(PFNGLDELETEBUFFERSPROC, DeleteBuffers) \
+    X(PFNGLBINDBUFFERPROC, BindBuffer) \
+    X(PFNGLBUFFERDATAPROC, BufferData) \
+    X(PFNGLBUFFERSUBDATAPROC, BufferSubData) \
+    X(PFNGLMAPBUFFERRANGEPROC, MapBufferRange) \
+    X(PFNGLUNMAPBUFFERPROC, UnmapBuffer) \
+    /* Sync */ \
+    X(PFNGLFENCESYNCPROC, FenceSync) \
+    X(PFNGLDELETESYNCPROC, DeleteSync) \
+    X(PFNGLCLIENTWAITSYNCPROC, ClientWaitSync) \
+    /* Vertex array */ \
+    X(PFNGLGENVERTEXARRAYSPROC, GenVertexArrays) \
+    X(PFNGLDELETEVERTEXARRAYSPROC, DeleteVertexArrays) \
+    X(PFNGLBINDVERTEXARRAYPROC, BindVertexArray) \
+    X(PFNGLENABLEVERTEXATTRIBARRAYPROC, EnableVertexAttribArray) \
+    X(PFNGLDISABLEVERTEXATTRIBARRAYPROC, DisableVertexAttribArray) \
+    X(PFNGLVERTEXATTRIBPOINTERPROC, VertexAttribPointer) \
+    /* Shader & program */ \
+    X(PFNGLCREATESHADERPROC, CreateShader) \
+    X(PFNGLDELETESHADERPROC, DeleteShader) \
+    X(PFNGLSHADERSOURCEPROC, ShaderSource) \
+    X(PFNGLCOMPILESHADERPROC, CompileShader) \
+    X(PFNGLGETSHADERIVPROC, GetShaderiv) \
+    X(PFNGLGETSHADERINFOLOGPROC, GetShaderInfoLog) \
+    X(PFNGLCREATEPROGRAMPROC, CreateProgram) \
+    X(PFNGLDELETEPROGRAMPROC, DeleteProgram) \
+    X(PFNGLATTACHSHADERPROC, AttachShader) \
+    X(PFNGLLINKPROGRAMPROC, LinkProgram) \
+    X(PFNGLGETPROGRAMIVPROC, GetProgramiv) \
+    X(PFNGLGETPROGRAMINFOLOGPROC, GetProgramInfoLog) \
+    X(PFNGLUSEPROGRAMPROC, UseProgram) \
+    X(PFNGLGETUNIFORMLOCATIONPROC, GetUniformLocation) \
+    X(PFNGLUNIFORM1IPROC, Uniform1i) \
+    X(PFNGLUNIFORM1FPROC, Uniform1f) \
+    X(PFNGLUNIFORM4FVPROC, Uniform4fv) \
+    X(PFNGLUNIFORMMATRIX4FVPROC, UniformMatrix4fv) \
+    /* Texture */ \
+    X(PFNGLACTIVETEXTUREPROC, ActiveTexture) \
+    X(PFNGLGENERATEMIPMAPPROC, GenerateMipmap) \
+    /* Framebuffer */ \
+    X(PFNGLGENFRAMEBUFFERSPROC, GenFramebuffers) \
+    X(PFNGLDELETEFRAMEBUFFERSPROC, DeleteFramebuffers) \
+    X(PFNGLBINDFRAMEBUFFERPROC, BindFramebuffer) \
+    X(PFNGLFRAMEBUFFERTEXTURE2DPROC, FramebufferTexture2D) \
+    X(PFNGLCHECKFRAMEBUFFERSTATUSPROC, CheckFramebufferStatus) \
+    X(PFNGLBLITFRAMEBUFFERPROC, BlitFramebuffer) \
+    /* Debug */ \
+    X(PFNGLDEBUGMESSAGECALLBACKPROC, DebugMessageCallback)
+
+namespace NWA
+{
+    // Function pointers of one context, laid out contiguously so a frame's
+    // calls touch a handful of cache lines. Missing entry points stay nullptr.
+    struct GLDispatchTable
+    {
+        void* context = nullptr;
+
+#define NWA_GL_DECLARE_FUNCTION(type, name) type name = nullptr;
+        NWA_GL_FUNCTIONS(NWA_GL_DECLARE_FUNCTION)
+#undef NWA_GL_DECLARE_FUNCTION
+    };
+
+    class GLProcLoader
+    {
+    public:
+        GLProcLoader() = delete;
+
+    public:
+        // wglGetProcAddress, with the OpenGL 1.1 fallback of Window::GetOpenGLProcAddress.
+        static auto LoadProcAddress(const char* name) -> void*;
+        static auto GetCurrentContext() -> void*;
+
+        // Resolve (once) the table of the context current on this thread and make
+        // it the thread's current table. Call after every context switch.
+        static auto BindCurrentContext() -> const GLDispatchTable*;
+
+        // Drop the cached table before the context is destroyed. Tables other threads last
+        // bound become invalid, their next BindCurrentContext resolves again.
+        static auto ReleaseContext(void* context) -> void;
+
+        static auto Current() -> const GLDispatchTable*
+        {
+            return _sCurrentTable;
+        }
+
+    private:
+        inline static thread_local const GLDispatchTable* _sCurrentTable = nullptr;
+        // The cache is checked on these, never through the table: another thread may have
+        // released it, and the driver may hand the same handle to a new context.
+        inline static thread_local void* _sCurrentContext = nullptr;
+        inline static thread_local uint64_t _sCurrentGeneration = 0;
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Utility.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace NWA
+{
+    struct GpuZoneStats
+    {
+        std::string name;
+        uint32_t sampleCount;
+        double lastMs;
+        double averageMs;
+        double minMs;
+        double maxMs;
+    };
+
+    // Resolved zone timings of GLGpuProfiler and VulkanGpuProfiler: rolling statistics per
+    // zone name and the optional Chrome trace. Zones are keyed on the name's content, so the
+    // same name from different pointers (e.g. duplicated literals) shares one history.
+    class GpuZoneRecorder : NonCopyable
+    {
+    public:
+        explicit GpuZoneRecorder(int rollingWindow = 120);
+
+    public:
+        // beginNs is on the GPU clock, the first traced zone becomes the trace origin.
+        auto Record(std::string_view name, uint64_t frameIndex, uint64_t beginNs, uint64_t durationNs, int depth) -> void;
+
+        auto GetZoneStats() const -> std::vector<GpuZoneStats>;
+
+        auto SetTraceEnabled(bool enable, std::size_t maxEvents = 16384) -> void;
+        auto ExportTrace() const -> std::string;
+        auto ExportTrace(const std::string& path) const -> bool;
+
+    private:
+        struct NameHash
+        {
+            using is_transparent = void;
+
+            auto operator()(std::string_view name) const -> std::size_t
+            {
+                return std::hash<std::string_view>()(name);
+            }
+        };
+
+        struct ZoneHistory
+        {
+            std::vector<double> samples;
+            std::size_t head = 0;
+            std::size_t count = 0;
+            uint64_t totalCount = 0;
+        };
+
+        struct TraceEvent
+        {
+            // Key of the zone's history, node keys never move
+            const std::string* pName;
+            uint64_t frameIndex;
+            uint64_t startNs;
+            uint64_t durationNs;
+            int depth;
+        };
+
+    private:
+        int _rollingWindow;
+        std::unordered_map<std::string, ZoneHistory, NameHash, std::equal_to<>> _zoneHistory;
+
+        bool _traceEnabled;
+        std::size_t _maxTraceEvents;
+        uint64_t _traceOriginNs;
+        std::deque<TraceEvent> _traceEvents;
+    };
+}
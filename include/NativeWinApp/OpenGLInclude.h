@@ -0,0 +1,156 @@
+#pragma once
+
+#if defined(_WIN32)
+#   include "WindowsInclude.h"
+#endif
+
+#include <GL/gl.h>
+#include <cstddef>
+#include <cstdint>
+
+// opengl32.lib only exports OpenGL 1.1, everything above it must be
+// fetched from the driver at runtime. Declare what the library uses.
+
+typedef char GLchar;
+typedef std::int64_t GLint64;
+typedef std::uint64_t GLuint64;
+
+#ifndef GL_TIMESTAMP
+#   define GL_TIMESTAMP                 0x8E28
+#endif
+
+#ifndef GL_QUERY_RESULT
+#   define GL_QUERY_RESULT              0x8866
+#endif
+
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#   define GL_QUERY_RESULT_AVAILABLE    0x8867
+#endif
+
+typedef void (APIENTRY* PFNGLGENQUERIESPROC)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY* PFNGLDELETEQUERIESPROC)(GLsizei n, const GLuint* ids);
+typedef void (APIENTRY* PFNGLQUERYCOUNTERPROC)(GLuint id, GLenum target);
+typedef void (APIENTRY* PFNGLGETQUERYOBJECTIVPROC)(GLuint id, GLenum pname, GLint* params);
+typedef void (APIENTRY* PFNGLGETQUERYOBJECTUI64VPROC)(GLuint id, GLenum pname, GLuint64* params);
+
+typedef std::ptrdiff_t GLsizeiptr;
+typedef std::ptrdiff_t GLintptr;
+typedef struct __GLsync* GLsync;
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#   define GL_PIXEL_PACK_BUFFER         0x88EB
+#endif
+
+#ifndef GL_STREAM_READ
+#   define GL_STREAM_READ               0x88E1
+#endif
+
+#ifndef GL_MAP_READ_BIT
+#   define GL_MAP_READ_BIT              0x0001
+#endif
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#   define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+
+#ifndef GL_ALREADY_SIGNALED
+#   define GL_ALREADY_SIGNALED          0x911A
+#endif
+
+#ifndef GL_CONDITION_SATISFIED
+#   define GL_CONDITION_SATISFIED       0x911C
+#endif
+
+typedef void (APIENTRY* PFNGLGENBUFFERSPROC)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY* PFNGLDELETEBUFFERSPROC)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY* PFNGLBINDBUFFERPROC)(GLenum target, GLuint buffer);
+typedef void (APIENTRY* PFNGLBUFFERDATAPROC)(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+typedef void* (APIENTRY* PFNGLMAPBUFFERRANGEPROC)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (APIENTRY* PFNGLUNMAPBUFFERPROC)(GLenum target);
+typedef GLsync (APIENTRY* PFNGLFENCESYNCPROC)(GLenum condition, GLbitfield flags);
+typedef void (APIENTRY* PFNGLDELETESYNCPROC)(GLsync sync);
+typedef GLenum (APIENTRY* PFNGLCLIENTWAITSYNCPROC)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+
+typedef void (APIENTRY* GLDEBUGPROC)(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
+
+// Buffer, shader and debug output enums used through GLDispatchTable
+
+#ifndef GL_ARRAY_BUFFER
+#   define GL_ARRAY_BUFFER              0x8892
+#endif
+
+#ifndef GL_STATIC_DRAW
+#   define GL_STATIC_DRAW               0x88E4
+#endif
+
+#ifndef GL_FRAGMENT_SHADER
+#   define GL_FRAGMENT_SHADER           0x8B30
+#endif
+
+#ifndef GL_VERTEX_SHADER
+#   define GL_VERTEX_SHADER             0x8B31
+#endif
+
+#ifndef GL_COMPILE_STATUS
+#   define GL_COMPILE_STATUS            0x8B81
+#endif
+
+#ifndef GL_LINK_STATUS
+#   define GL_LINK_STATUS               0x8B82
+#endif
+
+#ifndef GL_DEBUG_OUTPUT
+#   define GL_DEBUG_OUTPUT                      0x92E0
+#   define GL_DEBUG_SOURCE_API                  0x8246
+#   define GL_DEBUG_SOURCE_WINDOW_SYSTEM        0x8247
+#   define GL_DEBUG_SOURCE_SHADER_COMPILER      0x8248
+#   define GL_DEBUG_SOURCE_THIRD_PARTY          0x8249
+#   define GL_DEBUG_SOURCE_APPLICATION          0x824A
+#   define GL_DEBUG_SOURCE_OTHER                0x824B
+#   define GL_DEBUG_TYPE_ERROR                  0x824C
+#   define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR    0x824D
+#   define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR     0x824E
+#   define GL_DEBUG_TYPE_PORTABILITY            0x824F
+#   define GL_DEBUG_TYPE_PERFORMANCE            0x8250
+#   define GL_DEBUG_TYPE_OTHER                  0x8251
+#   define GL_DEBUG_SEVERITY_HIGH               0x9146
+#   define GL_DEBUG_SEVERITY_MEDIUM             0x9147
+#   define GL_DEBUG_SEVERITY_LOW                0x9148
+#endif
+
+typedef const GLubyte* (APIENTRY* PFNGLGETSTRINGIPROC)(GLenum name, GLuint index);
+typedef void (APIENTRY* PFNGLGETINTEGER64VPROC)(GLenum pname, GLint64* data);
+typedef void (APIENTRY* PFNGLBUFFERSUBDATAPROC)(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+typedef void (APIENTRY* PFNGLGENVERTEXARRAYSPROC)(GLsizei n, GLuint* arrays);
+typedef void (APIENTRY* PFNGLDELETEVERTEXARRAYSPROC)(GLsizei n, const GLuint* arrays);
+typedef void (APIENTRY* PFNGLBINDVERTEXARRAYPROC)(GLuint array);
+typedef void (APIENTRY* PFNGLENABLEVERTEXATTRIBARRAYPROC)(GLuint index);
+typedef void (APIENTRY* PFNGLDISABLEVERTEXATTRIBARRAYPROC)(GLuint index);
+typedef void (APIENTRY* PFNGLVERTEXATTRIBPOINTERPROC)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+typedef GLuint (APIENTRY* PFNGLCREATESHADERPROC)(GLenum type);
+typedef void (APIENTRY* PFNGLDELETESHADERPROC)(GLuint shader);
+typedef void (APIENTRY* PFNGLSHADERSOURCEPROC)(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+typedef void (APIENTRY* PFNGLCOMPILESHADERPROC)(GLuint shader);
+typedef void (APIENTRY* PFNGLGETSHADERIVPROC)(GLuint shader, GLenum pname, GLint* params);
+typedef void (APIENTRY* PFNGLGETSHADERINFOLOGPROC)(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+typedef GLuint (APIENTRY* PFNGLCREATEPROGRAMPROC)(void);
+typedef void (APIENTRY* PFNGLDELETEPROGRAMPROC)(GLuint program);
+typedef void (APIENTRY* PFNGLATTACHSHADERPROC)(GLuint program, GLuint shader);
+typedef void (APIENTRY* PFNGLLINKPROGRAMPROC)(GLuint program);
+typedef void (APIENTRY* PFNGLGETPROGRAMIVPROC)(GLuint program, GLenum pname, GLint* params);
+typedef void (APIENTRY* PFNGLGETPROGRAMINFOLOGPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog);
+typedef void (APIENTRY* PFNGLUSEPROGRAMPROC)(GLuint program);
+typedef GLint (APIENTRY* PFNGLGETUNIFORMLOCATIONPROC)(GLuint program, const GLchar* name);
+typedef void (APIENTRY* PFNGLUNIFORM1IPROC)(GLint location, GLint v0);
+typedef void (APIENTRY* PFNGLUNIFORM1FPROC)(GLint location, GLfloat v0);
+typedef void (APIENTRY* PFNGLUNIFORM4FVPROC)(GLint location, GLsizei count, const GLfloat* value);
+typedef void (APIENTRY* PFNGLUNIFORMMATRIX4FVPROC)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+typedef void (APIENTRY* PFNGLACTIVETEXTUREPROC)(GLenum texture);
+typedef void (APIENTRY* PFNGLGENERATEMIPMAPPROC)(GLenum target);
+typedef void (APIENTRY* PFNGLGENFRAMEBUFFERSPROC)(GLsizei n, GLuint* framebuffers);
+typedef void (APIENTRY* PFNGLDELETEFRAMEBUFFERSPROC)(GLsizei n, const GLuint* framebuffers);
+typedef void (APIENTRY* PFNGLBINDFRAMEBUFFERPROC)(GLenum target, GLuint framebuffer);
+typedef void (APIENTRY* PFNGLFRAMEBUFFERTEXTURE2DPROC)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum (APIENTRY* PFNGLCHECKFRAMEBUFFERSTATUSPROC)(GLenum target);
+typedef void (APIENTRY* PFNGLBLITFRAMEBUFFERPROC)(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
+typedef void (APIENTRY* PFNGLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROC callback, const void* userParam);
@@ -3,16 +3,31 @@
 #include "Window.h"
 
 
-#define VK_USE_PLATFORM_WIN32_KHR // for windows platform
-#define VK_NO_PROTOTYPES // for static link
+#if defined(_WIN32)
+#   define VK_USE_PLATFORM_WIN32_KHR // for windows platform
+#endif
+
+#define VK_NO_PROTOTYPES // functions are loaded at runtime, see VulkanLoader
 #include <vulkan/vulkan.h>
 
 namespace NWA
 {
+    enum class VulkanSurfaceType: int
+    {
+        // Surface of a Window
+        Window,
+        // VK_EXT_headless_surface, no display needed (CI, benchmarks). The swapchain picks the
+        // extent from its create info, presentation does not show anything.
+        Headless,
+    };
+
     class Vulkan
     {
     public:
-        static const std::vector<const char*>& GetRequiredInstanceExtensions();
+        static const std::vector<const char*>& GetRequiredInstanceExtensions(VulkanSurfaceType type = VulkanSurfaceType::Window);
+        static bool IsHeadlessSurfaceSupported();
+
         static bool CreateVulkanSurface(const VkInstance& instance, const Window& window, VkSurfaceKHR& surface, const VkAllocationCallbacks* allocator);
+        static bool CreateHeadlessSurface(const VkInstance& instance, VkSurfaceKHR& surface, const VkAllocationCallbacks* allocator);
     };
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace NWA
+{
+    // Physical device and queue family selection. Devices are scored on type, required
+    // extensions and queue capabilities, the decision is written to a small file keyed by the
+    // device UUID, driver version and required extensions. Later launches find the device by
+    // its UUID and skip enumerating extensions and queue families.
+    class VulkanBootstrap : NonCopyable
+    {
+    public:
+        struct CreateInfo
+        {
+            VkInstance instance = VK_NULL_HANDLE;
+            // Null when nothing is presented, the present family is then VK_QUEUE_FAMILY_IGNORED
+            VkSurfaceKHR surface = VK_NULL_HANDLE;
+            std::vector<const char*> requiredExtensions;
+            // Empty to probe on every launch
+            std::string cachePath;
+        };
+
+        struct Selection
+        {
+            VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+            VkPhysicalDeviceProperties properties {};
+            // Graphics with compute, presenting when possible
+            uint32_t graphicsQueueFamily = 0;
+            // No graphics when the device has an async compute family
+            uint32_t computeQueueFamily = 0;
+            // Neither graphics nor compute when the device has a DMA family
+            uint32_t transferQueueFamily = 0;
+            uint32_t presentQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+            int64_t score = 0;
+        };
+
+    public:
+        VulkanBootstrap(const VulkanInstanceTable& instanceTable, const CreateInfo& createInfo);
+
+    public:
+        // False when no device has the required extensions and queues.
+        auto IsValid() const -> bool;
+
+        auto GetSelection() const -> const Selection&;
+        // Distinct families of the selection, one queue create info each.
+        auto GetQueueFamilies() const -> std::vector<uint32_t>;
+
+        auto IsLoadedFromCache() const -> bool;
+        auto GetSelectionTime() const -> std::chrono::microseconds;
+
+    private:
+        struct DeviceKey
+        {
+            uint8_t uuid[VK_UUID_SIZE];
+            uint32_t vendorID;
+            uint32_t deviceID;
+            uint32_t driverVersion;
+        };
+
+    private:
+        auto GetDeviceKey(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties& properties) const -> DeviceKey;
+        auto GetRequirementHash() const -> uint64_t;
+        auto LoadCache(const std::vector<VkPhysicalDevice>& physicalDevices) -> bool;
+        auto SaveCache() const -> bool;
+        auto ProbeDevice(VkPhysicalDevice physicalDevice, Selection& selection) const -> bool;
+
+    private:
+        bool _valid;
+        const VulkanInstanceTable* _pInstance;
+        CreateInfo _createInfo;
+
+        Selection _selection;
+        bool _loadedFromCache;
+        std::chrono::microseconds _selectionTime;
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <vector>
+
+namespace NWA
+{
+    // Command buffers for recording on several threads. Every recording thread has its own
+    // command pool per frame in flight, so handing out a command buffer never takes a lock,
+    // and a frame is recycled with one vkResetCommandPool per thread instead of resetting
+    // every buffer. Command buffers stay allocated and are reused by the following frames.
+    class VulkanCommandContext : NonCopyable
+    {
+    public:
+        struct CreateInfo
+        {
+            uint32_t queueFamilyIndex = 0;
+            uint32_t framesInFlight = 2;
+            // Thread indices passed to BeginPrimary / BeginSecondary are below this
+            uint32_t threadCount = 1;
+        };
+
+    public:
+        VulkanCommandContext(const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo);
+        ~VulkanCommandContext();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Reset every pool of the frame slot. The slot's previous submission must be finished
+        // and no thread may be recording. Workers started afterwards see the new frame.
+        auto BeginFrame(uint32_t frameIndex) -> bool;
+
+        // Next command buffer of the thread for the current frame, already begun for one
+        // submission. A thread index must only be used by one thread at a time.
+        auto BeginPrimary(uint32_t threadIndex) -> VkCommandBuffer;
+        // Secondary continuing a subpass, executed by a primary with vkCmdExecuteCommands.
+        // The framebuffer may be null when it is not known while recording.
+        auto BeginSecondary(uint32_t threadIndex, VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer) -> VkCommandBuffer;
+
+        auto GetThreadCount() const -> uint32_t;
+        auto GetFramesInFlight() const -> uint32_t;
+        // Command buffers allocated over all pools, stops growing once frames are alike
+        auto GetAllocatedCount() const -> uint32_t;
+
+    private:
+        // Cache line sized so threads recording side by side do not share counters
+        struct alignas(64) ThreadPool
+        {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> primaries;
+            std::vector<VkCommandBuffer> secondaries;
+            uint32_t primaryUsed = 0;
+            uint32_t secondaryUsed = 0;
+        };
+
+    private:
+        auto GetThreadPool(uint32_t threadIndex) -> ThreadPool*;
+        auto Allocate(ThreadPool& pool, VkCommandBufferLevel level) -> VkCommandBuffer;
+
+    private:
+        bool _valid;
+        const VulkanDeviceTable* _pDevice;
+        CreateInfo _createInfo;
+
+        // framesInFlight * threadCount, frame major
+        std::vector<ThreadPool> _pools;
+        uint32_t _frameIndex;
+    };
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace NWA
+{
+    // VK_EXT_debug_utils messenger that keeps validation floods off the frame. The callback only
+    // copies the message into a preallocated ring, repeats of a message id beyond the rate limit
+    // are counted instead of queued, and formatting and output happen on a background thread.
+    // Messages that do not fit in the ring are dropped and counted.
+    class VulkanDebugMessenger : NonCopyable
+    {
+    public:
+        struct Message
+        {
+            VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+            VkDebugUtilsMessageTypeFlagsEXT types;
+            int32_t messageIdNumber;
+            std::string messageIdName;
+            std::string text;
+            // Repeats of the id suppressed by the rate limit since the previous one came through
+            uint64_t suppressedCount;
+        };
+
+        struct CreateInfo
+        {
+            VkInstance instance = VK_NULL_HANDLE;
+            VkDebugUtilsMessageSeverityFlagsEXT severities = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+            VkDebugUtilsMessageTypeFlagsEXT types = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+
+            // Messages waiting for the background thread, longer texts are truncated
+            uint32_t ringCapacity = 256;
+            uint32_t maxMessageLength = 1024;
+
+            // Per message id, at most maxPerInterval messages per interval are queued
+            uint32_t maxPerInterval = 5;
+            std::chrono::milliseconds rateInterval = std::chrono::milliseconds(1000);
+
+            // Called on the background thread, prints to std::cerr when empty
+            std::function<void(const Message&)> sink;
+            const VkAllocationCallbacks* pAllocator = nullptr;
+        };
+
+        struct Statistics
+        {
+            uint64_t receivedCount;
+            uint64_t queuedCount;
+            // Over the rate limit of their id
+            uint64_t suppressedCount;
+            // Ring full
+            uint64_t droppedCount;
+            uint32_t uniqueIdCount;
+        };
+
+    public:
+        VulkanDebugMessenger(const VulkanInstanceTable& instanceTable, const CreateInfo& createInfo);
+        // Outputs what is still queued.
+        ~VulkanDebugMessenger();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Wait until every queued message reached the sink.
+        auto Flush() -> void;
+        auto GetStatistics() const -> Statistics;
+
+        static auto Format(const Message& message) -> std::string;
+
+    private:
+        // Open addressing, ids are never removed
+        struct IdSlot
+        {
+            std::atomic<uint64_t> hash;
+            std::atomic<int64_t> intervalStart;
+            std::atomic<uint32_t> intervalCount;
+            std::atomic<uint64_t> suppressedCount;
+        };
+
+        struct RingEntry
+        {
+            VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+            VkDebugUtilsMessageTypeFlagsEXT types;
+            int32_t messageIdNumber;
+            uint64_t suppressedCount;
+            uint32_t idNameLength;
+            uint32_t textLength;
+        };
+
+        static constexpr uint32_t ID_TABLE_SIZE = 1024;
+        static constexpr uint32_t MAX_ID_NAME_LENGTH = 128;
+
+    private:
+        static VKAPI_ATTR VkBool32 VKAPI_CALL Callback(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types,
+            const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData);
+
+        auto OnMessage(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData) -> void;
+        auto FindIdSlot(uint64_t hash) -> IdSlot*;
+        auto PassRateLimit(IdSlot& slot, uint64_t& suppressedCount) -> bool;
+        auto FormatThread() -> void;
+
+    private:
+        bool _valid;
+        const VulkanInstanceTable* _pInstance;
+        CreateInfo _createInfo;
+        VkDebugUtilsMessengerEXT _messenger;
+
+        std::unique_ptr<IdSlot[]> _idSlots;
+
+        // Ring of entries, id name and text of an entry live in one fixed size block of _ringText
+        std::vector<RingEntry> _ring;
+        std::vector<char> _ringText;
+        size_t _ringStride;
+        uint64_t _ringHead;
+        uint64_t _ringTail;
+        // Messages handed to the sink, Flush waits for it to reach the head
+        uint64_t _sinkCount;
+        std::mutex _ringMutex;
+        std::condition_variable _ringCondition;
+        std::condition_variable _flushCondition;
+        bool _stop;
+        std::thread _formatThread;
+
+        std::atomic<uint64_t> _receivedCount;
+        std::atomic<uint64_t> _queuedCount;
+        std::atomic<uint64_t> _suppressedCount;
+        std::atomic<uint64_t> _droppedCount;
+        std::atomic<uint32_t> _uniqueIdCount;
+    };
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace NWA
+{
+    // Descriptor sets living one frame. Every frame in flight allocates from its own chain of
+    // pools: when a pool runs out it is set aside as full and the next one is taken, so nothing
+    // has to be sized for the worst case up front. BeginFrame resets the pools of the frame
+    // slot and hands them back for reuse, new pools are only created while usage still grows.
+    // Also caches descriptor set layouts by their bindings. Not thread safe, use one allocator
+    // per recording thread.
+    class VulkanDescriptorAllocator : NonCopyable
+    {
+    public:
+        struct PoolRatio
+        {
+            VkDescriptorType type;
+            // Descriptors of the type per set
+            float ratio;
+        };
+
+        struct CreateInfo
+        {
+            uint32_t framesInFlight = 2;
+            // Sets of the first pool, each new pool is 1.5 times larger up to maxSetsPerPool
+            uint32_t initialSetsPerPool = 64;
+            uint32_t maxSetsPerPool = 4096;
+            std::vector<PoolRatio> ratios = {
+                { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+                { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+                { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+                { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+            };
+        };
+
+    public:
+        VulkanDescriptorAllocator(const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo);
+        ~VulkanDescriptorAllocator();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Reset the pools of the frame slot, its previous submission must be finished.
+        auto BeginFrame(uint32_t frameIndex) -> bool;
+        // Set of the current frame, valid until the slot comes around again. pNext is passed
+        // through, e.g. for variable descriptor counts. Null when the set does not fit an empty
+        // pool either (type missing from the ratios, more descriptors than a pool holds).
+        auto Allocate(VkDescriptorSetLayout layout, const void* pNext = nullptr) -> VkDescriptorSet;
+
+        // Same bindings and flags give the same layout, owned by the allocator.
+        auto GetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings, VkDescriptorSetLayoutCreateFlags flags = 0) -> VkDescriptorSetLayout;
+
+        auto GetPoolCount() const -> uint32_t;
+        // Pools that ran out of space and made the chain grow
+        auto GetFullPoolCount() const -> uint64_t;
+        auto GetLayoutCount() const -> uint32_t;
+        auto GetLayoutCacheHitCount() const -> uint64_t;
+
+    private:
+        struct FramePools
+        {
+            VkDescriptorPool current = VK_NULL_HANDLE;
+            // Sets allocated from current since it was taken or reset
+            uint32_t currentSetCount = 0;
+            std::vector<VkDescriptorPool> full;
+        };
+
+        struct LayoutBinding
+        {
+            uint32_t binding;
+            VkDescriptorType type;
+            uint32_t count;
+            VkShaderStageFlags stageFlags;
+            // Immutable samplers are part of the layout
+            std::vector<VkSampler> immutableSamplers;
+
+            bool operator==(const LayoutBinding&) const = default;
+        };
+
+        struct LayoutKey
+        {
+            VkDescriptorSetLayoutCreateFlags flags;
+            // Sorted by binding number
+            std::vector<LayoutBinding> bindings;
+
+            bool operator==(const LayoutKey&) const = default;
+        };
+
+        struct LayoutKeyHash
+        {
+            auto operator()(const LayoutKey& key) const -> size_t;
+        };
+
+    private:
+        auto GetPool() -> VkDescriptorPool;
+        auto CreatePool(uint32_t setCount) -> VkDescriptorPool;
+
+    private:
+        bool _valid;
+        const VulkanDeviceTable* _pDevice;
+        CreateInfo _createInfo;
+
+        std::vector<FramePools> _frames;
+        uint32_t _frameIndex;
+        // Reset pools any frame can take
+        std::vector<VkDescriptorPool> _readyPools;
+        uint32_t _setsPerPool;
+        uint32_t _poolCount;
+        uint64_t _fullPoolCount;
+
+        std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> _layouts;
+        uint64_t _layoutCacheHits;
+    };
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace NWA
+{
+    // Submission ordering on timeline semaphores (Vulkan 1.2 or VK_KHR_timeline_semaphore).
+    // Every queue has one timeline and every submission signals its next value, so a point in
+    // the GPU's work is a queue and a value: other queues wait on it, the CPU waits for it and
+    // resources are destroyed once it is reached. Frames in flight are paced on the values the
+    // previous use of the frame slot reached on every queue. Not thread safe.
+    class VulkanFrameScheduler : NonCopyable
+    {
+    public:
+        struct CreateInfo
+        {
+            // A queue index of the scheduler is the position in this list
+            std::vector<VkQueue> queues;
+            uint32_t framesInFlight = 2;
+        };
+
+        struct SyncPoint
+        {
+            uint32_t queueIndex = 0;
+            uint64_t value = 0;
+        };
+
+        struct Wait
+        {
+            SyncPoint point;
+            VkPipelineStageFlags stageMask;
+        };
+
+    public:
+        VulkanFrameScheduler(const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo);
+        // Waits for everything submitted and runs the remaining deletions.
+        ~VulkanFrameScheduler();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Wait until the frame slot's previous frame finished on every queue, then run the
+        // deletions that became safe.
+        auto BeginFrame() -> bool;
+        // Deletions deferred during the frame are keyed on the values submitted up to here.
+        auto EndFrame() -> void;
+        auto GetFrameIndex() const -> uint32_t;
+
+        // Submit command buffers after the waits, signalling the queue's next value.
+        auto Submit(uint32_t queueIndex, std::span<const VkCommandBuffer> commandBuffers, std::span<const Wait> waits = {}) -> std::optional<SyncPoint>;
+        // Reserve the queue's next value for a submission made elsewhere, e.g. the swapchain.
+        // That submission must signal it before the queue is submitted to again.
+        auto Signal(uint32_t queueIndex) -> SyncPoint;
+        // Fulfil a reservation whose submission failed or never happened, otherwise waits on
+        // it (BeginFrame, WaitIdle, the destructor) never return. Waits for the queue to idle,
+        // then signals the value from the host unless the queue already reached it.
+        auto CancelSignal(const SyncPoint& point) -> bool;
+
+        auto IsComplete(const SyncPoint& point) -> bool;
+        auto WaitFor(const SyncPoint& point, uint64_t timeout = UINT64_MAX) -> bool;
+        auto WaitIdle() -> bool;
+
+        // Run once everything submitted up to the end of the current frame is finished.
+        auto Defer(std::function<void()> deleter) -> void;
+        // Run once the point is reached.
+        auto Defer(const SyncPoint& point, std::function<void()> deleter) -> void;
+        // Run the deletions whose values are reached, returns how many ran.
+        auto Collect() -> uint32_t;
+
+        auto GetSemaphore(uint32_t queueIndex) const -> VkSemaphore;
+        // Last value reserved on the queue
+        auto GetSubmittedValue(uint32_t queueIndex) const -> uint64_t;
+        auto GetSubmitCount() const -> uint64_t;
+        auto GetPendingDeletionCount() const -> uint32_t;
+
+    private:
+        struct Timeline
+        {
+            VkQueue queue = VK_NULL_HANDLE;
+            VkSemaphore semaphore = VK_NULL_HANDLE;
+            uint64_t submittedValue = 0;
+            // Last value read back from the semaphore
+            uint64_t completedValue = 0;
+        };
+
+        struct Deletion
+        {
+            // One value per queue, zero when the queue does not matter
+            std::vector<uint64_t> values;
+            std::function<void()> deleter;
+        };
+
+    private:
+        auto RefreshCompletedValues() -> void;
+        auto WaitForValues(const std::vector<uint64_t>& values, uint64_t timeout) -> bool;
+
+    private:
+        bool _valid;
+        const VulkanDeviceTable* _pDevice;
+        uint32_t _framesInFlight;
+
+        std::vector<Timeline> _timelines;
+        // Values submitted on every queue when each frame slot ended
+        std::vector<std::vector<uint64_t>> _frameValues;
+        uint32_t _frameIndex;
+        uint64_t _submitCount;
+
+        std::vector<std::function<void()>> _frameDeletions;
+        std::vector<Deletion> _deletions;
+    };
+}
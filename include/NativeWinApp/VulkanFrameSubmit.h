@@ -0,0 +1,53 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace NWA
+{
+    // Submission of a presented frame, shared by VulkanSwapchain and VulkanPresenter: waits on
+    // the acquire semaphores at color attachment output, signals the present semaphores, plus
+    // the timeline semaphore values added for the frame (uploads, frame scheduler points).
+    class VulkanFrameSubmit : NonCopyable
+    {
+    public:
+        explicit VulkanFrameSubmit(const VulkanDeviceTable& deviceTable);
+
+    public:
+        // Wait on a timeline semaphore value, one wait per semaphore on the highest value.
+        auto AddWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stageMask) -> void;
+        // Signal a timeline semaphore value.
+        auto AddSignalSemaphore(VkSemaphore semaphore, uint64_t value) -> void;
+
+        // Submit the frame's command buffers. The timeline semaphores are consumed on success,
+        // a failed submission keeps them for SubmitEmpty.
+        auto Submit(VkQueue queue, std::span<const VkSemaphore> acquireSemaphores, std::span<const VkCommandBuffer> commandBuffers,
+            std::span<const VkSemaphore> presentSemaphores, VkFence fence) -> VkResult;
+        // Frame abandoned after its images were acquired: consume the acquire semaphores, signal
+        // the timeline values and the fence without any work, so nothing waits on them forever.
+        // When even that submission fails the timeline values are signaled from the host, the
+        // fence is left to the device loss such failures come with.
+        auto SubmitEmpty(VkQueue queue, std::span<const VkSemaphore> acquireSemaphores, VkFence fence) -> bool;
+
+    private:
+        struct TimelineWait
+        {
+            VkSemaphore semaphore;
+            uint64_t value;
+            VkPipelineStageFlags stageMask;
+        };
+
+    private:
+        auto SignalFromHost(VkQueue queue) -> void;
+        auto Clear() -> void;
+
+    private:
+        const VulkanDeviceTable* _pDevice;
+        std::vector<TimelineWait> _timelineWaits;
+        std::vector<VkSemaphore> _timelineSignals;
+        std::vector<uint64_t> _timelineSignalValues;
+    };
+}
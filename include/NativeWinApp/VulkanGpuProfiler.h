@@ -0,0 +1,110 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "GpuZoneRecorder.h"
+#include "Utility.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace NWA
+{
+    // GPU time per zone measured with timestamp queries, one query pool per frame in flight.
+    // A pool is read back when its frame comes around again, without waiting: results not
+    // available yet are dropped, so the profiler never stalls the CPU on the GPU.
+    class VulkanGpuProfiler : NonCopyable
+    {
+    public:
+        using ZoneStats = GpuZoneStats;
+
+        class ScopeZone : NonCopyable
+        {
+        public:
+            ScopeZone(VulkanGpuProfiler& profiler, const char* name)
+                : _profiler(profiler)
+            {
+                _profiler.BeginZone(name);
+            }
+
+            ~ScopeZone()
+            {
+                _profiler.EndZone();
+            }
+
+        private:
+            VulkanGpuProfiler& _profiler;
+        };
+
+    public:
+        // queueFamilyIndex is the family the command buffers are submitted to, latencyFrames
+        // at least the swapchain's frames in flight.
+        VulkanGpuProfiler(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, VkPhysicalDevice physicalDevice,
+            uint32_t queueFamilyIndex, int latencyFrames = 3, int maxZonesPerFrame = 64, int rollingWindow = 120);
+        ~VulkanGpuProfiler();
+
+    public:
+        // False when the queue family has no timestamp support.
+        auto IsValid() const -> bool;
+
+        // Zones of the frame are recorded into this command buffer. BeginFrame resets the
+        // frame's queries so it goes outside of a render pass, EndFrame before the command
+        // buffer is ended.
+        auto BeginFrame(VkCommandBuffer commandBuffer) -> void;
+        auto EndFrame() -> void;
+
+        // Zone name must live until the frame is read back, string literal is expected.
+        auto BeginZone(const char* name) -> void;
+        auto EndZone() -> void;
+
+        // Disabled profiler records nothing, to compare frame times with and without it.
+        auto SetEnabled(bool enable) -> void;
+        auto IsEnabled() const -> bool;
+
+        auto GetZoneStats() const -> std::vector<ZoneStats>;
+        auto GetDroppedFrameCount() const -> uint64_t;
+        // Nanoseconds per timestamp tick
+        auto GetTimestampPeriod() const -> float;
+
+        auto SetTraceEnabled(bool enable, std::size_t maxEvents = 16384) -> void;
+        auto ExportTrace() const -> std::string;
+        auto ExportTrace(const std::string& path) const -> bool;
+
+    private:
+        struct ZoneRecord
+        {
+            const char* name;
+            int depth;
+        };
+
+        struct FrameSlot
+        {
+            VkQueryPool queryPool = VK_NULL_HANDLE;
+            std::vector<ZoneRecord> zones;
+            uint64_t frameIndex = 0;
+            bool pending = false;
+        };
+
+    private:
+        auto ResolveSlot(FrameSlot& slot) -> bool;
+
+    private:
+        bool _valid;
+        bool _enabled;
+        const VulkanDeviceTable* _pDevice;
+        int _maxZonesPerFrame;
+        double _timestampPeriod;
+        uint64_t _timestampMask;
+
+        // Frames in flight
+        std::vector<FrameSlot> _frameSlots;
+        std::size_t _currentSlot;
+        VkCommandBuffer _commandBuffer;
+        uint64_t _frameIndex;
+        uint64_t _droppedFrames;
+        std::vector<int> _zoneStack;
+        std::vector<uint64_t> _queryResults;
+
+        // Results
+        GpuZoneRecorder _recorder;
+    };
+}
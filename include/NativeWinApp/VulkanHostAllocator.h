@@ -0,0 +1,107 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace NWA
+{
+    // VkAllocationCallbacks for the driver's host allocations. Command scope allocations live
+    // only for the duration of a Vulkan command and come from a bump arena, rewound whenever
+    // none of them is alive. Longer scopes go to power of two size class pools, large ones to
+    // the system allocator. Live bytes and counts are tracked per scope, so host allocation
+    // churn shows up in GetStats. Thread safe, the driver calls it from any thread.
+    class VulkanHostAllocator : NonCopyable
+    {
+    public:
+        static constexpr std::size_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+        struct ScopeStats
+        {
+            uint64_t liveBytes;
+            uint64_t liveCount;
+            uint64_t peakBytes;
+            uint64_t totalCount;
+            // Allocations made between the last two EndFrame calls
+            uint64_t frameCount;
+            // Reported through the internal allocation notifications, executable memory
+            uint64_t internalBytes;
+        };
+
+        struct Stats
+        {
+            std::array<ScopeStats, SCOPE_COUNT> scopes;
+            uint64_t arenaCapacity;
+            uint64_t arenaPeakBytes;
+            // Command scope allocations that did not fit in the arena
+            uint64_t arenaOverflowCount;
+            uint64_t poolChunkCount;
+        };
+
+    public:
+        explicit VulkanHostAllocator(std::size_t arenaSize = std::size_t(256) << 10);
+        ~VulkanHostAllocator();
+
+    public:
+        // Stays valid as long as the allocator, which must outlive every object created with it.
+        auto GetCallbacks() const -> const VkAllocationCallbacks*;
+
+        // Frame boundary for the per frame allocation counts.
+        auto EndFrame() -> void;
+        auto GetStats() const -> Stats;
+
+    private:
+        // One pool per size class, 32 bytes to 8 KiB
+        static constexpr std::size_t SIZE_CLASS_COUNT = 9;
+
+        struct Pool
+        {
+            std::mutex mutex;
+            void* pFreeList = nullptr;
+            std::vector<void*> chunks;
+        };
+
+        struct ScopeCounters
+        {
+            std::atomic<uint64_t> liveBytes = 0;
+            std::atomic<uint64_t> liveCount = 0;
+            std::atomic<uint64_t> peakBytes = 0;
+            std::atomic<uint64_t> totalCount = 0;
+            std::atomic<uint64_t> internalBytes = 0;
+            uint64_t frameStartCount = 0;
+            uint64_t frameCount = 0;
+        };
+
+    private:
+        static VKAPI_ATTR void* VKAPI_CALL Allocation(void* pUserData, std::size_t size, std::size_t alignment, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void* VKAPI_CALL Reallocation(void* pUserData, void* pOriginal, std::size_t size, std::size_t alignment, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void VKAPI_CALL Free(void* pUserData, void* pMemory);
+        static VKAPI_ATTR void VKAPI_CALL InternalAllocation(void* pUserData, std::size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void VKAPI_CALL InternalFree(void* pUserData, std::size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+        auto Allocate(std::size_t size, std::size_t alignment, VkSystemAllocationScope scope) -> void*;
+        auto Deallocate(void* pMemory) -> void;
+        auto AllocateFromArena(std::size_t blockSize, std::size_t alignment) -> void*;
+        auto FreeToArena() -> void;
+        auto AllocateFromPool(std::size_t sizeClass) -> void*;
+        auto FreeToPool(std::size_t sizeClass, void* pBlock) -> void;
+
+    private:
+        VkAllocationCallbacks _callbacks;
+
+        // Command scope arena, the live count and the head share one atomic
+        std::vector<std::byte> _arena;
+        std::atomic<uint64_t> _arenaState;
+        std::atomic<uint64_t> _arenaPeak;
+        std::atomic<uint64_t> _arenaOverflows;
+
+        std::array<Pool, SIZE_CLASS_COUNT> _pools;
+        std::atomic<uint64_t> _poolChunks;
+
+        std::array<ScopeCounters, SCOPE_COUNT> _scopes;
+    };
+}
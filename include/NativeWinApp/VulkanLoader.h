@@ -0,0 +1,227 @@
+#pragma once
+
+#include "Vulkan.h"
+
+// Entry points loaded by VulkanLoader: X(function name). The tables must have the same layout
+// in every translation unit, so nothing here depends on platform macros (the platform surface
+// functions are loaded by Vulkan::CreateVulkanSurface).
+
+#define NWA_VK_GLOBAL_FUNCTIONS(X) \
+    X(vkCreateInstance) \
+    X(vkEnumerateInstanceExtensionProperties) \
+    X(vkEnumerateInstanceLayerProperties) \
+    X(vkEnumerateInstanceVersion)
+
+#if defined(VK_KHR_present_wait)
+#   define NWA_VK_DEVICE_FUNCTIONS_PRESENT_WAIT(X) \
+    X(vkWaitForPresentKHR)
+#else
+#   define NWA_VK_DEVICE_FUNCTIONS_PRESENT_WAIT(X)
+#endif
+
+#define NWA_VK_INSTANCE_FUNCTIONS(X) \
+    /* Vulkan 1.0 */ \
+    X(vkDestroyInstance) \
+    X(vkEnumeratePhysicalDevices) \
+    X(vkGetPhysicalDeviceFeatures) \
+    X(vkGetPhysicalDeviceFormatProperties) \
+    X(vkGetPhysicalDeviceImageFormatProperties) \
+    X(vkGetPhysicalDeviceProperties) \
+    X(vkGetPhysicalDeviceQueueFamilyProperties) \
+    X(vkGetPhysicalDeviceMemoryProperties) \
+    X(vkGetDeviceProcAddr) \
+    X(vkCreateDevice) \
+    X(vkEnumerateDeviceExtensionProperties) \
+    X(vkEnumerateDeviceLayerProperties) \
+    /* Vulkan 1.1 */ \
+    X(vkGetPhysicalDeviceFeatures2) \
+    X(vkGetPhysicalDeviceProperties2) \
+    X(vkGetPhysicalDeviceMemoryProperties2) \
+    /* VK_KHR_surface */ \
+    X(vkDestroySurfaceKHR) \
+    X(vkGetPhysicalDeviceSurfaceSupportKHR) \
+    X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+    X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+    X(vkGetPhysicalDeviceSurfacePresentModesKHR) \
+    /* VK_EXT_debug_utils */ \
+    X(vkCreateDebugUtilsMessengerEXT) \
+    X(vkDestroyDebugUtilsMessengerEXT) \
+    X(vkSubmitDebugUtilsMessageEXT)
+
+#define NWA_VK_DEVICE_FUNCTIONS(X) \
+    /* Vulkan 1.0 */ \
+    X(vkDestroyDevice) \
+    X(vkGetDeviceQueue) \
+    X(vkQueueSubmit) \
+    X(vkQueueWaitIdle) \
+    X(vkDeviceWaitIdle) \
+    X(vkAllocateMemory) \
+    X(vkFreeMemory) \
+    X(vkMapMemory) \
+    X(vkUnmapMemory) \
+    X(vkFlushMappedMemoryRanges) \
+    X(vkInvalidateMappedMemoryRanges) \
+    X(vkBindBufferMemory) \
+    X(vkBindImageMemory) \
+    X(vkGetBufferMemoryRequirements) \
+    X(vkGetImageMemoryRequirements) \
+    X(vkCreateFence) \
+    X(vkDestroyFence) \
+    X(vkResetFences) \
+    X(vkGetFenceStatus) \
+    X(vkWaitForFences) \
+    X(vkCreateSemaphore) \
+    X(vkDestroySemaphore) \
+    X(vkCreateEvent) \
+    X(vkDestroyEvent) \
+    X(vkGetEventStatus) \
+    X(vkSetEvent) \
+    X(vkResetEvent) \
+    X(vkCreateQueryPool) \
+    X(vkDestroyQueryPool) \
+    X(vkGetQueryPoolResults) \
+    X(vkCreateBuffer) \
+    X(vkDestroyBuffer) \
+    X(vkCreateBufferView) \
+    X(vkDestroyBufferView) \
+    X(vkCreateImage) \
+    X(vkDestroyImage) \
+    X(vkGetImageSubresourceLayout) \
+    X(vkCreateImageView) \
+    X(vkDestroyImageView) \
+    X(vkCreateShaderModule) \
+    X(vkDestroyShaderModule) \
+    X(vkCreatePipelineCache) \
+    X(vkDestroyPipelineCache) \
+    X(vkGetPipelineCacheData) \
+    X(vkMergePipelineCaches) \
+    X(vkCreateGraphicsPipelines) \
+    X(vkCreateComputePipelines) \
+    X(vkDestroyPipeline) \
+    X(vkCreatePipelineLayout) \
+    X(vkDestroyPipelineLayout) \
+    X(vkCreateSampler) \
+    X(vkDestroySampler) \
+    X(vkCreateDescriptorSetLayout) \
+    X(vkDestroyDescriptorSetLayout) \
+    X(vkCreateDescriptorPool) \
+    X(vkDestroyDescriptorPool) \
+    X(vkResetDescriptorPool) \
+    X(vkAllocateDescriptorSets) \
+    X(vkFreeDescriptorSets) \
+    X(vkUpdateDescriptorSets) \
+    X(vkCreateFramebuffer) \
+    X(vkDestroyFramebuffer) \
+    X(vkCreateRenderPass) \
+    X(vkDestroyRenderPass) \
+    X(vkCreateCommandPool) \
+    X(vkDestroyCommandPool) \
+    X(vkResetCommandPool) \
+    X(vkAllocateCommandBuffers) \
+    X(vkFreeCommandBuffers) \
+    X(vkBeginCommandBuffer) \
+    X(vkEndCommandBuffer) \
+    X(vkResetCommandBuffer) \
+    X(vkCmdBindPipeline) \
+    X(vkCmdSetViewport) \
+    X(vkCmdSetScissor) \
+    X(vkCmdSetLineWidth) \
+    X(vkCmdSetDepthBias) \
+    X(vkCmdSetBlendConstants) \
+    X(vkCmdSetStencilReference) \
+    X(vkCmdBindDescriptorSets) \
+    X(vkCmdBindIndexBuffer) \
+    X(vkCmdBindVertexBuffers) \
+    X(vkCmdDraw) \
+    X(vkCmdDrawIndexed) \
+    X(vkCmdDrawIndirect) \
+    X(vkCmdDrawIndexedIndirect) \
+    X(vkCmdDispatch) \
+    X(vkCmdDispatchIndirect) \
+    X(vkCmdCopyBuffer) \
+    X(vkCmdCopyImage) \
+    X(vkCmdBlitImage) \
+    X(vkCmdCopyBufferToImage) \
+    X(vkCmdCopyImageToBuffer) \
+    X(vkCmdUpdateBuffer) \
+    X(vkCmdFillBuffer) \
+    X(vkCmdClearColorImage) \
+    X(vkCmdClearDepthStencilImage) \
+    X(vkCmdClearAttachments) \
+    X(vkCmdResolveImage) \
+    X(vkCmdSetEvent) \
+    X(vkCmdResetEvent) \
+    X(vkCmdWaitEvents) \
+    X(vkCmdPipelineBarrier) \
+    X(vkCmdBeginQuery) \
+    X(vkCmdEndQuery) \
+    X(vkCmdResetQueryPool) \
+    X(vkCmdWriteTimestamp) \
+    X(vkCmdCopyQueryPoolResults) \
+    X(vkCmdPushConstants) \
+    X(vkCmdBeginRenderPass) \
+    X(vkCmdNextSubpass) \
+    X(vkCmdEndRenderPass) \
+    X(vkCmdExecuteCommands) \
+    /* Vulkan 1.1 */ \
+    X(vkGetBufferMemoryRequirements2) \
+    X(vkGetImageMemoryRequirements2) \
+    X(vkTrimCommandPool) \
+    /* Vulkan 1.2, VK_KHR_timeline_semaphore, VK_EXT_host_query_reset */ \
+    X(vkGetSemaphoreCounterValue) \
+    X(vkWaitSemaphores) \
+    X(vkSignalSemaphore) \
+    X(vkResetQueryPool) \
+    /* VK_KHR_swapchain */ \
+    X(vkCreateSwapchainKHR) \
+    X(vkDestroySwapchainKHR) \
+    X(vkGetSwapchainImagesKHR) \
+    X(vkAcquireNextImageKHR) \
+    X(vkQueuePresentKHR) \
+    /* VK_KHR_present_wait */ \
+    NWA_VK_DEVICE_FUNCTIONS_PRESENT_WAIT(X)
+
+namespace NWA
+{
+    struct VulkanGlobalTable
+    {
+#define NWA_VK_DECLARE_FUNCTION(name) PFN_##name name = nullptr;
+        NWA_VK_GLOBAL_FUNCTIONS(NWA_VK_DECLARE_FUNCTION)
+#undef NWA_VK_DECLARE_FUNCTION
+    };
+
+    struct VulkanInstanceTable
+    {
+        VkInstance instance = VK_NULL_HANDLE;
+
+#define NWA_VK_DECLARE_FUNCTION(name) PFN_##name name = nullptr;
+        NWA_VK_INSTANCE_FUNCTIONS(NWA_VK_DECLARE_FUNCTION)
+#undef NWA_VK_DECLARE_FUNCTION
+    };
+
+    // Device level functions fetched with vkGetDeviceProcAddr, which call straight
+    // into the driver instead of going through loader trampolines.
+    struct VulkanDeviceTable
+    {
+        VkDevice device = VK_NULL_HANDLE;
+
+#define NWA_VK_DECLARE_FUNCTION(name) PFN_##name name = nullptr;
+        NWA_VK_DEVICE_FUNCTIONS(NWA_VK_DECLARE_FUNCTION)
+#undef NWA_VK_DECLARE_FUNCTION
+    };
+
+    // Loads vulkan-1.dll (libvulkan.so.1 on Linux) at runtime, nothing links against the loader.
+    class VulkanLoader
+    {
+    public:
+        VulkanLoader() = delete;
+
+    public:
+        static bool Initialize();
+        static PFN_vkGetInstanceProcAddr GetInstanceProcAddr();
+        static const VulkanGlobalTable& GetGlobalTable();
+
+        static bool LoadInstanceTable(VkInstance instance, VulkanInstanceTable& table);
+        static bool LoadDeviceTable(const VulkanInstanceTable& instanceTable, VkDevice device, VulkanDeviceTable& table);
+    };
+}
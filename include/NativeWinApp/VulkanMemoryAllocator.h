@@ -0,0 +1,195 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace NWA
+{
+    struct VulkanMemoryBlock;
+    class VulkanMemoryAllocator;
+
+    enum class VulkanMemoryUsage: int
+    {
+        // Device local, never mapped
+        GpuOnly,
+        // Host visible and coherent, written by the CPU (uniforms, staging)
+        CpuToGpu,
+        // Host visible, cached when possible, read back by the CPU
+        GpuToCpu,
+    };
+
+    struct VulkanAllocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        // Null unless the memory is host visible
+        void* pMapped = nullptr;
+        // Handed back to the defragmentation callback
+        void* pUserData = nullptr;
+
+        // Owned by the allocator, null for arena allocations
+        VulkanMemoryBlock* pBlock = nullptr;
+        uint32_t node = 0;
+    };
+
+    // Bump allocator over one device memory allocation, for resources living a single frame.
+    // Nothing is freed individually: Reset once the GPU is done with the frame.
+    class VulkanMemoryArena : NonCopyable
+    {
+    public:
+        ~VulkanMemoryArena();
+
+    public:
+        // Linear for buffers and linear images, adjacent resources of different kinds are kept
+        // bufferImageGranularity apart.
+        auto Allocate(const VkMemoryRequirements& requirements, bool linear = true) -> std::optional<VulkanAllocation>;
+        auto Reset() -> void;
+
+        auto GetMemoryTypeIndex() const -> uint32_t;
+        auto GetCapacity() const -> VkDeviceSize;
+        auto GetUsedBytes() const -> VkDeviceSize;
+        // Highest usage since creation, to size the arena
+        auto GetPeakBytes() const -> VkDeviceSize;
+
+    private:
+        friend class VulkanMemoryAllocator;
+        VulkanMemoryArena(VulkanMemoryAllocator& allocator, const VulkanAllocation& allocation, VkDeviceSize granularity);
+
+    private:
+        VulkanMemoryAllocator* _pAllocator;
+        VulkanAllocation _allocation;
+        VkDeviceSize _granularity;
+        VkDeviceSize _head;
+        VkDeviceSize _peak;
+        bool _lastLinear;
+    };
+
+    // Device memory sub-allocator. Every memory type has block pools sub-allocated with TLSF
+    // (two level segregated fit, constant time allocate and free with immediate coalescing),
+    // so the driver sees a handful of vkAllocateMemory calls instead of one per resource.
+    // Buffers and optimal images use separate pools when the device has a buffer-image
+    // granularity, large requests get dedicated memory. Host visible blocks stay mapped.
+    class VulkanMemoryAllocator : NonCopyable
+    {
+    public:
+        struct CreateInfo
+        {
+            VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+            // Blocks are smaller on heaps under 8 times this size. Requests above half a
+            // block get their own device memory.
+            VkDeviceSize blockSize = VkDeviceSize(64) << 20;
+        };
+
+        struct AllocationInfo
+        {
+            VulkanMemoryUsage usage = VulkanMemoryUsage::GpuOnly;
+            // Buffers and linear images, false for optimal images. Set by CreateBuffer and CreateImage.
+            bool linear = true;
+            // Own device memory, for large render targets that live as long as the swapchain
+            bool dedicated = false;
+            void* pUserData = nullptr;
+        };
+
+        struct Stats
+        {
+            uint64_t blockCount;
+            uint64_t dedicatedCount;
+            uint64_t allocationCount;
+            // Device memory taken from the driver, and the part of it in use
+            VkDeviceSize reservedBytes;
+            VkDeviceSize usedBytes;
+            // Free space of the blocks
+            uint64_t freeRangeCount;
+            VkDeviceSize largestFreeRange;
+            // 0 when the free space of every block is one range, close to 1 when scattered
+            float fragmentation;
+            uint64_t deviceAllocationCount;
+        };
+
+        // Called by Defragment for every allocation it moves. Copy the contents, bind the
+        // resource to the new allocation and return true, or return false to keep the old one.
+        using MoveCallback = std::function<bool(const VulkanAllocation& from, const VulkanAllocation& to)>;
+
+    public:
+        VulkanMemoryAllocator(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo);
+        ~VulkanMemoryAllocator();
+
+    public:
+        auto IsValid() const -> bool;
+
+        auto Allocate(const VkMemoryRequirements& requirements, const AllocationInfo& allocationInfo) -> std::optional<VulkanAllocation>;
+        auto Free(const VulkanAllocation& allocation) -> void;
+
+        // Create the resource, allocate its memory and bind it.
+        auto CreateBuffer(const VkBufferCreateInfo& createInfo, const AllocationInfo& allocationInfo, VkBuffer& buffer) -> std::optional<VulkanAllocation>;
+        auto DestroyBuffer(VkBuffer buffer, const VulkanAllocation& allocation) -> void;
+        auto CreateImage(const VkImageCreateInfo& createInfo, const AllocationInfo& allocationInfo, VkImage& image) -> std::optional<VulkanAllocation>;
+        auto DestroyImage(VkImage image, const VulkanAllocation& allocation) -> void;
+
+        // memoryTypeBits comes from the requirements of the resources placed in the arena.
+        auto CreateArena(VkDeviceSize size, uint32_t memoryTypeBits, VulkanMemoryUsage usage) -> std::unique_ptr<VulkanMemoryArena>;
+
+        // No-op on coherent memory.
+        auto Flush(const VulkanAllocation& allocation) const -> void;
+        auto Invalidate(const VulkanAllocation& allocation) const -> void;
+
+        // Move allocations out of the emptiest blocks into the fuller ones of the same pool,
+        // then release the blocks left empty. Returns the number of bytes moved.
+        auto Defragment(const MoveCallback& move, VkDeviceSize maxBytesToMove = ~VkDeviceSize(0)) -> VkDeviceSize;
+
+        auto FindMemoryType(uint32_t memoryTypeBits, VulkanMemoryUsage usage) const -> std::optional<uint32_t>;
+        auto GetStats() const -> Stats;
+        // Device memory taken from the driver on the heap, blocks included whole
+        auto GetHeapReservedBytes(uint32_t heapIndex) const -> VkDeviceSize;
+
+    private:
+        using BlockList = std::vector<std::unique_ptr<VulkanMemoryBlock>>;
+
+        struct PendingMove
+        {
+            VulkanAllocation from;
+            VulkanAllocation to;
+        };
+
+    private:
+        auto GetMemoryTypeCandidates(uint32_t memoryTypeBits, VulkanMemoryUsage usage) const -> std::vector<uint32_t>;
+        auto GetPoolIndex(uint32_t memoryTypeIndex, bool linear) const -> std::size_t;
+        auto AllocateFromPool(uint32_t memoryTypeIndex, bool linear, const VkMemoryRequirements& requirements, void* pUserData) -> std::optional<VulkanAllocation>;
+        auto AllocateFromBlock(VulkanMemoryBlock& block, const VkMemoryRequirements& requirements, void* pUserData) -> std::optional<VulkanAllocation>;
+        auto AllocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size, void* pUserData) -> std::optional<VulkanAllocation>;
+        auto CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated) -> std::unique_ptr<VulkanMemoryBlock>;
+        auto DestroyBlock(VulkanMemoryBlock& block) -> void;
+        auto FreeLocked(const VulkanAllocation& allocation) -> void;
+        auto ReleaseEmptyBlocks(BlockList& blocks) -> void;
+        auto FlushOrInvalidate(const VulkanAllocation& allocation, bool flush) const -> void;
+
+    private:
+        bool _valid;
+        const VulkanDeviceTable* _pDevice;
+        VkPhysicalDeviceMemoryProperties _memoryProperties;
+        VkDeviceSize _bufferImageGranularity;
+        VkDeviceSize _nonCoherentAtomSize;
+        uint32_t _maxAllocationCount;
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> _heapBlockSizes;
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> _heapReservedBytes;
+
+        mutable std::mutex _mutex;
+        // Two pools per memory type, linear and optimal resources
+        std::vector<BlockList> _pools;
+        BlockList _dedicatedBlocks;
+
+        uint64_t _allocationCount;
+        VkDeviceSize _usedBytes;
+        uint64_t _deviceAllocationCount;
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace NWA
+{
+    class VulkanMemoryAllocator;
+
+    enum class VulkanMemoryPressure: int
+    {
+        Normal,
+        // Above the warning ratio, streaming should stop growing
+        Warning,
+        // Above the critical ratio, streaming should release memory
+        Critical,
+    };
+
+    // Per heap usage against budget, polled once per frame. With VK_EXT_memory_budget enabled on
+    // the device the numbers come from the driver and cover the whole process; without it the
+    // budget is the heap size and the usage is what the allocator took from the driver, so other
+    // allocations of the process are invisible. Callbacks run from Update when a heap changes
+    // pressure level, a level is only left once the ratio drops the hysteresis below it.
+    // Not thread safe.
+    class VulkanMemoryMonitor : NonCopyable
+    {
+    public:
+        struct CreateInfo
+        {
+            VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+            // VK_EXT_memory_budget is enabled on the device
+            bool memoryBudget = false;
+            // Usage source when memoryBudget is false
+            const VulkanMemoryAllocator* pAllocator = nullptr;
+
+            float warningRatio = 0.8f;
+            float criticalRatio = 0.95f;
+            float hysteresis = 0.05f;
+        };
+
+        struct HeapBudget
+        {
+            VkMemoryHeapFlags flags;
+            VkDeviceSize size;
+            VkDeviceSize usage;
+            VkDeviceSize budget;
+            // usage / budget, may go above 1
+            float ratio;
+            VulkanMemoryPressure pressure;
+        };
+
+        struct PressureEvent
+        {
+            uint32_t heapIndex;
+            VulkanMemoryPressure previous;
+            HeapBudget heap;
+        };
+
+    public:
+        VulkanMemoryMonitor(const VulkanInstanceTable& instanceTable, const CreateInfo& createInfo);
+
+    public:
+        auto IsValid() const -> bool;
+        auto IsBudgetSupported() const -> bool;
+
+        // Read the budget of every heap and fire the callbacks of the heaps that changed level.
+        auto Update() -> void;
+        auto GetUpdateCount() const -> uint64_t;
+
+        auto GetHeaps() const -> std::span<const HeapBudget>;
+        // Highest level of the device local heaps
+        auto GetPressure() const -> VulkanMemoryPressure;
+
+        auto AddPressureCallback(const std::function<void(const PressureEvent&)>& f) -> int;
+        auto RemovePressureCallback(int callbackId) -> void;
+
+    private:
+        struct PressureCallback
+        {
+            int id;
+            std::function<void(const PressureEvent&)> func;
+        };
+
+    private:
+        auto GetLevel(float ratio, VulkanMemoryPressure current) const -> VulkanMemoryPressure;
+
+    private:
+        bool _valid;
+        const VulkanInstanceTable* _pInstance;
+        CreateInfo _createInfo;
+        uint64_t _updateCount;
+
+        std::vector<HeapBudget> _heaps;
+
+        std::vector<PressureCallback> _pressureCallbacks;
+        int _nextPressureCallbackId;
+    };
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace NWA
+{
+    // Pipeline cache persisted on disk. The file is memory mapped and handed to the driver as
+    // initial data when its header matches the device (vendor, device id, cache UUID), so a warm
+    // start skips compiling SPIR-V again. Save merges the per-thread caches into the main one
+    // and replaces the file through a rename, a crash never leaves a truncated cache behind.
+    class VulkanPipelineCache : NonCopyable
+    {
+    public:
+        VulkanPipelineCache(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, VkPhysicalDevice physicalDevice, const std::string& path);
+        ~VulkanPipelineCache();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Cache seeded from disk, use it from one thread at a time.
+        auto GetCache() const -> VkPipelineCache;
+
+        // Cache owned by the calling thread, pipeline creation on several threads does not
+        // contend on the driver's cache lock. Merged into the main cache on Save.
+        auto GetThreadCache() -> VkPipelineCache;
+
+        // Whether the file existed and matched the device.
+        auto IsLoadedFromDisk() const -> bool;
+        auto GetLoadedSize() const -> std::size_t;
+
+        // Also called on destruction.
+        auto Save() -> bool;
+
+    private:
+        auto ValidateHeader(const void* pData, std::size_t size) const -> bool;
+        auto MergeThreadCaches() -> bool;
+
+    private:
+        bool _valid;
+        const VulkanDeviceTable* _pDevice;
+        VkPhysicalDeviceProperties _deviceProperties;
+        std::string _path;
+
+        VkPipelineCache _cache;
+        bool _loadedFromDisk;
+        std::size_t _loadedSize;
+
+        std::mutex _threadCacheMutex;
+        std::unordered_map<std::thread::id, VkPipelineCache> _threadCaches;
+    };
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <vector>
+#include <deque>
+
+namespace NWA
+{
+    class VulkanPipelineCache;
+
+    enum class VulkanCompilePriority: int
+    {
+        // Needed by the next frame
+        High,
+        Normal,
+        // Variants that may be needed later
+        Background,
+    };
+
+    // Worker pool building shader modules and pipelines off the render thread. Every worker
+    // compiles into its own cache of the VulkanPipelineCache, merged back when it is saved.
+    // Jobs are taken highest priority first and in submission order within a priority, so
+    // the first frame's pipelines never queue behind background variants.
+    class VulkanPipelineCompiler : NonCopyable
+    {
+    public:
+        struct ShaderStage
+        {
+            VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+
+            // Existing module, or SPIR-V built into a module on the worker and destroyed
+            // once the pipeline is created
+            VkShaderModule module = VK_NULL_HANDLE;
+            const uint32_t* pCode = nullptr;
+            std::size_t codeSize = 0;
+
+            const char* pEntryName = "main";
+            const VkSpecializationInfo* pSpecializationInfo = nullptr;
+        };
+
+        // Everything createInfo and the stages point to must stay alive until the future
+        // is ready. Stages of createInfo are filled from stages.
+        struct GraphicsPipelineDesc
+        {
+            std::vector<ShaderStage> stages;
+            VkGraphicsPipelineCreateInfo createInfo {};
+        };
+
+        struct ComputePipelineDesc
+        {
+            ShaderStage stage;
+            VkComputePipelineCreateInfo createInfo {};
+        };
+
+    public:
+        // The pipeline cache is optional and must outlive the compiler. Zero workers picks
+        // one less than the hardware threads, leaving one for the render thread.
+        VulkanPipelineCompiler(const VulkanDeviceTable& deviceTable, VulkanPipelineCache* pPipelineCache, uint32_t workerCount = 0);
+        ~VulkanPipelineCompiler();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Futures hold VK_NULL_HANDLE when creation failed or the compiler was destroyed
+        // before the job ran.
+        auto CompileShaderModule(const uint32_t* pCode, std::size_t codeSize, VulkanCompilePriority priority = VulkanCompilePriority::Normal) -> std::future<VkShaderModule>;
+        auto CompileGraphics(const GraphicsPipelineDesc& desc, VulkanCompilePriority priority = VulkanCompilePriority::Normal) -> std::future<VkPipeline>;
+        auto CompileCompute(const ComputePipelineDesc& desc, VulkanCompilePriority priority = VulkanCompilePriority::Normal) -> std::future<VkPipeline>;
+
+        // Batches are queued under one lock, futures are in the order of the descriptions.
+        auto CompileGraphics(const std::vector<GraphicsPipelineDesc>& descs, VulkanCompilePriority priority = VulkanCompilePriority::Normal) -> std::vector<std::future<VkPipeline>>;
+        auto CompileCompute(const std::vector<ComputePipelineDesc>& descs, VulkanCompilePriority priority = VulkanCompilePriority::Normal) -> std::vector<std::future<VkPipeline>>;
+
+        // Wait until every queued job is done.
+        auto WaitIdle() -> void;
+
+        auto GetPendingCount() const -> std::size_t;
+        auto GetWorkerCount() const -> uint32_t;
+
+    private:
+        struct Job
+        {
+            std::function<void(VkPipelineCache)> run;
+            // Fulfills the future with a null handle when the job never runs
+            std::function<void()> cancel;
+        };
+
+        static constexpr std::size_t PRIORITY_COUNT = 3;
+
+    private:
+        auto WorkerLoop() -> void;
+        auto Enqueue(Job&& job, VulkanCompilePriority priority) -> void;
+        auto MakeGraphicsJob(const GraphicsPipelineDesc& desc) -> std::pair<Job, std::future<VkPipeline>>;
+        auto MakeComputeJob(const ComputePipelineDesc& desc) -> std::pair<Job, std::future<VkPipeline>>;
+        auto CreateShaderModule(const uint32_t* pCode, std::size_t codeSize) const -> VkShaderModule;
+        auto CreateStages(const ShaderStage* pStages, std::size_t stageCount, std::vector<VkPipelineShaderStageCreateInfo>& stageInfos, std::vector<VkShaderModule>& ownedModules) const -> bool;
+        auto DestroyModules(const std::vector<VkShaderModule>& modules) const -> void;
+        auto BuildGraphics(const GraphicsPipelineDesc& desc, VkPipelineCache cache) const -> VkPipeline;
+        auto BuildCompute(const ComputePipelineDesc& desc, VkPipelineCache cache) const -> VkPipeline;
+
+    private:
+        bool _valid;
+        const VulkanDeviceTable* _pDevice;
+        VulkanPipelineCache* _pPipelineCache;
+
+        // Workers
+        std::vector<std::thread> _workers;
+        mutable std::mutex _queueMutex;
+        std::condition_variable _queueCondition;
+        std::condition_variable _idleCondition;
+        std::array<std::deque<Job>, PRIORITY_COUNT> _queues;
+        std::size_t _runningJobs;
+        bool _stopWorkers;
+    };
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "VulkanCommandContext.h"
+#include "VulkanFrameSubmit.h"
+#include "VulkanSurfaceSwapchain.h"
+#include "Utility.h"
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace NWA
+{
+    class FramePacer;
+
+    // Swapchains of several surfaces (editor viewports, windows) on one device and queue. A
+    // frame acquires an image of every view, records the views in parallel, one command buffer
+    // each, submits them all at once and presents every swapchain with one vkQueuePresentKHR.
+    // Frame slots (fence, command pools) are shared, views only own their swapchain, images and
+    // acquire semaphores. Views whose surface has no area or cannot be acquired sit the frame
+    // out. Recreation retires the old swapchain like VulkanSwapchain. All views share the render
+    // pass, so their surfaces must support the preferred format. No present timing.
+    class VulkanPresenter : NonCopyable
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct CreateInfo
+        {
+            VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+            // Queue used for both rendering and presentation
+            VkQueue queue = VK_NULL_HANDLE;
+            uint32_t queueFamilyIndex = 0;
+
+            uint32_t framesInFlight = 2;
+            // Recording threads including the one calling Record
+            uint32_t threadCount = 1;
+
+            VulkanPresentMode presentMode = VulkanPresentMode::Fifo;
+            VkSurfaceFormatKHR preferredFormat = { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+            VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+            // Resize bursts recreate a view at most once per interval
+            std::chrono::milliseconds recreateDebounce = std::chrono::milliseconds(50);
+
+            // Waited on right before every vkQueuePresentKHR, must outlive the presenter
+            FramePacer* pFramePacer = nullptr;
+        };
+
+        struct ViewFrame
+        {
+            uint32_t viewId;
+            uint32_t imageIndex;
+            // Begun for one submission, ended by the presenter
+            VkCommandBuffer commandBuffer;
+            VkImage image;
+            VkImageView imageView;
+            // Null until SetRenderPass is called
+            VkFramebuffer framebuffer;
+            VkExtent2D extent;
+        };
+
+        // Called once per acquired view, from the recording threads. Views of a frame are
+        // recorded concurrently, the callback must not touch state shared between them.
+        using RecordCallback = std::function<void(const ViewFrame& view, uint32_t threadIndex)>;
+
+    public:
+        VulkanPresenter(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo);
+        ~VulkanPresenter();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // The surface must outlive its view. Width and height are used when the surface lets the
+        // application pick the extent (e.g. headless). Nullopt when the queue cannot present to it.
+        auto AddView(VkSurfaceKHR surface, uint32_t width = 0, uint32_t height = 0) -> std::optional<uint32_t>;
+        // Waits for the queue, removing a view is rare. Not between BeginFrame and EndFrame.
+        auto RemoveView(uint32_t viewId) -> void;
+
+        // Follow the window size, like VulkanSwapchain::Attach.
+        auto AttachView(uint32_t viewId, Window& window) -> void;
+        auto DetachView(uint32_t viewId) -> void;
+        auto ResizeView(uint32_t viewId, uint32_t width, uint32_t height) -> void;
+
+        // One framebuffer per swapchain image of every view, kept in sync across recreation.
+        auto SetRenderPass(VkRenderPass renderPass) -> bool;
+        // Null stops pacing.
+        auto SetFramePacer(FramePacer* pFramePacer) -> void;
+
+        // Wait for the frame slot and acquire an image of every view. Returns how many views
+        // take part in the frame, Record and EndFrame do nothing when none does.
+        auto BeginFrame() -> uint32_t;
+        // Record every acquired view, spread over the recording threads.
+        auto Record(const RecordCallback& record) -> bool;
+        // Submit the command buffers of every view at once, then present every swapchain.
+        auto EndFrame() -> bool;
+
+        // Make the next EndFrame submission wait on / signal a timeline semaphore value.
+        auto AddWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stageMask) -> void;
+        auto AddSignalSemaphore(VkSemaphore semaphore, uint64_t value) -> void;
+
+        // Wait until every frame in flight is finished on the GPU.
+        auto WaitIdle() const -> void;
+
+        auto GetViewCount() const -> uint32_t;
+        auto GetViewExtent(uint32_t viewId) const -> VkExtent2D;
+        auto GetViewFormat(uint32_t viewId) const -> VkSurfaceFormatKHR;
+        auto GetFramesInFlight() const -> uint32_t;
+        auto GetThreadCount() const -> uint32_t;
+        auto GetRecreateCount() const -> uint64_t;
+        // Old swapchains waiting for their frames to retire
+        auto GetRetiredSwapchainCount() const -> uint32_t;
+
+    private:
+        struct View
+        {
+            uint32_t id = 0;
+            // Swapchain, images and retired swapchains of the surface
+            std::unique_ptr<VulkanSurfaceSwapchain> pSwapchain;
+            // One per frame slot
+            std::vector<VkSemaphore> imageAvailable;
+
+            Window* pWindow = nullptr;
+            int eventCallbackId = -1;
+        };
+
+        struct FrameSlot
+        {
+            VkFence inFlightFence = VK_NULL_HANDLE;
+            uint64_t submitSerial = 0;
+        };
+
+    private:
+        auto FindView(uint32_t viewId) const -> View*;
+        auto AcquireView(View& view, uint32_t& imageIndex) -> bool;
+        auto CollectRetired() -> void;
+        auto AbandonFrame(FrameSlot& slot, uint32_t frameIndex, const std::vector<View*>& frameViews) -> void;
+        auto DestroyView(View& view) -> void;
+        auto RecordViews(uint32_t threadIndex) -> void;
+        auto WorkerThread(uint32_t threadIndex) -> void;
+
+    private:
+        bool _valid;
+        const VulkanInstanceTable* _pInstance;
+        const VulkanDeviceTable* _pDevice;
+        CreateInfo _createInfo;
+        VulkanCommandContext _commandContext;
+
+        std::vector<std::unique_ptr<View>> _views;
+        uint32_t _nextViewId;
+        VkRenderPass _renderPass;
+
+        // Frames in flight
+        std::vector<FrameSlot> _frameSlots;
+        uint32_t _frameIndex;
+        uint64_t _submitSerial;
+        uint64_t _completedSerial;
+        VulkanFrameSubmit _frameSubmit;
+
+        // Views acquired by BeginFrame, in view order, and their recorded command buffers
+        std::vector<View*> _frameViews;
+        std::vector<ViewFrame> _viewFrames;
+        std::vector<VkCommandBuffer> _commandBuffers;
+
+        // Recording workers, thread index 0 is the caller of Record
+        std::vector<std::thread> _workers;
+        std::mutex _workerMutex;
+        std::condition_variable _workerCondition;
+        std::condition_variable _doneCondition;
+        const RecordCallback* _pRecord;
+        uint64_t _recordGeneration;
+        uint32_t _busyWorkers;
+        std::atomic<uint32_t> _nextFrameView;
+        std::atomic<bool> _recordFailed;
+        bool _stopWorkers;
+    };
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace NWA
+{
+    // One shader of a header generated by nwa_embed_shaders (cmake/NwaEmbedShaders.cmake).
+    struct VulkanShaderBlob
+    {
+        std::string_view name;
+        // Execution models of the entry points
+        VkShaderStageFlags stages;
+        // Stored bytes, 4 byte aligned
+        const uint8_t* pData;
+        uint32_t dataSize;
+        // SPIR-V bytes once decompressed
+        uint32_t codeSize;
+        // LZ compressed, stored as is otherwise
+        bool compressed;
+    };
+
+    // Hands out the SPIR-V of embedded shader blobs. Compressed blobs are decompressed on first
+    // use into memory owned by the library, uncompressed ones are returned in place. Thread safe.
+    class VulkanShaderLibrary : NonCopyable
+    {
+    public:
+        // The blobs must outlive the library, generated headers keep them in static storage.
+        explicit VulkanShaderLibrary(std::span<const VulkanShaderBlob> blobs);
+
+    public:
+        auto GetBlobCount() const -> uint32_t;
+        auto GetBlob(uint32_t index) const -> const VulkanShaderBlob&;
+        auto Find(std::string_view name) const -> std::optional<uint32_t>;
+
+        // Empty when the index is out of range or the blob is corrupt.
+        auto GetCode(uint32_t index) -> std::span<const uint32_t>;
+
+        // Embedded bytes of every blob, and bytes decompressed so far
+        auto GetStoredBytes() const -> uint64_t;
+        auto GetResidentBytes() const -> uint64_t;
+
+        // LZ block as written by the embedding tool, false unless it fills the destination exactly.
+        static auto Decompress(std::span<const uint8_t> source, std::span<uint8_t> destination) -> bool;
+
+    private:
+        struct Entry
+        {
+            std::once_flag once;
+            std::unique_ptr<uint32_t[]> pCode;
+            uint32_t wordCount = 0;
+        };
+
+    private:
+        std::span<const VulkanShaderBlob> _blobs;
+        std::unique_ptr<Entry[]> _entries;
+        std::atomic<uint64_t> _residentBytes;
+    };
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "Utility.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace NWA
+{
+    // Surface queries of one physical device and surface. Formats and present modes do not
+    // change over the surface's life and are enumerated once, only the capabilities (current
+    // extent, transform) are queried again on resize. Spans stay valid until the next Refresh.
+    class VulkanSurfaceCache : NonCopyable
+    {
+    public:
+        VulkanSurfaceCache(const VulkanInstanceTable& instanceTable, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Capabilities only, what a swapchain recreation needs.
+        auto RefreshCapabilities() -> bool;
+        // Everything, after the surface moved to another display or was lost.
+        auto Refresh() -> bool;
+
+        auto GetCapabilities() const -> const VkSurfaceCapabilitiesKHR&;
+        auto GetFormats() const -> std::span<const VkSurfaceFormatKHR>;
+        auto GetPresentModes() const -> std::span<const VkPresentModeKHR>;
+        auto SupportsPresentMode(VkPresentModeKHR presentMode) const -> bool;
+
+        // Driver queries issued so far
+        auto GetQueryCount() const -> uint64_t;
+
+    private:
+        bool _valid;
+        const VulkanInstanceTable* _pInstance;
+        VkPhysicalDevice _physicalDevice;
+        VkSurfaceKHR _surface;
+
+        VkSurfaceCapabilitiesKHR _capabilities;
+        std::vector<VkSurfaceFormatKHR> _formats;
+        std::vector<VkPresentModeKHR> _presentModes;
+        uint64_t _queryCount;
+    };
+}
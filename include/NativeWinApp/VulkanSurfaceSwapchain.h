@@ -0,0 +1,145 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "VulkanSurfaceCache.h"
+#include "Utility.h"
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace NWA
+{
+    enum class VulkanPresentMode: int
+    {
+        Fifo,
+        FifoRelaxed,
+        Mailbox,
+        Immediate,
+    };
+
+    // Swapchain of one surface with its images, views, framebuffers and present semaphores,
+    // shared by VulkanSwapchain and VulkanPresenter. Recreation is debounced and hands the old
+    // swapchain to the new one, the old one is retired until the frames that used it are done.
+    // The owner keeps the frame slots and passes its submission serials in: recreation tags
+    // the retired swapchain with the current serial, CollectRetired destroys it once completed.
+    class VulkanSurfaceSwapchain : NonCopyable
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct CreateInfo
+        {
+            VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+            VkSurfaceKHR surface = VK_NULL_HANDLE;
+
+            // Retired swapchains also wait this many more submissions, for their presents
+            uint32_t framesInFlight = 2;
+            VulkanPresentMode presentMode = VulkanPresentMode::Fifo;
+            VkSurfaceFormatKHR preferredFormat = { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+            VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+            // Used when the surface lets the application pick the extent (e.g. headless)
+            uint32_t width = 0;
+            uint32_t height = 0;
+
+            std::chrono::milliseconds recreateDebounce = std::chrono::milliseconds(50);
+        };
+
+        struct Image
+        {
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView imageView = VK_NULL_HANDLE;
+            // Null until SetRenderPass is called
+            VkFramebuffer framebuffer = VK_NULL_HANDLE;
+            // Per image rather than per frame, the presentation engine holds it until the image comes back
+            VkSemaphore renderFinished = VK_NULL_HANDLE;
+        };
+
+    public:
+        VulkanSurfaceSwapchain(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo);
+        // The owner waits for its queue first, presents may still use the semaphores
+        ~VulkanSurfaceSwapchain();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Recreated on a later Update once the size settles for the debounce interval
+        auto Resize(uint32_t width, uint32_t height) -> void;
+        auto SetPresentMode(VulkanPresentMode presentMode) -> void;
+        // No frame in flight may use the current framebuffers
+        auto SetRenderPass(VkRenderPass renderPass) -> bool;
+
+        // Recreate when needed and the debounce allows it. While the surface has no area the
+        // current swapchain is kept. A failed vkCreateSwapchainKHR still retires the old one
+        // (it was passed as oldSwapchain) and leaves no swapchain until a later Update creates
+        // one. Returns whether there is a swapchain to acquire.
+        auto Update(uint64_t submitSerial) -> bool;
+        // Out of date recreates and acquires once more, suboptimal still returns the image
+        // and recreates on a later Update. Other results are left to the caller.
+        auto Acquire(VkSemaphore semaphore, uint64_t timeout, uint64_t submitSerial, uint32_t& imageIndex) -> VkResult;
+        // Result of this swapchain's present
+        auto OnPresentResult(VkResult result) -> void;
+        // The acquired image was not presented, only a recreation gets it back
+        auto MarkOutOfDate() -> void;
+
+        // Destroy the retired swapchains whose serial completed. canDestroy runs before each one,
+        // false keeps it and the later ones for another call (e.g. a wait still uses it).
+        auto CollectRetired(uint64_t completedSerial, uint64_t submitSerial, const std::function<bool(VkSwapchainKHR)>& canDestroy = nullptr) -> void;
+
+        auto GetSwapchain() const -> VkSwapchainKHR;
+        auto GetFormat() const -> VkSurfaceFormatKHR;
+        auto GetExtent() const -> VkExtent2D;
+        auto GetPresentMode() const -> VkPresentModeKHR;
+        auto GetImageCount() const -> uint32_t;
+        auto GetImage(uint32_t imageIndex) const -> const Image&;
+        auto GetRecreateCount() const -> uint64_t;
+        auto GetRetiredCount() const -> uint32_t;
+        auto GetSurfaceCache() const -> const VulkanSurfaceCache&;
+
+    private:
+        struct RetiredSwapchain
+        {
+            VkSwapchainKHR swapchain;
+            std::vector<Image> images;
+            // Destroyed once this serial completed and the new swapchain presented a few frames
+            uint64_t retireSerial;
+        };
+
+    private:
+        auto ChooseSurfaceFormat() -> bool;
+        auto ChoosePresentMode() const -> VkPresentModeKHR;
+        auto NeedRecreate() const -> bool;
+        auto CanRecreate() const -> bool;
+        auto Recreate(uint64_t submitSerial) -> bool;
+        auto ChooseExtent(const VkSurfaceCapabilitiesKHR& capabilities) -> bool;
+        auto CreateSwapchain(const VkSurfaceCapabilitiesKHR& capabilities) -> bool;
+        auto CreateImages() -> bool;
+        auto CreateFramebuffers() -> bool;
+        auto DestroyFramebuffers() -> void;
+        auto DestroyImages(std::vector<Image>& images) -> void;
+
+    private:
+        bool _valid;
+        const VulkanDeviceTable* _pDevice;
+        CreateInfo _createInfo;
+        VulkanSurfaceCache _surfaceCache;
+
+        VkSwapchainKHR _swapchain;
+        VkSurfaceFormatKHR _format;
+        VkExtent2D _extent;
+        VkPresentModeKHR _presentMode;
+        VkRenderPass _renderPass;
+        std::vector<Image> _images;
+        std::deque<RetiredSwapchain> _retired;
+        uint64_t _recreateCount;
+
+        // Out of date comes from Vulkan results and cannot be rendered to, a pending
+        // recreation (resize, suboptimal) keeps presenting meanwhile.
+        bool _outOfDate;
+        bool _recreatePending;
+        Clock::time_point _lastResizeTime;
+        Clock::time_point _lastRecreateTime;
+    };
+}
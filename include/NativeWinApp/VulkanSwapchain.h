@@ -0,0 +1,219 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "VulkanFrameSubmit.h"
+#include "VulkanSurfaceCache.h"
+#include "VulkanSurfaceSwapchain.h"
+#include "Utility.h"
+#include <cstdint>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace NWA
+{
+    class FramePacer;
+
+    // Swapchain of one surface plus the objects needed to keep several frames in flight:
+    // every frame slot has its own command pool, command buffer, fence and acquire semaphore,
+    // so the CPU only waits when it laps the GPU by framesInFlight frames.
+    // Recreation hands the old swapchain to the new one and retires its images, views and
+    // framebuffers once the frames that used them are done, the device is never idled.
+    class VulkanSwapchain : NonCopyable
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct CreateInfo
+        {
+            VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+            VkSurfaceKHR surface = VK_NULL_HANDLE;
+
+            // Queue used for both rendering and presentation
+            VkQueue queue = VK_NULL_HANDLE;
+            uint32_t queueFamilyIndex = 0;
+
+            uint32_t framesInFlight = 2;
+            VulkanPresentMode presentMode = VulkanPresentMode::Fifo;
+            VkSurfaceFormatKHR preferredFormat = { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+            VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+            // Used when the surface lets the application pick the extent (e.g. headless)
+            uint32_t width = 0;
+            uint32_t height = 0;
+
+            // Resize bursts (window drag) recreate at most once per interval
+            std::chrono::milliseconds recreateDebounce = std::chrono::milliseconds(50);
+
+            // The device was created with the presentId and presentWait features of
+            // VK_KHR_present_id / VK_KHR_present_wait: presents are tagged and timed until shown.
+            bool presentWait = false;
+
+            // Waited on right before every vkQueuePresentKHR, must outlive the swapchain
+            FramePacer* pFramePacer = nullptr;
+        };
+
+        struct PresentTiming
+        {
+            uint64_t presentId;
+            // Earliest input the frame consumed, see SetInputTime
+            std::optional<Clock::time_point> inputTime;
+            Clock::time_point acquireTime;
+            Clock::time_point presentTime;
+            // Null when present wait is unavailable or the swapchain went away first
+            std::optional<Clock::time_point> displayTime;
+        };
+
+        struct LatencyStatistics
+        {
+            uint64_t presentCount;
+            uint64_t displayedCount;
+            double averageAcquireToPresentMs;
+            double averagePresentToDisplayMs;
+            double maxPresentToDisplayMs;
+            // Displayed frames with an input time
+            uint64_t inputCount;
+            double averageInputToDisplayMs;
+            double maxInputToDisplayMs;
+        };
+
+        struct Frame
+        {
+            uint32_t frameIndex;
+            uint32_t imageIndex;
+            VkCommandBuffer commandBuffer;
+            VkImage image;
+            VkImageView imageView;
+            // Null until SetRenderPass is called
+            VkFramebuffer framebuffer;
+            VkExtent2D extent;
+        };
+
+    public:
+        VulkanSwapchain(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo);
+        ~VulkanSwapchain();
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Follow the window size, a Resize event marks the swapchain out of date.
+        auto Attach(Window& window) -> void;
+        auto Detach() -> void;
+
+        // Swapchain is recreated on a later BeginFrame, once the size settles for the debounce
+        // interval. The old swapchain keeps being used meanwhile as long as it is presentable.
+        auto Resize(uint32_t width, uint32_t height) -> void;
+        auto SetPresentMode(VulkanPresentMode presentMode) -> void;
+        // Null stops pacing.
+        auto SetFramePacer(FramePacer* pFramePacer) -> void;
+
+        // Create one framebuffer per swapchain image, kept in sync across recreation.
+        auto SetRenderPass(VkRenderPass renderPass) -> bool;
+
+        // Wait for the frame slot, acquire an image and begin its command buffer.
+        // Returns nullopt while the surface has no area (minimized) or on device errors.
+        auto BeginFrame() -> std::optional<Frame>;
+
+        // End the command buffer, submit it and present.
+        auto EndFrame() -> bool;
+
+        // Make the next EndFrame submission wait on a timeline semaphore value, e.g. uploads
+        // finishing on a transfer queue.
+        auto AddWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stageMask) -> void;
+        // Make the next EndFrame submission signal a timeline semaphore value, e.g. the
+        // frame's point on a VulkanFrameScheduler.
+        auto AddSignalSemaphore(VkSemaphore semaphore, uint64_t value) -> void;
+
+        // Wait until every frame in flight is finished on the GPU.
+        auto WaitIdle() const -> void;
+
+        // Time of the oldest input handled for the current frame, usually a WindowEvent
+        // timestamp. The earliest one set before EndFrame is kept.
+        auto SetInputTime(Clock::time_point inputTime) -> void;
+        // Presents whose display time is known (or will never be), oldest first.
+        auto PopPresentTimings() -> std::vector<PresentTiming>;
+        auto GetLatencyStatistics() const -> LatencyStatistics;
+        auto ResetLatencyStatistics() -> void;
+        auto IsPresentWaitEnabled() const -> bool;
+        // Id of the last present, 0 before the first one
+        auto GetLastPresentId() const -> uint64_t;
+
+        auto GetSwapchain() const -> VkSwapchainKHR;
+        auto GetFormat() const -> VkSurfaceFormatKHR;
+        auto GetExtent() const -> VkExtent2D;
+        auto GetPresentMode() const -> VkPresentModeKHR;
+        auto GetImageCount() const -> uint32_t;
+        auto GetFramesInFlight() const -> uint32_t;
+        auto GetRecreateCount() const -> uint64_t;
+        // Old swapchains waiting for their frames to retire
+        auto GetRetiredSwapchainCount() const -> uint32_t;
+        auto GetSurfaceCache() const -> const VulkanSurfaceCache&;
+
+    private:
+        struct FrameSlot
+        {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkFence inFlightFence = VK_NULL_HANDLE;
+            VkSemaphore imageAvailable = VK_NULL_HANDLE;
+            // Submission serial the fence was last submitted with
+            uint64_t submitSerial = 0;
+        };
+
+        struct PendingPresent
+        {
+            VkSwapchainKHR swapchain;
+            PresentTiming timing;
+        };
+
+    private:
+        auto CreateFrameSlots() -> bool;
+        auto DestroyFrameSlots() -> void;
+        auto CollectRetired() -> void;
+        auto CompletePresent(PresentTiming& timing) -> void;
+        auto PresentWaitThread() -> void;
+
+    private:
+        bool _valid;
+        const VulkanInstanceTable* _pInstance;
+        const VulkanDeviceTable* _pDevice;
+        CreateInfo _createInfo;
+        // Swapchain, images and retired swapchains, only used by the render thread
+        VulkanSurfaceSwapchain _surface;
+
+        // Frames in flight
+        std::vector<FrameSlot> _frameSlots;
+        uint32_t _frameIndex;
+        uint32_t _imageIndex;
+        bool _frameBegun;
+        uint64_t _submitSerial;
+        uint64_t _completedSerial;
+        VulkanFrameSubmit _frameSubmit;
+
+        // Present timing. vkWaitForPresentKHR runs on its own thread without any lock, the
+        // mutex only guards the present lists. A retired swapchain is not destroyed while the
+        // wait thread still waits on it.
+        bool _presentWaitEnabled;
+        uint64_t _presentId;
+        Clock::time_point _acquireTime;
+        std::optional<Clock::time_point> _inputTime;
+        std::mutex _presentMutex;
+        std::condition_variable _presentCondition;
+        bool _stopPresentWait;
+        std::deque<PendingPresent> _pendingPresents;
+        VkSwapchainKHR _waitingSwapchain;
+        std::deque<PresentTiming> _completedPresents;
+        // Own mutex, reading the statistics never holds up presents
+        mutable std::mutex _statisticsMutex;
+        LatencyStatistics _latencyStatistics;
+        std::thread _presentWaitThread;
+
+        // Attached window
+        Window* _pWindow;
+        int _eventCallbackId;
+    };
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "VulkanLoader.h"
+#include "VulkanMemoryAllocator.h"
+#include "Utility.h"
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace NWA
+{
+    // Uploads through a persistently mapped staging ring. Copies are batched into one command
+    // buffer, submitted by Flush (once per frame) on the transfer queue, and every batch
+    // signals the next value of a timeline semaphore: staging space is reclaimed and callers
+    // wait on values instead of idling the queue. When the transfer queue belongs to another
+    // family, copies end with a release barrier and AcquireUploads records the matching
+    // acquire barriers on the graphics side.
+    // Not thread safe, uploads are recorded from one thread.
+    class VulkanUploader : NonCopyable
+    {
+    public:
+        struct CreateInfo
+        {
+            // Dedicated transfer queue, or the graphics queue when the device has none
+            VkQueue transferQueue = VK_NULL_HANDLE;
+            uint32_t transferQueueFamilyIndex = 0;
+            // Family of the queue using the uploaded resources
+            uint32_t graphicsQueueFamilyIndex = 0;
+
+            VkDeviceSize stagingSize = VkDeviceSize(64) << 20;
+            // Batches recorded while earlier ones are still executing
+            uint32_t batchCount = 3;
+        };
+
+        struct ImageUpload
+        {
+            VkImage image = VK_NULL_HANDLE;
+            VkImageSubresourceLayers subresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+            VkOffset3D offset = { 0, 0, 0 };
+            // Data is tightly packed rows of this extent
+            VkExtent3D extent = { 0, 0, 1 };
+            VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkImageLayout newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            // First use on the graphics queue
+            VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            VkAccessFlags dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        };
+
+        // Semaphore wait to add to a graphics submission
+        struct QueueWait
+        {
+            VkSemaphore semaphore;
+            uint64_t value;
+            VkPipelineStageFlags stageMask;
+        };
+
+    public:
+        VulkanUploader(const VulkanDeviceTable& deviceTable, VulkanMemoryAllocator& allocator, const CreateInfo& createInfo);
+        ~VulkanUploader();
+
+    public:
+        // Family with transfer but neither graphics nor compute, the DMA engine on discrete GPUs.
+        static auto FindTransferQueueFamily(const VulkanInstanceTable& instanceTable, VkPhysicalDevice physicalDevice) -> std::optional<uint32_t>;
+
+    public:
+        auto IsValid() const -> bool;
+
+        // Copy the data into the staging ring and record the copy. Returns the timeline value
+        // the upload is complete at, reached after the batch is flushed. Buffers larger than
+        // half the ring are split, images must fit in the ring.
+        auto UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* pData, VkDeviceSize size,
+            VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            VkAccessFlags dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT) -> std::optional<uint64_t>;
+        auto UploadImage(const ImageUpload& upload, const void* pData, VkDeviceSize size) -> std::optional<uint64_t>;
+
+        // Submit the batch recorded since the last flush.
+        auto Flush() -> bool;
+
+        // Record the acquire barriers of the flushed uploads into a graphics command buffer and
+        // return the wait its submission needs, nullopt when nothing was flushed since last call.
+        auto AcquireUploads(VkCommandBuffer commandBuffer) -> std::optional<QueueWait>;
+
+        auto IsComplete(uint64_t value) const -> bool;
+        // Flushes first when the value belongs to the batch being recorded.
+        auto Wait(uint64_t value) -> bool;
+
+        auto GetTimelineSemaphore() const -> VkSemaphore;
+        auto GetSubmittedValue() const -> uint64_t;
+        auto GetCompletedValue() const -> uint64_t;
+        auto UsesOwnershipTransfer() const -> bool;
+
+        auto GetUploadedBytes() const -> uint64_t;
+        // Uploads that had to wait for the GPU to free staging space, the ring is too small
+        auto GetStallCount() const -> uint64_t;
+
+    private:
+        struct Batch
+        {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            uint64_t value = 0;
+        };
+
+        struct StagingRegion
+        {
+            VkDeviceSize size;
+            uint64_t value;
+        };
+
+        struct PendingAcquire
+        {
+            bool isImage;
+            VkBufferMemoryBarrier bufferBarrier;
+            VkImageMemoryBarrier imageBarrier;
+            uint64_t value;
+        };
+
+    private:
+        auto ReserveStaging(VkDeviceSize size, VkDeviceSize alignment) -> std::optional<VkDeviceSize>;
+        auto ReclaimStaging() -> void;
+        auto BeginBatch() -> bool;
+        auto GetRecordingValue() const -> uint64_t;
+
+    private:
+        bool _valid;
+        const VulkanDeviceTable* _pDevice;
+        VulkanMemoryAllocator* _pAllocator;
+        CreateInfo _createInfo;
+
+        // Staging ring
+        VkBuffer _stagingBuffer;
+        VulkanAllocation _stagingAllocation;
+        VkDeviceSize _stagingHead;
+        VkDeviceSize _stagingUsed;
+        std::deque<StagingRegion> _stagingRegions;
+
+        // Batches
+        VkSemaphore _timeline;
+        std::vector<Batch> _batches;
+        uint32_t _batchIndex;
+        bool _recording;
+        VkDeviceSize _recordingStagingBytes;
+        uint64_t _submittedValue;
+
+        // Graphics side of the uploads, acquire barriers are only used across families
+        std::vector<PendingAcquire> _pendingAcquires;
+        VkPipelineStageFlags _waitStageMask;
+        uint64_t _acquiredValue;
+
+        uint64_t _uploadedBytes;
+        uint64_t _stallCount;
+    };
+}
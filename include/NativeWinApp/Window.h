@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <string>
 #include <queue>
+#include <vector>
 #include <optional>
 #include <functional>
 
@@ -21,6 +22,12 @@ namespace NWA
     inline int WindowStyleNoResize = static_cast<int>(WindowStyle::HaveTitleBar) | static_cast<int>(WindowStyle::HaveClose);
     inline int WindowStyleNoClose = static_cast<int>(WindowStyle::HaveTitleBar) | static_cast<int>(WindowStyle::HaveResize);
 
+    enum class SwapBufferStage: int
+    {
+        BeforeSwap,
+        AfterSwap,
+    };
+
     class Window
     {
     public:
@@ -36,14 +43,20 @@ namespace NWA
 
     public:
         auto EventLoop() -> void;
+        auto SetOpenGLPixelFormat() -> bool;
         auto CreateOpenGLContext() -> void;
         auto SwapBuffer() const -> void;
+        auto AddSwapBufferCallback(SwapBufferStage stage, const std::function<void()>& f) -> int;
+        auto RemoveSwapBufferCallback(int callbackId) -> void;
+        static auto GetOpenGLProcAddress(const char* name) -> void*;
         auto WindowEventProcess(uint32_t message, void* wpara, void* lpara) -> void;
         auto SetWindowEventProcessFunction(const std::function<bool(void*, uint32_t, void*, void*)>& f) -> void;
         auto ClearWindowEventProcessFunction() -> void;
         auto HasEvent() const -> bool;
         auto PopEvent(WindowEvent& outEvent) -> bool;
         auto PopAllEvent() -> std::vector<WindowEvent>;
+        auto AddEventCallback(const std::function<void(const WindowEvent&)>& f) -> int;
+        auto RemoveEventCallback(int callbackId) -> void;
 
         auto GetSize() const -> std::pair<int, int>;
         auto SetSize(int width, int height) -> void;
@@ -52,6 +65,7 @@ namespace NWA
         auto SetPosition(int x, int y) -> void;
 
         auto GetSystemHandle() const -> void*;
+        auto GetDeviceContext() const -> DeviceContextHandle;
 
         auto SetIcon(unsigned int width, unsigned int height, const std::byte* pixels) -> void;
         auto SetIcon(int iconResId) -> void;
@@ -93,11 +107,42 @@ namespace NWA
         // Event
         std::queue<WindowEvent> _eventQueue;
 
+        // Event hooks, invoked when the event is queued
+        struct EventCallback
+        {
+            int id;
+            std::function<void(const WindowEvent&)> func;
+            bool removed;
+        };
+
+        // While callbacks run, removed ones are only marked and added ones wait, both are
+        // applied once the outermost callback returns
+        std::vector<EventCallback> _eventCallbacks;
+        std::vector<EventCallback> _addedEventCallbacks;
+        int _eventCallbackDepth;
+        int _nextEventCallbackId;
+
         // Additional handler
         std::function<bool(void*, uint32_t, void*, void*)> _winEventProcess;
 
         // OpenGL
         GLContextHandle _hGLContext;
+        bool _glPixelFormatSet;
+
+        // Swap buffer hooks, invoked in registration order
+        struct SwapBufferCallback
+        {
+            int id;
+            SwapBufferStage stage;
+            std::function<void()> func;
+            bool removed;
+        };
+
+        // Same deferral as the event hooks
+        mutable std::vector<SwapBufferCallback> _swapBufferCallbacks;
+        mutable std::vector<SwapBufferCallback> _addedSwapBufferCallbacks;
+        mutable int _swapBufferCallbackDepth;
+        int _nextSwapBufferCallbackId;
 
     private:
         static void RegisterWindowClass();
@@ -2,6 +2,8 @@
 
 #include "Keyboard.h"
 #include "Mouse.h"
+#include <cstdint>
+#include <chrono>
 
 namespace NWA
 {
@@ -81,10 +83,13 @@ namespace NWA
     public:
         Type type;
         Data data;
+        // When the window procedure received the message, for input to display latency
+        std::chrono::steady_clock::time_point timestamp;
 
     public:
         explicit WindowEvent(Type t)
             : type(t)
+            , timestamp(std::chrono::steady_clock::now())
         {
         }
     };
@@ -0,0 +1,253 @@
+
+#include <algorithm>
+#include "NativeWinApp/GLProcLoader.h"
+#include "NativeWinApp/FrameCapture.h"
+
+namespace NWA
+{
+    FrameCapture::FrameCapture(const Callback& callback, int ringSize)
+        : _valid(false)
+        , _callback(callback)
+        , _slots(std::max(ringSize, 2))
+        , _nextSlot(0)
+        , _remainingCaptures(0)
+        , _frameIndex(0)
+        , _capturedFrames(0)
+        , _droppedFrames(0)
+        , _stopWorker(false)
+        , _pWindow(nullptr)
+        , _swapCallbackId(-1)
+        , _pGL(GLProcLoader::BindCurrentContext())
+    {
+        if (_pGL == nullptr || !_callback)
+            return;
+
+        if (_pGL->GenBuffers == nullptr || _pGL->DeleteBuffers == nullptr || _pGL->BindBuffer == nullptr
+            || _pGL->BufferData == nullptr || _pGL->MapBufferRange == nullptr || _pGL->UnmapBuffer == nullptr
+            || _pGL->FenceSync == nullptr || _pGL->DeleteSync == nullptr || _pGL->ClientWaitSync == nullptr)
+            return;
+
+        for (auto& slot : _slots)
+            _pGL->GenBuffers(1, &slot.buffer);
+
+        _worker = std::thread(&FrameCapture::WorkerLoop, this);
+
+        _valid = true;
+    }
+
+    FrameCapture::~FrameCapture()
+    {
+        Detach();
+
+        if (!_valid)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(_workerMutex);
+            _stopWorker = true;
+        }
+
+        _workerCondition.notify_one();
+        _worker.join();
+
+        for (auto& slot : _slots)
+        {
+            const SlotState state = slot.state.load();
+            if (state == SlotState::Pending)
+                _pGL->DeleteSync(static_cast<GLsync>(slot.fence));
+
+            if (state == SlotState::Mapped || state == SlotState::Consumed)
+            {
+                _pGL->BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+                _pGL->UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+
+            _pGL->DeleteBuffers(1, &slot.buffer);
+        }
+
+        _pGL->BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    auto FrameCapture::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto FrameCapture::Attach(Window& window) -> void
+    {
+        Detach();
+
+        _pWindow = &window;
+        _swapCallbackId = window.AddSwapBufferCallback(SwapBufferStage::BeforeSwap, [this]() -> void
+        {
+            auto [width, height] = _pWindow->GetSize();
+            Capture(width, height);
+        });
+    }
+
+    auto FrameCapture::Detach() -> void
+    {
+        if (_pWindow == nullptr)
+            return;
+
+        _pWindow->RemoveSwapBufferCallback(_swapCallbackId);
+        _pWindow = nullptr;
+        _swapCallbackId = -1;
+    }
+
+    auto FrameCapture::RequestCapture(int frameCount) -> void
+    {
+        _remainingCaptures = frameCount;
+    }
+
+    auto FrameCapture::StopCapture() -> void
+    {
+        _remainingCaptures = 0;
+    }
+
+    auto FrameCapture::Capture(int width, int height) -> void
+    {
+        if (!_valid)
+            return;
+
+        Poll();
+
+        if (_remainingCaptures == 0 || width <= 0 || height <= 0)
+            return;
+
+        const uint64_t frameIndex = _frameIndex++;
+
+        if (_remainingCaptures > 0)
+            _remainingCaptures--;
+
+        // Whole ring still in flight or in the callback, do not wait
+        Slot& slot = _slots[_nextSlot];
+        if (slot.state.load() != SlotState::Free)
+        {
+            _droppedFrames++;
+            return;
+        }
+
+        const std::size_t stride = static_cast<std::size_t>(width) * 4;
+        const std::size_t size = stride * static_cast<std::size_t>(height);
+
+        _pGL->BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+
+        if (slot.capacity < size)
+        {
+            _pGL->BufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+            slot.capacity = size;
+        }
+
+        // With a pack buffer bound, the copy is queued on the GPU and the call returns immediately
+        _pGL->ReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        _pGL->BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.fence = _pGL->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = Frame { frameIndex, width, height, static_cast<int>(stride), nullptr };
+        slot.state.store(SlotState::Pending);
+
+        _pendingSlots.push_back(_nextSlot);
+        _nextSlot = (_nextSlot + 1) % _slots.size();
+    }
+
+    auto FrameCapture::Poll() -> void
+    {
+        if (!_valid)
+            return;
+
+        RecycleConsumedSlots();
+
+        while (!_pendingSlots.empty())
+        {
+            const std::size_t slotIndex = _pendingSlots.front();
+            Slot& slot = _slots[slotIndex];
+
+            // Zero timeout only tests the fence
+            const GLenum waitResult = _pGL->ClientWaitSync(static_cast<GLsync>(slot.fence), 0, 0);
+            if (waitResult != GL_ALREADY_SIGNALED && waitResult != GL_CONDITION_SATISFIED)
+                break;
+
+            _pendingSlots.pop_front();
+
+            _pGL->DeleteSync(static_cast<GLsync>(slot.fence));
+            slot.fence = nullptr;
+
+            const auto size = static_cast<GLsizeiptr>(slot.frame.stride) * slot.frame.height;
+
+            _pGL->BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            void* pData = _pGL->MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+            _pGL->BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            if (pData == nullptr)
+            {
+                slot.state.store(SlotState::Free);
+                _droppedFrames++;
+                continue;
+            }
+
+            // Buffer stays mapped until the worker is done with it
+            slot.frame.pixels = static_cast<const std::byte*>(pData);
+            slot.state.store(SlotState::Mapped);
+
+            {
+                std::lock_guard<std::mutex> lock(_workerMutex);
+                _workerQueue.push_back(slotIndex);
+            }
+
+            _workerCondition.notify_one();
+        }
+    }
+
+    auto FrameCapture::RecycleConsumedSlots() -> void
+    {
+        for (auto& slot : _slots)
+        {
+            if (slot.state.load() != SlotState::Consumed)
+                continue;
+
+            _pGL->BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            _pGL->UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            _pGL->BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            slot.frame.pixels = nullptr;
+            slot.state.store(SlotState::Free);
+        }
+    }
+
+    auto FrameCapture::WorkerLoop() -> void
+    {
+        while (true)
+        {
+            std::size_t slotIndex;
+
+            {
+                std::unique_lock<std::mutex> lock(_workerMutex);
+                _workerCondition.wait(lock, [this]() -> bool { return _stopWorker || !_workerQueue.empty(); });
+
+                // Deliver what is already mapped before leaving
+                if (_workerQueue.empty())
+                    return;
+
+                slotIndex = _workerQueue.front();
+                _workerQueue.pop_front();
+            }
+
+            Slot& slot = _slots[slotIndex];
+            _callback(slot.frame);
+
+            _capturedFrames++;
+            slot.state.store(SlotState::Consumed);
+        }
+    }
+
+    auto FrameCapture::GetCapturedFrameCount() const -> uint64_t
+    {
+        return _capturedFrames.load();
+    }
+
+    auto FrameCapture::GetDroppedFrameCount() const -> uint64_t
+    {
+        return _droppedFrames;
+    }
+}
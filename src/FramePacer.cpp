@@ -0,0 +1,239 @@
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include "NativeWinApp/FramePacer.h"
+
+#if defined(_WIN32)
+#   include "NativeWinApp/WindowsInclude.h"
+#   ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#       define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#   endif
+#endif
+
+namespace NWA
+{
+    FramePacer::FramePacer(double targetFrameRate, std::chrono::microseconds spinThreshold)
+        : _period(Clock::duration::zero())
+        , _spinThreshold(spinThreshold)
+        , _inputLead(Clock::duration::zero())
+        , _started(false)
+        , _hTimer(nullptr)
+        , _pWindow(nullptr)
+        , _swapCallbackId(-1)
+    {
+        SetTargetFrameRate(targetFrameRate);
+        ResetStatistics();
+
+#if defined(_WIN32)
+        // High resolution timer exists since Windows 10 1803, fall back to a regular one.
+        _hTimer = ::CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (_hTimer == nullptr)
+            _hTimer = ::CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+#endif
+    }
+
+    FramePacer::~FramePacer()
+    {
+        Detach();
+
+#if defined(_WIN32)
+        if (_hTimer != nullptr)
+            ::CloseHandle(static_cast<HANDLE>(_hTimer));
+#endif
+    }
+
+    auto FramePacer::SetTargetFrameRate(double targetFrameRate) -> void
+    {
+        if (targetFrameRate <= 0)
+            _period = Clock::duration::zero();
+        else
+            _period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFrameRate));
+
+        // Start a new timeline on the next frame
+        _started = false;
+    }
+
+    auto FramePacer::GetTargetFrameRate() const -> double
+    {
+        if (_period == Clock::duration::zero())
+            return 0;
+
+        return 1.0 / std::chrono::duration<double>(_period).count();
+    }
+
+    auto FramePacer::SetSpinThreshold(std::chrono::microseconds spinThreshold) -> void
+    {
+        _spinThreshold = spinThreshold;
+    }
+
+    auto FramePacer::SetLateInputCallback(const std::function<void()>& f, std::chrono::microseconds inputLead) -> void
+    {
+        _lateInputCallback = f;
+        _inputLead = inputLead;
+    }
+
+    auto FramePacer::Attach(Window& window) -> void
+    {
+        Detach();
+
+        _pWindow = &window;
+        _swapCallbackId = window.AddSwapBufferCallback(SwapBufferStage::BeforeSwap, [this]() -> void { Wait(); });
+    }
+
+    auto FramePacer::Detach() -> void
+    {
+        if (_pWindow == nullptr)
+            return;
+
+        _pWindow->RemoveSwapBufferCallback(_swapCallbackId);
+        _pWindow = nullptr;
+        _swapCallbackId = -1;
+    }
+
+    auto FramePacer::Wait() -> void
+    {
+        Clock::time_point now = Clock::now();
+
+        if (!_started)
+        {
+            _started = true;
+            _lastFrameTime = now;
+            _nextDeadline = now + _period;
+
+            if (_lateInputCallback)
+                _lateInputCallback();
+
+            return;
+        }
+
+        // Uncapped, only measure
+        if (_period == Clock::duration::zero())
+        {
+            if (_lateInputCallback)
+                _lateInputCallback();
+
+            now = Clock::now();
+            RecordFrame(now, now);
+            return;
+        }
+
+        const Clock::time_point deadline = _nextDeadline;
+
+        if (_lateInputCallback)
+        {
+            WaitUntil(deadline - _inputLead);
+            _lateInputCallback();
+        }
+
+        WaitUntil(deadline);
+
+        now = Clock::now();
+        RecordFrame(now, deadline);
+
+        // Missed by more than a whole frame, restart the timeline instead of bursting to catch up
+        if (now - deadline > _period)
+        {
+            _missedDeadlines++;
+            _nextDeadline = now + _period;
+        }
+        else
+        {
+            _nextDeadline = deadline + _period;
+        }
+    }
+
+    auto FramePacer::WaitUntil(Clock::time_point deadline) -> void
+    {
+        Clock::time_point now = Clock::now();
+        if (now >= deadline)
+            return;
+
+        // Coarse sleep
+        const Clock::duration sleepTime = (deadline - now) - _spinThreshold;
+        if (sleepTime > Clock::duration::zero())
+        {
+#if defined(_WIN32)
+            if (_hTimer != nullptr)
+            {
+                // Negative due time is relative, in 100ns units
+                LARGE_INTEGER dueTime;
+                dueTime.QuadPart = -static_cast<LONGLONG>(std::chrono::duration_cast<std::chrono::nanoseconds>(sleepTime).count() / 100);
+
+                if (::SetWaitableTimer(static_cast<HANDLE>(_hTimer), &dueTime, 0, nullptr, nullptr, FALSE))
+                    ::WaitForSingleObject(static_cast<HANDLE>(_hTimer), INFINITE);
+            }
+            else
+            {
+                std::this_thread::sleep_for(sleepTime);
+            }
+#else
+            std::this_thread::sleep_for(sleepTime);
+#endif
+        }
+
+        // Spin the remaining part, the OS scheduler cannot be trusted below a millisecond
+        while (Clock::now() < deadline)
+        {
+        }
+    }
+
+    auto FramePacer::RecordFrame(Clock::time_point now, Clock::time_point deadline) -> void
+    {
+        const double frameMs = std::chrono::duration<double, std::milli>(now - _lastFrameTime).count();
+        _lastFrameTime = now;
+
+        _frameCount++;
+        const double delta = frameMs - _meanMs;
+        _meanMs += delta / static_cast<double>(_frameCount);
+        _m2 += delta * (frameMs - _meanMs);
+        _minMs = std::min(_minMs, frameMs);
+        _maxMs = std::max(_maxMs, frameMs);
+
+        if (_period == Clock::duration::zero())
+            return;
+
+        const double wakeErrorUs = std::max(0.0, std::chrono::duration<double, std::micro>(now - deadline).count());
+        _wakeCount++;
+        _totalWakeErrorUs += wakeErrorUs;
+        _maxWakeErrorUs = std::max(_maxWakeErrorUs, wakeErrorUs);
+    }
+
+    auto FramePacer::GetStatistics() const -> Statistics
+    {
+        Statistics statistics {};
+        statistics.frameCount = _frameCount;
+        statistics.targetMs = std::chrono::duration<double, std::milli>(_period).count();
+        statistics.missedDeadlines = _missedDeadlines;
+
+        if (_frameCount > 0)
+        {
+            statistics.averageMs = _meanMs;
+            statistics.minMs = _minMs;
+            statistics.maxMs = _maxMs;
+            statistics.jitterMs = _frameCount > 1 ? std::sqrt(_m2 / static_cast<double>(_frameCount - 1)) : 0;
+        }
+
+        if (_wakeCount > 0)
+        {
+            statistics.averageWakeErrorUs = _totalWakeErrorUs / static_cast<double>(_wakeCount);
+            statistics.maxWakeErrorUs = _maxWakeErrorUs;
+        }
+
+        return statistics;
+    }
+
+    auto FramePacer::ResetStatistics() -> void
+    {
+        _frameCount = 0;
+        _meanMs = 0;
+        _m2 = 0;
+        _minMs = std::numeric_limits<double>::max();
+        _maxMs = 0;
+        _wakeCount = 0;
+        _totalWakeErrorUs = 0;
+        _maxWakeErrorUs = 0;
+        _missedDeadlines = 0;
+    }
+}
@@ -0,0 +1,134 @@
+
+#include <algorithm>
+#include "NativeWinApp/WindowsInclude.h"
+#include "NativeWinApp/GLProcLoader.h"
+#include "NativeWinApp/GLContextManager.h"
+
+namespace NWA
+{
+    GLContextManager::~GLContextManager()
+    {
+        if (_hGLContext == nullptr)
+            return;
+
+        GLProcLoader::ReleaseContext(_hGLContext);
+
+        if (::wglGetCurrentContext() == static_cast<HGLRC>(_hGLContext))
+            ::wglMakeCurrent(nullptr, nullptr);
+
+        ::wglDeleteContext(static_cast<HGLRC>(_hGLContext));
+    }
+
+    auto GLContextManager::AddWindow(Window& window) -> bool
+    {
+        if (FindDrawable(window) != nullptr)
+            return true;
+
+        // Every window shares the same pixel format, so the context fits all of them
+        if (!window.SetOpenGLPixelFormat())
+            return false;
+
+        const auto hDeviceContext = window.GetDeviceContext();
+
+        if (_hGLContext == nullptr)
+        {
+            _hGLContext = ::wglCreateContext(static_cast<HDC>(hDeviceContext));
+            if (_hGLContext == nullptr)
+                return false;
+        }
+
+        _drawables.push_back({ &window, hDeviceContext, false });
+
+        return true;
+    }
+
+    auto GLContextManager::RemoveWindow(Window& window) -> void
+    {
+        const Drawable* pDrawable = FindDrawable(window);
+        if (pDrawable == nullptr)
+            return;
+
+        if (pDrawable->hDeviceContext == _hCurrentDeviceContext)
+        {
+            ::wglMakeCurrent(nullptr, nullptr);
+            _hCurrentDeviceContext = nullptr;
+        }
+
+        std::erase_if(_drawables, [&window](const Drawable& drawable) -> bool { return drawable.pWindow == &window; });
+    }
+
+    auto GLContextManager::MakeCurrent(const Window& window) -> bool
+    {
+        Drawable* pDrawable = FindDrawable(window);
+        if (pDrawable == nullptr)
+            return false;
+
+        pDrawable->drawn = true;
+
+        // Someone else may have switched the context behind our back, the WGL
+        // getters only read thread local state and cost nothing compared to a switch.
+        if (pDrawable->hDeviceContext == _hCurrentDeviceContext
+            && ::wglGetCurrentContext() == static_cast<HGLRC>(_hGLContext)
+            && ::wglGetCurrentDC() == static_cast<HDC>(_hCurrentDeviceContext))
+        {
+            _statistics.skippedMakeCurrentCalls++;
+            return true;
+        }
+
+        _statistics.makeCurrentCalls++;
+
+        if (!::wglMakeCurrent(static_cast<HDC>(pDrawable->hDeviceContext), static_cast<HGLRC>(_hGLContext)))
+        {
+            _hCurrentDeviceContext = nullptr;
+            return false;
+        }
+
+        _hCurrentDeviceContext = pDrawable->hDeviceContext;
+
+        // Same context on every window, this only refreshes the thread's table pointer
+        GLProcLoader::BindCurrentContext();
+
+        return true;
+    }
+
+    auto GLContextManager::EndWindow(const Window& window) -> void
+    {
+        Drawable* pDrawable = FindDrawable(window);
+        if (pDrawable == nullptr || !pDrawable->drawn)
+            return;
+
+        pDrawable->pWindow->SwapBuffer();
+        pDrawable->drawn = false;
+    }
+
+    auto GLContextManager::Present() -> void
+    {
+        // SwapBuffers only needs the device context, rebinding each window would double the switches
+        for (auto& drawable : _drawables)
+        {
+            if (!drawable.drawn)
+                continue;
+
+            drawable.pWindow->SwapBuffer();
+            drawable.drawn = false;
+        }
+
+        _statistics.presentedFrames++;
+    }
+
+    auto GLContextManager::GetContext() const -> Window::GLContextHandle
+    {
+        return _hGLContext;
+    }
+
+    auto GLContextManager::GetStatistics() const -> Statistics
+    {
+        return _statistics;
+    }
+
+    auto GLContextManager::FindDrawable(const Window& window) -> Drawable*
+    {
+        auto itr = std::ranges::find_if(_drawables, [&window](const Drawable& drawable) -> bool { return drawable.pWindow == &window; });
+        return itr == _drawables.end() ? nullptr : &(*itr);
+    }
+}
@@ -0,0 +1,183 @@
+
+#include <algorithm>
+#include "NativeWinApp/GLProcLoader.h"
+#include "NativeWinApp/GLGpuProfiler.h"
+
+namespace NWA
+{
+    GLGpuProfiler::GLGpuProfiler(int latencyFrames, int maxZonesPerFrame, int rollingWindow)
+        : _valid(false)
+        , _maxZonesPerFrame(std::max(maxZonesPerFrame, 1))
+        , _currentSlot(0)
+        , _frameIndex(0)
+        , _droppedFrames(0)
+        , _recorder(rollingWindow)
+        , _pWindow(nullptr)
+        , _swapCallbackId(-1)
+        , _pGL(GLProcLoader::BindCurrentContext())
+    {
+        if (_pGL == nullptr)
+            return;
+
+        if (_pGL->GenQueries == nullptr || _pGL->DeleteQueries == nullptr || _pGL->QueryCounter == nullptr
+            || _pGL->GetQueryObjectiv == nullptr || _pGL->GetQueryObjectui64v == nullptr)
+            return;
+
+        // Need at least one frame between write and read back
+        _frameSlots.resize(std::max(latencyFrames, 2));
+
+        for (auto& slot : _frameSlots)
+        {
+            slot.queries.resize(_maxZonesPerFrame * 2);
+            slot.zones.reserve(_maxZonesPerFrame);
+            _pGL->GenQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+        }
+
+        _zoneStack.reserve(_maxZonesPerFrame);
+
+        _valid = true;
+    }
+
+    GLGpuProfiler::~GLGpuProfiler()
+    {
+        Detach();
+
+        if (!_valid)
+            return;
+
+        for (auto& slot : _frameSlots)
+            _pGL->DeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+    }
+
+    auto GLGpuProfiler::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto GLGpuProfiler::Attach(Window& window) -> void
+    {
+        Detach();
+
+        _pWindow = &window;
+        _swapCallbackId = window.AddSwapBufferCallback(SwapBufferStage::AfterSwap, [this]() -> void { EndFrame(); });
+    }
+
+    auto GLGpuProfiler::Detach() -> void
+    {
+        if (_pWindow == nullptr)
+            return;
+
+        _pWindow->RemoveSwapBufferCallback(_swapCallbackId);
+        _pWindow = nullptr;
+        _swapCallbackId = -1;
+    }
+
+    auto GLGpuProfiler::BeginZone(const char* name) -> void
+    {
+        if (!_valid)
+            return;
+
+        FrameSlot& slot = _frameSlots[_currentSlot];
+
+        // Out of queries, keep the stack balanced and skip this zone
+        if (static_cast<int>(slot.zones.size()) >= _maxZonesPerFrame)
+        {
+            _zoneStack.push_back(-1);
+            return;
+        }
+
+        const int zoneIndex = static_cast<int>(slot.zones.size());
+        slot.zones.push_back({ name, static_cast<int>(_zoneStack.size()) });
+        _zoneStack.push_back(zoneIndex);
+
+        _pGL->QueryCounter(slot.queries[zoneIndex * 2], GL_TIMESTAMP);
+    }
+
+    auto GLGpuProfiler::EndZone() -> void
+    {
+        if (!_valid || _zoneStack.empty())
+            return;
+
+        const int zoneIndex = _zoneStack.back();
+        _zoneStack.pop_back();
+
+        if (zoneIndex < 0)
+            return;
+
+        FrameSlot& slot = _frameSlots[_currentSlot];
+        slot.lastQuery = slot.queries[zoneIndex * 2 + 1];
+        _pGL->QueryCounter(slot.lastQuery, GL_TIMESTAMP);
+    }
+
+    auto GLGpuProfiler::EndFrame() -> void
+    {
+        if (!_valid)
+            return;
+
+        // Close zones left open by the user
+        while (!_zoneStack.empty())
+            EndZone();
+
+        FrameSlot& finishedSlot = _frameSlots[_currentSlot];
+        finishedSlot.frameIndex = _frameIndex;
+        finishedSlot.pending = !finishedSlot.zones.empty();
+
+        _frameIndex++;
+        _currentSlot = (_currentSlot + 1) % _frameSlots.size();
+
+        // The oldest frame is about to be reused, read it back if the GPU is done with it
+        FrameSlot& reuseSlot = _frameSlots[_currentSlot];
+        if (reuseSlot.pending && !ResolveSlot(reuseSlot))
+            _droppedFrames++;
+
+        reuseSlot.zones.clear();
+        reuseSlot.pending = false;
+    }
+
+    auto GLGpuProfiler::ResolveSlot(FrameSlot& slot) -> bool
+    {
+        // Queries complete in submission order, the last issued one tells for the whole frame
+        GLint available = 0;
+        _pGL->GetQueryObjectiv(slot.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0)
+            return false;
+
+        for (std::size_t i = 0; i < slot.zones.size(); i++)
+        {
+            GLuint64 beginNs = 0;
+            GLuint64 endNs = 0;
+            _pGL->GetQueryObjectui64v(slot.queries[i * 2], GL_QUERY_RESULT, &beginNs);
+            _pGL->GetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &endNs);
+
+            const uint64_t durationNs = endNs > beginNs ? endNs - beginNs : 0;
+            _recorder.Record(slot.zones[i].name, slot.frameIndex, beginNs, durationNs, slot.zones[i].depth);
+        }
+
+        return true;
+    }
+
+    auto GLGpuProfiler::GetZoneStats() const -> std::vector<ZoneStats>
+    {
+        return _recorder.GetZoneStats();
+    }
+
+    auto GLGpuProfiler::GetDroppedFrameCount() const -> uint64_t
+    {
+        return _droppedFrames;
+    }
+
+    auto GLGpuProfiler::SetTraceEnabled(bool enable, std::size_t maxEvents) -> void
+    {
+        _recorder.SetTraceEnabled(enable, maxEvents);
+    }
+
+    auto GLGpuProfiler::ExportTrace() const -> std::string
+    {
+        return _recorder.ExportTrace();
+    }
+
+    auto GLGpuProfiler::ExportTrace(const std::string& path) const -> bool
+    {
+        return _recorder.ExportTrace(path);
+    }
+}
@@ -0,0 +1,92 @@
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "NativeWinApp/GLProcLoader.h"
+#include "NativeWinApp/Window.h"
+
+namespace NWA
+{
+    // Only touched when a context is bound or released, never on the call path.
+    static std::mutex& GetTableMutex()
+    {
+        static std::mutex sMutex;
+        return sMutex;
+    }
+
+    static std::unordered_map<void*, std::unique_ptr<GLDispatchTable>>& GetTables()
+    {
+        static std::unordered_map<void*, std::unique_ptr<GLDispatchTable>> sTables;
+        return sTables;
+    }
+
+    // Bumped by every release, thread caches from an older generation resolve again.
+    static std::atomic<uint64_t>& GetGeneration()
+    {
+        static std::atomic<uint64_t> sGeneration = 1;
+        return sGeneration;
+    }
+
+    auto GLProcLoader::LoadProcAddress(const char* name) -> void*
+    {
+        return Window::GetOpenGLProcAddress(name);
+    }
+
+    auto GLProcLoader::GetCurrentContext() -> void*
+    {
+        return ::wglGetCurrentContext();
+    }
+
+    auto GLProcLoader::BindCurrentContext() -> const GLDispatchTable*
+    {
+        void* context = GetCurrentContext();
+        if (context == nullptr)
+        {
+            _sCurrentTable = nullptr;
+            _sCurrentContext = nullptr;
+            return nullptr;
+        }
+
+        if (_sCurrentTable != nullptr && _sCurrentContext == context && _sCurrentGeneration == GetGeneration().load(std::memory_order_acquire))
+            return _sCurrentTable;
+
+        std::lock_guard<std::mutex> lock(GetTableMutex());
+
+        // Read under the lock, no release can slip in before the table is looked up
+        const uint64_t generation = GetGeneration().load(std::memory_order_relaxed);
+
+        auto& pTable = GetTables()[context];
+        if (pTable == nullptr)
+        {
+            pTable = std::make_unique<GLDispatchTable>();
+            pTable->context = context;
+
+#define NWA_GL_LOAD_FUNCTION(type, name) pTable->name = reinterpret_cast<type>(LoadProcAddress("gl" #name));
+            NWA_GL_FUNCTIONS(NWA_GL_LOAD_FUNCTION)
+#undef NWA_GL_LOAD_FUNCTION
+        }
+
+        _sCurrentTable = pTable.get();
+        _sCurrentContext = context;
+        _sCurrentGeneration = generation;
+
+        return _sCurrentTable;
+    }
+
+    auto GLProcLoader::ReleaseContext(void* context) -> void
+    {
+        if (context == nullptr)
+            return;
+
+        if (_sCurrentContext == context)
+        {
+            _sCurrentTable = nullptr;
+            _sCurrentContext = nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(GetTableMutex());
+        if (GetTables().erase(context) > 0)
+            GetGeneration().fetch_add(1, std::memory_order_release);
+    }
+}
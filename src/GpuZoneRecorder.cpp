@@ -0,0 +1,151 @@
+
+#include <algorithm>
+#include <fstream>
+#include <format>
+#include "NativeWinApp/GpuZoneRecorder.h"
+
+namespace NWA
+{
+    static auto AppendJsonString(std::string& result, std::string_view str) -> void
+    {
+        result += '"';
+
+        for (const char c : str)
+        {
+            switch (c)
+            {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                case '\n': result += "\\n"; break;
+                case '\r': result += "\\r"; break;
+                case '\t': result += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        result += std::format("\\u{:04x}", static_cast<unsigned int>(c));
+                    else
+                        result += c;
+                    break;
+            }
+        }
+
+        result += '"';
+    }
+
+    GpuZoneRecorder::GpuZoneRecorder(int rollingWindow)
+        : _rollingWindow(std::max(rollingWindow, 1))
+        , _traceEnabled(false)
+        , _maxTraceEvents(0)
+        , _traceOriginNs(0)
+    {
+    }
+
+    auto GpuZoneRecorder::Record(std::string_view name, uint64_t frameIndex, uint64_t beginNs, uint64_t durationNs, int depth) -> void
+    {
+        // Only a new zone name allocates
+        auto itr = _zoneHistory.find(name);
+        if (itr == _zoneHistory.end())
+        {
+            itr = _zoneHistory.emplace(std::string(name), ZoneHistory {}).first;
+            itr->second.samples.resize(_rollingWindow);
+        }
+
+        ZoneHistory& history = itr->second;
+        history.samples[history.head] = static_cast<double>(durationNs) / 1000000.0;
+        history.head = (history.head + 1) % history.samples.size();
+        history.count = std::min(history.count + 1, history.samples.size());
+        history.totalCount++;
+
+        if (!_traceEnabled)
+            return;
+
+        if (_traceOriginNs == 0)
+            _traceOriginNs = beginNs;
+
+        if (_traceEvents.size() >= _maxTraceEvents)
+            _traceEvents.pop_front();
+
+        const uint64_t startNs = beginNs > _traceOriginNs ? beginNs - _traceOriginNs : 0;
+        _traceEvents.push_back({ &itr->first, frameIndex, startNs, durationNs, depth });
+    }
+
+    auto GpuZoneRecorder::GetZoneStats() const -> std::vector<GpuZoneStats>
+    {
+        std::vector<GpuZoneStats> result;
+        result.reserve(_zoneHistory.size());
+
+        for (const auto& [name, history] : _zoneHistory)
+        {
+            if (history.count == 0)
+                continue;
+
+            GpuZoneStats stats {};
+            stats.name = name;
+            stats.sampleCount = static_cast<uint32_t>(history.count);
+            stats.lastMs = history.samples[(history.head + history.samples.size() - 1) % history.samples.size()];
+            stats.minMs = history.samples[0];
+            stats.maxMs = history.samples[0];
+
+            double total = 0;
+            for (std::size_t i = 0; i < history.count; i++)
+            {
+                const double sample = history.samples[i];
+                total += sample;
+                stats.minMs = std::min(stats.minMs, sample);
+                stats.maxMs = std::max(stats.maxMs, sample);
+            }
+
+            stats.averageMs = total / static_cast<double>(history.count);
+            result.push_back(stats);
+        }
+
+        std::ranges::sort(result, [](const GpuZoneStats& a, const GpuZoneStats& b) -> bool { return a.name < b.name; });
+
+        return result;
+    }
+
+    auto GpuZoneRecorder::SetTraceEnabled(bool enable, std::size_t maxEvents) -> void
+    {
+        _traceEnabled = enable;
+        _maxTraceEvents = std::max<std::size_t>(maxEvents, 1);
+
+        while (_traceEvents.size() > _maxTraceEvents)
+            _traceEvents.pop_front();
+    }
+
+    // Chrome trace event format, open with chrome://tracing or Perfetto
+    auto GpuZoneRecorder::ExportTrace() const -> std::string
+    {
+        std::string result = "{\"traceEvents\":[";
+
+        bool first = true;
+        for (const auto& event : _traceEvents)
+        {
+            if (!first)
+                result += ",";
+
+            first = false;
+            result += "{\"name\":";
+            AppendJsonString(result, *event.pName);
+            result += std::format(R"(,"cat":"gpu","ph":"X","pid":0,"tid":0,"ts":{:.3f},"dur":{:.3f},"args":{{"frame":{},"depth":{}}}}})",
+                                  static_cast<double>(event.startNs) / 1000.0,
+                                  static_cast<double>(event.durationNs) / 1000.0,
+                                  event.frameIndex,
+                                  event.depth);
+        }
+
+        result += "]}";
+
+        return result;
+    }
+
+    auto GpuZoneRecorder::ExportTrace(const std::string& path) const -> bool
+    {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        file << ExportTrace();
+
+        return file.good();
+    }
+}
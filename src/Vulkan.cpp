@@ -1,87 +1,67 @@
 
-#include "NativeWinApp/Vulkan.h"
+#include <cstring>
+#include "NativeWinApp/VulkanLoader.h"
+
+#if defined(_WIN32)
+#   include "NativeWinApp/WindowsInclude.h"
+#endif
 
 namespace NWA
 {
-    class VulkanDllLoader
+    const std::vector<const char*>& Vulkan::GetRequiredInstanceExtensions(VulkanSurfaceType type)
     {
-    public:
-        VulkanDllLoader(const VulkanDllLoader&) = delete;
+        static std::vector<const char*> windowExtensions;
+        static std::vector<const char*> headlessExtensions;
 
-        ~VulkanDllLoader()
+        if (type == VulkanSurfaceType::Headless)
         {
-            if (_loaded)
+            if (headlessExtensions.empty())
             {
-                ::FreeLibrary(_hVulkanDll);
-                _hVulkanDll = nullptr;
-                _loaded = false;
+                headlessExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+                headlessExtensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
             }
-        }
-
-        static VulkanDllLoader& Get()
-        {
-            static VulkanDllLoader sLoader;
-
-            if (!sLoader._loaded)
-                sLoader.Load();
-
-            return sLoader;
-        }
-
-    private:
-        VulkanDllLoader() = default;
-
-        bool Load()
-        {
-            if (_hVulkanDll != nullptr)
-                return true;
-
-            _hVulkanDll = ::LoadLibraryA("vulkan-1.dll");
-
-            if (_hVulkanDll == nullptr)
-                return false;
-
-            _vkGetInstanceProcAddr = reinterpret_cast<PFN_vkGetInstanceProcAddr>(::GetProcAddress(_hVulkanDll, "vkGetInstanceProcAddr"));
-            if (_vkGetInstanceProcAddr == nullptr)
-            {
-                ::FreeLibrary(_hVulkanDll);
-                _hVulkanDll = nullptr;
-                return false;
-            }
-
-            _loaded = true;
 
-            return true;
+            return headlessExtensions;
         }
 
-    public:
-        PFN_vkGetInstanceProcAddr VkGetInstanceProcAddr() const
+        if (windowExtensions.empty())
         {
-            return _vkGetInstanceProcAddr;
+            windowExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+            windowExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
         }
 
-    private:
-        bool _loaded = false;
-        HMODULE _hVulkanDll = nullptr;
-        PFN_vkGetInstanceProcAddr _vkGetInstanceProcAddr = nullptr;
-    };
+        return windowExtensions;
+    }
 
-    const std::vector<const char*>& Vulkan::GetRequiredInstanceExtensions()
+    bool Vulkan::IsHeadlessSurfaceSupported()
     {
-        static std::vector<const char*> extensions;
+        const VulkanGlobalTable& globalTable = VulkanLoader::GetGlobalTable();
+        if (globalTable.vkEnumerateInstanceExtensionProperties == nullptr)
+            return false;
+
+        uint32_t extensionCount = 0;
+        if (globalTable.vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr) != VK_SUCCESS)
+            return false;
 
-        if (extensions.empty())
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        if (globalTable.vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data()) != VK_SUCCESS)
+            return false;
+
+        for (const auto& extension : extensions)
         {
-            extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
-            extensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+            if (std::strcmp(extension.extensionName, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME) == 0)
+                return true;
         }
 
-        return extensions;
+        return false;
     }
 
     bool Vulkan::CreateVulkanSurface(const VkInstance& instance, const Window& window, VkSurfaceKHR& surface, const VkAllocationCallbacks* allocator)
     {
-        const auto vkProcLoader = VulkanDllLoader::Get().VkGetInstanceProcAddr();
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+        const auto vkProcLoader = VulkanLoader::GetInstanceProcAddr();
         if (vkProcLoader == nullptr)
             return false;
 
@@ -95,5 +75,25 @@ namespace NWA
         surfaceCreateInfo.hwnd = static_cast<HWND>(window.GetSystemHandle());
 
         return vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, allocator, &surface) == VK_SUCCESS;
+#else
+        return false;
+#endif
+    }
+
+    bool Vulkan::CreateHeadlessSurface(const VkInstance& instance, VkSurfaceKHR& surface, const VkAllocationCallbacks* allocator)
+    {
+        const auto vkProcLoader = VulkanLoader::GetInstanceProcAddr();
+        if (vkProcLoader == nullptr)
+            return false;
+
+        // Null unless the instance was created with GetRequiredInstanceExtensions(Headless)
+        const auto vkCreateHeadlessSurfaceEXT = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(vkProcLoader(instance, "vkCreateHeadlessSurfaceEXT"));
+        if (vkCreateHeadlessSurfaceEXT == nullptr)
+            return false;
+
+        VkHeadlessSurfaceCreateInfoEXT surfaceCreateInfo {};
+        surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+
+        return vkCreateHeadlessSurfaceEXT(instance, &surfaceCreateInfo, allocator, &surface) == VK_SUCCESS;
     }
 }
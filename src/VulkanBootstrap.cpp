@@ -0,0 +1,368 @@
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "NativeWinApp/VulkanBootstrap.h"
+
+namespace NWA
+{
+    static constexpr uint32_t BOOTSTRAP_CACHE_MAGIC = 0x4E574142; // "NWAB"
+    static constexpr uint32_t BOOTSTRAP_CACHE_VERSION = 1;
+
+    // Layout of the cache file
+    struct BootstrapRecord
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint8_t uuid[VK_UUID_SIZE];
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint32_t graphicsQueueFamily;
+        uint64_t requirementHash;
+        uint32_t computeQueueFamily;
+        uint32_t transferQueueFamily;
+        uint32_t presentQueueFamily;
+        uint32_t padding;
+        int64_t score;
+    };
+
+    VulkanBootstrap::VulkanBootstrap(const VulkanInstanceTable& instanceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pInstance(&instanceTable)
+        , _createInfo(createInfo)
+        , _loadedFromCache(false)
+        , _selectionTime(0)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        if (_createInfo.instance == VK_NULL_HANDLE || _pInstance->vkEnumeratePhysicalDevices == nullptr)
+            return;
+
+        uint32_t deviceCount = 0;
+        _pInstance->vkEnumeratePhysicalDevices(_createInfo.instance, &deviceCount, nullptr);
+        std::vector<VkPhysicalDevice> physicalDevices(deviceCount);
+        _pInstance->vkEnumeratePhysicalDevices(_createInfo.instance, &deviceCount, physicalDevices.data());
+        physicalDevices.resize(deviceCount);
+
+        _loadedFromCache = LoadCache(physicalDevices);
+        _valid = _loadedFromCache;
+
+        if (!_valid)
+        {
+            for (VkPhysicalDevice physicalDevice : physicalDevices)
+            {
+                Selection candidate;
+                if (ProbeDevice(physicalDevice, candidate) && (!_valid || candidate.score > _selection.score))
+                {
+                    _selection = candidate;
+                    _valid = true;
+                }
+            }
+
+            if (_valid)
+                SaveCache();
+        }
+
+        _selectionTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    auto VulkanBootstrap::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanBootstrap::GetSelection() const -> const Selection&
+    {
+        return _selection;
+    }
+
+    auto VulkanBootstrap::GetQueueFamilies() const -> std::vector<uint32_t>
+    {
+        std::vector<uint32_t> families = { _selection.graphicsQueueFamily, _selection.computeQueueFamily, _selection.transferQueueFamily };
+        if (_selection.presentQueueFamily != VK_QUEUE_FAMILY_IGNORED)
+            families.push_back(_selection.presentQueueFamily);
+
+        std::ranges::sort(families);
+        families.erase(std::unique(families.begin(), families.end()), families.end());
+
+        return families;
+    }
+
+    auto VulkanBootstrap::IsLoadedFromCache() const -> bool
+    {
+        return _loadedFromCache;
+    }
+
+    auto VulkanBootstrap::GetSelectionTime() const -> std::chrono::microseconds
+    {
+        return _selectionTime;
+    }
+
+    auto VulkanBootstrap::GetDeviceKey(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties& properties) const -> DeviceKey
+    {
+        DeviceKey key {};
+
+        // Device UUID needs Vulkan 1.1, the pipeline cache UUID also changes with the driver
+        if (_pInstance->vkGetPhysicalDeviceProperties2 != nullptr)
+        {
+            VkPhysicalDeviceIDProperties idProperties {};
+            idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+            VkPhysicalDeviceProperties2 properties2 {};
+            properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties2.pNext = &idProperties;
+
+            _pInstance->vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+            properties = properties2.properties;
+            std::memcpy(key.uuid, idProperties.deviceUUID, VK_UUID_SIZE);
+        }
+        else
+        {
+            _pInstance->vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+            std::memcpy(key.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+        }
+
+        key.vendorID = properties.vendorID;
+        key.deviceID = properties.deviceID;
+        key.driverVersion = properties.driverVersion;
+
+        return key;
+    }
+
+    auto VulkanBootstrap::GetRequirementHash() const -> uint64_t
+    {
+        // FNV-1a over the extension names, a different surface kind or extension list probes again
+        uint64_t hash = 14695981039346656037ull;
+        const auto mix = [&hash](uint8_t value) -> void
+        {
+            hash ^= value;
+            hash *= 1099511628211ull;
+        };
+
+        mix(_createInfo.surface != VK_NULL_HANDLE ? 1 : 0);
+
+        for (const char* extension : _createInfo.requiredExtensions)
+        {
+            for (const char* c = extension; *c != '\0'; c++)
+                mix(static_cast<uint8_t>(*c));
+
+            mix(0);
+        }
+
+        return hash;
+    }
+
+    auto VulkanBootstrap::LoadCache(const std::vector<VkPhysicalDevice>& physicalDevices) -> bool
+    {
+        if (_createInfo.cachePath.empty())
+            return false;
+
+        BootstrapRecord record {};
+
+        {
+            std::ifstream file(_createInfo.cachePath, std::ios::in | std::ios::binary);
+            if (!file.is_open())
+                return false;
+
+            file.read(reinterpret_cast<char*>(&record), sizeof(record));
+            if (file.gcount() != sizeof(record))
+                return false;
+        }
+
+        if (record.magic != BOOTSTRAP_CACHE_MAGIC || record.version != BOOTSTRAP_CACHE_VERSION || record.requirementHash != GetRequirementHash())
+            return false;
+
+        for (VkPhysicalDevice physicalDevice : physicalDevices)
+        {
+            VkPhysicalDeviceProperties properties {};
+            const DeviceKey key = GetDeviceKey(physicalDevice, properties);
+
+            if (std::memcmp(key.uuid, record.uuid, VK_UUID_SIZE) != 0 || key.vendorID != record.vendorID
+                || key.deviceID != record.deviceID || key.driverVersion != record.driverVersion)
+                continue;
+
+            // The surface is new on every launch, one query confirms the cached family
+            if (_createInfo.surface != VK_NULL_HANDLE)
+            {
+                VkBool32 supported = VK_FALSE;
+                if (_pInstance->vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, record.presentQueueFamily, _createInfo.surface, &supported) != VK_SUCCESS || !supported)
+                    return false;
+            }
+
+            _selection.physicalDevice = physicalDevice;
+            _selection.properties = properties;
+            _selection.graphicsQueueFamily = record.graphicsQueueFamily;
+            _selection.computeQueueFamily = record.computeQueueFamily;
+            _selection.transferQueueFamily = record.transferQueueFamily;
+            _selection.presentQueueFamily = record.presentQueueFamily;
+            _selection.score = record.score;
+            return true;
+        }
+
+        return false;
+    }
+
+    auto VulkanBootstrap::SaveCache() const -> bool
+    {
+        if (_createInfo.cachePath.empty())
+            return false;
+
+        BootstrapRecord record {};
+        record.magic = BOOTSTRAP_CACHE_MAGIC;
+        record.version = BOOTSTRAP_CACHE_VERSION;
+        record.requirementHash = GetRequirementHash();
+        record.graphicsQueueFamily = _selection.graphicsQueueFamily;
+        record.computeQueueFamily = _selection.computeQueueFamily;
+        record.transferQueueFamily = _selection.transferQueueFamily;
+        record.presentQueueFamily = _selection.presentQueueFamily;
+        record.score = _selection.score;
+
+        VkPhysicalDeviceProperties properties {};
+        const DeviceKey key = GetDeviceKey(_selection.physicalDevice, properties);
+        std::memcpy(record.uuid, key.uuid, VK_UUID_SIZE);
+        record.vendorID = key.vendorID;
+        record.deviceID = key.deviceID;
+        record.driverVersion = key.driverVersion;
+
+        std::error_code errorCode;
+        const std::string tempPath = _createInfo.cachePath + ".tmp";
+
+        {
+            std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+                return false;
+
+            file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            file.flush();
+
+            if (!file.good())
+            {
+                file.close();
+                std::filesystem::remove(std::filesystem::path(tempPath), errorCode);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(std::filesystem::path(tempPath), std::filesystem::path(_createInfo.cachePath), errorCode);
+        if (errorCode)
+        {
+            std::filesystem::remove(std::filesystem::path(tempPath), errorCode);
+            return false;
+        }
+
+        return true;
+    }
+
+    auto VulkanBootstrap::ProbeDevice(VkPhysicalDevice physicalDevice, Selection& selection) const -> bool
+    {
+        VkPhysicalDeviceProperties properties {};
+        _pInstance->vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        // Required extensions
+        uint32_t extensionCount = 0;
+        _pInstance->vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        _pInstance->vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+        for (const char* required : _createInfo.requiredExtensions)
+        {
+            const bool found = std::ranges::any_of(extensions, [required](const VkExtensionProperties& extension) -> bool
+            {
+                return std::strcmp(extension.extensionName, required) == 0;
+            });
+
+            if (!found)
+                return false;
+        }
+
+        // Queue families
+        uint32_t queueFamilyCount = 0;
+        _pInstance->vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        _pInstance->vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        std::vector<bool> presents(queueFamilyCount, false);
+        if (_createInfo.surface != VK_NULL_HANDLE)
+        {
+            for (uint32_t i = 0; i < queueFamilyCount; i++)
+            {
+                VkBool32 supported = VK_FALSE;
+                _pInstance->vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, _createInfo.surface, &supported);
+                presents[i] = supported == VK_TRUE;
+            }
+        }
+
+        const auto findFamily = [&](VkQueueFlags required, VkQueueFlags excluded, bool present) -> int64_t
+        {
+            for (uint32_t i = 0; i < queueFamilyCount; i++)
+            {
+                const VkQueueFlags flags = queueFamilies[i].queueFlags;
+                if (queueFamilies[i].queueCount > 0 && (flags & required) == required && (flags & excluded) == 0 && (!present || presents[i]))
+                    return i;
+            }
+
+            return -1;
+        };
+
+        const bool needPresent = _createInfo.surface != VK_NULL_HANDLE;
+        const VkQueueFlags graphicsCompute = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+
+        // Graphics, ideally the family that presents as well so one queue does both
+        int64_t graphics = findFamily(graphicsCompute, 0, needPresent);
+        if (graphics < 0)
+            graphics = findFamily(graphicsCompute, 0, false);
+        if (graphics < 0)
+            return false;
+
+        int64_t present = VK_QUEUE_FAMILY_IGNORED;
+        if (needPresent)
+        {
+            present = presents[graphics] ? graphics : findFamily(0, 0, true);
+            if (present < 0)
+                return false;
+        }
+
+        const int64_t asyncCompute = findFamily(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT, false);
+        const int64_t dedicatedTransfer = findFamily(VK_QUEUE_TRANSFER_BIT, graphicsCompute, false);
+
+        selection.physicalDevice = physicalDevice;
+        selection.properties = properties;
+        selection.graphicsQueueFamily = static_cast<uint32_t>(graphics);
+        selection.presentQueueFamily = static_cast<uint32_t>(present);
+        selection.computeQueueFamily = static_cast<uint32_t>(asyncCompute >= 0 ? asyncCompute : graphics);
+        selection.transferQueueFamily = static_cast<uint32_t>(dedicatedTransfer >= 0 ? dedicatedTransfer : selection.computeQueueFamily);
+
+        // Device type first, then queue layout, then the largest texture as a tie breaker
+        switch (properties.deviceType)
+        {
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+                selection.score = 10000;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+                selection.score = 5000;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+                selection.score = 2000;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_CPU:
+                selection.score = 1000;
+                break;
+            default:
+                selection.score = 0;
+                break;
+        }
+
+        if (needPresent && present == graphics)
+            selection.score += 500;
+        if (asyncCompute >= 0)
+            selection.score += 100;
+        if (dedicatedTransfer >= 0)
+            selection.score += 100;
+
+        selection.score += properties.limits.maxImageDimension2D / 1024;
+
+        return true;
+    }
+}
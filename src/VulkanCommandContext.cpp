@@ -0,0 +1,170 @@
+
+#include "NativeWinApp/VulkanCommandContext.h"
+
+namespace NWA
+{
+    VulkanCommandContext::VulkanCommandContext(const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pDevice(&deviceTable)
+        , _createInfo(createInfo)
+        , _frameIndex(0)
+    {
+        if (_createInfo.framesInFlight == 0 || _createInfo.threadCount == 0)
+            return;
+
+        _pools.resize(static_cast<size_t>(_createInfo.framesInFlight) * _createInfo.threadCount);
+
+        // Transient without per-buffer reset, pools are only ever reset as a whole
+        VkCommandPoolCreateInfo poolInfo {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = _createInfo.queueFamilyIndex;
+
+        for (auto& pool : _pools)
+        {
+            if (_pDevice->vkCreateCommandPool(_pDevice->device, &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS)
+                return;
+        }
+
+        _valid = true;
+    }
+
+    VulkanCommandContext::~VulkanCommandContext()
+    {
+        // Destroying a pool frees its command buffers
+        for (auto& pool : _pools)
+        {
+            if (pool.commandPool != VK_NULL_HANDLE)
+                _pDevice->vkDestroyCommandPool(_pDevice->device, pool.commandPool, nullptr);
+        }
+    }
+
+    auto VulkanCommandContext::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanCommandContext::BeginFrame(uint32_t frameIndex) -> bool
+    {
+        if (!_valid || frameIndex >= _createInfo.framesInFlight)
+            return false;
+
+        _frameIndex = frameIndex;
+
+        bool result = true;
+        for (uint32_t i = 0; i < _createInfo.threadCount; i++)
+        {
+            auto& pool = _pools[static_cast<size_t>(_frameIndex) * _createInfo.threadCount + i];
+            if (pool.primaryUsed == 0 && pool.secondaryUsed == 0)
+                continue;
+
+            // Keeps the memory of the pool, the next frame records into the same allocations
+            if (_pDevice->vkResetCommandPool(_pDevice->device, pool.commandPool, 0) != VK_SUCCESS)
+                result = false;
+
+            pool.primaryUsed = 0;
+            pool.secondaryUsed = 0;
+        }
+
+        return result;
+    }
+
+    auto VulkanCommandContext::BeginPrimary(uint32_t threadIndex) -> VkCommandBuffer
+    {
+        ThreadPool* pPool = GetThreadPool(threadIndex);
+        if (pPool == nullptr)
+            return VK_NULL_HANDLE;
+
+        VkCommandBuffer commandBuffer = Allocate(*pPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+        if (commandBuffer == VK_NULL_HANDLE)
+            return VK_NULL_HANDLE;
+
+        VkCommandBufferBeginInfo beginInfo {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (_pDevice->vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        return commandBuffer;
+    }
+
+    auto VulkanCommandContext::BeginSecondary(uint32_t threadIndex, VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer) -> VkCommandBuffer
+    {
+        ThreadPool* pPool = GetThreadPool(threadIndex);
+        if (pPool == nullptr)
+            return VK_NULL_HANDLE;
+
+        VkCommandBuffer commandBuffer = Allocate(*pPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        if (commandBuffer == VK_NULL_HANDLE)
+            return VK_NULL_HANDLE;
+
+        VkCommandBufferInheritanceInfo inheritanceInfo {};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass;
+        inheritanceInfo.subpass = subpass;
+        inheritanceInfo.framebuffer = framebuffer;
+
+        VkCommandBufferBeginInfo beginInfo {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        if (_pDevice->vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        return commandBuffer;
+    }
+
+    auto VulkanCommandContext::GetThreadCount() const -> uint32_t
+    {
+        return _createInfo.threadCount;
+    }
+
+    auto VulkanCommandContext::GetFramesInFlight() const -> uint32_t
+    {
+        return _createInfo.framesInFlight;
+    }
+
+    auto VulkanCommandContext::GetAllocatedCount() const -> uint32_t
+    {
+        size_t count = 0;
+        for (const auto& pool : _pools)
+            count += pool.primaries.size() + pool.secondaries.size();
+
+        return static_cast<uint32_t>(count);
+    }
+
+    auto VulkanCommandContext::GetThreadPool(uint32_t threadIndex) -> ThreadPool*
+    {
+        if (!_valid || threadIndex >= _createInfo.threadCount)
+            return nullptr;
+
+        return &_pools[static_cast<size_t>(_frameIndex) * _createInfo.threadCount + threadIndex];
+    }
+
+    auto VulkanCommandContext::Allocate(ThreadPool& pool, VkCommandBufferLevel level) -> VkCommandBuffer
+    {
+        const bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        auto& commandBuffers = primary ? pool.primaries : pool.secondaries;
+        uint32_t& used = primary ? pool.primaryUsed : pool.secondaryUsed;
+
+        // Only the first frames allocate, later ones reuse what the pool reset left behind
+        if (used == commandBuffers.size())
+        {
+            VkCommandBufferAllocateInfo allocInfo {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = pool.commandPool;
+            allocInfo.level = level;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            if (_pDevice->vkAllocateCommandBuffers(_pDevice->device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+                return VK_NULL_HANDLE;
+
+            commandBuffers.push_back(commandBuffer);
+        }
+
+        return commandBuffers[used++];
+    }
+}
@@ -0,0 +1,304 @@
+
+#include <cstdio>
+#include <iostream>
+#include "NativeWinApp/VulkanDebugMessenger.h"
+
+namespace NWA
+{
+    // Copy up to maxLength characters, returns how many were copied
+    static uint32_t CopyBounded(char* pDestination, const char* pSource, uint32_t maxLength)
+    {
+        if (pSource == nullptr)
+            return 0;
+
+        uint32_t length = 0;
+        while (length < maxLength && pSource[length] != '\0')
+        {
+            pDestination[length] = pSource[length];
+            length++;
+        }
+
+        return length;
+    }
+
+    static const char* SeverityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+    {
+        switch (severity)
+        {
+            case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:
+                return "verbose";
+            case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:
+                return "info";
+            case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:
+                return "warning";
+            default:
+                return "error";
+        }
+    }
+
+    VulkanDebugMessenger::VulkanDebugMessenger(const VulkanInstanceTable& instanceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pInstance(&instanceTable)
+        , _createInfo(createInfo)
+        , _messenger(VK_NULL_HANDLE)
+        , _idSlots(new IdSlot[ID_TABLE_SIZE]())
+        , _ringStride(0)
+        , _ringHead(0)
+        , _ringTail(0)
+        , _sinkCount(0)
+        , _stop(false)
+        , _receivedCount(0)
+        , _queuedCount(0)
+        , _suppressedCount(0)
+        , _droppedCount(0)
+        , _uniqueIdCount(0)
+    {
+        if (_createInfo.instance == VK_NULL_HANDLE || _createInfo.ringCapacity == 0)
+            return;
+
+        if (_pInstance->vkCreateDebugUtilsMessengerEXT == nullptr || _pInstance->vkDestroyDebugUtilsMessengerEXT == nullptr)
+            return;
+
+        // Everything the callback writes to is allocated here
+        _ring.resize(_createInfo.ringCapacity);
+        _ringStride = static_cast<size_t>(MAX_ID_NAME_LENGTH) + _createInfo.maxMessageLength;
+        _ringText.resize(_ringStride * _createInfo.ringCapacity);
+
+        _formatThread = std::thread(&VulkanDebugMessenger::FormatThread, this);
+
+        VkDebugUtilsMessengerCreateInfoEXT messengerInfo {};
+        messengerInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+        messengerInfo.messageSeverity = _createInfo.severities;
+        messengerInfo.messageType = _createInfo.types;
+        messengerInfo.pfnUserCallback = Callback;
+        messengerInfo.pUserData = this;
+
+        if (_pInstance->vkCreateDebugUtilsMessengerEXT(_createInfo.instance, &messengerInfo, _createInfo.pAllocator, &_messenger) != VK_SUCCESS)
+        {
+            _messenger = VK_NULL_HANDLE;
+            return;
+        }
+
+        _valid = true;
+    }
+
+    VulkanDebugMessenger::~VulkanDebugMessenger()
+    {
+        // No callback after this, the thread drains the ring and stops
+        if (_messenger != VK_NULL_HANDLE)
+            _pInstance->vkDestroyDebugUtilsMessengerEXT(_createInfo.instance, _messenger, _createInfo.pAllocator);
+
+        if (_formatThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(_ringMutex);
+                _stop = true;
+            }
+
+            _ringCondition.notify_all();
+            _formatThread.join();
+        }
+    }
+
+    auto VulkanDebugMessenger::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanDebugMessenger::Flush() -> void
+    {
+        if (!_formatThread.joinable())
+            return;
+
+        std::unique_lock<std::mutex> lock(_ringMutex);
+        _flushCondition.wait(lock, [this]() -> bool { return _sinkCount == _ringHead; });
+    }
+
+    auto VulkanDebugMessenger::GetStatistics() const -> Statistics
+    {
+        Statistics statistics {};
+        statistics.receivedCount = _receivedCount.load();
+        statistics.queuedCount = _queuedCount.load();
+        statistics.suppressedCount = _suppressedCount.load();
+        statistics.droppedCount = _droppedCount.load();
+        statistics.uniqueIdCount = _uniqueIdCount.load();
+
+        return statistics;
+    }
+
+    auto VulkanDebugMessenger::Format(const Message& message) -> std::string
+    {
+        char id[32];
+        std::snprintf(id, sizeof(id), "0x%08x", static_cast<uint32_t>(message.messageIdNumber));
+
+        std::string result;
+        result.reserve(message.text.size() + message.messageIdName.size() + 64);
+
+        result += "vulkan ";
+        result += SeverityName(message.severity);
+        result += (message.types & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT) != 0 ? " [validation] " :
+            (message.types & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) != 0 ? " [performance] " : " [general] ";
+        result += message.messageIdName.empty() ? id : message.messageIdName + " (" + id + ")";
+        result += ": ";
+        result += message.text;
+
+        if (message.suppressedCount > 0)
+            result += " (" + std::to_string(message.suppressedCount) + " repeats suppressed)";
+
+        return result;
+    }
+
+    VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugMessenger::Callback(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types,
+        const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData)
+    {
+        if (pUserData != nullptr && pCallbackData != nullptr)
+            static_cast<VulkanDebugMessenger*>(pUserData)->OnMessage(severity, types, pCallbackData);
+
+        // Never abort the call that triggered the message
+        return VK_FALSE;
+    }
+
+    auto VulkanDebugMessenger::OnMessage(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData) -> void
+    {
+        _receivedCount++;
+
+        // The layers hash the VUID into the id number, the name tells apart ids without one
+        uint64_t hash = 14695981039346656037ull;
+        hash ^= static_cast<uint32_t>(pCallbackData->messageIdNumber);
+        hash *= 1099511628211ull;
+
+        if (pCallbackData->pMessageIdName != nullptr)
+        {
+            for (const char* c = pCallbackData->pMessageIdName; *c != '\0'; c++)
+            {
+                hash ^= static_cast<uint8_t>(*c);
+                hash *= 1099511628211ull;
+            }
+        }
+
+        // Zero marks a free slot
+        if (hash == 0)
+            hash = 1;
+
+        // A full id table stops deduplicating, nothing is lost
+        uint64_t suppressedCount = 0;
+        IdSlot* pSlot = FindIdSlot(hash);
+        if (pSlot != nullptr && !PassRateLimit(*pSlot, suppressedCount))
+        {
+            _suppressedCount++;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_ringMutex);
+
+            if (_ringHead - _ringTail == _ring.size())
+            {
+                _droppedCount++;
+                return;
+            }
+
+            const size_t index = static_cast<size_t>(_ringHead % _ring.size());
+            char* pText = _ringText.data() + index * _ringStride;
+
+            RingEntry& entry = _ring[index];
+            entry.severity = severity;
+            entry.types = types;
+            entry.messageIdNumber = pCallbackData->messageIdNumber;
+            entry.suppressedCount = suppressedCount;
+            entry.idNameLength = CopyBounded(pText, pCallbackData->pMessageIdName, MAX_ID_NAME_LENGTH);
+            entry.textLength = CopyBounded(pText + MAX_ID_NAME_LENGTH, pCallbackData->pMessage, _createInfo.maxMessageLength);
+
+            _ringHead++;
+        }
+
+        _queuedCount++;
+        _ringCondition.notify_one();
+    }
+
+    auto VulkanDebugMessenger::FindIdSlot(uint64_t hash) -> IdSlot*
+    {
+        const uint32_t start = static_cast<uint32_t>(hash % ID_TABLE_SIZE);
+        for (uint32_t i = 0; i < ID_TABLE_SIZE; i++)
+        {
+            IdSlot& slot = _idSlots[(start + i) % ID_TABLE_SIZE];
+
+            uint64_t current = slot.hash.load(std::memory_order_acquire);
+            if (current == hash)
+                return &slot;
+
+            if (current != 0)
+                continue;
+
+            // Claim the free slot, unless another thread just claimed it for the same id
+            if (slot.hash.compare_exchange_strong(current, hash, std::memory_order_acq_rel))
+            {
+                _uniqueIdCount++;
+                return &slot;
+            }
+
+            if (current == hash)
+                return &slot;
+        }
+
+        return nullptr;
+    }
+
+    auto VulkanDebugMessenger::PassRateLimit(IdSlot& slot, uint64_t& suppressedCount) -> bool
+    {
+        const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        const int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(_createInfo.rateInterval).count();
+
+        // First one to see the interval expire starts the next one, races only blur the count
+        int64_t start = slot.intervalStart.load(std::memory_order_relaxed);
+        if (now - start >= interval && slot.intervalStart.compare_exchange_strong(start, now, std::memory_order_relaxed))
+            slot.intervalCount.store(0, std::memory_order_relaxed);
+
+        if (slot.intervalCount.fetch_add(1, std::memory_order_relaxed) < _createInfo.maxPerInterval)
+        {
+            suppressedCount = slot.suppressedCount.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        slot.suppressedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto VulkanDebugMessenger::FormatThread() -> void
+    {
+        std::unique_lock<std::mutex> lock(_ringMutex);
+        while (true)
+        {
+            _ringCondition.wait(lock, [this]() -> bool { return _stop || _ringTail != _ringHead; });
+
+            // Drain before stopping
+            if (_ringTail == _ringHead)
+                return;
+
+            const size_t index = static_cast<size_t>(_ringTail % _ring.size());
+            const RingEntry& entry = _ring[index];
+            const char* pText = _ringText.data() + index * _ringStride;
+
+            Message message;
+            message.severity = entry.severity;
+            message.types = entry.types;
+            message.messageIdNumber = entry.messageIdNumber;
+            message.messageIdName.assign(pText, entry.idNameLength);
+            message.text.assign(pText + MAX_ID_NAME_LENGTH, entry.textLength);
+            message.suppressedCount = entry.suppressedCount;
+
+            // The slot is free again, the callback can go on while this one is written
+            _ringTail++;
+            lock.unlock();
+
+            if (_createInfo.sink)
+                _createInfo.sink(message);
+            else
+                std::cerr << Format(message) << '\n';
+
+            lock.lock();
+            _sinkCount++;
+            _flushCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,245 @@
+
+#include <algorithm>
+#include "NativeWinApp/VulkanDescriptorAllocator.h"
+
+namespace NWA
+{
+    VulkanDescriptorAllocator::VulkanDescriptorAllocator(const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pDevice(&deviceTable)
+        , _createInfo(createInfo)
+        , _frameIndex(0)
+        , _setsPerPool(createInfo.initialSetsPerPool)
+        , _poolCount(0)
+        , _fullPoolCount(0)
+        , _layoutCacheHits(0)
+    {
+        if (_createInfo.framesInFlight == 0 || _createInfo.initialSetsPerPool == 0 || _createInfo.ratios.empty())
+            return;
+
+        _createInfo.maxSetsPerPool = std::max(_createInfo.maxSetsPerPool, _createInfo.initialSetsPerPool);
+        _frames.resize(_createInfo.framesInFlight);
+
+        _valid = true;
+    }
+
+    VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+    {
+        // Destroying a pool frees its sets
+        for (auto& frame : _frames)
+        {
+            if (frame.current != VK_NULL_HANDLE)
+                _pDevice->vkDestroyDescriptorPool(_pDevice->device, frame.current, nullptr);
+
+            for (VkDescriptorPool pool : frame.full)
+                _pDevice->vkDestroyDescriptorPool(_pDevice->device, pool, nullptr);
+        }
+
+        for (VkDescriptorPool pool : _readyPools)
+            _pDevice->vkDestroyDescriptorPool(_pDevice->device, pool, nullptr);
+
+        for (auto& [key, layout] : _layouts)
+            _pDevice->vkDestroyDescriptorSetLayout(_pDevice->device, layout, nullptr);
+    }
+
+    auto VulkanDescriptorAllocator::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanDescriptorAllocator::BeginFrame(uint32_t frameIndex) -> bool
+    {
+        if (!_valid || frameIndex >= _createInfo.framesInFlight)
+            return false;
+
+        _frameIndex = frameIndex;
+        auto& frame = _frames[_frameIndex];
+
+        bool result = true;
+        if (frame.current != VK_NULL_HANDLE && _pDevice->vkResetDescriptorPool(_pDevice->device, frame.current, 0) != VK_SUCCESS)
+            result = false;
+
+        frame.currentSetCount = 0;
+
+        // Full pools go back to every frame, the slot keeps only the pool it was allocating from
+        for (VkDescriptorPool pool : frame.full)
+        {
+            if (_pDevice->vkResetDescriptorPool(_pDevice->device, pool, 0) != VK_SUCCESS)
+                result = false;
+
+            _readyPools.push_back(pool);
+        }
+
+        frame.full.clear();
+        return result;
+    }
+
+    auto VulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout layout, const void* pNext) -> VkDescriptorSet
+    {
+        if (!_valid)
+            return VK_NULL_HANDLE;
+
+        auto& frame = _frames[_frameIndex];
+        if (frame.current == VK_NULL_HANDLE)
+        {
+            frame.current = GetPool();
+            if (frame.current == VK_NULL_HANDLE)
+                return VK_NULL_HANDLE;
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pNext = pNext;
+        allocInfo.descriptorPool = frame.current;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        VkResult result = _pDevice->vkAllocateDescriptorSets(_pDevice->device, &allocInfo, &descriptorSet);
+
+        // Out of sets or of one descriptor type, move on to the next pool of the chain. A set that
+        // does not fit an empty pool never will, rotating would only grow the chain every call.
+        if ((result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) && frame.currentSetCount > 0)
+        {
+            frame.full.push_back(frame.current);
+            _fullPoolCount++;
+
+            frame.current = GetPool();
+            frame.currentSetCount = 0;
+            if (frame.current == VK_NULL_HANDLE)
+                return VK_NULL_HANDLE;
+
+            // The fresh pool stays current when this fails too, the next set may fit it
+            allocInfo.descriptorPool = frame.current;
+            result = _pDevice->vkAllocateDescriptorSets(_pDevice->device, &allocInfo, &descriptorSet);
+        }
+
+        if (result != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        frame.currentSetCount++;
+        return descriptorSet;
+    }
+
+    auto VulkanDescriptorAllocator::GetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings, VkDescriptorSetLayoutCreateFlags flags) -> VkDescriptorSetLayout
+    {
+        LayoutKey key;
+        key.flags = flags;
+        key.bindings.reserve(bindings.size());
+
+        for (const auto& binding : bindings)
+        {
+            LayoutBinding layoutBinding { binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags, {} };
+            if (binding.pImmutableSamplers != nullptr)
+                layoutBinding.immutableSamplers.assign(binding.pImmutableSamplers, binding.pImmutableSamplers + binding.descriptorCount);
+
+            key.bindings.push_back(std::move(layoutBinding));
+        }
+
+        // Binding order does not matter to Vulkan, it must not matter to the cache either
+        std::ranges::sort(key.bindings, {}, &LayoutBinding::binding);
+
+        if (auto itr = _layouts.find(key); itr != _layouts.end())
+        {
+            _layoutCacheHits++;
+            return itr->second;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.flags = flags;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+        if (_pDevice->vkCreateDescriptorSetLayout(_pDevice->device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        _layouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    auto VulkanDescriptorAllocator::GetPoolCount() const -> uint32_t
+    {
+        return _poolCount;
+    }
+
+    auto VulkanDescriptorAllocator::GetFullPoolCount() const -> uint64_t
+    {
+        return _fullPoolCount;
+    }
+
+    auto VulkanDescriptorAllocator::GetLayoutCount() const -> uint32_t
+    {
+        return static_cast<uint32_t>(_layouts.size());
+    }
+
+    auto VulkanDescriptorAllocator::GetLayoutCacheHitCount() const -> uint64_t
+    {
+        return _layoutCacheHits;
+    }
+
+    auto VulkanDescriptorAllocator::GetPool() -> VkDescriptorPool
+    {
+        if (!_readyPools.empty())
+        {
+            VkDescriptorPool pool = _readyPools.back();
+            _readyPools.pop_back();
+            return pool;
+        }
+
+        VkDescriptorPool pool = CreatePool(_setsPerPool);
+        if (pool != VK_NULL_HANDLE)
+            _setsPerPool = std::min(_setsPerPool + _setsPerPool / 2, _createInfo.maxSetsPerPool);
+
+        return pool;
+    }
+
+    auto VulkanDescriptorAllocator::CreatePool(uint32_t setCount) -> VkDescriptorPool
+    {
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        poolSizes.reserve(_createInfo.ratios.size());
+
+        for (const auto& ratio : _createInfo.ratios)
+            poolSizes.push_back({ ratio.type, std::max(1u, static_cast<uint32_t>(ratio.ratio * static_cast<float>(setCount))) });
+
+        // No FREE_DESCRIPTOR_SET_BIT, sets are only released by resetting the whole pool
+        VkDescriptorPoolCreateInfo poolInfo {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = setCount;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        if (_pDevice->vkCreateDescriptorPool(_pDevice->device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        _poolCount++;
+        return pool;
+    }
+
+    auto VulkanDescriptorAllocator::LayoutKeyHash::operator()(const LayoutKey& key) const -> size_t
+    {
+        // FNV-1a over the fields of every binding
+        uint64_t hash = 14695981039346656037ull;
+        const auto mix = [&hash](uint64_t value) -> void
+        {
+            hash ^= value;
+            hash *= 1099511628211ull;
+        };
+
+        mix(key.flags);
+        for (const auto& binding : key.bindings)
+        {
+            mix(binding.binding);
+            mix(static_cast<uint64_t>(binding.type));
+            mix(binding.count);
+            mix(binding.stageFlags);
+
+            for (VkSampler sampler : binding.immutableSamplers)
+                mix(reinterpret_cast<uint64_t>(sampler));
+        }
+
+        return static_cast<size_t>(hash);
+    }
+}
@@ -0,0 +1,339 @@
+
+#include <algorithm>
+#include "NativeWinApp/VulkanFrameScheduler.h"
+
+namespace NWA
+{
+    VulkanFrameScheduler::VulkanFrameScheduler(const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pDevice(&deviceTable)
+        , _framesInFlight(createInfo.framesInFlight)
+        , _frameIndex(0)
+        , _submitCount(0)
+    {
+        if (createInfo.queues.empty() || _framesInFlight == 0)
+            return;
+
+        if (_pDevice->vkWaitSemaphores == nullptr || _pDevice->vkGetSemaphoreCounterValue == nullptr)
+            return;
+
+        VkSemaphoreTypeCreateInfo typeCreateInfo {};
+        typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeCreateInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo {};
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreCreateInfo.pNext = &typeCreateInfo;
+
+        _timelines.resize(createInfo.queues.size());
+        for (size_t i = 0; i < _timelines.size(); i++)
+        {
+            _timelines[i].queue = createInfo.queues[i];
+            if (_pDevice->vkCreateSemaphore(_pDevice->device, &semaphoreCreateInfo, nullptr, &_timelines[i].semaphore) != VK_SUCCESS)
+                return;
+        }
+
+        _frameValues.assign(_framesInFlight, std::vector<uint64_t>(_timelines.size(), 0));
+
+        _valid = true;
+    }
+
+    VulkanFrameScheduler::~VulkanFrameScheduler()
+    {
+        if (_valid)
+            WaitIdle();
+
+        // Everything is finished or the device is lost, either way the deletions can run
+        for (size_t i = 0; i < _deletions.size(); i++)
+        {
+            if (_deletions[i].deleter)
+                _deletions[i].deleter();
+        }
+
+        for (size_t i = 0; i < _frameDeletions.size(); i++)
+            _frameDeletions[i]();
+
+        for (auto& timeline : _timelines)
+        {
+            if (timeline.semaphore != VK_NULL_HANDLE)
+                _pDevice->vkDestroySemaphore(_pDevice->device, timeline.semaphore, nullptr);
+        }
+    }
+
+    auto VulkanFrameScheduler::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanFrameScheduler::BeginFrame() -> bool
+    {
+        if (!_valid)
+            return false;
+
+        if (!WaitForValues(_frameValues[_frameIndex], UINT64_MAX))
+            return false;
+
+        Collect();
+        return true;
+    }
+
+    auto VulkanFrameScheduler::EndFrame() -> void
+    {
+        if (!_valid)
+            return;
+
+        auto& values = _frameValues[_frameIndex];
+        for (size_t i = 0; i < _timelines.size(); i++)
+            values[i] = _timelines[i].submittedValue;
+
+        for (auto& deleter : _frameDeletions)
+            _deletions.push_back({ values, std::move(deleter) });
+
+        _frameDeletions.clear();
+        _frameIndex = (_frameIndex + 1) % _framesInFlight;
+    }
+
+    auto VulkanFrameScheduler::GetFrameIndex() const -> uint32_t
+    {
+        return _frameIndex;
+    }
+
+    auto VulkanFrameScheduler::Submit(uint32_t queueIndex, std::span<const VkCommandBuffer> commandBuffers, std::span<const Wait> waits) -> std::optional<SyncPoint>
+    {
+        if (!_valid || queueIndex >= _timelines.size())
+            return std::nullopt;
+
+        Timeline& timeline = _timelines[queueIndex];
+
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        std::vector<uint64_t> waitValues;
+
+        for (const auto& wait : waits)
+        {
+            // Points the CPU already saw reached need no wait
+            if (wait.point.queueIndex >= _timelines.size() || wait.point.value <= _timelines[wait.point.queueIndex].completedValue)
+                continue;
+
+            waitSemaphores.push_back(_timelines[wait.point.queueIndex].semaphore);
+            waitStages.push_back(wait.stageMask);
+            waitValues.push_back(wait.point.value);
+        }
+
+        const uint64_t signalValue = timeline.submittedValue + 1;
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo {};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timelineSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineSubmitInfo.signalSemaphoreValueCount = 1;
+        timelineSubmitInfo.pSignalSemaphoreValues = &signalValue;
+
+        VkSubmitInfo submitInfo {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        submitInfo.pCommandBuffers = commandBuffers.data();
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &timeline.semaphore;
+
+        if (_pDevice->vkQueueSubmit(timeline.queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+            return std::nullopt;
+
+        timeline.submittedValue = signalValue;
+        _submitCount++;
+
+        return SyncPoint { queueIndex, signalValue };
+    }
+
+    auto VulkanFrameScheduler::Signal(uint32_t queueIndex) -> SyncPoint
+    {
+        if (!_valid || queueIndex >= _timelines.size())
+            return SyncPoint {};
+
+        _submitCount++;
+        return SyncPoint { queueIndex, ++_timelines[queueIndex].submittedValue };
+    }
+
+    auto VulkanFrameScheduler::CancelSignal(const SyncPoint& point) -> bool
+    {
+        if (!_valid || point.queueIndex >= _timelines.size() || _pDevice->vkSignalSemaphore == nullptr)
+            return false;
+
+        Timeline& timeline = _timelines[point.queueIndex];
+
+        // A host signal must not overtake the queue's pending signals of lower values
+        if (_pDevice->vkQueueWaitIdle(timeline.queue) != VK_SUCCESS)
+            return false;
+
+        _pDevice->vkGetSemaphoreCounterValue(_pDevice->device, timeline.semaphore, &timeline.completedValue);
+        if (point.value <= timeline.completedValue)
+            return true;
+
+        VkSemaphoreSignalInfo signalInfo {};
+        signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+        signalInfo.semaphore = timeline.semaphore;
+        signalInfo.value = point.value;
+
+        if (_pDevice->vkSignalSemaphore(_pDevice->device, &signalInfo) != VK_SUCCESS)
+            return false;
+
+        timeline.completedValue = point.value;
+        return true;
+    }
+
+    auto VulkanFrameScheduler::IsComplete(const SyncPoint& point) -> bool
+    {
+        if (!_valid || point.queueIndex >= _timelines.size())
+            return false;
+
+        Timeline& timeline = _timelines[point.queueIndex];
+        if (point.value <= timeline.completedValue)
+            return true;
+
+        _pDevice->vkGetSemaphoreCounterValue(_pDevice->device, timeline.semaphore, &timeline.completedValue);
+        return point.value <= timeline.completedValue;
+    }
+
+    auto VulkanFrameScheduler::WaitFor(const SyncPoint& point, uint64_t timeout) -> bool
+    {
+        if (!_valid || point.queueIndex >= _timelines.size())
+            return false;
+
+        std::vector<uint64_t> values(_timelines.size(), 0);
+        values[point.queueIndex] = point.value;
+
+        return WaitForValues(values, timeout);
+    }
+
+    auto VulkanFrameScheduler::WaitIdle() -> bool
+    {
+        if (!_valid)
+            return false;
+
+        std::vector<uint64_t> values(_timelines.size(), 0);
+        for (size_t i = 0; i < _timelines.size(); i++)
+            values[i] = _timelines[i].submittedValue;
+
+        return WaitForValues(values, UINT64_MAX);
+    }
+
+    auto VulkanFrameScheduler::Defer(std::function<void()> deleter) -> void
+    {
+        _frameDeletions.push_back(std::move(deleter));
+    }
+
+    auto VulkanFrameScheduler::Defer(const SyncPoint& point, std::function<void()> deleter) -> void
+    {
+        if (point.queueIndex >= _timelines.size())
+            return;
+
+        std::vector<uint64_t> values(_timelines.size(), 0);
+        values[point.queueIndex] = point.value;
+
+        _deletions.push_back({ std::move(values), std::move(deleter) });
+    }
+
+    auto VulkanFrameScheduler::Collect() -> uint32_t
+    {
+        if (_deletions.empty())
+            return 0;
+
+        // One counter read per queue, however many deletions are waiting
+        RefreshCompletedValues();
+
+        const auto isReached = [this](const Deletion& deletion) -> bool
+        {
+            for (size_t i = 0; i < _timelines.size(); i++)
+            {
+                if (deletion.values[i] > _timelines[i].completedValue)
+                    return false;
+            }
+
+            return true;
+        };
+
+        // Deleters run in the order they were deferred, the ones they defer wait for the next Collect
+        uint32_t count = 0;
+        const size_t deletionCount = _deletions.size();
+        for (size_t i = 0; i < deletionCount; i++)
+        {
+            if (!isReached(_deletions[i]))
+                continue;
+
+            std::function<void()> deleter = std::move(_deletions[i].deleter);
+            _deletions[i].deleter = nullptr;
+            deleter();
+            count++;
+        }
+
+        std::erase_if(_deletions, [](const Deletion& deletion) { return !deletion.deleter; });
+        return count;
+    }
+
+    auto VulkanFrameScheduler::GetSemaphore(uint32_t queueIndex) const -> VkSemaphore
+    {
+        return queueIndex < _timelines.size() ? _timelines[queueIndex].semaphore : VK_NULL_HANDLE;
+    }
+
+    auto VulkanFrameScheduler::GetSubmittedValue(uint32_t queueIndex) const -> uint64_t
+    {
+        return queueIndex < _timelines.size() ? _timelines[queueIndex].submittedValue : 0;
+    }
+
+    auto VulkanFrameScheduler::GetSubmitCount() const -> uint64_t
+    {
+        return _submitCount;
+    }
+
+    auto VulkanFrameScheduler::GetPendingDeletionCount() const -> uint32_t
+    {
+        return static_cast<uint32_t>(_deletions.size() + _frameDeletions.size());
+    }
+
+    auto VulkanFrameScheduler::RefreshCompletedValues() -> void
+    {
+        for (auto& timeline : _timelines)
+        {
+            if (timeline.completedValue < timeline.submittedValue)
+                _pDevice->vkGetSemaphoreCounterValue(_pDevice->device, timeline.semaphore, &timeline.completedValue);
+        }
+    }
+
+    auto VulkanFrameScheduler::WaitForValues(const std::vector<uint64_t>& values, uint64_t timeout) -> bool
+    {
+        std::vector<VkSemaphore> semaphores;
+        std::vector<uint64_t> waitValues;
+
+        for (size_t i = 0; i < _timelines.size(); i++)
+        {
+            if (values[i] > _timelines[i].completedValue)
+            {
+                semaphores.push_back(_timelines[i].semaphore);
+                waitValues.push_back(values[i]);
+            }
+        }
+
+        if (semaphores.empty())
+            return true;
+
+        VkSemaphoreWaitInfo waitInfo {};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = static_cast<uint32_t>(semaphores.size());
+        waitInfo.pSemaphores = semaphores.data();
+        waitInfo.pValues = waitValues.data();
+
+        if (_pDevice->vkWaitSemaphores(_pDevice->device, &waitInfo, timeout) != VK_SUCCESS)
+            return false;
+
+        // Every wait is reached, no need to read the counters back
+        for (size_t i = 0; i < _timelines.size(); i++)
+            _timelines[i].completedValue = std::max(_timelines[i].completedValue, values[i]);
+
+        return true;
+    }
+}
@@ -0,0 +1,149 @@
+
+#include <algorithm>
+#include "NativeWinApp/VulkanFrameSubmit.h"
+
+namespace NWA
+{
+    VulkanFrameSubmit::VulkanFrameSubmit(const VulkanDeviceTable& deviceTable)
+        : _pDevice(&deviceTable)
+    {
+    }
+
+    auto VulkanFrameSubmit::AddWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stageMask) -> void
+    {
+        for (auto& timelineWait : _timelineWaits)
+        {
+            if (timelineWait.semaphore == semaphore)
+            {
+                timelineWait.value = std::max(timelineWait.value, value);
+                timelineWait.stageMask |= stageMask;
+                return;
+            }
+        }
+
+        _timelineWaits.push_back({ semaphore, value, stageMask });
+    }
+
+    auto VulkanFrameSubmit::AddSignalSemaphore(VkSemaphore semaphore, uint64_t value) -> void
+    {
+        _timelineSignals.push_back(semaphore);
+        _timelineSignalValues.push_back(value);
+    }
+
+    auto VulkanFrameSubmit::Submit(VkQueue queue, std::span<const VkSemaphore> acquireSemaphores, std::span<const VkCommandBuffer> commandBuffers,
+        std::span<const VkSemaphore> presentSemaphores, VkFence fence) -> VkResult
+    {
+        // Acquire semaphores first, then the timeline waits. Values of binary semaphores are ignored.
+        std::vector<VkSemaphore> waitSemaphores(acquireSemaphores.begin(), acquireSemaphores.end());
+        std::vector<VkPipelineStageFlags> waitStages(acquireSemaphores.size(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        std::vector<uint64_t> waitValues(acquireSemaphores.size(), 0);
+
+        for (const auto& timelineWait : _timelineWaits)
+        {
+            waitSemaphores.push_back(timelineWait.semaphore);
+            waitStages.push_back(timelineWait.stageMask);
+            waitValues.push_back(timelineWait.value);
+        }
+
+        // Present semaphores first, then the timeline signals
+        std::vector<VkSemaphore> signalSemaphores(presentSemaphores.begin(), presentSemaphores.end());
+        std::vector<uint64_t> signalValues(presentSemaphores.size(), 0);
+
+        signalSemaphores.insert(signalSemaphores.end(), _timelineSignals.begin(), _timelineSignals.end());
+        signalValues.insert(signalValues.end(), _timelineSignalValues.begin(), _timelineSignalValues.end());
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo {};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timelineSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineSubmitInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo submitInfo {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = _timelineWaits.empty() && _timelineSignals.empty() ? nullptr : &timelineSubmitInfo;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        submitInfo.pCommandBuffers = commandBuffers.data();
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        const VkResult result = _pDevice->vkQueueSubmit(queue, 1, &submitInfo, fence);
+        if (result == VK_SUCCESS)
+            Clear();
+
+        return result;
+    }
+
+    auto VulkanFrameSubmit::SubmitEmpty(VkQueue queue, std::span<const VkSemaphore> acquireSemaphores, VkFence fence) -> bool
+    {
+        // The timeline waits still apply, a signaled value promises the work before it is done
+        std::vector<VkSemaphore> waitSemaphores(acquireSemaphores.begin(), acquireSemaphores.end());
+        std::vector<VkPipelineStageFlags> waitStages(acquireSemaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        std::vector<uint64_t> waitValues(acquireSemaphores.size(), 0);
+
+        for (const auto& timelineWait : _timelineWaits)
+        {
+            waitSemaphores.push_back(timelineWait.semaphore);
+            waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+            waitValues.push_back(timelineWait.value);
+        }
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo {};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timelineSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineSubmitInfo.signalSemaphoreValueCount = static_cast<uint32_t>(_timelineSignalValues.size());
+        timelineSubmitInfo.pSignalSemaphoreValues = _timelineSignalValues.data();
+
+        VkSubmitInfo submitInfo {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = _timelineWaits.empty() && _timelineSignals.empty() ? nullptr : &timelineSubmitInfo;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(_timelineSignals.size());
+        submitInfo.pSignalSemaphores = _timelineSignals.data();
+
+        const VkResult result = _pDevice->vkQueueSubmit(queue, 1, &submitInfo, fence);
+        if (result != VK_SUCCESS)
+            SignalFromHost(queue);
+
+        Clear();
+        return result == VK_SUCCESS;
+    }
+
+    auto VulkanFrameSubmit::SignalFromHost(VkQueue queue) -> void
+    {
+        if (_timelineSignals.empty() || _pDevice->vkSignalSemaphore == nullptr || _pDevice->vkGetSemaphoreCounterValue == nullptr)
+            return;
+
+        // Values reserved for the frame (e.g. VulkanFrameScheduler::Signal) would never be
+        // reached. Lower values still pending on the queue must be signaled first.
+        _pDevice->vkQueueWaitIdle(queue);
+
+        for (size_t i = 0; i < _timelineSignals.size(); i++)
+        {
+            uint64_t value = 0;
+            _pDevice->vkGetSemaphoreCounterValue(_pDevice->device, _timelineSignals[i], &value);
+            if (value >= _timelineSignalValues[i])
+                continue;
+
+            VkSemaphoreSignalInfo signalInfo {};
+            signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+            signalInfo.semaphore = _timelineSignals[i];
+            signalInfo.value = _timelineSignalValues[i];
+
+            _pDevice->vkSignalSemaphore(_pDevice->device, &signalInfo);
+        }
+    }
+
+    auto VulkanFrameSubmit::Clear() -> void
+    {
+        _timelineWaits.clear();
+        _timelineSignals.clear();
+        _timelineSignalValues.clear();
+    }
+}
@@ -0,0 +1,222 @@
+
+#include <algorithm>
+#include "NativeWinApp/VulkanGpuProfiler.h"
+
+namespace NWA
+{
+    VulkanGpuProfiler::VulkanGpuProfiler(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, VkPhysicalDevice physicalDevice,
+        uint32_t queueFamilyIndex, int latencyFrames, int maxZonesPerFrame, int rollingWindow)
+        : _valid(false)
+        , _enabled(true)
+        , _pDevice(&deviceTable)
+        , _maxZonesPerFrame(std::max(maxZonesPerFrame, 1))
+        , _timestampPeriod(1.0)
+        , _timestampMask(~uint64_t(0))
+        , _currentSlot(0)
+        , _commandBuffer(VK_NULL_HANDLE)
+        , _frameIndex(0)
+        , _droppedFrames(0)
+        , _recorder(rollingWindow)
+    {
+        if (instanceTable.vkGetPhysicalDeviceProperties == nullptr || instanceTable.vkGetPhysicalDeviceQueueFamilyProperties == nullptr)
+            return;
+
+        // Timestamp support is per queue family, zero valid bits means none
+        uint32_t queueFamilyCount = 0;
+        instanceTable.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        instanceTable.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        if (queueFamilyIndex >= queueFamilyCount)
+            return;
+
+        const uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+        if (validBits == 0)
+            return;
+
+        if (validBits < 64)
+            _timestampMask = (uint64_t(1) << validBits) - 1;
+
+        VkPhysicalDeviceProperties properties {};
+        instanceTable.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        _timestampPeriod = properties.limits.timestampPeriod;
+
+        // Need at least one frame between write and read back
+        _frameSlots.resize(std::max(latencyFrames, 2));
+
+        for (auto& slot : _frameSlots)
+        {
+            VkQueryPoolCreateInfo queryPoolCreateInfo {};
+            queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolCreateInfo.queryCount = static_cast<uint32_t>(_maxZonesPerFrame * 2);
+
+            if (_pDevice->vkCreateQueryPool(_pDevice->device, &queryPoolCreateInfo, nullptr, &slot.queryPool) != VK_SUCCESS)
+            {
+                slot.queryPool = VK_NULL_HANDLE;
+                return;
+            }
+
+            slot.zones.reserve(_maxZonesPerFrame);
+        }
+
+        _zoneStack.reserve(_maxZonesPerFrame);
+        _queryResults.resize(_maxZonesPerFrame * 2);
+
+        _valid = true;
+    }
+
+    VulkanGpuProfiler::~VulkanGpuProfiler()
+    {
+        for (auto& slot : _frameSlots)
+        {
+            if (slot.queryPool != VK_NULL_HANDLE)
+                _pDevice->vkDestroyQueryPool(_pDevice->device, slot.queryPool, nullptr);
+        }
+    }
+
+    auto VulkanGpuProfiler::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanGpuProfiler::BeginFrame(VkCommandBuffer commandBuffer) -> void
+    {
+        if (!_valid)
+            return;
+
+        // The slot was last used latencyFrames ago, the swapchain has just waited on that
+        // frame's fence so its results are normally available
+        FrameSlot& slot = _frameSlots[_currentSlot];
+        if (slot.pending && !ResolveSlot(slot))
+            _droppedFrames++;
+
+        slot.zones.clear();
+        slot.pending = false;
+
+        _commandBuffer = _enabled ? commandBuffer : VK_NULL_HANDLE;
+        if (_commandBuffer == VK_NULL_HANDLE)
+            return;
+
+        _pDevice->vkCmdResetQueryPool(_commandBuffer, slot.queryPool, 0, static_cast<uint32_t>(_maxZonesPerFrame * 2));
+    }
+
+    auto VulkanGpuProfiler::EndFrame() -> void
+    {
+        if (!_valid)
+            return;
+
+        // Close zones left open by the user
+        while (!_zoneStack.empty())
+            EndZone();
+
+        FrameSlot& finishedSlot = _frameSlots[_currentSlot];
+        finishedSlot.frameIndex = _frameIndex;
+        finishedSlot.pending = !finishedSlot.zones.empty();
+
+        _commandBuffer = VK_NULL_HANDLE;
+        _frameIndex++;
+        _currentSlot = (_currentSlot + 1) % _frameSlots.size();
+    }
+
+    auto VulkanGpuProfiler::BeginZone(const char* name) -> void
+    {
+        if (!_valid || _commandBuffer == VK_NULL_HANDLE)
+            return;
+
+        FrameSlot& slot = _frameSlots[_currentSlot];
+
+        // Out of queries, keep the stack balanced and skip this zone
+        if (static_cast<int>(slot.zones.size()) >= _maxZonesPerFrame)
+        {
+            _zoneStack.push_back(-1);
+            return;
+        }
+
+        const int zoneIndex = static_cast<int>(slot.zones.size());
+        slot.zones.push_back({ name, static_cast<int>(_zoneStack.size()) });
+        _zoneStack.push_back(zoneIndex);
+
+        _pDevice->vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.queryPool, static_cast<uint32_t>(zoneIndex * 2));
+    }
+
+    auto VulkanGpuProfiler::EndZone() -> void
+    {
+        if (!_valid || _zoneStack.empty())
+            return;
+
+        const int zoneIndex = _zoneStack.back();
+        _zoneStack.pop_back();
+
+        if (zoneIndex < 0 || _commandBuffer == VK_NULL_HANDLE)
+            return;
+
+        FrameSlot& slot = _frameSlots[_currentSlot];
+        _pDevice->vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot.queryPool, static_cast<uint32_t>(zoneIndex * 2 + 1));
+    }
+
+    auto VulkanGpuProfiler::SetEnabled(bool enable) -> void
+    {
+        _enabled = enable;
+    }
+
+    auto VulkanGpuProfiler::IsEnabled() const -> bool
+    {
+        return _enabled;
+    }
+
+    auto VulkanGpuProfiler::ResolveSlot(FrameSlot& slot) -> bool
+    {
+        // No wait flag: VK_NOT_READY as long as one of the queries is unavailable
+        const uint32_t queryCount = static_cast<uint32_t>(slot.zones.size() * 2);
+        const VkResult result = _pDevice->vkGetQueryPoolResults(_pDevice->device, slot.queryPool, 0, queryCount,
+            queryCount * sizeof(uint64_t), _queryResults.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+        if (result != VK_SUCCESS)
+            return false;
+
+        for (std::size_t i = 0; i < slot.zones.size(); i++)
+        {
+            const uint64_t beginTicks = _queryResults[i * 2] & _timestampMask;
+            const uint64_t endTicks = _queryResults[i * 2 + 1] & _timestampMask;
+            const uint64_t beginNs = static_cast<uint64_t>(static_cast<double>(beginTicks) * _timestampPeriod);
+
+            // Modular difference, the counter may wrap inside the zone with fewer than 64 valid bits
+            const uint64_t durationTicks = (endTicks - beginTicks) & _timestampMask;
+            const uint64_t durationNs = static_cast<uint64_t>(static_cast<double>(durationTicks) * _timestampPeriod);
+            _recorder.Record(slot.zones[i].name, slot.frameIndex, beginNs, durationNs, slot.zones[i].depth);
+        }
+
+        return true;
+    }
+
+    auto VulkanGpuProfiler::GetZoneStats() const -> std::vector<ZoneStats>
+    {
+        return _recorder.GetZoneStats();
+    }
+
+    auto VulkanGpuProfiler::GetDroppedFrameCount() const -> uint64_t
+    {
+        return _droppedFrames;
+    }
+
+    auto VulkanGpuProfiler::GetTimestampPeriod() const -> float
+    {
+        return static_cast<float>(_timestampPeriod);
+    }
+
+    auto VulkanGpuProfiler::SetTraceEnabled(bool enable, std::size_t maxEvents) -> void
+    {
+        _recorder.SetTraceEnabled(enable, maxEvents);
+    }
+
+    auto VulkanGpuProfiler::ExportTrace() const -> std::string
+    {
+        return _recorder.ExportTrace();
+    }
+
+    auto VulkanGpuProfiler::ExportTrace(const std::string& path) const -> bool
+    {
+        return _recorder.ExportTrace(path);
+    }
+}
@@ -0,0 +1,338 @@
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include "NativeWinApp/VulkanHostAllocator.h"
+
+#if defined(_WIN32)
+#   include <malloc.h>
+#endif
+
+namespace NWA
+{
+    static constexpr std::size_t HEADER_SIZE = 16;
+    static constexpr std::size_t MIN_SIZE_CLASS_SHIFT = 5;
+    static constexpr std::size_t CHUNK_SIZE = std::size_t(64) << 10;
+    static constexpr std::size_t CHUNK_ALIGNMENT = std::size_t(8) << 10;
+
+    enum class HostBlockSource: uint8_t
+    {
+        Arena,
+        Pool,
+        System,
+    };
+
+    // Right in front of every pointer handed to the driver
+    struct HostAllocationHeader
+    {
+        uint64_t size;
+        uint32_t blockOffset;
+        uint8_t scope;
+        HostBlockSource source;
+        uint16_t sizeClass;
+    };
+
+    static_assert(sizeof(HostAllocationHeader) == HEADER_SIZE);
+
+    static std::size_t AlignUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    static void* SystemAlloc(std::size_t size, std::size_t alignment)
+    {
+#if defined(_WIN32)
+        return ::_aligned_malloc(size, alignment);
+#else
+        return std::aligned_alloc(alignment, AlignUp(size, alignment));
+#endif
+    }
+
+    static void SystemFree(void* pMemory)
+    {
+#if defined(_WIN32)
+        ::_aligned_free(pMemory);
+#else
+        std::free(pMemory);
+#endif
+    }
+
+    VulkanHostAllocator::VulkanHostAllocator(std::size_t arenaSize)
+        : _callbacks()
+        , _arena(std::min<std::size_t>(arenaSize, UINT32_MAX))
+        , _arenaState(0)
+        , _arenaPeak(0)
+        , _arenaOverflows(0)
+        , _poolChunks(0)
+    {
+        _callbacks.pUserData = this;
+        _callbacks.pfnAllocation = &VulkanHostAllocator::Allocation;
+        _callbacks.pfnReallocation = &VulkanHostAllocator::Reallocation;
+        _callbacks.pfnFree = &VulkanHostAllocator::Free;
+        _callbacks.pfnInternalAllocation = &VulkanHostAllocator::InternalAllocation;
+        _callbacks.pfnInternalFree = &VulkanHostAllocator::InternalFree;
+    }
+
+    VulkanHostAllocator::~VulkanHostAllocator()
+    {
+        for (auto& pool : _pools)
+        {
+            for (void* pChunk : pool.chunks)
+                SystemFree(pChunk);
+        }
+    }
+
+    auto VulkanHostAllocator::GetCallbacks() const -> const VkAllocationCallbacks*
+    {
+        return &_callbacks;
+    }
+
+    auto VulkanHostAllocator::EndFrame() -> void
+    {
+        for (auto& counters : _scopes)
+        {
+            const uint64_t totalCount = counters.totalCount.load(std::memory_order_relaxed);
+            counters.frameCount = totalCount - counters.frameStartCount;
+            counters.frameStartCount = totalCount;
+        }
+    }
+
+    auto VulkanHostAllocator::GetStats() const -> Stats
+    {
+        Stats stats {};
+
+        for (std::size_t i = 0; i < SCOPE_COUNT; i++)
+        {
+            const ScopeCounters& counters = _scopes[i];
+            stats.scopes[i].liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+            stats.scopes[i].liveCount = counters.liveCount.load(std::memory_order_relaxed);
+            stats.scopes[i].peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+            stats.scopes[i].totalCount = counters.totalCount.load(std::memory_order_relaxed);
+            stats.scopes[i].frameCount = counters.frameCount;
+            stats.scopes[i].internalBytes = counters.internalBytes.load(std::memory_order_relaxed);
+        }
+
+        stats.arenaCapacity = _arena.size();
+        stats.arenaPeakBytes = _arenaPeak.load(std::memory_order_relaxed);
+        stats.arenaOverflowCount = _arenaOverflows.load(std::memory_order_relaxed);
+        stats.poolChunkCount = _poolChunks.load(std::memory_order_relaxed);
+
+        return stats;
+    }
+
+    VKAPI_ATTR void* VKAPI_CALL VulkanHostAllocator::Allocation(void* pUserData, std::size_t size, std::size_t alignment, VkSystemAllocationScope scope)
+    {
+        return static_cast<VulkanHostAllocator*>(pUserData)->Allocate(size, alignment, scope);
+    }
+
+    VKAPI_ATTR void* VKAPI_CALL VulkanHostAllocator::Reallocation(void* pUserData, void* pOriginal, std::size_t size, std::size_t alignment, VkSystemAllocationScope scope)
+    {
+        auto* pAllocator = static_cast<VulkanHostAllocator*>(pUserData);
+
+        if (pOriginal == nullptr)
+            return pAllocator->Allocate(size, alignment, scope);
+
+        if (size == 0)
+        {
+            pAllocator->Deallocate(pOriginal);
+            return nullptr;
+        }
+
+        // The original stays untouched when the new allocation fails
+        void* pMemory = pAllocator->Allocate(size, alignment, scope);
+        if (pMemory == nullptr)
+            return nullptr;
+
+        const auto* pHeader = reinterpret_cast<const HostAllocationHeader*>(static_cast<std::byte*>(pOriginal) - HEADER_SIZE);
+        std::memcpy(pMemory, pOriginal, std::min<std::size_t>(size, pHeader->size));
+
+        pAllocator->Deallocate(pOriginal);
+        return pMemory;
+    }
+
+    VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::Free(void* pUserData, void* pMemory)
+    {
+        if (pMemory != nullptr)
+            static_cast<VulkanHostAllocator*>(pUserData)->Deallocate(pMemory);
+    }
+
+    VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::InternalAllocation(void* pUserData, std::size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+    {
+        static_cast<VulkanHostAllocator*>(pUserData)->_scopes[scope].internalBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    VKAPI_ATTR void VKAPI_CALL VulkanHostAllocator::InternalFree(void* pUserData, std::size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+    {
+        static_cast<VulkanHostAllocator*>(pUserData)->_scopes[scope].internalBytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    auto VulkanHostAllocator::Allocate(std::size_t size, std::size_t alignment, VkSystemAllocationScope scope) -> void*
+    {
+        if (size == 0 || scope >= SCOPE_COUNT)
+            return nullptr;
+
+        // The header space keeps the pointer aligned, alignments are powers of two
+        const std::size_t headerSpace = std::max(HEADER_SIZE, alignment);
+        const std::size_t blockSize = headerSpace + size;
+
+        std::byte* pBlock = nullptr;
+        HostBlockSource source = HostBlockSource::System;
+        std::size_t sizeClass = 0;
+
+        if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+        {
+            pBlock = static_cast<std::byte*>(AllocateFromArena(blockSize, headerSpace));
+            source = HostBlockSource::Arena;
+
+            if (pBlock == nullptr)
+                _arenaOverflows.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (pBlock == nullptr)
+        {
+            // Class of the next power of two, the slot alignment is its size
+            sizeClass = std::bit_width(std::max<std::size_t>(blockSize, std::size_t(1) << MIN_SIZE_CLASS_SHIFT) - 1) - MIN_SIZE_CLASS_SHIFT;
+            if (sizeClass < SIZE_CLASS_COUNT)
+            {
+                pBlock = static_cast<std::byte*>(AllocateFromPool(sizeClass));
+                source = HostBlockSource::Pool;
+            }
+        }
+
+        if (pBlock == nullptr)
+        {
+            pBlock = static_cast<std::byte*>(SystemAlloc(blockSize, headerSpace));
+            source = HostBlockSource::System;
+        }
+
+        if (pBlock == nullptr)
+            return nullptr;
+
+        std::byte* pMemory = pBlock + headerSpace;
+
+        auto* pHeader = reinterpret_cast<HostAllocationHeader*>(pMemory - HEADER_SIZE);
+        pHeader->size = size;
+        pHeader->blockOffset = static_cast<uint32_t>(headerSpace);
+        pHeader->scope = static_cast<uint8_t>(scope);
+        pHeader->source = source;
+        pHeader->sizeClass = static_cast<uint16_t>(sizeClass);
+
+        ScopeCounters& counters = _scopes[scope];
+        const uint64_t liveBytes = counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        counters.liveCount.fetch_add(1, std::memory_order_relaxed);
+        counters.totalCount.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+        while (liveBytes > peakBytes && !counters.peakBytes.compare_exchange_weak(peakBytes, liveBytes, std::memory_order_relaxed))
+        {
+        }
+
+        return pMemory;
+    }
+
+    auto VulkanHostAllocator::Deallocate(void* pMemory) -> void
+    {
+        const auto* pHeader = reinterpret_cast<const HostAllocationHeader*>(static_cast<std::byte*>(pMemory) - HEADER_SIZE);
+
+        ScopeCounters& counters = _scopes[pHeader->scope];
+        counters.liveBytes.fetch_sub(pHeader->size, std::memory_order_relaxed);
+        counters.liveCount.fetch_sub(1, std::memory_order_relaxed);
+
+        std::byte* pBlock = static_cast<std::byte*>(pMemory) - pHeader->blockOffset;
+
+        switch (pHeader->source)
+        {
+        case HostBlockSource::Arena:
+            FreeToArena();
+            break;
+        case HostBlockSource::Pool:
+            FreeToPool(pHeader->sizeClass, pBlock);
+            break;
+        case HostBlockSource::System:
+            SystemFree(pBlock);
+            break;
+        }
+    }
+
+    auto VulkanHostAllocator::AllocateFromArena(std::size_t blockSize, std::size_t alignment) -> void*
+    {
+        // State is live count in the high half, head in the low half
+        const auto base = reinterpret_cast<std::uintptr_t>(_arena.data());
+        uint64_t state = _arenaState.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            const uint64_t liveCount = state >> 32;
+            const uint64_t head = state & UINT32_MAX;
+
+            const uint64_t offset = AlignUp(base + head, alignment) - base;
+            const uint64_t end = offset + blockSize;
+            if (end > _arena.size())
+                return nullptr;
+
+            if (_arenaState.compare_exchange_weak(state, ((liveCount + 1) << 32) | end, std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                uint64_t peak = _arenaPeak.load(std::memory_order_relaxed);
+                while (end > peak && !_arenaPeak.compare_exchange_weak(peak, end, std::memory_order_relaxed))
+                {
+                }
+
+                return _arena.data() + offset;
+            }
+        }
+    }
+
+    auto VulkanHostAllocator::FreeToArena() -> void
+    {
+        // The last live allocation rewinds the arena, a command's allocations never outlive it
+        uint64_t state = _arenaState.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            const uint64_t liveCount = (state >> 32) - 1;
+            const uint64_t head = liveCount == 0 ? 0 : (state & UINT32_MAX);
+
+            if (_arenaState.compare_exchange_weak(state, (liveCount << 32) | head, std::memory_order_acq_rel, std::memory_order_relaxed))
+                return;
+        }
+    }
+
+    auto VulkanHostAllocator::AllocateFromPool(std::size_t sizeClass) -> void*
+    {
+        Pool& pool = _pools[sizeClass];
+        std::lock_guard<std::mutex> lock(pool.mutex);
+
+        if (pool.pFreeList == nullptr)
+        {
+            auto* pChunk = static_cast<std::byte*>(SystemAlloc(CHUNK_SIZE, CHUNK_ALIGNMENT));
+            if (pChunk == nullptr)
+                return nullptr;
+
+            pool.chunks.push_back(pChunk);
+            _poolChunks.fetch_add(1, std::memory_order_relaxed);
+
+            // Thread the chunk's slots into the free list
+            const std::size_t slotSize = std::size_t(1) << (sizeClass + MIN_SIZE_CLASS_SHIFT);
+            for (std::size_t offset = CHUNK_SIZE; offset >= slotSize; offset -= slotSize)
+            {
+                void* pSlot = pChunk + offset - slotSize;
+                *static_cast<void**>(pSlot) = pool.pFreeList;
+                pool.pFreeList = pSlot;
+            }
+        }
+
+        void* pSlot = pool.pFreeList;
+        pool.pFreeList = *static_cast<void**>(pSlot);
+        return pSlot;
+    }
+
+    auto VulkanHostAllocator::FreeToPool(std::size_t sizeClass, void* pBlock) -> void
+    {
+        Pool& pool = _pools[sizeClass];
+        std::lock_guard<std::mutex> lock(pool.mutex);
+
+        *static_cast<void**>(pBlock) = pool.pFreeList;
+        pool.pFreeList = pBlock;
+    }
+}
@@ -0,0 +1,166 @@
+
+#include "NativeWinApp/VulkanLoader.h"
+
+#if defined(_WIN32)
+#   include "NativeWinApp/WindowsInclude.h"
+#else
+#   include <dlfcn.h>
+#endif
+
+namespace NWA
+{
+    class VulkanLibrary
+    {
+    public:
+        VulkanLibrary(const VulkanLibrary&) = delete;
+
+        ~VulkanLibrary()
+        {
+            if (_hLibrary != nullptr)
+            {
+#if defined(_WIN32)
+                ::FreeLibrary(static_cast<HMODULE>(_hLibrary));
+#else
+                ::dlclose(_hLibrary);
+#endif
+                _hLibrary = nullptr;
+            }
+        }
+
+        static VulkanLibrary& Get()
+        {
+            static VulkanLibrary sLibrary;
+
+            if (sLibrary._hLibrary == nullptr)
+                sLibrary.Load();
+
+            return sLibrary;
+        }
+
+    private:
+        VulkanLibrary() = default;
+
+        bool Load()
+        {
+#if defined(_WIN32)
+            _hLibrary = ::LoadLibraryA("vulkan-1.dll");
+#else
+            _hLibrary = ::dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+            if (_hLibrary == nullptr)
+                _hLibrary = ::dlopen("libvulkan.so", RTLD_NOW | RTLD_LOCAL);
+#endif
+
+            if (_hLibrary == nullptr)
+                return false;
+
+#if defined(_WIN32)
+            _vkGetInstanceProcAddr = reinterpret_cast<PFN_vkGetInstanceProcAddr>(::GetProcAddress(static_cast<HMODULE>(_hLibrary), "vkGetInstanceProcAddr"));
+#else
+            _vkGetInstanceProcAddr = reinterpret_cast<PFN_vkGetInstanceProcAddr>(::dlsym(_hLibrary, "vkGetInstanceProcAddr"));
+#endif
+
+            if (_vkGetInstanceProcAddr == nullptr)
+            {
+#if defined(_WIN32)
+                ::FreeLibrary(static_cast<HMODULE>(_hLibrary));
+#else
+                ::dlclose(_hLibrary);
+#endif
+                _hLibrary = nullptr;
+                return false;
+            }
+
+            // Global functions are queried with a null instance
+#define NWA_VK_LOAD_FUNCTION(name) _globalTable.name = reinterpret_cast<PFN_##name>(_vkGetInstanceProcAddr(VK_NULL_HANDLE, #name));
+            NWA_VK_GLOBAL_FUNCTIONS(NWA_VK_LOAD_FUNCTION)
+#undef NWA_VK_LOAD_FUNCTION
+
+            return true;
+        }
+
+    public:
+        bool IsLoaded() const
+        {
+            return _hLibrary != nullptr;
+        }
+
+        PFN_vkGetInstanceProcAddr VkGetInstanceProcAddr() const
+        {
+            return _vkGetInstanceProcAddr;
+        }
+
+        const VulkanGlobalTable& GlobalTable() const
+        {
+            return _globalTable;
+        }
+
+    private:
+        void* _hLibrary = nullptr;
+        PFN_vkGetInstanceProcAddr _vkGetInstanceProcAddr = nullptr;
+        VulkanGlobalTable _globalTable;
+    };
+
+    bool VulkanLoader::Initialize()
+    {
+        return VulkanLibrary::Get().IsLoaded();
+    }
+
+    PFN_vkGetInstanceProcAddr VulkanLoader::GetInstanceProcAddr()
+    {
+        return VulkanLibrary::Get().VkGetInstanceProcAddr();
+    }
+
+    const VulkanGlobalTable& VulkanLoader::GetGlobalTable()
+    {
+        return VulkanLibrary::Get().GlobalTable();
+    }
+
+    bool VulkanLoader::LoadInstanceTable(VkInstance instance, VulkanInstanceTable& table)
+    {
+        const auto vkGetInstanceProcAddr = GetInstanceProcAddr();
+        if (vkGetInstanceProcAddr == nullptr || instance == VK_NULL_HANDLE)
+            return false;
+
+        table = VulkanInstanceTable();
+        table.instance = instance;
+
+#define NWA_VK_LOAD_FUNCTION(name) table.name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name));
+        NWA_VK_INSTANCE_FUNCTIONS(NWA_VK_LOAD_FUNCTION)
+#undef NWA_VK_LOAD_FUNCTION
+
+        // Promoted in 1.1, instances created with a 1.0 api only expose VK_KHR_get_physical_device_properties2
+        if (table.vkGetPhysicalDeviceMemoryProperties2 == nullptr)
+            table.vkGetPhysicalDeviceMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+
+        return table.vkGetDeviceProcAddr != nullptr;
+    }
+
+    bool VulkanLoader::LoadDeviceTable(const VulkanInstanceTable& instanceTable, VkDevice device, VulkanDeviceTable& table)
+    {
+        const auto vkGetDeviceProcAddr = instanceTable.vkGetDeviceProcAddr;
+        if (vkGetDeviceProcAddr == nullptr || device == VK_NULL_HANDLE)
+            return false;
+
+        table = VulkanDeviceTable();
+        table.device = device;
+
+#define NWA_VK_LOAD_FUNCTION(name) table.name = reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name));
+        NWA_VK_DEVICE_FUNCTIONS(NWA_VK_LOAD_FUNCTION)
+#undef NWA_VK_LOAD_FUNCTION
+
+        // Promoted in 1.2, devices created with a 1.0/1.1 api only expose the extension names
+        if (table.vkGetSemaphoreCounterValue == nullptr)
+            table.vkGetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValue>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+
+        if (table.vkWaitSemaphores == nullptr)
+            table.vkWaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphores>(vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+
+        if (table.vkSignalSemaphore == nullptr)
+            table.vkSignalSemaphore = reinterpret_cast<PFN_vkSignalSemaphore>(vkGetDeviceProcAddr(device, "vkSignalSemaphoreKHR"));
+
+        if (table.vkResetQueryPool == nullptr)
+            table.vkResetQueryPool = reinterpret_cast<PFN_vkResetQueryPool>(vkGetDeviceProcAddr(device, "vkResetQueryPoolEXT"));
+
+        return table.vkDestroyDevice != nullptr;
+    }
+}
@@ -0,0 +1,984 @@
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include "NativeWinApp/VulkanMemoryAllocator.h"
+
+namespace NWA
+{
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static VkDeviceSize AlignDown(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return value / alignment * alignment;
+    }
+
+    // Two level segregated fit over one block. Free ranges are bucketed by size class, a power
+    // of two split in 16 linear steps, and two bitmap levels find a fitting bucket in constant
+    // time. Ranges are linked in address order so a free merges with its free neighbours.
+    class Tlsf
+    {
+    public:
+        static constexpr uint32_t NULL_NODE = UINT32_MAX;
+
+    public:
+        explicit Tlsf(VkDeviceSize size)
+            : _firstNode(NULL_NODE)
+            , _flBitmap(0)
+            , _slBitmaps()
+            , _size(size)
+            , _usedBytes(0)
+        {
+            _freeHeads.fill(NULL_NODE);
+
+            _firstNode = NewNode();
+            _nodes[_firstNode].offset = 0;
+            _nodes[_firstNode].size = AlignDown(size, MIN_SIZE);
+            InsertFree(_firstNode);
+        }
+
+        // Node of the allocated range, its offset is aligned
+        auto Allocate(VkDeviceSize size, VkDeviceSize alignment) -> uint32_t
+        {
+            size = AlignUp(std::max(size, MIN_SIZE), MIN_SIZE);
+            alignment = std::max(alignment, MIN_SIZE);
+
+            // Offsets are multiples of MIN_SIZE, so this is the worst case padding
+            const uint32_t node = FindFree(size + alignment - MIN_SIZE);
+            if (node == NULL_NODE)
+                return NULL_NODE;
+
+            RemoveFree(node);
+
+            const VkDeviceSize padding = AlignUp(_nodes[node].offset, alignment) - _nodes[node].offset;
+            if (padding > 0)
+            {
+                // Free neighbours are always merged, the previous range is in use
+                const uint32_t front = NewNode();
+                _nodes[front].offset = _nodes[node].offset;
+                _nodes[front].size = padding;
+                _nodes[front].prevPhysical = _nodes[node].prevPhysical;
+                _nodes[front].nextPhysical = node;
+
+                if (_nodes[front].prevPhysical != NULL_NODE)
+                    _nodes[_nodes[front].prevPhysical].nextPhysical = front;
+                else
+                    _firstNode = front;
+
+                _nodes[node].prevPhysical = front;
+                _nodes[node].offset += padding;
+                _nodes[node].size -= padding;
+                InsertFree(front);
+            }
+
+            if (_nodes[node].size - size >= MIN_SIZE)
+            {
+                const uint32_t back = NewNode();
+                _nodes[back].offset = _nodes[node].offset + size;
+                _nodes[back].size = _nodes[node].size - size;
+                _nodes[back].prevPhysical = node;
+                _nodes[back].nextPhysical = _nodes[node].nextPhysical;
+
+                if (_nodes[back].nextPhysical != NULL_NODE)
+                    _nodes[_nodes[back].nextPhysical].prevPhysical = back;
+
+                _nodes[node].nextPhysical = back;
+                _nodes[node].size = size;
+                InsertFree(back);
+            }
+
+            _nodes[node].free = false;
+            _nodes[node].alignment = alignment;
+            _usedBytes += _nodes[node].size;
+            return node;
+        }
+
+        auto Free(uint32_t node) -> void
+        {
+            _usedBytes -= _nodes[node].size;
+            _nodes[node].free = true;
+            _nodes[node].pUserData = nullptr;
+
+            const uint32_t prev = _nodes[node].prevPhysical;
+            if (prev != NULL_NODE && _nodes[prev].free)
+            {
+                RemoveFree(prev);
+                Absorb(prev, node);
+                node = prev;
+            }
+
+            const uint32_t next = _nodes[node].nextPhysical;
+            if (next != NULL_NODE && _nodes[next].free)
+            {
+                RemoveFree(next);
+                Absorb(node, next);
+            }
+
+            InsertFree(node);
+        }
+
+        auto GetOffset(uint32_t node) const -> VkDeviceSize
+        {
+            return _nodes[node].offset;
+        }
+
+        auto GetSize(uint32_t node) const -> VkDeviceSize
+        {
+            return _nodes[node].size;
+        }
+
+        auto GetAlignment(uint32_t node) const -> VkDeviceSize
+        {
+            return _nodes[node].alignment;
+        }
+
+        auto GetUserData(uint32_t node) const -> void*
+        {
+            return _nodes[node].pUserData;
+        }
+
+        auto SetUserData(uint32_t node, void* pUserData) -> void
+        {
+            _nodes[node].pUserData = pUserData;
+        }
+
+        // In address order
+        auto GetUsedNodes() const -> std::vector<uint32_t>
+        {
+            std::vector<uint32_t> usedNodes;
+            for (uint32_t node = _firstNode; node != NULL_NODE; node = _nodes[node].nextPhysical)
+            {
+                if (!_nodes[node].free)
+                    usedNodes.push_back(node);
+            }
+
+            return usedNodes;
+        }
+
+        auto GetUsedBytes() const -> VkDeviceSize
+        {
+            return _usedBytes;
+        }
+
+        auto GetFreeBytes() const -> VkDeviceSize
+        {
+            return AlignDown(_size, MIN_SIZE) - _usedBytes;
+        }
+
+        auto IsEmpty() const -> bool
+        {
+            return _usedBytes == 0;
+        }
+
+        auto GetFreeRangeCount() const -> uint64_t
+        {
+            uint64_t count = 0;
+            for (uint32_t node = _firstNode; node != NULL_NODE; node = _nodes[node].nextPhysical)
+            {
+                if (_nodes[node].free)
+                    count++;
+            }
+
+            return count;
+        }
+
+        auto GetLargestFreeRange() const -> VkDeviceSize
+        {
+            VkDeviceSize largest = 0;
+            for (uint32_t node = _firstNode; node != NULL_NODE; node = _nodes[node].nextPhysical)
+            {
+                if (_nodes[node].free)
+                    largest = std::max(largest, _nodes[node].size);
+            }
+
+            return largest;
+        }
+
+    private:
+        struct Node
+        {
+            VkDeviceSize offset = 0;
+            VkDeviceSize size = 0;
+            VkDeviceSize alignment = 0;
+            uint32_t prevPhysical = NULL_NODE;
+            uint32_t nextPhysical = NULL_NODE;
+            uint32_t prevFree = NULL_NODE;
+            uint32_t nextFree = NULL_NODE;
+            bool free = true;
+            void* pUserData = nullptr;
+        };
+
+        static constexpr uint32_t SL_BITS = 4;
+        static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+        static constexpr uint32_t FL_COUNT = 64;
+        static constexpr VkDeviceSize MIN_SIZE = SL_COUNT;
+
+    private:
+        static auto Mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl) -> void
+        {
+            fl = static_cast<uint32_t>(std::bit_width(size)) - 1;
+            sl = static_cast<uint32_t>(size >> (fl - SL_BITS)) & (SL_COUNT - 1);
+        }
+
+        auto NewNode() -> uint32_t
+        {
+            if (!_unusedNodes.empty())
+            {
+                const uint32_t node = _unusedNodes.back();
+                _unusedNodes.pop_back();
+                _nodes[node] = Node();
+                return node;
+            }
+
+            _nodes.emplace_back();
+            return static_cast<uint32_t>(_nodes.size() - 1);
+        }
+
+        // Merge next into node, next must directly follow node
+        auto Absorb(uint32_t node, uint32_t next) -> void
+        {
+            _nodes[node].size += _nodes[next].size;
+            _nodes[node].nextPhysical = _nodes[next].nextPhysical;
+
+            if (_nodes[node].nextPhysical != NULL_NODE)
+                _nodes[_nodes[node].nextPhysical].prevPhysical = node;
+
+            _unusedNodes.push_back(next);
+        }
+
+        auto InsertFree(uint32_t node) -> void
+        {
+            uint32_t fl, sl;
+            Mapping(_nodes[node].size, fl, sl);
+
+            uint32_t& head = _freeHeads[fl * SL_COUNT + sl];
+            _nodes[node].free = true;
+            _nodes[node].prevFree = NULL_NODE;
+            _nodes[node].nextFree = head;
+
+            if (head != NULL_NODE)
+                _nodes[head].prevFree = node;
+
+            head = node;
+            _flBitmap |= uint64_t(1) << fl;
+            _slBitmaps[fl] |= 1u << sl;
+        }
+
+        auto RemoveFree(uint32_t node) -> void
+        {
+            uint32_t fl, sl;
+            Mapping(_nodes[node].size, fl, sl);
+
+            const uint32_t prev = _nodes[node].prevFree;
+            const uint32_t next = _nodes[node].nextFree;
+
+            if (prev != NULL_NODE)
+                _nodes[prev].nextFree = next;
+            else
+                _freeHeads[fl * SL_COUNT + sl] = next;
+
+            if (next != NULL_NODE)
+                _nodes[next].prevFree = prev;
+
+            if (_freeHeads[fl * SL_COUNT + sl] == NULL_NODE)
+            {
+                _slBitmaps[fl] &= ~(1u << sl);
+                if (_slBitmaps[fl] == 0)
+                    _flBitmap &= ~(uint64_t(1) << fl);
+            }
+        }
+
+        auto FindFree(VkDeviceSize size) -> uint32_t
+        {
+            // Round up to the next size class, every range in it is large enough
+            const uint32_t msb = static_cast<uint32_t>(std::bit_width(size)) - 1;
+            size += (VkDeviceSize(1) << (msb - SL_BITS)) - 1;
+
+            uint32_t fl, sl;
+            Mapping(size, fl, sl);
+
+            if (fl >= FL_COUNT)
+                return NULL_NODE;
+
+            uint32_t slMap = _slBitmaps[fl] & (~0u << sl);
+            if (slMap == 0)
+            {
+                const uint64_t flMap = fl + 1 < FL_COUNT ? _flBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+                if (flMap == 0)
+                    return NULL_NODE;
+
+                fl = static_cast<uint32_t>(std::countr_zero(flMap));
+                slMap = _slBitmaps[fl];
+            }
+
+            sl = static_cast<uint32_t>(std::countr_zero(slMap));
+            return _freeHeads[fl * SL_COUNT + sl];
+        }
+
+    private:
+        std::vector<Node> _nodes;
+        std::vector<uint32_t> _unusedNodes;
+        uint32_t _firstNode;
+
+        uint64_t _flBitmap;
+        std::array<uint32_t, FL_COUNT> _slBitmaps;
+        std::array<uint32_t, FL_COUNT * SL_COUNT> _freeHeads;
+
+        VkDeviceSize _size;
+        VkDeviceSize _usedBytes;
+    };
+
+    struct VulkanMemoryBlock
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        void* pMapped = nullptr;
+        // Null for dedicated memory
+        std::unique_ptr<Tlsf> pTlsf;
+        std::size_t poolIndex = 0;
+    };
+
+    VulkanMemoryArena::VulkanMemoryArena(VulkanMemoryAllocator& allocator, const VulkanAllocation& allocation, VkDeviceSize granularity)
+        : _pAllocator(&allocator)
+        , _allocation(allocation)
+        , _granularity(granularity)
+        , _head(0)
+        , _peak(0)
+        , _lastLinear(true)
+    {
+    }
+
+    VulkanMemoryArena::~VulkanMemoryArena()
+    {
+        _pAllocator->Free(_allocation);
+    }
+
+    auto VulkanMemoryArena::Allocate(const VkMemoryRequirements& requirements, bool linear) -> std::optional<VulkanAllocation>
+    {
+        if ((requirements.memoryTypeBits & (1u << _allocation.memoryTypeIndex)) == 0)
+            return std::nullopt;
+
+        VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+        if (_head > 0 && linear != _lastLinear)
+            alignment = std::max(alignment, _granularity);
+
+        const VkDeviceSize offset = AlignUp(_head, alignment);
+        if (offset + requirements.size > _allocation.size)
+            return std::nullopt;
+
+        _head = offset + requirements.size;
+        _peak = std::max(_peak, _head);
+        _lastLinear = linear;
+
+        VulkanAllocation allocation;
+        allocation.memory = _allocation.memory;
+        allocation.offset = _allocation.offset + offset;
+        allocation.size = requirements.size;
+        allocation.memoryTypeIndex = _allocation.memoryTypeIndex;
+
+        if (_allocation.pMapped != nullptr)
+            allocation.pMapped = static_cast<std::byte*>(_allocation.pMapped) + offset;
+
+        return allocation;
+    }
+
+    auto VulkanMemoryArena::Reset() -> void
+    {
+        _head = 0;
+        _lastLinear = true;
+    }
+
+    auto VulkanMemoryArena::GetMemoryTypeIndex() const -> uint32_t
+    {
+        return _allocation.memoryTypeIndex;
+    }
+
+    auto VulkanMemoryArena::GetCapacity() const -> VkDeviceSize
+    {
+        return _allocation.size;
+    }
+
+    auto VulkanMemoryArena::GetUsedBytes() const -> VkDeviceSize
+    {
+        return _head;
+    }
+
+    auto VulkanMemoryArena::GetPeakBytes() const -> VkDeviceSize
+    {
+        return _peak;
+    }
+
+    VulkanMemoryAllocator::VulkanMemoryAllocator(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pDevice(&deviceTable)
+        , _memoryProperties()
+        , _bufferImageGranularity(1)
+        , _nonCoherentAtomSize(1)
+        , _maxAllocationCount(UINT32_MAX)
+        , _heapBlockSizes()
+        , _heapReservedBytes()
+        , _allocationCount(0)
+        , _usedBytes(0)
+        , _deviceAllocationCount(0)
+    {
+        if (instanceTable.vkGetPhysicalDeviceProperties == nullptr || instanceTable.vkGetPhysicalDeviceMemoryProperties == nullptr
+            || _pDevice->vkAllocateMemory == nullptr || _pDevice->vkFreeMemory == nullptr || _pDevice->vkMapMemory == nullptr)
+            return;
+
+        VkPhysicalDeviceProperties properties {};
+        instanceTable.vkGetPhysicalDeviceProperties(createInfo.physicalDevice, &properties);
+        instanceTable.vkGetPhysicalDeviceMemoryProperties(createInfo.physicalDevice, &_memoryProperties);
+
+        _bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+        _nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+        _maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+        // Small heaps (e.g. 256 MiB of host visible VRAM) get smaller blocks
+        constexpr VkDeviceSize minBlockSize = VkDeviceSize(1) << 20;
+        for (uint32_t i = 0; i < _memoryProperties.memoryHeapCount; i++)
+        {
+            VkDeviceSize blockSize = std::max(std::bit_floor(createInfo.blockSize), minBlockSize);
+            while (blockSize > minBlockSize && blockSize * 8 > _memoryProperties.memoryHeaps[i].size)
+                blockSize /= 2;
+
+            _heapBlockSizes[i] = blockSize;
+        }
+
+        _pools.resize(_memoryProperties.memoryTypeCount * 2);
+
+        _valid = true;
+    }
+
+    VulkanMemoryAllocator::~VulkanMemoryAllocator()
+    {
+        for (auto& pool : _pools)
+        {
+            for (auto& pBlock : pool)
+                DestroyBlock(*pBlock);
+        }
+
+        for (auto& pBlock : _dedicatedBlocks)
+            DestroyBlock(*pBlock);
+    }
+
+    auto VulkanMemoryAllocator::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanMemoryAllocator::Allocate(const VkMemoryRequirements& requirements, const AllocationInfo& allocationInfo) -> std::optional<VulkanAllocation>
+    {
+        if (!_valid || requirements.size == 0)
+            return std::nullopt;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Next candidate type when a heap is exhausted
+        for (uint32_t memoryTypeIndex : GetMemoryTypeCandidates(requirements.memoryTypeBits, allocationInfo.usage))
+        {
+            const uint32_t heapIndex = _memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+
+            std::optional<VulkanAllocation> allocation;
+            if (allocationInfo.dedicated || requirements.size > _heapBlockSizes[heapIndex] / 2)
+                allocation = AllocateDedicated(memoryTypeIndex, requirements.size, allocationInfo.pUserData);
+            else
+                allocation = AllocateFromPool(memoryTypeIndex, allocationInfo.linear, requirements, allocationInfo.pUserData);
+
+            if (allocation)
+                return allocation;
+        }
+
+        return std::nullopt;
+    }
+
+    auto VulkanMemoryAllocator::Free(const VulkanAllocation& allocation) -> void
+    {
+        if (allocation.pBlock == nullptr)
+            return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        FreeLocked(allocation);
+    }
+
+    auto VulkanMemoryAllocator::CreateBuffer(const VkBufferCreateInfo& createInfo, const AllocationInfo& allocationInfo, VkBuffer& buffer) -> std::optional<VulkanAllocation>
+    {
+        buffer = VK_NULL_HANDLE;
+        if (!_valid || _pDevice->vkCreateBuffer(_pDevice->device, &createInfo, nullptr, &buffer) != VK_SUCCESS)
+            return std::nullopt;
+
+        VkMemoryRequirements requirements {};
+        _pDevice->vkGetBufferMemoryRequirements(_pDevice->device, buffer, &requirements);
+
+        AllocationInfo bufferAllocationInfo = allocationInfo;
+        bufferAllocationInfo.linear = true;
+
+        auto allocation = Allocate(requirements, bufferAllocationInfo);
+        if (allocation && _pDevice->vkBindBufferMemory(_pDevice->device, buffer, allocation->memory, allocation->offset) == VK_SUCCESS)
+            return allocation;
+
+        if (allocation)
+            Free(*allocation);
+
+        _pDevice->vkDestroyBuffer(_pDevice->device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return std::nullopt;
+    }
+
+    auto VulkanMemoryAllocator::DestroyBuffer(VkBuffer buffer, const VulkanAllocation& allocation) -> void
+    {
+        if (buffer != VK_NULL_HANDLE)
+            _pDevice->vkDestroyBuffer(_pDevice->device, buffer, nullptr);
+
+        Free(allocation);
+    }
+
+    auto VulkanMemoryAllocator::CreateImage(const VkImageCreateInfo& createInfo, const AllocationInfo& allocationInfo, VkImage& image) -> std::optional<VulkanAllocation>
+    {
+        image = VK_NULL_HANDLE;
+        if (!_valid || _pDevice->vkCreateImage(_pDevice->device, &createInfo, nullptr, &image) != VK_SUCCESS)
+            return std::nullopt;
+
+        VkMemoryRequirements requirements {};
+        _pDevice->vkGetImageMemoryRequirements(_pDevice->device, image, &requirements);
+
+        AllocationInfo imageAllocationInfo = allocationInfo;
+        imageAllocationInfo.linear = createInfo.tiling == VK_IMAGE_TILING_LINEAR;
+
+        auto allocation = Allocate(requirements, imageAllocationInfo);
+        if (allocation && _pDevice->vkBindImageMemory(_pDevice->device, image, allocation->memory, allocation->offset) == VK_SUCCESS)
+            return allocation;
+
+        if (allocation)
+            Free(*allocation);
+
+        _pDevice->vkDestroyImage(_pDevice->device, image, nullptr);
+        image = VK_NULL_HANDLE;
+        return std::nullopt;
+    }
+
+    auto VulkanMemoryAllocator::DestroyImage(VkImage image, const VulkanAllocation& allocation) -> void
+    {
+        if (image != VK_NULL_HANDLE)
+            _pDevice->vkDestroyImage(_pDevice->device, image, nullptr);
+
+        Free(allocation);
+    }
+
+    auto VulkanMemoryAllocator::CreateArena(VkDeviceSize size, uint32_t memoryTypeBits, VulkanMemoryUsage usage) -> std::unique_ptr<VulkanMemoryArena>
+    {
+        if (!_valid || size == 0)
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        for (uint32_t memoryTypeIndex : GetMemoryTypeCandidates(memoryTypeBits, usage))
+        {
+            auto allocation = AllocateDedicated(memoryTypeIndex, size, nullptr);
+            if (allocation)
+                return std::unique_ptr<VulkanMemoryArena>(new VulkanMemoryArena(*this, *allocation, _bufferImageGranularity));
+        }
+
+        return nullptr;
+    }
+
+    auto VulkanMemoryAllocator::Flush(const VulkanAllocation& allocation) const -> void
+    {
+        FlushOrInvalidate(allocation, true);
+    }
+
+    auto VulkanMemoryAllocator::Invalidate(const VulkanAllocation& allocation) const -> void
+    {
+        FlushOrInvalidate(allocation, false);
+    }
+
+    auto VulkanMemoryAllocator::Defragment(const MoveCallback& move, VkDeviceSize maxBytesToMove) -> VkDeviceSize
+    {
+        if (!_valid || !move)
+            return 0;
+
+        std::vector<PendingMove> moves;
+
+        // Destinations are reserved under the lock, the callback runs without it so it can
+        // create and bind resources through the allocator
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            VkDeviceSize plannedBytes = 0;
+
+            for (auto& pool : _pools)
+            {
+                if (pool.size() < 2)
+                    continue;
+
+                std::vector<VulkanMemoryBlock*> blocks;
+                for (auto& pBlock : pool)
+                    blocks.push_back(pBlock.get());
+
+                std::sort(blocks.begin(), blocks.end(), [](const VulkanMemoryBlock* pLeft, const VulkanMemoryBlock* pRight) -> bool
+                {
+                    return pLeft->pTlsf->GetUsedBytes() < pRight->pTlsf->GetUsedBytes();
+                });
+
+                // Emptier half is drained into the fuller half, fullest first
+                const std::size_t sourceCount = blocks.size() / 2;
+
+                for (std::size_t i = 0; i < sourceCount && plannedBytes < maxBytesToMove; i++)
+                {
+                    VulkanMemoryBlock& source = *blocks[i];
+
+                    for (uint32_t node : source.pTlsf->GetUsedNodes())
+                    {
+                        VkMemoryRequirements requirements {};
+                        requirements.size = source.pTlsf->GetSize(node);
+                        requirements.alignment = source.pTlsf->GetAlignment(node);
+                        requirements.memoryTypeBits = 1u << source.memoryTypeIndex;
+
+                        if (plannedBytes + requirements.size > maxBytesToMove)
+                            break;
+
+                        PendingMove pendingMove;
+                        pendingMove.from.memory = source.memory;
+                        pendingMove.from.offset = source.pTlsf->GetOffset(node);
+                        pendingMove.from.size = requirements.size;
+                        pendingMove.from.memoryTypeIndex = source.memoryTypeIndex;
+                        pendingMove.from.pUserData = source.pTlsf->GetUserData(node);
+                        pendingMove.from.pBlock = &source;
+                        pendingMove.from.node = node;
+
+                        if (source.pMapped != nullptr)
+                            pendingMove.from.pMapped = static_cast<std::byte*>(source.pMapped) + pendingMove.from.offset;
+
+                        std::optional<VulkanAllocation> destination;
+                        for (std::size_t j = blocks.size(); j-- > sourceCount && !destination;)
+                            destination = AllocateFromBlock(*blocks[j], requirements, pendingMove.from.pUserData);
+
+                        if (!destination)
+                            break;
+
+                        pendingMove.to = *destination;
+                        moves.push_back(pendingMove);
+                        plannedBytes += requirements.size;
+                    }
+                }
+            }
+        }
+
+        VkDeviceSize movedBytes = 0;
+
+        for (const auto& pendingMove : moves)
+        {
+            const bool moved = move(pendingMove.from, pendingMove.to);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            FreeLocked(moved ? pendingMove.from : pendingMove.to);
+
+            if (moved)
+                movedBytes += pendingMove.from.size;
+        }
+
+        return movedBytes;
+    }
+
+    auto VulkanMemoryAllocator::FindMemoryType(uint32_t memoryTypeBits, VulkanMemoryUsage usage) const -> std::optional<uint32_t>
+    {
+        const auto candidates = GetMemoryTypeCandidates(memoryTypeBits, usage);
+        if (candidates.empty())
+            return std::nullopt;
+
+        return candidates.front();
+    }
+
+    auto VulkanMemoryAllocator::GetStats() const -> Stats
+    {
+        Stats stats {};
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        VkDeviceSize freeBytes = 0;
+        VkDeviceSize blockLargestFreeRanges = 0;
+
+        for (const auto& pool : _pools)
+        {
+            for (const auto& pBlock : pool)
+            {
+                const VkDeviceSize largestFreeRange = pBlock->pTlsf->GetLargestFreeRange();
+
+                stats.blockCount++;
+                stats.reservedBytes += pBlock->size;
+                stats.freeRangeCount += pBlock->pTlsf->GetFreeRangeCount();
+                stats.largestFreeRange = std::max(stats.largestFreeRange, largestFreeRange);
+
+                freeBytes += pBlock->pTlsf->GetFreeBytes();
+                blockLargestFreeRanges += largestFreeRange;
+            }
+        }
+
+        for (const auto& pBlock : _dedicatedBlocks)
+        {
+            stats.dedicatedCount++;
+            stats.reservedBytes += pBlock->size;
+        }
+
+        stats.allocationCount = _allocationCount;
+        stats.usedBytes = _usedBytes;
+        stats.deviceAllocationCount = _deviceAllocationCount;
+        stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(blockLargestFreeRanges) / static_cast<float>(freeBytes) : 0.0f;
+
+        return stats;
+    }
+
+    auto VulkanMemoryAllocator::GetHeapReservedBytes(uint32_t heapIndex) const -> VkDeviceSize
+    {
+        if (heapIndex >= _memoryProperties.memoryHeapCount)
+            return 0;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _heapReservedBytes[heapIndex];
+    }
+
+    auto VulkanMemoryAllocator::GetMemoryTypeCandidates(uint32_t memoryTypeBits, VulkanMemoryUsage usage) const -> std::vector<uint32_t>
+    {
+        VkMemoryPropertyFlags required = 0;
+        VkMemoryPropertyFlags preferred = 0;
+        VkMemoryPropertyFlags avoided = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+        switch (usage)
+        {
+            case VulkanMemoryUsage::GpuOnly:
+                preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+                avoided |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+                break;
+            case VulkanMemoryUsage::CpuToGpu:
+                required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+                break;
+            case VulkanMemoryUsage::GpuToCpu:
+                required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+                preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+                break;
+        }
+
+        std::vector<std::pair<int, uint32_t>> scoredTypes;
+        for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++)
+        {
+            const VkMemoryPropertyFlags flags = _memoryProperties.memoryTypes[i].propertyFlags;
+            if ((memoryTypeBits & (1u << i)) == 0 || (flags & required) != required)
+                continue;
+
+            const int score = 2 * std::popcount(flags & preferred) - std::popcount(flags & avoided);
+            scoredTypes.emplace_back(score, i);
+        }
+
+        std::stable_sort(scoredTypes.begin(), scoredTypes.end(), [](const auto& left, const auto& right) -> bool
+        {
+            return left.first > right.first;
+        });
+
+        std::vector<uint32_t> candidates;
+        for (const auto& [score, memoryTypeIndex] : scoredTypes)
+            candidates.push_back(memoryTypeIndex);
+
+        return candidates;
+    }
+
+    auto VulkanMemoryAllocator::GetPoolIndex(uint32_t memoryTypeIndex, bool linear) const -> std::size_t
+    {
+        // Without a granularity buffers and images can share pages
+        if (_bufferImageGranularity <= 1)
+            return memoryTypeIndex * 2;
+
+        return memoryTypeIndex * 2 + (linear ? 0 : 1);
+    }
+
+    auto VulkanMemoryAllocator::AllocateFromPool(uint32_t memoryTypeIndex, bool linear, const VkMemoryRequirements& requirements, void* pUserData) -> std::optional<VulkanAllocation>
+    {
+        const std::size_t poolIndex = GetPoolIndex(memoryTypeIndex, linear);
+        BlockList& pool = _pools[poolIndex];
+
+        for (auto& pBlock : pool)
+        {
+            auto allocation = AllocateFromBlock(*pBlock, requirements, pUserData);
+            if (allocation)
+                return allocation;
+        }
+
+        const uint32_t heapIndex = _memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+
+        auto pBlock = CreateBlock(memoryTypeIndex, _heapBlockSizes[heapIndex], false);
+        if (pBlock == nullptr)
+            return std::nullopt;
+
+        pBlock->poolIndex = poolIndex;
+        pool.push_back(std::move(pBlock));
+
+        return AllocateFromBlock(*pool.back(), requirements, pUserData);
+    }
+
+    auto VulkanMemoryAllocator::AllocateFromBlock(VulkanMemoryBlock& block, const VkMemoryRequirements& requirements, void* pUserData) -> std::optional<VulkanAllocation>
+    {
+        const uint32_t node = block.pTlsf->Allocate(requirements.size, requirements.alignment);
+        if (node == Tlsf::NULL_NODE)
+            return std::nullopt;
+
+        block.pTlsf->SetUserData(node, pUserData);
+
+        VulkanAllocation allocation;
+        allocation.memory = block.memory;
+        allocation.offset = block.pTlsf->GetOffset(node);
+        allocation.size = block.pTlsf->GetSize(node);
+        allocation.memoryTypeIndex = block.memoryTypeIndex;
+        allocation.pUserData = pUserData;
+        allocation.pBlock = &block;
+        allocation.node = node;
+
+        if (block.pMapped != nullptr)
+            allocation.pMapped = static_cast<std::byte*>(block.pMapped) + allocation.offset;
+
+        _allocationCount++;
+        _usedBytes += allocation.size;
+        return allocation;
+    }
+
+    auto VulkanMemoryAllocator::AllocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size, void* pUserData) -> std::optional<VulkanAllocation>
+    {
+        // Whole atoms, flushing the end of the allocation never goes past the memory
+        auto pBlock = CreateBlock(memoryTypeIndex, AlignUp(size, _nonCoherentAtomSize), true);
+        if (pBlock == nullptr)
+            return std::nullopt;
+
+        VulkanAllocation allocation;
+        allocation.memory = pBlock->memory;
+        allocation.offset = 0;
+        allocation.size = pBlock->size;
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.pMapped = pBlock->pMapped;
+        allocation.pUserData = pUserData;
+        allocation.pBlock = pBlock.get();
+
+        _dedicatedBlocks.push_back(std::move(pBlock));
+
+        _allocationCount++;
+        _usedBytes += allocation.size;
+        return allocation;
+    }
+
+    auto VulkanMemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated) -> std::unique_ptr<VulkanMemoryBlock>
+    {
+        if (_deviceAllocationCount >= _maxAllocationCount)
+            return nullptr;
+
+        VkMemoryAllocateInfo allocateInfo {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = size;
+        allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+        auto pBlock = std::make_unique<VulkanMemoryBlock>();
+        if (_pDevice->vkAllocateMemory(_pDevice->device, &allocateInfo, nullptr, &pBlock->memory) != VK_SUCCESS)
+            return nullptr;
+
+        pBlock->size = size;
+        pBlock->memoryTypeIndex = memoryTypeIndex;
+
+        // Host visible memory stays mapped for its whole life
+        if ((_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0)
+        {
+            if (_pDevice->vkMapMemory(_pDevice->device, pBlock->memory, 0, VK_WHOLE_SIZE, 0, &pBlock->pMapped) != VK_SUCCESS)
+            {
+                _pDevice->vkFreeMemory(_pDevice->device, pBlock->memory, nullptr);
+                return nullptr;
+            }
+        }
+
+        if (!dedicated)
+            pBlock->pTlsf = std::make_unique<Tlsf>(size);
+
+        _heapReservedBytes[_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex] += size;
+        _deviceAllocationCount++;
+        return pBlock;
+    }
+
+    auto VulkanMemoryAllocator::DestroyBlock(VulkanMemoryBlock& block) -> void
+    {
+        if (block.pMapped != nullptr)
+            _pDevice->vkUnmapMemory(_pDevice->device, block.memory);
+
+        _pDevice->vkFreeMemory(_pDevice->device, block.memory, nullptr);
+        _heapReservedBytes[_memoryProperties.memoryTypes[block.memoryTypeIndex].heapIndex] -= block.size;
+        _deviceAllocationCount--;
+    }
+
+    auto VulkanMemoryAllocator::FreeLocked(const VulkanAllocation& allocation) -> void
+    {
+        VulkanMemoryBlock& block = *allocation.pBlock;
+
+        _allocationCount--;
+        _usedBytes -= allocation.size;
+
+        if (block.pTlsf == nullptr)
+        {
+            const auto itr = std::find_if(_dedicatedBlocks.begin(), _dedicatedBlocks.end(), [&block](const std::unique_ptr<VulkanMemoryBlock>& pBlock) -> bool
+            {
+                return pBlock.get() == &block;
+            });
+
+            if (itr != _dedicatedBlocks.end())
+            {
+                DestroyBlock(block);
+                std::swap(*itr, _dedicatedBlocks.back());
+                _dedicatedBlocks.pop_back();
+            }
+
+            return;
+        }
+
+        block.pTlsf->Free(allocation.node);
+
+        if (block.pTlsf->IsEmpty())
+            ReleaseEmptyBlocks(_pools[block.poolIndex]);
+    }
+
+    auto VulkanMemoryAllocator::ReleaseEmptyBlocks(BlockList& blocks) -> void
+    {
+        // One empty block is kept, a pool that empties and refills every frame does not
+        // call into the driver each time
+        bool keptEmptyBlock = false;
+
+        for (std::size_t i = 0; i < blocks.size();)
+        {
+            if (!blocks[i]->pTlsf->IsEmpty() || !keptEmptyBlock)
+            {
+                keptEmptyBlock = keptEmptyBlock || blocks[i]->pTlsf->IsEmpty();
+                i++;
+                continue;
+            }
+
+            DestroyBlock(*blocks[i]);
+            std::swap(blocks[i], blocks.back());
+            blocks.pop_back();
+        }
+    }
+
+    auto VulkanMemoryAllocator::FlushOrInvalidate(const VulkanAllocation& allocation, bool flush) const -> void
+    {
+        if (allocation.memory == VK_NULL_HANDLE || allocation.pMapped == nullptr)
+            return;
+
+        if ((_memoryProperties.memoryTypes[allocation.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0)
+            return;
+
+        // Blocks and dedicated memory are whole atoms, the aligned range stays inside
+        VkMappedMemoryRange range {};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = allocation.memory;
+        range.offset = AlignDown(allocation.offset, _nonCoherentAtomSize);
+        range.size = AlignUp(allocation.offset + allocation.size, _nonCoherentAtomSize) - range.offset;
+
+        if (flush)
+            _pDevice->vkFlushMappedMemoryRanges(_pDevice->device, 1, &range);
+        else
+            _pDevice->vkInvalidateMappedMemoryRanges(_pDevice->device, 1, &range);
+    }
+}
@@ -0,0 +1,170 @@
+
+#include <algorithm>
+#include "NativeWinApp/VulkanMemoryAllocator.h"
+#include "NativeWinApp/VulkanMemoryMonitor.h"
+
+namespace NWA
+{
+    VulkanMemoryMonitor::VulkanMemoryMonitor(const VulkanInstanceTable& instanceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pInstance(&instanceTable)
+        , _createInfo(createInfo)
+        , _updateCount(0)
+        , _nextPressureCallbackId(0)
+    {
+        if (_createInfo.physicalDevice == VK_NULL_HANDLE || _pInstance->vkGetPhysicalDeviceMemoryProperties == nullptr)
+            return;
+
+        // The budget comes through the properties2 chain
+        if (_pInstance->vkGetPhysicalDeviceMemoryProperties2 == nullptr)
+            _createInfo.memoryBudget = false;
+
+        if (!_createInfo.memoryBudget && _createInfo.pAllocator == nullptr)
+            return;
+
+        _createInfo.criticalRatio = std::max(_createInfo.criticalRatio, _createInfo.warningRatio);
+        _createInfo.hysteresis = std::max(_createInfo.hysteresis, 0.0f);
+
+        VkPhysicalDeviceMemoryProperties memoryProperties {};
+        _pInstance->vkGetPhysicalDeviceMemoryProperties(_createInfo.physicalDevice, &memoryProperties);
+
+        _heaps.resize(memoryProperties.memoryHeapCount);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+        {
+            HeapBudget& heap = _heaps[i];
+            heap.flags = memoryProperties.memoryHeaps[i].flags;
+            heap.size = memoryProperties.memoryHeaps[i].size;
+            heap.usage = 0;
+            heap.budget = heap.size;
+            heap.ratio = 0.0f;
+            heap.pressure = VulkanMemoryPressure::Normal;
+        }
+
+        _valid = true;
+
+        // Levels start from the current usage, without callbacks
+        Update();
+    }
+
+    auto VulkanMemoryMonitor::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanMemoryMonitor::IsBudgetSupported() const -> bool
+    {
+        return _valid && _createInfo.memoryBudget;
+    }
+
+    auto VulkanMemoryMonitor::Update() -> void
+    {
+        if (!_valid)
+            return;
+
+        if (_createInfo.memoryBudget)
+        {
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties {};
+            budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+            VkPhysicalDeviceMemoryProperties2 memoryProperties2 {};
+            memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            memoryProperties2.pNext = &budgetProperties;
+
+            _pInstance->vkGetPhysicalDeviceMemoryProperties2(_createInfo.physicalDevice, &memoryProperties2);
+
+            for (size_t i = 0; i < _heaps.size(); i++)
+            {
+                _heaps[i].usage = budgetProperties.heapUsage[i];
+                // Zero would be a driver bug, keep the heap size then
+                _heaps[i].budget = budgetProperties.heapBudget[i] > 0 ? budgetProperties.heapBudget[i] : _heaps[i].size;
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < _heaps.size(); i++)
+                _heaps[i].usage = _createInfo.pAllocator->GetHeapReservedBytes(static_cast<uint32_t>(i));
+        }
+
+        std::vector<PressureEvent> events;
+        for (size_t i = 0; i < _heaps.size(); i++)
+        {
+            HeapBudget& heap = _heaps[i];
+            heap.ratio = heap.budget > 0 ? static_cast<float>(static_cast<double>(heap.usage) / static_cast<double>(heap.budget)) : 0.0f;
+
+            const VulkanMemoryPressure previous = heap.pressure;
+            heap.pressure = GetLevel(heap.ratio, previous);
+
+            // The first update only sets the starting levels
+            if (heap.pressure != previous && _updateCount > 0)
+                events.push_back({ static_cast<uint32_t>(i), previous, heap });
+        }
+
+        _updateCount++;
+
+        if (events.empty())
+            return;
+
+        // Callbacks may add or remove callbacks
+        const std::vector<PressureCallback> callbacks = _pressureCallbacks;
+        for (const auto& event : events)
+        {
+            for (const auto& callback : callbacks)
+                callback.func(event);
+        }
+    }
+
+    auto VulkanMemoryMonitor::GetUpdateCount() const -> uint64_t
+    {
+        return _updateCount;
+    }
+
+    auto VulkanMemoryMonitor::GetHeaps() const -> std::span<const HeapBudget>
+    {
+        return _heaps;
+    }
+
+    auto VulkanMemoryMonitor::GetPressure() const -> VulkanMemoryPressure
+    {
+        VulkanMemoryPressure pressure = VulkanMemoryPressure::Normal;
+        for (const auto& heap : _heaps)
+        {
+            if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0)
+                pressure = std::max(pressure, heap.pressure);
+        }
+
+        return pressure;
+    }
+
+    auto VulkanMemoryMonitor::AddPressureCallback(const std::function<void(const PressureEvent&)>& f) -> int
+    {
+        const int id = _nextPressureCallbackId++;
+        _pressureCallbacks.push_back({ id, f });
+        return id;
+    }
+
+    auto VulkanMemoryMonitor::RemovePressureCallback(int callbackId) -> void
+    {
+        std::erase_if(_pressureCallbacks, [callbackId](const PressureCallback& callback) -> bool
+        {
+            return callback.id == callbackId;
+        });
+    }
+
+    auto VulkanMemoryMonitor::GetLevel(float ratio, VulkanMemoryPressure current) const -> VulkanMemoryPressure
+    {
+        // Rising takes the threshold, falling takes the threshold minus the hysteresis
+        if (ratio >= _createInfo.criticalRatio)
+            return VulkanMemoryPressure::Critical;
+
+        if (current == VulkanMemoryPressure::Critical && ratio >= _createInfo.criticalRatio - _createInfo.hysteresis)
+            return VulkanMemoryPressure::Critical;
+
+        if (ratio >= _createInfo.warningRatio)
+            return VulkanMemoryPressure::Warning;
+
+        if (current != VulkanMemoryPressure::Normal && ratio >= _createInfo.warningRatio - _createInfo.hysteresis)
+            return VulkanMemoryPressure::Warning;
+
+        return VulkanMemoryPressure::Normal;
+    }
+}
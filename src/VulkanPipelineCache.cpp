@@ -0,0 +1,285 @@
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "NativeWinApp/VulkanPipelineCache.h"
+
+#if defined(_WIN32)
+#   include "NativeWinApp/WindowsInclude.h"
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace NWA
+{
+    // Read only view of a whole file, the driver copies the initial data so it lives only for
+    // the vkCreatePipelineCache call.
+    class MappedFile : NonCopyable
+    {
+    public:
+        explicit MappedFile(const std::string& path)
+        {
+#if defined(_WIN32)
+            _hFile = ::CreateFileW(Utility::StringToWideString(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (_hFile == INVALID_HANDLE_VALUE)
+                return;
+
+            LARGE_INTEGER fileSize;
+            if (!::GetFileSizeEx(_hFile, &fileSize) || fileSize.QuadPart == 0)
+                return;
+
+            _hMapping = ::CreateFileMappingW(_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (_hMapping == nullptr)
+                return;
+
+            _pData = ::MapViewOfFile(_hMapping, FILE_MAP_READ, 0, 0, 0);
+            if (_pData != nullptr)
+                _size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+            _fd = ::open(path.c_str(), O_RDONLY);
+            if (_fd < 0)
+                return;
+
+            struct stat fileStat {};
+            if (::fstat(_fd, &fileStat) != 0 || fileStat.st_size == 0)
+                return;
+
+            void* pData = ::mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, _fd, 0);
+            if (pData == MAP_FAILED)
+                return;
+
+            _pData = pData;
+            _size = static_cast<std::size_t>(fileStat.st_size);
+#endif
+        }
+
+        ~MappedFile()
+        {
+#if defined(_WIN32)
+            if (_pData != nullptr)
+                ::UnmapViewOfFile(_pData);
+
+            if (_hMapping != nullptr)
+                ::CloseHandle(_hMapping);
+
+            if (_hFile != INVALID_HANDLE_VALUE)
+                ::CloseHandle(_hFile);
+#else
+            if (_pData != nullptr)
+                ::munmap(_pData, _size);
+
+            if (_fd >= 0)
+                ::close(_fd);
+#endif
+        }
+
+        const void* Data() const
+        {
+            return _pData;
+        }
+
+        std::size_t Size() const
+        {
+            return _size;
+        }
+
+    private:
+#if defined(_WIN32)
+        HANDLE _hFile = INVALID_HANDLE_VALUE;
+        HANDLE _hMapping = nullptr;
+#else
+        int _fd = -1;
+#endif
+        void* _pData = nullptr;
+        std::size_t _size = 0;
+    };
+
+    VulkanPipelineCache::VulkanPipelineCache(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, VkPhysicalDevice physicalDevice, const std::string& path)
+        : _valid(false)
+        , _pDevice(&deviceTable)
+        , _deviceProperties()
+        , _path(path)
+        , _cache(VK_NULL_HANDLE)
+        , _loadedFromDisk(false)
+        , _loadedSize(0)
+    {
+        if (_pDevice->vkCreatePipelineCache == nullptr || instanceTable.vkGetPhysicalDeviceProperties == nullptr)
+            return;
+
+        instanceTable.vkGetPhysicalDeviceProperties(physicalDevice, &_deviceProperties);
+
+        VkPipelineCacheCreateInfo createInfo {};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+        {
+            const MappedFile file(_path);
+
+            // A cache from another driver or GPU is ignored rather than trusted to the driver
+            if (file.Data() != nullptr && ValidateHeader(file.Data(), file.Size()))
+            {
+                createInfo.initialDataSize = file.Size();
+                createInfo.pInitialData = file.Data();
+            }
+
+            if (_pDevice->vkCreatePipelineCache(_pDevice->device, &createInfo, nullptr, &_cache) == VK_SUCCESS)
+            {
+                _loadedFromDisk = createInfo.pInitialData != nullptr;
+                _loadedSize = createInfo.initialDataSize;
+            }
+        }
+
+        // Driver rejected the data anyway, start empty
+        if (_cache == VK_NULL_HANDLE && createInfo.pInitialData != nullptr)
+        {
+            createInfo.initialDataSize = 0;
+            createInfo.pInitialData = nullptr;
+
+            if (_pDevice->vkCreatePipelineCache(_pDevice->device, &createInfo, nullptr, &_cache) != VK_SUCCESS)
+                _cache = VK_NULL_HANDLE;
+        }
+
+        _valid = _cache != VK_NULL_HANDLE;
+    }
+
+    VulkanPipelineCache::~VulkanPipelineCache()
+    {
+        if (!_valid)
+            return;
+
+        Save();
+
+        for (auto& [threadId, cache] : _threadCaches)
+            _pDevice->vkDestroyPipelineCache(_pDevice->device, cache, nullptr);
+
+        _pDevice->vkDestroyPipelineCache(_pDevice->device, _cache, nullptr);
+    }
+
+    auto VulkanPipelineCache::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanPipelineCache::GetCache() const -> VkPipelineCache
+    {
+        return _cache;
+    }
+
+    auto VulkanPipelineCache::GetThreadCache() -> VkPipelineCache
+    {
+        if (!_valid)
+            return VK_NULL_HANDLE;
+
+        std::lock_guard<std::mutex> lock(_threadCacheMutex);
+
+        const auto itr = _threadCaches.find(std::this_thread::get_id());
+        if (itr != _threadCaches.end())
+            return itr->second;
+
+        VkPipelineCacheCreateInfo createInfo {};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+        VkPipelineCache cache = VK_NULL_HANDLE;
+        if (_pDevice->vkCreatePipelineCache(_pDevice->device, &createInfo, nullptr, &cache) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        _threadCaches[std::this_thread::get_id()] = cache;
+        return cache;
+    }
+
+    auto VulkanPipelineCache::IsLoadedFromDisk() const -> bool
+    {
+        return _loadedFromDisk;
+    }
+
+    auto VulkanPipelineCache::GetLoadedSize() const -> std::size_t
+    {
+        return _loadedSize;
+    }
+
+    auto VulkanPipelineCache::Save() -> bool
+    {
+        if (!_valid || !MergeThreadCaches())
+            return false;
+
+        std::size_t size = 0;
+        if (_pDevice->vkGetPipelineCacheData(_pDevice->device, _cache, &size, nullptr) != VK_SUCCESS || size == 0)
+            return false;
+
+        std::vector<char> data(size);
+        if (_pDevice->vkGetPipelineCacheData(_pDevice->device, _cache, &size, data.data()) != VK_SUCCESS)
+            return false;
+
+        std::error_code errorCode;
+        const std::string tempPath = _path + ".tmp";
+        const std::filesystem::path filePath(_path);
+
+        if (filePath.has_parent_path())
+            std::filesystem::create_directories(filePath.parent_path(), errorCode);
+
+        {
+            std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+                return false;
+
+            file.write(data.data(), static_cast<std::streamsize>(size));
+            file.flush();
+
+            if (!file.good())
+            {
+                file.close();
+                std::filesystem::remove(std::filesystem::path(tempPath), errorCode);
+                return false;
+            }
+        }
+
+        // Rename replaces the old file in one step
+        std::filesystem::rename(std::filesystem::path(tempPath), filePath, errorCode);
+        if (errorCode)
+        {
+            std::filesystem::remove(std::filesystem::path(tempPath), errorCode);
+            return false;
+        }
+
+        return true;
+    }
+
+    auto VulkanPipelineCache::ValidateHeader(const void* pData, std::size_t size) const -> bool
+    {
+        VkPipelineCacheHeaderVersionOne header {};
+        if (size < sizeof(header))
+            return false;
+
+        std::memcpy(&header, pData, sizeof(header));
+
+        if (header.headerSize < sizeof(header) || header.headerSize > size)
+            return false;
+
+        if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+            return false;
+
+        if (header.vendorID != _deviceProperties.vendorID || header.deviceID != _deviceProperties.deviceID)
+            return false;
+
+        return std::memcmp(header.pipelineCacheUUID, _deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    auto VulkanPipelineCache::MergeThreadCaches() -> bool
+    {
+        std::lock_guard<std::mutex> lock(_threadCacheMutex);
+
+        if (_threadCaches.empty())
+            return true;
+
+        std::vector<VkPipelineCache> sources;
+        sources.reserve(_threadCaches.size());
+
+        for (const auto& [threadId, cache] : _threadCaches)
+            sources.push_back(cache);
+
+        return _pDevice->vkMergePipelineCaches(_pDevice->device, _cache, static_cast<uint32_t>(sources.size()), sources.data()) == VK_SUCCESS;
+    }
+}
@@ -0,0 +1,358 @@
+
+#include <algorithm>
+#include <memory>
+#include "NativeWinApp/VulkanPipelineCache.h"
+#include "NativeWinApp/VulkanPipelineCompiler.h"
+
+namespace NWA
+{
+    VulkanPipelineCompiler::VulkanPipelineCompiler(const VulkanDeviceTable& deviceTable, VulkanPipelineCache* pPipelineCache, uint32_t workerCount)
+        : _valid(false)
+        , _pDevice(&deviceTable)
+        , _pPipelineCache(pPipelineCache)
+        , _runningJobs(0)
+        , _stopWorkers(false)
+    {
+        if (_pDevice->vkCreateShaderModule == nullptr || _pDevice->vkDestroyShaderModule == nullptr
+            || _pDevice->vkCreateGraphicsPipelines == nullptr || _pDevice->vkCreateComputePipelines == nullptr)
+            return;
+
+        if (workerCount == 0)
+        {
+            const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+        _workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++)
+            _workers.emplace_back(&VulkanPipelineCompiler::WorkerLoop, this);
+
+        _valid = true;
+    }
+
+    VulkanPipelineCompiler::~VulkanPipelineCompiler()
+    {
+        std::array<std::deque<Job>, PRIORITY_COUNT> cancelledJobs;
+
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            _stopWorkers = true;
+            cancelledJobs.swap(_queues);
+        }
+
+        _queueCondition.notify_all();
+
+        for (auto& worker : _workers)
+            worker.join();
+
+        for (auto& queue : cancelledJobs)
+        {
+            for (auto& job : queue)
+                job.cancel();
+        }
+    }
+
+    auto VulkanPipelineCompiler::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanPipelineCompiler::CompileShaderModule(const uint32_t* pCode, std::size_t codeSize, VulkanCompilePriority priority) -> std::future<VkShaderModule>
+    {
+        auto pPromise = std::make_shared<std::promise<VkShaderModule>>();
+        auto future = pPromise->get_future();
+
+        Job job;
+        job.run = [this, pPromise, pCode, codeSize](VkPipelineCache) -> void
+        {
+            pPromise->set_value(CreateShaderModule(pCode, codeSize));
+        };
+        job.cancel = [pPromise]() -> void
+        {
+            pPromise->set_value(VK_NULL_HANDLE);
+        };
+
+        Enqueue(std::move(job), priority);
+        return future;
+    }
+
+    auto VulkanPipelineCompiler::CompileGraphics(const GraphicsPipelineDesc& desc, VulkanCompilePriority priority) -> std::future<VkPipeline>
+    {
+        auto [job, future] = MakeGraphicsJob(desc);
+        Enqueue(std::move(job), priority);
+        return std::move(future);
+    }
+
+    auto VulkanPipelineCompiler::CompileCompute(const ComputePipelineDesc& desc, VulkanCompilePriority priority) -> std::future<VkPipeline>
+    {
+        auto [job, future] = MakeComputeJob(desc);
+        Enqueue(std::move(job), priority);
+        return std::move(future);
+    }
+
+    auto VulkanPipelineCompiler::CompileGraphics(const std::vector<GraphicsPipelineDesc>& descs, VulkanCompilePriority priority) -> std::vector<std::future<VkPipeline>>
+    {
+        std::vector<Job> jobs;
+        std::vector<std::future<VkPipeline>> futures;
+        jobs.reserve(descs.size());
+        futures.reserve(descs.size());
+
+        for (const auto& desc : descs)
+        {
+            auto [job, future] = MakeGraphicsJob(desc);
+            jobs.push_back(std::move(job));
+            futures.push_back(std::move(future));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            auto& queue = _queues[static_cast<std::size_t>(priority)];
+            for (auto& job : jobs)
+                queue.push_back(std::move(job));
+        }
+
+        _queueCondition.notify_all();
+        return futures;
+    }
+
+    auto VulkanPipelineCompiler::CompileCompute(const std::vector<ComputePipelineDesc>& descs, VulkanCompilePriority priority) -> std::vector<std::future<VkPipeline>>
+    {
+        std::vector<Job> jobs;
+        std::vector<std::future<VkPipeline>> futures;
+        jobs.reserve(descs.size());
+        futures.reserve(descs.size());
+
+        for (const auto& desc : descs)
+        {
+            auto [job, future] = MakeComputeJob(desc);
+            jobs.push_back(std::move(job));
+            futures.push_back(std::move(future));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            auto& queue = _queues[static_cast<std::size_t>(priority)];
+            for (auto& job : jobs)
+                queue.push_back(std::move(job));
+        }
+
+        _queueCondition.notify_all();
+        return futures;
+    }
+
+    auto VulkanPipelineCompiler::WaitIdle() -> void
+    {
+        std::unique_lock<std::mutex> lock(_queueMutex);
+        _idleCondition.wait(lock, [this]() -> bool
+        {
+            if (_runningJobs != 0)
+                return false;
+
+            return std::all_of(_queues.begin(), _queues.end(), [](const std::deque<Job>& queue) -> bool { return queue.empty(); });
+        });
+    }
+
+    auto VulkanPipelineCompiler::GetPendingCount() const -> std::size_t
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+
+        std::size_t count = _runningJobs;
+        for (const auto& queue : _queues)
+            count += queue.size();
+
+        return count;
+    }
+
+    auto VulkanPipelineCompiler::GetWorkerCount() const -> uint32_t
+    {
+        return static_cast<uint32_t>(_workers.size());
+    }
+
+    auto VulkanPipelineCompiler::WorkerLoop() -> void
+    {
+        const VkPipelineCache cache = _pPipelineCache != nullptr ? _pPipelineCache->GetThreadCache() : VK_NULL_HANDLE;
+
+        while (true)
+        {
+            Job job;
+
+            {
+                std::unique_lock<std::mutex> lock(_queueMutex);
+                _queueCondition.wait(lock, [this]() -> bool
+                {
+                    if (_stopWorkers)
+                        return true;
+
+                    return std::any_of(_queues.begin(), _queues.end(), [](const std::deque<Job>& queue) -> bool { return !queue.empty(); });
+                });
+
+                if (_stopWorkers)
+                    return;
+
+                // Queues are ordered by priority
+                for (auto& queue : _queues)
+                {
+                    if (queue.empty())
+                        continue;
+
+                    job = std::move(queue.front());
+                    queue.pop_front();
+                    break;
+                }
+
+                _runningJobs++;
+            }
+
+            job.run(cache);
+
+            {
+                std::lock_guard<std::mutex> lock(_queueMutex);
+                _runningJobs--;
+            }
+
+            _idleCondition.notify_all();
+        }
+    }
+
+    auto VulkanPipelineCompiler::Enqueue(Job&& job, VulkanCompilePriority priority) -> void
+    {
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            _queues[static_cast<std::size_t>(priority)].push_back(std::move(job));
+        }
+
+        _queueCondition.notify_one();
+    }
+
+    auto VulkanPipelineCompiler::MakeGraphicsJob(const GraphicsPipelineDesc& desc) -> std::pair<Job, std::future<VkPipeline>>
+    {
+        auto pPromise = std::make_shared<std::promise<VkPipeline>>();
+        auto future = pPromise->get_future();
+
+        Job job;
+        job.run = [this, pPromise, desc](VkPipelineCache cache) -> void
+        {
+            pPromise->set_value(BuildGraphics(desc, cache));
+        };
+        job.cancel = [pPromise]() -> void
+        {
+            pPromise->set_value(VK_NULL_HANDLE);
+        };
+
+        return { std::move(job), std::move(future) };
+    }
+
+    auto VulkanPipelineCompiler::MakeComputeJob(const ComputePipelineDesc& desc) -> std::pair<Job, std::future<VkPipeline>>
+    {
+        auto pPromise = std::make_shared<std::promise<VkPipeline>>();
+        auto future = pPromise->get_future();
+
+        Job job;
+        job.run = [this, pPromise, desc](VkPipelineCache cache) -> void
+        {
+            pPromise->set_value(BuildCompute(desc, cache));
+        };
+        job.cancel = [pPromise]() -> void
+        {
+            pPromise->set_value(VK_NULL_HANDLE);
+        };
+
+        return { std::move(job), std::move(future) };
+    }
+
+    auto VulkanPipelineCompiler::CreateShaderModule(const uint32_t* pCode, std::size_t codeSize) const -> VkShaderModule
+    {
+        if (pCode == nullptr || codeSize == 0)
+            return VK_NULL_HANDLE;
+
+        VkShaderModuleCreateInfo createInfo {};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = codeSize;
+        createInfo.pCode = pCode;
+
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        if (_pDevice->vkCreateShaderModule(_pDevice->device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        return shaderModule;
+    }
+
+    auto VulkanPipelineCompiler::CreateStages(const ShaderStage* pStages, std::size_t stageCount, std::vector<VkPipelineShaderStageCreateInfo>& stageInfos, std::vector<VkShaderModule>& ownedModules) const -> bool
+    {
+        stageInfos.reserve(stageCount);
+
+        for (std::size_t i = 0; i < stageCount; i++)
+        {
+            const ShaderStage& stage = pStages[i];
+
+            VkShaderModule shaderModule = stage.module;
+            if (shaderModule == VK_NULL_HANDLE)
+            {
+                shaderModule = CreateShaderModule(stage.pCode, stage.codeSize);
+                if (shaderModule == VK_NULL_HANDLE)
+                    return false;
+
+                ownedModules.push_back(shaderModule);
+            }
+
+            VkPipelineShaderStageCreateInfo stageInfo {};
+            stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stageInfo.stage = stage.stage;
+            stageInfo.module = shaderModule;
+            stageInfo.pName = stage.pEntryName;
+            stageInfo.pSpecializationInfo = stage.pSpecializationInfo;
+            stageInfos.push_back(stageInfo);
+        }
+
+        return true;
+    }
+
+    auto VulkanPipelineCompiler::DestroyModules(const std::vector<VkShaderModule>& modules) const -> void
+    {
+        for (VkShaderModule shaderModule : modules)
+            _pDevice->vkDestroyShaderModule(_pDevice->device, shaderModule, nullptr);
+    }
+
+    auto VulkanPipelineCompiler::BuildGraphics(const GraphicsPipelineDesc& desc, VkPipelineCache cache) const -> VkPipeline
+    {
+        std::vector<VkPipelineShaderStageCreateInfo> stageInfos;
+        std::vector<VkShaderModule> ownedModules;
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+
+        if (CreateStages(desc.stages.data(), desc.stages.size(), stageInfos, ownedModules))
+        {
+            VkGraphicsPipelineCreateInfo createInfo = desc.createInfo;
+            createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+            createInfo.stageCount = static_cast<uint32_t>(stageInfos.size());
+            createInfo.pStages = stageInfos.data();
+
+            if (_pDevice->vkCreateGraphicsPipelines(_pDevice->device, cache, 1, &createInfo, nullptr, &pipeline) != VK_SUCCESS)
+                pipeline = VK_NULL_HANDLE;
+        }
+
+        DestroyModules(ownedModules);
+        return pipeline;
+    }
+
+    auto VulkanPipelineCompiler::BuildCompute(const ComputePipelineDesc& desc, VkPipelineCache cache) const -> VkPipeline
+    {
+        std::vector<VkPipelineShaderStageCreateInfo> stageInfos;
+        std::vector<VkShaderModule> ownedModules;
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+
+        if (CreateStages(&desc.stage, 1, stageInfos, ownedModules))
+        {
+            VkComputePipelineCreateInfo createInfo = desc.createInfo;
+            createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            createInfo.stage = stageInfos[0];
+
+            if (_pDevice->vkCreateComputePipelines(_pDevice->device, cache, 1, &createInfo, nullptr, &pipeline) != VK_SUCCESS)
+                pipeline = VK_NULL_HANDLE;
+        }
+
+        DestroyModules(ownedModules);
+        return pipeline;
+    }
+}
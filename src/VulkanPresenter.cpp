@@ -0,0 +1,533 @@
+
+#include <algorithm>
+#include <limits>
+#include "NativeWinApp/FramePacer.h"
+#include "NativeWinApp/VulkanPresenter.h"
+
+namespace NWA
+{
+    VulkanPresenter::VulkanPresenter(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pInstance(&instanceTable)
+        , _pDevice(&deviceTable)
+        , _createInfo(createInfo)
+        , _commandContext(deviceTable, { createInfo.queueFamilyIndex, std::max(createInfo.framesInFlight, 1u), std::max(createInfo.threadCount, 1u) })
+        , _nextViewId(0)
+        , _renderPass(VK_NULL_HANDLE)
+        , _frameIndex(0)
+        , _submitSerial(0)
+        , _completedSerial(0)
+        , _frameSubmit(deviceTable)
+        , _pRecord(nullptr)
+        , _recordGeneration(0)
+        , _busyWorkers(0)
+        , _nextFrameView(0)
+        , _recordFailed(false)
+        , _stopWorkers(false)
+    {
+        _createInfo.framesInFlight = std::max(_createInfo.framesInFlight, 1u);
+        _createInfo.threadCount = std::max(_createInfo.threadCount, 1u);
+
+        if (_createInfo.physicalDevice == VK_NULL_HANDLE || _createInfo.queue == VK_NULL_HANDLE)
+            return;
+
+        if (_pDevice->vkCreateSwapchainKHR == nullptr || _pInstance->vkGetPhysicalDeviceSurfaceSupportKHR == nullptr || !_commandContext.IsValid())
+            return;
+
+        VkFenceCreateInfo fenceInfo {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        _frameSlots.resize(_createInfo.framesInFlight);
+        for (auto& slot : _frameSlots)
+        {
+            if (_pDevice->vkCreateFence(_pDevice->device, &fenceInfo, nullptr, &slot.inFlightFence) != VK_SUCCESS)
+                return;
+        }
+
+        for (uint32_t i = 1; i < _createInfo.threadCount; i++)
+            _workers.emplace_back(&VulkanPresenter::WorkerThread, this, i);
+
+        _valid = true;
+    }
+
+    VulkanPresenter::~VulkanPresenter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_workerMutex);
+            _stopWorkers = true;
+        }
+
+        _workerCondition.notify_all();
+        for (auto& worker : _workers)
+            worker.join();
+
+        // Presentation may still wait on our semaphores, fences do not cover it
+        if (_valid)
+            _pDevice->vkQueueWaitIdle(_createInfo.queue);
+
+        for (auto& pView : _views)
+            DestroyView(*pView);
+
+        _views.clear();
+
+        for (auto& slot : _frameSlots)
+        {
+            if (slot.inFlightFence != VK_NULL_HANDLE)
+                _pDevice->vkDestroyFence(_pDevice->device, slot.inFlightFence, nullptr);
+        }
+    }
+
+    auto VulkanPresenter::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanPresenter::AddView(VkSurfaceKHR surface, uint32_t width, uint32_t height) -> std::optional<uint32_t>
+    {
+        if (!_valid || surface == VK_NULL_HANDLE)
+            return std::nullopt;
+
+        VkBool32 supported = VK_FALSE;
+        _pInstance->vkGetPhysicalDeviceSurfaceSupportKHR(_createInfo.physicalDevice, _createInfo.queueFamilyIndex, surface, &supported);
+        if (supported != VK_TRUE)
+            return std::nullopt;
+
+        VulkanSurfaceSwapchain::CreateInfo swapchainInfo {};
+        swapchainInfo.physicalDevice = _createInfo.physicalDevice;
+        swapchainInfo.surface = surface;
+        swapchainInfo.framesInFlight = _createInfo.framesInFlight;
+        swapchainInfo.presentMode = _createInfo.presentMode;
+        swapchainInfo.preferredFormat = _createInfo.preferredFormat;
+        swapchainInfo.imageUsage = _createInfo.imageUsage;
+        swapchainInfo.width = width;
+        swapchainInfo.height = height;
+        swapchainInfo.recreateDebounce = _createInfo.recreateDebounce;
+
+        auto pView = std::make_unique<View>();
+        pView->id = _nextViewId;
+        pView->pSwapchain = std::make_unique<VulkanSurfaceSwapchain>(*_pInstance, *_pDevice, swapchainInfo);
+
+        // Zero extent is not an error, the swapchain is created once the surface gets an area
+        if (!pView->pSwapchain->IsValid() || !pView->pSwapchain->SetRenderPass(_renderPass))
+            return std::nullopt;
+
+        VkSemaphoreCreateInfo semaphoreInfo {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        pView->imageAvailable.resize(_createInfo.framesInFlight, VK_NULL_HANDLE);
+        for (auto& semaphore : pView->imageAvailable)
+        {
+            if (_pDevice->vkCreateSemaphore(_pDevice->device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+            {
+                DestroyView(*pView);
+                return std::nullopt;
+            }
+        }
+
+        _views.push_back(std::move(pView));
+        return _nextViewId++;
+    }
+
+    auto VulkanPresenter::RemoveView(uint32_t viewId) -> void
+    {
+        const auto itr = std::ranges::find_if(_views, [viewId](const std::unique_ptr<View>& pView) -> bool
+        {
+            return pView->id == viewId;
+        });
+
+        if (itr == _views.end())
+            return;
+
+        // The surface may be destroyed right after, every swapchain of it must be gone
+        _pDevice->vkQueueWaitIdle(_createInfo.queue);
+
+        DestroyView(**itr);
+        _views.erase(itr);
+    }
+
+    auto VulkanPresenter::AttachView(uint32_t viewId, Window& window) -> void
+    {
+        View* pView = FindView(viewId);
+        if (pView == nullptr)
+            return;
+
+        DetachView(viewId);
+
+        pView->pWindow = &window;
+        pView->eventCallbackId = window.AddEventCallback([this, viewId](const WindowEvent& event) -> void
+        {
+            if (event.type == WindowEvent::Type::Resize)
+                ResizeView(viewId, event.data.sizeData.width, event.data.sizeData.height);
+        });
+
+        auto [width, height] = window.GetSize();
+        ResizeView(viewId, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    }
+
+    auto VulkanPresenter::DetachView(uint32_t viewId) -> void
+    {
+        View* pView = FindView(viewId);
+        if (pView == nullptr || pView->pWindow == nullptr)
+            return;
+
+        pView->pWindow->RemoveEventCallback(pView->eventCallbackId);
+        pView->pWindow = nullptr;
+        pView->eventCallbackId = -1;
+    }
+
+    auto VulkanPresenter::ResizeView(uint32_t viewId, uint32_t width, uint32_t height) -> void
+    {
+        View* pView = FindView(viewId);
+        if (pView == nullptr)
+            return;
+
+        pView->pSwapchain->Resize(width, height);
+    }
+
+    auto VulkanPresenter::SetRenderPass(VkRenderPass renderPass) -> bool
+    {
+        WaitIdle();
+
+        _renderPass = renderPass;
+
+        bool result = true;
+        for (auto& pView : _views)
+        {
+            if (!pView->pSwapchain->SetRenderPass(renderPass))
+                result = false;
+        }
+
+        return result;
+    }
+
+    auto VulkanPresenter::SetFramePacer(FramePacer* pFramePacer) -> void
+    {
+        _createInfo.pFramePacer = pFramePacer;
+    }
+
+    auto VulkanPresenter::BeginFrame() -> uint32_t
+    {
+        if (!_valid || !_frameViews.empty())
+            return 0;
+
+        FrameSlot& slot = _frameSlots[_frameIndex];
+
+        // Only blocks when the GPU is framesInFlight frames behind
+        _pDevice->vkWaitForFences(_pDevice->device, 1, &slot.inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        _completedSerial = std::max(_completedSerial, slot.submitSerial);
+
+        CollectRetired();
+
+        _viewFrames.clear();
+        for (auto& pView : _views)
+        {
+            uint32_t imageIndex = 0;
+            if (!AcquireView(*pView, imageIndex))
+                continue;
+
+            const VulkanSurfaceSwapchain::Image& image = pView->pSwapchain->GetImage(imageIndex);
+            _frameViews.push_back(pView.get());
+            _viewFrames.push_back({ pView->id, imageIndex, VK_NULL_HANDLE, image.image, image.imageView, image.framebuffer, pView->pSwapchain->GetExtent() });
+        }
+
+        if (_frameViews.empty())
+            return 0;
+
+        // Reset only once an image is acquired, a frame without views must leave the fence signaled
+        _pDevice->vkResetFences(_pDevice->device, 1, &slot.inFlightFence);
+        _commandContext.BeginFrame(_frameIndex);
+
+        _commandBuffers.assign(_frameViews.size(), VK_NULL_HANDLE);
+        return static_cast<uint32_t>(_frameViews.size());
+    }
+
+    auto VulkanPresenter::Record(const RecordCallback& record) -> bool
+    {
+        if (_frameViews.empty())
+            return true;
+
+        _nextFrameView = 0;
+        _recordFailed = false;
+
+        {
+            std::lock_guard<std::mutex> lock(_workerMutex);
+            _pRecord = &record;
+            _recordGeneration++;
+            _busyWorkers = static_cast<uint32_t>(_workers.size());
+        }
+
+        _workerCondition.notify_all();
+
+        RecordViews(0);
+
+        {
+            std::unique_lock<std::mutex> lock(_workerMutex);
+            _doneCondition.wait(lock, [this]() -> bool { return _busyWorkers == 0; });
+            _pRecord = nullptr;
+        }
+
+        return !_recordFailed;
+    }
+
+    auto VulkanPresenter::EndFrame() -> bool
+    {
+        if (_frameViews.empty())
+            return true;
+
+        FrameSlot& slot = _frameSlots[_frameIndex];
+        const uint32_t frameIndex = _frameIndex;
+        _frameIndex = (_frameIndex + 1) % _createInfo.framesInFlight;
+
+        std::vector<View*> frameViews = std::move(_frameViews);
+        _frameViews.clear();
+
+        // A view failed to record
+        if (std::ranges::find(_commandBuffers, VK_NULL_HANDLE) != _commandBuffers.end())
+        {
+            AbandonFrame(slot, frameIndex, frameViews);
+            return false;
+        }
+
+        std::vector<VkSemaphore> acquireSemaphores;
+        std::vector<VkSemaphore> presentSemaphores;
+        std::vector<VkSwapchainKHR> swapchains;
+        std::vector<uint32_t> imageIndices;
+
+        for (size_t i = 0; i < frameViews.size(); i++)
+        {
+            const VulkanSurfaceSwapchain& swapchain = *frameViews[i]->pSwapchain;
+
+            acquireSemaphores.push_back(frameViews[i]->imageAvailable[frameIndex]);
+            presentSemaphores.push_back(swapchain.GetImage(_viewFrames[i].imageIndex).renderFinished);
+            swapchains.push_back(swapchain.GetSwapchain());
+            imageIndices.push_back(_viewFrames[i].imageIndex);
+        }
+
+        if (_frameSubmit.Submit(_createInfo.queue, acquireSemaphores, _commandBuffers, presentSemaphores, slot.inFlightFence) != VK_SUCCESS)
+        {
+            AbandonFrame(slot, frameIndex, frameViews);
+            return false;
+        }
+
+        slot.submitSerial = ++_submitSerial;
+
+        // The GPU works on the frame meanwhile, only the present is held back
+        if (_createInfo.pFramePacer != nullptr)
+            _createInfo.pFramePacer->Wait();
+
+        // One present for every swapchain, each reports its own result
+        std::vector<VkResult> results(swapchains.size(), VK_SUCCESS);
+
+        VkPresentInfoKHR presentInfo {};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = static_cast<uint32_t>(presentSemaphores.size());
+        presentInfo.pWaitSemaphores = presentSemaphores.data();
+        presentInfo.swapchainCount = static_cast<uint32_t>(swapchains.size());
+        presentInfo.pSwapchains = swapchains.data();
+        presentInfo.pImageIndices = imageIndices.data();
+        presentInfo.pResults = results.data();
+
+        const VkResult result = _pDevice->vkQueuePresentKHR(_createInfo.queue, &presentInfo);
+
+        bool succeeded = result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR;
+        for (size_t i = 0; i < frameViews.size(); i++)
+        {
+            frameViews[i]->pSwapchain->OnPresentResult(results[i]);
+
+            if (results[i] != VK_SUCCESS && results[i] != VK_SUBOPTIMAL_KHR && results[i] != VK_ERROR_OUT_OF_DATE_KHR)
+                succeeded = false;
+        }
+
+        return succeeded;
+    }
+
+    auto VulkanPresenter::AddWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stageMask) -> void
+    {
+        _frameSubmit.AddWaitSemaphore(semaphore, value, stageMask);
+    }
+
+    auto VulkanPresenter::AddSignalSemaphore(VkSemaphore semaphore, uint64_t value) -> void
+    {
+        _frameSubmit.AddSignalSemaphore(semaphore, value);
+    }
+
+    auto VulkanPresenter::WaitIdle() const -> void
+    {
+        std::vector<VkFence> fences;
+        fences.reserve(_frameSlots.size());
+
+        for (const auto& slot : _frameSlots)
+            fences.push_back(slot.inFlightFence);
+
+        if (!fences.empty())
+            _pDevice->vkWaitForFences(_pDevice->device, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+
+    auto VulkanPresenter::GetViewCount() const -> uint32_t
+    {
+        return static_cast<uint32_t>(_views.size());
+    }
+
+    auto VulkanPresenter::GetViewExtent(uint32_t viewId) const -> VkExtent2D
+    {
+        const View* pView = FindView(viewId);
+        return pView != nullptr ? pView->pSwapchain->GetExtent() : VkExtent2D { 0, 0 };
+    }
+
+    auto VulkanPresenter::GetViewFormat(uint32_t viewId) const -> VkSurfaceFormatKHR
+    {
+        const View* pView = FindView(viewId);
+        return pView != nullptr ? pView->pSwapchain->GetFormat() : VkSurfaceFormatKHR { VK_FORMAT_UNDEFINED, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+    }
+
+    auto VulkanPresenter::GetFramesInFlight() const -> uint32_t
+    {
+        return _createInfo.framesInFlight;
+    }
+
+    auto VulkanPresenter::GetThreadCount() const -> uint32_t
+    {
+        return _createInfo.threadCount;
+    }
+
+    auto VulkanPresenter::GetRecreateCount() const -> uint64_t
+    {
+        uint64_t count = 0;
+        for (const auto& pView : _views)
+            count += pView->pSwapchain->GetRecreateCount();
+
+        return count;
+    }
+
+    auto VulkanPresenter::GetRetiredSwapchainCount() const -> uint32_t
+    {
+        uint32_t count = 0;
+        for (const auto& pView : _views)
+            count += pView->pSwapchain->GetRetiredCount();
+
+        return count;
+    }
+
+    auto VulkanPresenter::FindView(uint32_t viewId) const -> View*
+    {
+        for (const auto& pView : _views)
+        {
+            if (pView->id == viewId)
+                return pView.get();
+        }
+
+        return nullptr;
+    }
+
+    auto VulkanPresenter::AcquireView(View& view, uint32_t& imageIndex) -> bool
+    {
+        VulkanSurfaceSwapchain& swapchain = *view.pSwapchain;
+        if (!swapchain.Update(_submitSerial))
+            return false;
+
+        const VkResult result = swapchain.Acquire(view.imageAvailable[_frameIndex], std::numeric_limits<uint64_t>::max(), _submitSerial, imageIndex);
+        return result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR;
+    }
+
+    auto VulkanPresenter::CollectRetired() -> void
+    {
+        // Submissions on one queue complete in order, the highest signaled serial covers all below
+        for (const auto& slot : _frameSlots)
+        {
+            if (slot.submitSerial > _completedSerial && _pDevice->vkGetFenceStatus(_pDevice->device, slot.inFlightFence) == VK_SUCCESS)
+                _completedSerial = slot.submitSerial;
+        }
+
+        for (auto& pView : _views)
+            pView->pSwapchain->CollectRetired(_completedSerial, _submitSerial);
+    }
+
+    auto VulkanPresenter::AbandonFrame(FrameSlot& slot, uint32_t frameIndex, const std::vector<View*>& frameViews) -> void
+    {
+        // Consume the acquire semaphores and signal the fence so the slot stays usable, the
+        // acquired images are released by recreating the swapchains
+        std::vector<VkSemaphore> acquireSemaphores;
+        for (View* pView : frameViews)
+        {
+            acquireSemaphores.push_back(pView->imageAvailable[frameIndex]);
+            pView->pSwapchain->MarkOutOfDate();
+        }
+
+        if (_frameSubmit.SubmitEmpty(_createInfo.queue, acquireSemaphores, slot.inFlightFence))
+            slot.submitSerial = ++_submitSerial;
+    }
+
+    auto VulkanPresenter::DestroyView(View& view) -> void
+    {
+        if (view.pWindow != nullptr)
+        {
+            view.pWindow->RemoveEventCallback(view.eventCallbackId);
+            view.pWindow = nullptr;
+        }
+
+        view.pSwapchain.reset();
+
+        for (VkSemaphore semaphore : view.imageAvailable)
+        {
+            if (semaphore != VK_NULL_HANDLE)
+                _pDevice->vkDestroySemaphore(_pDevice->device, semaphore, nullptr);
+        }
+
+        view.imageAvailable.clear();
+    }
+
+    auto VulkanPresenter::RecordViews(uint32_t threadIndex) -> void
+    {
+        const RecordCallback& record = *_pRecord;
+
+        // Views are handed out one at a time, a slow view does not hold up the others' threads
+        while (true)
+        {
+            const uint32_t index = _nextFrameView.fetch_add(1);
+            if (index >= _viewFrames.size())
+                return;
+
+            const VkCommandBuffer commandBuffer = _commandContext.BeginPrimary(threadIndex);
+            if (commandBuffer == VK_NULL_HANDLE)
+            {
+                _recordFailed = true;
+                continue;
+            }
+
+            ViewFrame& viewFrame = _viewFrames[index];
+            viewFrame.commandBuffer = commandBuffer;
+            record(viewFrame, threadIndex);
+
+            if (_pDevice->vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+            {
+                _recordFailed = true;
+                continue;
+            }
+
+            _commandBuffers[index] = commandBuffer;
+        }
+    }
+
+    auto VulkanPresenter::WorkerThread(uint32_t threadIndex) -> void
+    {
+        uint64_t generation = 0;
+
+        std::unique_lock<std::mutex> lock(_workerMutex);
+        while (true)
+        {
+            _workerCondition.wait(lock, [this, generation]() -> bool { return _stopWorkers || _recordGeneration != generation; });
+            if (_stopWorkers)
+                return;
+
+            generation = _recordGeneration;
+            lock.unlock();
+
+            RecordViews(threadIndex);
+
+            lock.lock();
+            if (--_busyWorkers == 0)
+                _doneCondition.notify_one();
+        }
+    }
+}
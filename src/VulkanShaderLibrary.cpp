@@ -0,0 +1,150 @@
+
+#include <cstring>
+#include "NativeWinApp/VulkanShaderLibrary.h"
+
+namespace NWA
+{
+    static constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+    // Length nibble of 15 continues in the following bytes, each 255 adds on
+    static bool ReadLength(std::span<const uint8_t> source, size_t& position, size_t& length)
+    {
+        uint8_t value = 255;
+        while (value == 255)
+        {
+            if (position >= source.size())
+                return false;
+
+            value = source[position++];
+            length += value;
+        }
+
+        return true;
+    }
+
+    VulkanShaderLibrary::VulkanShaderLibrary(std::span<const VulkanShaderBlob> blobs)
+        : _blobs(blobs)
+        , _entries(new Entry[blobs.size()])
+        , _residentBytes(0)
+    {
+    }
+
+    auto VulkanShaderLibrary::GetBlobCount() const -> uint32_t
+    {
+        return static_cast<uint32_t>(_blobs.size());
+    }
+
+    auto VulkanShaderLibrary::GetBlob(uint32_t index) const -> const VulkanShaderBlob&
+    {
+        return _blobs[index];
+    }
+
+    auto VulkanShaderLibrary::Find(std::string_view name) const -> std::optional<uint32_t>
+    {
+        for (size_t i = 0; i < _blobs.size(); i++)
+        {
+            if (_blobs[i].name == name)
+                return static_cast<uint32_t>(i);
+        }
+
+        return std::nullopt;
+    }
+
+    auto VulkanShaderLibrary::GetCode(uint32_t index) -> std::span<const uint32_t>
+    {
+        if (index >= _blobs.size())
+            return {};
+
+        const VulkanShaderBlob& blob = _blobs[index];
+        if (blob.codeSize == 0 || blob.codeSize % 4 != 0)
+            return {};
+
+        // Stored as is, the generated array is aligned for pCode
+        if (!blob.compressed)
+        {
+            if (blob.dataSize != blob.codeSize)
+                return {};
+
+            return std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(blob.pData), blob.codeSize / 4);
+        }
+
+        Entry& entry = _entries[index];
+        std::call_once(entry.once, [this, &blob, &entry]()
+        {
+            const uint32_t wordCount = blob.codeSize / 4;
+            std::unique_ptr<uint32_t[]> pCode(new uint32_t[wordCount]);
+
+            const std::span<uint8_t> destination(reinterpret_cast<uint8_t*>(pCode.get()), blob.codeSize);
+            if (!Decompress(std::span<const uint8_t>(blob.pData, blob.dataSize), destination) || pCode[0] != SPIRV_MAGIC)
+                return;
+
+            entry.pCode = std::move(pCode);
+            entry.wordCount = wordCount;
+            _residentBytes += blob.codeSize;
+        });
+
+        return std::span<const uint32_t>(entry.pCode.get(), entry.wordCount);
+    }
+
+    auto VulkanShaderLibrary::GetStoredBytes() const -> uint64_t
+    {
+        uint64_t bytes = 0;
+        for (const auto& blob : _blobs)
+            bytes += blob.dataSize;
+
+        return bytes;
+    }
+
+    auto VulkanShaderLibrary::GetResidentBytes() const -> uint64_t
+    {
+        return _residentBytes.load();
+    }
+
+    auto VulkanShaderLibrary::Decompress(std::span<const uint8_t> source, std::span<uint8_t> destination) -> bool
+    {
+        // Sequences of a token (literal length << 4 | match length - 4), the literals, then a
+        // little endian 16 bit offset back into the output. The last sequence has no match.
+        size_t in = 0;
+        size_t out = 0;
+
+        while (in < source.size())
+        {
+            const uint8_t token = source[in++];
+
+            size_t literalLength = token >> 4;
+            if (literalLength == 15 && !ReadLength(source, in, literalLength))
+                return false;
+
+            if (literalLength > source.size() - in || literalLength > destination.size() - out)
+                return false;
+
+            std::memcpy(destination.data() + out, source.data() + in, literalLength);
+            in += literalLength;
+            out += literalLength;
+
+            if (in == source.size())
+                break;
+
+            if (source.size() - in < 2)
+                return false;
+
+            const size_t offset = source[in] | (static_cast<size_t>(source[in + 1]) << 8);
+            in += 2;
+
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && !ReadLength(source, in, matchLength))
+                return false;
+
+            matchLength += 4;
+
+            if (offset == 0 || offset > out || matchLength > destination.size() - out)
+                return false;
+
+            // Overlapping matches repeat the bytes just written, copy forward one at a time
+            for (size_t i = 0; i < matchLength; i++, out++)
+                destination[out] = destination[out - offset];
+        }
+
+        return out == destination.size();
+    }
+}
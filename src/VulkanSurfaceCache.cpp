@@ -0,0 +1,93 @@
+
+#include <algorithm>
+#include "NativeWinApp/VulkanSurfaceCache.h"
+
+namespace NWA
+{
+    VulkanSurfaceCache::VulkanSurfaceCache(const VulkanInstanceTable& instanceTable, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
+        : _valid(false)
+        , _pInstance(&instanceTable)
+        , _physicalDevice(physicalDevice)
+        , _surface(surface)
+        , _capabilities()
+        , _queryCount(0)
+    {
+        if (_physicalDevice == VK_NULL_HANDLE || _surface == VK_NULL_HANDLE)
+            return;
+
+        if (_pInstance->vkGetPhysicalDeviceSurfaceCapabilitiesKHR == nullptr || _pInstance->vkGetPhysicalDeviceSurfaceFormatsKHR == nullptr
+            || _pInstance->vkGetPhysicalDeviceSurfacePresentModesKHR == nullptr)
+            return;
+
+        _valid = Refresh();
+    }
+
+    auto VulkanSurfaceCache::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanSurfaceCache::RefreshCapabilities() -> bool
+    {
+        if (_surface == VK_NULL_HANDLE)
+            return false;
+
+        _queryCount++;
+        return _pInstance->vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_physicalDevice, _surface, &_capabilities) == VK_SUCCESS;
+    }
+
+    auto VulkanSurfaceCache::Refresh() -> bool
+    {
+        if (!RefreshCapabilities())
+            return false;
+
+        // Vectors keep their capacity, refreshing does not allocate unless the lists grew
+        uint32_t formatCount = 0;
+        if (_pInstance->vkGetPhysicalDeviceSurfaceFormatsKHR(_physicalDevice, _surface, &formatCount, nullptr) != VK_SUCCESS)
+            return false;
+
+        _formats.resize(formatCount);
+        if (_pInstance->vkGetPhysicalDeviceSurfaceFormatsKHR(_physicalDevice, _surface, &formatCount, _formats.data()) < VK_SUCCESS)
+            return false;
+
+        _formats.resize(formatCount);
+
+        uint32_t presentModeCount = 0;
+        if (_pInstance->vkGetPhysicalDeviceSurfacePresentModesKHR(_physicalDevice, _surface, &presentModeCount, nullptr) != VK_SUCCESS)
+            return false;
+
+        _presentModes.resize(presentModeCount);
+        if (_pInstance->vkGetPhysicalDeviceSurfacePresentModesKHR(_physicalDevice, _surface, &presentModeCount, _presentModes.data()) < VK_SUCCESS)
+            return false;
+
+        _presentModes.resize(presentModeCount);
+
+        _queryCount += 4;
+        return !_formats.empty();
+    }
+
+    auto VulkanSurfaceCache::GetCapabilities() const -> const VkSurfaceCapabilitiesKHR&
+    {
+        return _capabilities;
+    }
+
+    auto VulkanSurfaceCache::GetFormats() const -> std::span<const VkSurfaceFormatKHR>
+    {
+        return _formats;
+    }
+
+    auto VulkanSurfaceCache::GetPresentModes() const -> std::span<const VkPresentModeKHR>
+    {
+        return _presentModes;
+    }
+
+    auto VulkanSurfaceCache::SupportsPresentMode(VkPresentModeKHR presentMode) const -> bool
+    {
+        return std::ranges::find(_presentModes, presentMode) != _presentModes.end();
+    }
+
+    auto VulkanSurfaceCache::GetQueryCount() const -> uint64_t
+    {
+        return _queryCount;
+    }
+}
@@ -0,0 +1,453 @@
+
+#include <algorithm>
+#include <limits>
+#include "NativeWinApp/VulkanSurfaceSwapchain.h"
+
+namespace NWA
+{
+    static VkPresentModeKHR ToVkPresentMode(VulkanPresentMode presentMode)
+    {
+        switch (presentMode)
+        {
+            case VulkanPresentMode::FifoRelaxed:
+                return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            case VulkanPresentMode::Mailbox:
+                return VK_PRESENT_MODE_MAILBOX_KHR;
+            case VulkanPresentMode::Immediate:
+                return VK_PRESENT_MODE_IMMEDIATE_KHR;
+            default:
+                return VK_PRESENT_MODE_FIFO_KHR;
+        }
+    }
+
+    VulkanSurfaceSwapchain::VulkanSurfaceSwapchain(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pDevice(&deviceTable)
+        , _createInfo(createInfo)
+        , _surfaceCache(instanceTable, createInfo.physicalDevice, createInfo.surface)
+        , _swapchain(VK_NULL_HANDLE)
+        , _format({ VK_FORMAT_UNDEFINED, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR })
+        , _extent({ 0, 0 })
+        , _presentMode(VK_PRESENT_MODE_FIFO_KHR)
+        , _renderPass(VK_NULL_HANDLE)
+        , _recreateCount(0)
+        , _outOfDate(false)
+        , _recreatePending(false)
+    {
+        if (_createInfo.physicalDevice == VK_NULL_HANDLE || _createInfo.surface == VK_NULL_HANDLE)
+            return;
+
+        if (_pDevice->vkCreateSwapchainKHR == nullptr || !_surfaceCache.IsValid())
+            return;
+
+        if (!ChooseSurfaceFormat())
+            return;
+
+        // Queried along with the formats by the surface cache
+        const VkSurfaceCapabilitiesKHR& capabilities = _surfaceCache.GetCapabilities();
+
+        // Zero extent is not an error, the swapchain is created once the surface gets an area
+        if (ChooseExtent(capabilities) && !CreateSwapchain(capabilities))
+            return;
+
+        _valid = true;
+    }
+
+    VulkanSurfaceSwapchain::~VulkanSurfaceSwapchain()
+    {
+        for (auto& retired : _retired)
+        {
+            DestroyImages(retired.images);
+            _pDevice->vkDestroySwapchainKHR(_pDevice->device, retired.swapchain, nullptr);
+        }
+
+        _retired.clear();
+
+        DestroyImages(_images);
+
+        if (_swapchain != VK_NULL_HANDLE)
+            _pDevice->vkDestroySwapchainKHR(_pDevice->device, _swapchain, nullptr);
+    }
+
+    auto VulkanSurfaceSwapchain::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanSurfaceSwapchain::Resize(uint32_t width, uint32_t height) -> void
+    {
+        _createInfo.width = width;
+        _createInfo.height = height;
+
+        // Already matching, e.g. the size reported when a window is attached
+        if (_swapchain != VK_NULL_HANDLE && width == _extent.width && height == _extent.height)
+            return;
+
+        _recreatePending = true;
+        _lastResizeTime = Clock::now();
+    }
+
+    auto VulkanSurfaceSwapchain::SetPresentMode(VulkanPresentMode presentMode) -> void
+    {
+        if (presentMode == _createInfo.presentMode)
+            return;
+
+        _createInfo.presentMode = presentMode;
+        _recreatePending = true;
+    }
+
+    auto VulkanSurfaceSwapchain::SetRenderPass(VkRenderPass renderPass) -> bool
+    {
+        DestroyFramebuffers();
+
+        _renderPass = renderPass;
+        return CreateFramebuffers();
+    }
+
+    auto VulkanSurfaceSwapchain::Update(uint64_t submitSerial) -> bool
+    {
+        if (NeedRecreate() && CanRecreate())
+            Recreate(submitSerial);
+
+        return _swapchain != VK_NULL_HANDLE && !_outOfDate;
+    }
+
+    auto VulkanSurfaceSwapchain::Acquire(VkSemaphore semaphore, uint64_t timeout, uint64_t submitSerial, uint32_t& imageIndex) -> VkResult
+    {
+        VkResult result = _pDevice->vkAcquireNextImageKHR(_pDevice->device, _swapchain, timeout, semaphore, VK_NULL_HANDLE, &imageIndex);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            _outOfDate = true;
+
+            if (!CanRecreate() || !Recreate(submitSerial))
+                return result;
+
+            result = _pDevice->vkAcquireNextImageKHR(_pDevice->device, _swapchain, timeout, semaphore, VK_NULL_HANDLE, &imageIndex);
+        }
+
+        // Suboptimal still signals the semaphore, render this frame and recreate later
+        if (result == VK_SUBOPTIMAL_KHR)
+            _recreatePending = true;
+        else if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            _outOfDate = true;
+
+        return result;
+    }
+
+    auto VulkanSurfaceSwapchain::OnPresentResult(VkResult result) -> void
+    {
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            _outOfDate = true;
+        else if (result == VK_SUBOPTIMAL_KHR)
+            _recreatePending = true;
+    }
+
+    auto VulkanSurfaceSwapchain::MarkOutOfDate() -> void
+    {
+        _outOfDate = true;
+    }
+
+    auto VulkanSurfaceSwapchain::CollectRetired(uint64_t completedSerial, uint64_t submitSerial, const std::function<bool(VkSwapchainKHR)>& canDestroy) -> void
+    {
+        while (!_retired.empty())
+        {
+            RetiredSwapchain& retired = _retired.front();
+
+            // Presents have no fence, wait framesInFlight more submissions on the new swapchain
+            // so the old presents have consumed their semaphores as well.
+            if (completedSerial < retired.retireSerial || submitSerial < retired.retireSerial + _createInfo.framesInFlight)
+                break;
+
+            if (canDestroy && !canDestroy(retired.swapchain))
+                break;
+
+            DestroyImages(retired.images);
+            _pDevice->vkDestroySwapchainKHR(_pDevice->device, retired.swapchain, nullptr);
+            _retired.pop_front();
+        }
+    }
+
+    auto VulkanSurfaceSwapchain::GetSwapchain() const -> VkSwapchainKHR
+    {
+        return _swapchain;
+    }
+
+    auto VulkanSurfaceSwapchain::GetFormat() const -> VkSurfaceFormatKHR
+    {
+        return _format;
+    }
+
+    auto VulkanSurfaceSwapchain::GetExtent() const -> VkExtent2D
+    {
+        return _extent;
+    }
+
+    auto VulkanSurfaceSwapchain::GetPresentMode() const -> VkPresentModeKHR
+    {
+        return _presentMode;
+    }
+
+    auto VulkanSurfaceSwapchain::GetImageCount() const -> uint32_t
+    {
+        return static_cast<uint32_t>(_images.size());
+    }
+
+    auto VulkanSurfaceSwapchain::GetImage(uint32_t imageIndex) const -> const Image&
+    {
+        return _images[imageIndex];
+    }
+
+    auto VulkanSurfaceSwapchain::GetRecreateCount() const -> uint64_t
+    {
+        return _recreateCount;
+    }
+
+    auto VulkanSurfaceSwapchain::GetRetiredCount() const -> uint32_t
+    {
+        return static_cast<uint32_t>(_retired.size());
+    }
+
+    auto VulkanSurfaceSwapchain::GetSurfaceCache() const -> const VulkanSurfaceCache&
+    {
+        return _surfaceCache;
+    }
+
+    auto VulkanSurfaceSwapchain::ChooseSurfaceFormat() -> bool
+    {
+        const auto formats = _surfaceCache.GetFormats();
+
+        if (formats.empty())
+            return false;
+
+        // A single undefined entry means any format is accepted
+        if (formats.size() == 1 && formats[0].format == VK_FORMAT_UNDEFINED)
+        {
+            _format = _createInfo.preferredFormat;
+            return true;
+        }
+
+        const auto itr = std::ranges::find_if(formats, [this](const VkSurfaceFormatKHR& format) -> bool
+        {
+            return format.format == _createInfo.preferredFormat.format && format.colorSpace == _createInfo.preferredFormat.colorSpace;
+        });
+
+        _format = itr != formats.end() ? *itr : formats[0];
+        return true;
+    }
+
+    auto VulkanSurfaceSwapchain::ChoosePresentMode() const -> VkPresentModeKHR
+    {
+        const VkPresentModeKHR wanted = ToVkPresentMode(_createInfo.presentMode);
+        if (_surfaceCache.SupportsPresentMode(wanted))
+            return wanted;
+
+        // Fifo is the only mode the spec guarantees
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    auto VulkanSurfaceSwapchain::NeedRecreate() const -> bool
+    {
+        return _swapchain == VK_NULL_HANDLE || _outOfDate || _recreatePending;
+    }
+
+    auto VulkanSurfaceSwapchain::CanRecreate() const -> bool
+    {
+        const Clock::time_point now = Clock::now();
+
+        // Still presentable, let the resize burst settle first
+        if (_swapchain != VK_NULL_HANDLE && !_outOfDate && now - _lastResizeTime < _createInfo.recreateDebounce)
+            return false;
+
+        // Not presentable, skip frames rather than rebuild on every step of the burst
+        return now - _lastRecreateTime >= _createInfo.recreateDebounce;
+    }
+
+    auto VulkanSurfaceSwapchain::Recreate(uint64_t submitSerial) -> bool
+    {
+        // Formats and present modes are cached, only the extent changes between recreations
+        if (!_surfaceCache.RefreshCapabilities())
+            return false;
+
+        const VkSurfaceCapabilitiesKHR& capabilities = _surfaceCache.GetCapabilities();
+
+        // Minimized, keep the current swapchain and try again next frame
+        if (!ChooseExtent(capabilities))
+            return false;
+
+        _lastRecreateTime = Clock::now();
+
+        // Frames in flight may still use the old images, they are destroyed in CollectRetired
+        const VkSwapchainKHR oldSwapchain = _swapchain;
+        std::vector<Image> oldImages = std::move(_images);
+        _images.clear();
+
+        const bool created = CreateSwapchain(capabilities);
+
+        // Passed as oldSwapchain it is retired even when creation failed
+        if (oldSwapchain != VK_NULL_HANDLE)
+            _retired.push_back(RetiredSwapchain { oldSwapchain, std::move(oldImages), submitSerial });
+
+        if (!created)
+            return false;
+
+        _outOfDate = false;
+        _recreatePending = false;
+        _recreateCount++;
+        return true;
+    }
+
+    auto VulkanSurfaceSwapchain::ChooseExtent(const VkSurfaceCapabilitiesKHR& capabilities) -> bool
+    {
+        // Special value means the surface size is defined by the swapchain
+        if (capabilities.currentExtent.width == std::numeric_limits<uint32_t>::max())
+        {
+            const bool hasArea = _createInfo.width != 0 && _createInfo.height != 0;
+            _extent.width = hasArea ? std::clamp(_createInfo.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width) : 0;
+            _extent.height = hasArea ? std::clamp(_createInfo.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height) : 0;
+        }
+        else
+        {
+            _extent = capabilities.currentExtent;
+        }
+
+        return _extent.width != 0 && _extent.height != 0;
+    }
+
+    auto VulkanSurfaceSwapchain::CreateSwapchain(const VkSurfaceCapabilitiesKHR& capabilities) -> bool
+    {
+        // One more image than the minimum so acquire does not wait on the presentation engine
+        uint32_t imageCount = capabilities.minImageCount + 1;
+        if (capabilities.maxImageCount > 0)
+            imageCount = std::min(imageCount, capabilities.maxImageCount);
+
+        VkCompositeAlphaFlagBitsKHR compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        for (const auto alpha : { VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR, VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR, VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR, VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR })
+        {
+            if (capabilities.supportedCompositeAlpha & alpha)
+            {
+                compositeAlpha = alpha;
+                break;
+            }
+        }
+
+        _presentMode = ChoosePresentMode();
+
+        VkSwapchainCreateInfoKHR swapchainCreateInfo {};
+        swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        swapchainCreateInfo.surface = _createInfo.surface;
+        swapchainCreateInfo.minImageCount = imageCount;
+        swapchainCreateInfo.imageFormat = _format.format;
+        swapchainCreateInfo.imageColorSpace = _format.colorSpace;
+        swapchainCreateInfo.imageExtent = _extent;
+        swapchainCreateInfo.imageArrayLayers = 1;
+        swapchainCreateInfo.imageUsage = _createInfo.imageUsage;
+        swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        swapchainCreateInfo.preTransform = capabilities.currentTransform;
+        swapchainCreateInfo.compositeAlpha = compositeAlpha;
+        swapchainCreateInfo.presentMode = _presentMode;
+        swapchainCreateInfo.clipped = VK_TRUE;
+        // Lets the driver reuse resources and keeps presenting until the switch
+        swapchainCreateInfo.oldSwapchain = _swapchain;
+
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        const VkResult result = _pDevice->vkCreateSwapchainKHR(_pDevice->device, &swapchainCreateInfo, nullptr, &swapchain);
+
+        _swapchain = result == VK_SUCCESS ? swapchain : VK_NULL_HANDLE;
+        if (_swapchain == VK_NULL_HANDLE)
+            return false;
+
+        return CreateImages() && CreateFramebuffers();
+    }
+
+    auto VulkanSurfaceSwapchain::CreateImages() -> bool
+    {
+        uint32_t imageCount = 0;
+        _pDevice->vkGetSwapchainImagesKHR(_pDevice->device, _swapchain, &imageCount, nullptr);
+        std::vector<VkImage> images(imageCount);
+        _pDevice->vkGetSwapchainImagesKHR(_pDevice->device, _swapchain, &imageCount, images.data());
+
+        _images.resize(imageCount);
+
+        VkImageViewCreateInfo imageViewCreateInfo {};
+        imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        imageViewCreateInfo.format = _format.format;
+        imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+        imageViewCreateInfo.subresourceRange.levelCount = 1;
+        imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+        imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+        VkSemaphoreCreateInfo semaphoreInfo {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        for (uint32_t i = 0; i < imageCount; i++)
+        {
+            _images[i].image = images[i];
+            imageViewCreateInfo.image = images[i];
+
+            if (_pDevice->vkCreateImageView(_pDevice->device, &imageViewCreateInfo, nullptr, &_images[i].imageView) != VK_SUCCESS)
+                return false;
+
+            if (_pDevice->vkCreateSemaphore(_pDevice->device, &semaphoreInfo, nullptr, &_images[i].renderFinished) != VK_SUCCESS)
+                return false;
+        }
+
+        return true;
+    }
+
+    auto VulkanSurfaceSwapchain::CreateFramebuffers() -> bool
+    {
+        if (_renderPass == VK_NULL_HANDLE)
+            return true;
+
+        for (auto& image : _images)
+        {
+            VkFramebufferCreateInfo framebufferInfo {};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = _renderPass;
+            framebufferInfo.attachmentCount = 1;
+            framebufferInfo.pAttachments = &image.imageView;
+            framebufferInfo.width = _extent.width;
+            framebufferInfo.height = _extent.height;
+            framebufferInfo.layers = 1;
+
+            if (_pDevice->vkCreateFramebuffer(_pDevice->device, &framebufferInfo, nullptr, &image.framebuffer) != VK_SUCCESS)
+                return false;
+        }
+
+        return true;
+    }
+
+    auto VulkanSurfaceSwapchain::DestroyFramebuffers() -> void
+    {
+        for (auto& image : _images)
+        {
+            if (image.framebuffer != VK_NULL_HANDLE)
+                _pDevice->vkDestroyFramebuffer(_pDevice->device, image.framebuffer, nullptr);
+
+            image.framebuffer = VK_NULL_HANDLE;
+        }
+    }
+
+    auto VulkanSurfaceSwapchain::DestroyImages(std::vector<Image>& images) -> void
+    {
+        for (auto& image : images)
+        {
+            if (image.framebuffer != VK_NULL_HANDLE)
+                _pDevice->vkDestroyFramebuffer(_pDevice->device, image.framebuffer, nullptr);
+
+            if (image.imageView != VK_NULL_HANDLE)
+                _pDevice->vkDestroyImageView(_pDevice->device, image.imageView, nullptr);
+
+            if (image.renderFinished != VK_NULL_HANDLE)
+                _pDevice->vkDestroySemaphore(_pDevice->device, image.renderFinished, nullptr);
+        }
+
+        images.clear();
+    }
+}
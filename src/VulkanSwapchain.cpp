@@ -0,0 +1,511 @@
+
+#include <algorithm>
+#include <limits>
+#include "NativeWinApp/FramePacer.h"
+#include "NativeWinApp/VulkanSwapchain.h"
+
+namespace NWA
+{
+    // Longest a single vkWaitForPresentKHR blocks. The wait thread notices a stop request or
+    // a retired swapchain in between, nothing else waits on it.
+    static constexpr uint64_t PresentWaitSliceNs = 10000000;
+
+    static VulkanSurfaceSwapchain::CreateInfo ToSurfaceCreateInfo(const VulkanSwapchain::CreateInfo& createInfo)
+    {
+        return VulkanSurfaceSwapchain::CreateInfo { createInfo.physicalDevice, createInfo.surface, std::max(createInfo.framesInFlight, 1u),
+            createInfo.presentMode, createInfo.preferredFormat, createInfo.imageUsage, createInfo.width, createInfo.height, createInfo.recreateDebounce };
+    }
+
+    VulkanSwapchain::VulkanSwapchain(const VulkanInstanceTable& instanceTable, const VulkanDeviceTable& deviceTable, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pInstance(&instanceTable)
+        , _pDevice(&deviceTable)
+        , _createInfo(createInfo)
+        , _surface(instanceTable, deviceTable, ToSurfaceCreateInfo(createInfo))
+        , _frameIndex(0)
+        , _imageIndex(0)
+        , _frameBegun(false)
+        , _submitSerial(0)
+        , _completedSerial(0)
+        , _frameSubmit(deviceTable)
+        , _presentWaitEnabled(false)
+        , _presentId(0)
+        , _stopPresentWait(false)
+        , _waitingSwapchain(VK_NULL_HANDLE)
+        , _latencyStatistics()
+        , _pWindow(nullptr)
+        , _eventCallbackId(-1)
+    {
+        _createInfo.framesInFlight = std::max(_createInfo.framesInFlight, 1u);
+
+        if (_createInfo.physicalDevice == VK_NULL_HANDLE || _createInfo.surface == VK_NULL_HANDLE || _createInfo.queue == VK_NULL_HANDLE)
+            return;
+
+        // Zero extent is not an error, the swapchain is created once the surface gets an area
+        if (!_surface.IsValid())
+            return;
+
+        if (!CreateFrameSlots())
+            return;
+
+        // VkPresentIdKHR comes with the same headers as present wait
+#if defined(VK_KHR_present_wait)
+        _presentWaitEnabled = _createInfo.presentWait && _pDevice->vkWaitForPresentKHR != nullptr;
+#endif
+
+        if (_presentWaitEnabled)
+            _presentWaitThread = std::thread(&VulkanSwapchain::PresentWaitThread, this);
+
+        _valid = true;
+    }
+
+    VulkanSwapchain::~VulkanSwapchain()
+    {
+        Detach();
+
+        if (_presentWaitThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(_presentMutex);
+                _stopPresentWait = true;
+            }
+
+            _presentCondition.notify_all();
+            _presentWaitThread.join();
+        }
+
+        // Presentation may still wait on our semaphores, fences do not cover it
+        if (_valid)
+            _pDevice->vkQueueWaitIdle(_createInfo.queue);
+
+        // The swapchains go with _surface
+        DestroyFrameSlots();
+    }
+
+    auto VulkanSwapchain::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanSwapchain::Attach(Window& window) -> void
+    {
+        Detach();
+
+        _pWindow = &window;
+        _eventCallbackId = window.AddEventCallback([this](const WindowEvent& event) -> void
+        {
+            if (event.type == WindowEvent::Type::Resize)
+                Resize(event.data.sizeData.width, event.data.sizeData.height);
+        });
+
+        auto [width, height] = window.GetSize();
+        Resize(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    }
+
+    auto VulkanSwapchain::Detach() -> void
+    {
+        if (_pWindow == nullptr)
+            return;
+
+        _pWindow->RemoveEventCallback(_eventCallbackId);
+        _pWindow = nullptr;
+        _eventCallbackId = -1;
+    }
+
+    auto VulkanSwapchain::Resize(uint32_t width, uint32_t height) -> void
+    {
+        _surface.Resize(width, height);
+    }
+
+    auto VulkanSwapchain::SetPresentMode(VulkanPresentMode presentMode) -> void
+    {
+        _surface.SetPresentMode(presentMode);
+    }
+
+    auto VulkanSwapchain::SetFramePacer(FramePacer* pFramePacer) -> void
+    {
+        _createInfo.pFramePacer = pFramePacer;
+    }
+
+    auto VulkanSwapchain::SetRenderPass(VkRenderPass renderPass) -> bool
+    {
+        WaitIdle();
+        return _surface.SetRenderPass(renderPass);
+    }
+
+    auto VulkanSwapchain::BeginFrame() -> std::optional<Frame>
+    {
+        if (!_valid || _frameBegun)
+            return std::nullopt;
+
+        FrameSlot& slot = _frameSlots[_frameIndex];
+
+        // Only blocks when the GPU is framesInFlight frames behind
+        _pDevice->vkWaitForFences(_pDevice->device, 1, &slot.inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        _completedSerial = std::max(_completedSerial, slot.submitSerial);
+
+        // Begun before the acquire, a failure here must not leave a signaled semaphore behind
+        _pDevice->vkResetCommandPool(_pDevice->device, slot.commandPool, 0);
+
+        VkCommandBufferBeginInfo beginInfo {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (_pDevice->vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS)
+            return std::nullopt;
+
+        CollectRetired();
+
+        if (!_surface.Update(_submitSerial))
+            return std::nullopt;
+
+        const VkResult result = _surface.Acquire(slot.imageAvailable, std::numeric_limits<uint64_t>::max(), _submitSerial, _imageIndex);
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+            return std::nullopt;
+
+        _acquireTime = Clock::now();
+
+        // Reset only once an image is acquired, an early return must leave the fence signaled
+        _pDevice->vkResetFences(_pDevice->device, 1, &slot.inFlightFence);
+
+        _frameBegun = true;
+
+        const VulkanSurfaceSwapchain::Image& image = _surface.GetImage(_imageIndex);
+        return Frame { _frameIndex, _imageIndex, slot.commandBuffer, image.image, image.imageView, image.framebuffer, _surface.GetExtent() };
+    }
+
+    auto VulkanSwapchain::EndFrame() -> bool
+    {
+        if (!_frameBegun)
+            return false;
+
+        _frameBegun = false;
+
+        FrameSlot& slot = _frameSlots[_frameIndex];
+        const VulkanSurfaceSwapchain::Image& image = _surface.GetImage(_imageIndex);
+        const VkSwapchainKHR swapchain = _surface.GetSwapchain();
+
+        const bool ended = _pDevice->vkEndCommandBuffer(slot.commandBuffer) == VK_SUCCESS;
+        if (!ended || _frameSubmit.Submit(_createInfo.queue, { &slot.imageAvailable, 1 }, { &slot.commandBuffer, 1 }, { &image.renderFinished, 1 }, slot.inFlightFence) != VK_SUCCESS)
+        {
+            // Consume the acquire semaphore and signal the fence, the acquired image is only
+            // released by recreating the swapchain
+            _surface.MarkOutOfDate();
+
+            if (_frameSubmit.SubmitEmpty(_createInfo.queue, { &slot.imageAvailable, 1 }, slot.inFlightFence))
+            {
+                slot.submitSerial = ++_submitSerial;
+                _frameIndex = (_frameIndex + 1) % _createInfo.framesInFlight;
+            }
+
+            return false;
+        }
+
+        slot.submitSerial = ++_submitSerial;
+        _frameIndex = (_frameIndex + 1) % _createInfo.framesInFlight;
+
+        // The GPU works on the frame meanwhile, only the present is held back
+        if (_createInfo.pFramePacer != nullptr)
+            _createInfo.pFramePacer->Wait();
+
+        PresentTiming timing { ++_presentId, _inputTime, _acquireTime, Clock::now(), std::nullopt };
+        _inputTime.reset();
+
+        VkPresentInfoKHR presentInfo {};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &image.renderFinished;
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &swapchain;
+        presentInfo.pImageIndices = &_imageIndex;
+
+#if defined(VK_KHR_present_wait)
+        VkPresentIdKHR presentIdInfo {};
+        presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        presentIdInfo.swapchainCount = 1;
+        presentIdInfo.pPresentIds = &timing.presentId;
+
+        if (_presentWaitEnabled)
+            presentInfo.pNext = &presentIdInfo;
+#endif
+
+        const VkResult result = _pDevice->vkQueuePresentKHR(_createInfo.queue, &presentInfo);
+        {
+            std::lock_guard<std::mutex> lock(_presentMutex);
+            if (_presentWaitEnabled && (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR))
+            {
+                _pendingPresents.push_back({ swapchain, timing });
+                _presentCondition.notify_one();
+            }
+            else
+            {
+                CompletePresent(timing);
+            }
+        }
+
+        _surface.OnPresentResult(result);
+        return result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR;
+    }
+
+    auto VulkanSwapchain::AddWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stageMask) -> void
+    {
+        _frameSubmit.AddWaitSemaphore(semaphore, value, stageMask);
+    }
+
+    auto VulkanSwapchain::AddSignalSemaphore(VkSemaphore semaphore, uint64_t value) -> void
+    {
+        _frameSubmit.AddSignalSemaphore(semaphore, value);
+    }
+
+    auto VulkanSwapchain::WaitIdle() const -> void
+    {
+        std::vector<VkFence> fences;
+        fences.reserve(_frameSlots.size());
+
+        for (const auto& slot : _frameSlots)
+            fences.push_back(slot.inFlightFence);
+
+        if (!fences.empty())
+            _pDevice->vkWaitForFences(_pDevice->device, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+
+    auto VulkanSwapchain::SetInputTime(Clock::time_point inputTime) -> void
+    {
+        if (!_inputTime || inputTime < *_inputTime)
+            _inputTime = inputTime;
+    }
+
+    auto VulkanSwapchain::PopPresentTimings() -> std::vector<PresentTiming>
+    {
+        std::lock_guard<std::mutex> lock(_presentMutex);
+
+        std::vector<PresentTiming> timings(_completedPresents.begin(), _completedPresents.end());
+        _completedPresents.clear();
+        return timings;
+    }
+
+    auto VulkanSwapchain::GetLatencyStatistics() const -> LatencyStatistics
+    {
+        std::lock_guard<std::mutex> lock(_statisticsMutex);
+        return _latencyStatistics;
+    }
+
+    auto VulkanSwapchain::ResetLatencyStatistics() -> void
+    {
+        std::lock_guard<std::mutex> lock(_statisticsMutex);
+        _latencyStatistics = LatencyStatistics {};
+    }
+
+    auto VulkanSwapchain::IsPresentWaitEnabled() const -> bool
+    {
+        return _presentWaitEnabled;
+    }
+
+    auto VulkanSwapchain::GetLastPresentId() const -> uint64_t
+    {
+        return _presentId;
+    }
+
+    auto VulkanSwapchain::GetSwapchain() const -> VkSwapchainKHR
+    {
+        return _surface.GetSwapchain();
+    }
+
+    auto VulkanSwapchain::GetFormat() const -> VkSurfaceFormatKHR
+    {
+        return _surface.GetFormat();
+    }
+
+    auto VulkanSwapchain::GetExtent() const -> VkExtent2D
+    {
+        return _surface.GetExtent();
+    }
+
+    auto VulkanSwapchain::GetPresentMode() const -> VkPresentModeKHR
+    {
+        return _surface.GetPresentMode();
+    }
+
+    auto VulkanSwapchain::GetImageCount() const -> uint32_t
+    {
+        return _surface.GetImageCount();
+    }
+
+    auto VulkanSwapchain::GetFramesInFlight() const -> uint32_t
+    {
+        return _createInfo.framesInFlight;
+    }
+
+    auto VulkanSwapchain::GetRecreateCount() const -> uint64_t
+    {
+        return _surface.GetRecreateCount();
+    }
+
+    auto VulkanSwapchain::GetRetiredSwapchainCount() const -> uint32_t
+    {
+        return _surface.GetRetiredCount();
+    }
+
+    auto VulkanSwapchain::GetSurfaceCache() const -> const VulkanSurfaceCache&
+    {
+        return _surface.GetSurfaceCache();
+    }
+
+    auto VulkanSwapchain::CreateFrameSlots() -> bool
+    {
+        _frameSlots.resize(_createInfo.framesInFlight);
+
+        VkCommandPoolCreateInfo poolInfo {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = _createInfo.queueFamilyIndex;
+
+        VkFenceCreateInfo fenceInfo {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        VkSemaphoreCreateInfo semaphoreInfo {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        for (auto& slot : _frameSlots)
+        {
+            if (_pDevice->vkCreateCommandPool(_pDevice->device, &poolInfo, nullptr, &slot.commandPool) != VK_SUCCESS)
+                return false;
+
+            VkCommandBufferAllocateInfo allocInfo {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = slot.commandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+
+            if (_pDevice->vkAllocateCommandBuffers(_pDevice->device, &allocInfo, &slot.commandBuffer) != VK_SUCCESS)
+                return false;
+
+            if (_pDevice->vkCreateFence(_pDevice->device, &fenceInfo, nullptr, &slot.inFlightFence) != VK_SUCCESS)
+                return false;
+
+            if (_pDevice->vkCreateSemaphore(_pDevice->device, &semaphoreInfo, nullptr, &slot.imageAvailable) != VK_SUCCESS)
+                return false;
+        }
+
+        return true;
+    }
+
+    auto VulkanSwapchain::DestroyFrameSlots() -> void
+    {
+        for (auto& slot : _frameSlots)
+        {
+            if (slot.imageAvailable != VK_NULL_HANDLE)
+                _pDevice->vkDestroySemaphore(_pDevice->device, slot.imageAvailable, nullptr);
+
+            if (slot.inFlightFence != VK_NULL_HANDLE)
+                _pDevice->vkDestroyFence(_pDevice->device, slot.inFlightFence, nullptr);
+
+            // Frees the command buffer too
+            if (slot.commandPool != VK_NULL_HANDLE)
+                _pDevice->vkDestroyCommandPool(_pDevice->device, slot.commandPool, nullptr);
+        }
+
+        _frameSlots.clear();
+    }
+
+    auto VulkanSwapchain::CollectRetired() -> void
+    {
+        // Submissions on one queue complete in order, the highest signaled serial covers all below
+        for (const auto& slot : _frameSlots)
+        {
+            if (slot.submitSerial > _completedSerial && _pDevice->vkGetFenceStatus(_pDevice->device, slot.inFlightFence) == VK_SUCCESS)
+                _completedSerial = slot.submitSerial;
+        }
+
+        // Presents of an old swapchain that were not shown yet never will be. The swapchain
+        // itself waits for a later call while the wait thread is still inside a wait on it.
+        std::lock_guard<std::mutex> lock(_presentMutex);
+        _surface.CollectRetired(_completedSerial, _submitSerial, [this](VkSwapchainKHR swapchain) -> bool
+        {
+            while (!_pendingPresents.empty() && _pendingPresents.front().swapchain == swapchain)
+            {
+                CompletePresent(_pendingPresents.front().timing);
+                _pendingPresents.pop_front();
+            }
+
+            return _waitingSwapchain != swapchain;
+        });
+    }
+
+    auto VulkanSwapchain::CompletePresent(PresentTiming& timing) -> void
+    {
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+
+        // Running means, like the frame pacer
+        std::lock_guard<std::mutex> lock(_statisticsMutex);
+        LatencyStatistics& stats = _latencyStatistics;
+        stats.presentCount++;
+
+        const double acquireToPresentMs = Milliseconds(timing.presentTime - timing.acquireTime).count();
+        stats.averageAcquireToPresentMs += (acquireToPresentMs - stats.averageAcquireToPresentMs) / static_cast<double>(stats.presentCount);
+
+        if (timing.displayTime)
+        {
+            stats.displayedCount++;
+
+            const double presentToDisplayMs = Milliseconds(*timing.displayTime - timing.presentTime).count();
+            stats.averagePresentToDisplayMs += (presentToDisplayMs - stats.averagePresentToDisplayMs) / static_cast<double>(stats.displayedCount);
+            stats.maxPresentToDisplayMs = std::max(stats.maxPresentToDisplayMs, presentToDisplayMs);
+
+            if (timing.inputTime)
+            {
+                stats.inputCount++;
+
+                const double inputToDisplayMs = Milliseconds(*timing.displayTime - *timing.inputTime).count();
+                stats.averageInputToDisplayMs += (inputToDisplayMs - stats.averageInputToDisplayMs) / static_cast<double>(stats.inputCount);
+                stats.maxInputToDisplayMs = std::max(stats.maxInputToDisplayMs, inputToDisplayMs);
+            }
+        }
+
+        // Bounded when nobody pops them
+        if (_completedPresents.size() >= 1024)
+            _completedPresents.pop_front();
+
+        _completedPresents.push_back(timing);
+    }
+
+    auto VulkanSwapchain::PresentWaitThread() -> void
+    {
+#if defined(VK_KHR_present_wait)
+        std::unique_lock<std::mutex> lock(_presentMutex);
+        while (true)
+        {
+            _presentCondition.wait(lock, [this]() -> bool { return _stopPresentWait || !_pendingPresents.empty(); });
+
+            if (_stopPresentWait)
+                return;
+
+            // Presents come in order, waiting for the oldest is enough. The handle and id are
+            // copied out, the render thread keeps acquiring and presenting meanwhile.
+            const VkSwapchainKHR swapchain = _pendingPresents.front().swapchain;
+            const uint64_t presentId = _pendingPresents.front().timing.presentId;
+            _waitingSwapchain = swapchain;
+
+            lock.unlock();
+            const VkResult result = _pDevice->vkWaitForPresentKHR(_pDevice->device, swapchain, presentId, PresentWaitSliceNs);
+            const Clock::time_point waitEnd = Clock::now();
+            lock.lock();
+
+            _waitingSwapchain = VK_NULL_HANDLE;
+
+            // Completed meanwhile by the retirement of its swapchain
+            if (result == VK_TIMEOUT || _pendingPresents.empty() || _pendingPresents.front().timing.presentId != presentId)
+                continue;
+
+            // Out of date or lost surfaces never show the image
+            PendingPresent& pending = _pendingPresents.front();
+            if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+                pending.timing.displayTime = waitEnd;
+
+            CompletePresent(pending.timing);
+            _pendingPresents.pop_front();
+        }
+#endif
+    }
+}
@@ -0,0 +1,533 @@
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "NativeWinApp/VulkanUploader.h"
+
+namespace NWA
+{
+    // Buffer to image copies need offsets aligned to the texel size
+    static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    VulkanUploader::VulkanUploader(const VulkanDeviceTable& deviceTable, VulkanMemoryAllocator& allocator, const CreateInfo& createInfo)
+        : _valid(false)
+        , _pDevice(&deviceTable)
+        , _pAllocator(&allocator)
+        , _createInfo(createInfo)
+        , _stagingBuffer(VK_NULL_HANDLE)
+        , _stagingAllocation()
+        , _stagingHead(0)
+        , _stagingUsed(0)
+        , _timeline(VK_NULL_HANDLE)
+        , _batchIndex(0)
+        , _recording(false)
+        , _recordingStagingBytes(0)
+        , _submittedValue(0)
+        , _waitStageMask(0)
+        , _acquiredValue(0)
+        , _uploadedBytes(0)
+        , _stallCount(0)
+    {
+        _createInfo.batchCount = std::max(_createInfo.batchCount, 1u);
+
+        if (_createInfo.transferQueue == VK_NULL_HANDLE || _createInfo.stagingSize == 0 || !_pAllocator->IsValid())
+            return;
+
+        // Timeline semaphores, core in 1.2 or VK_KHR_timeline_semaphore
+        if (_pDevice->vkGetSemaphoreCounterValue == nullptr || _pDevice->vkWaitSemaphores == nullptr)
+            return;
+
+        // Staging ring
+        {
+            VkBufferCreateInfo bufferCreateInfo {};
+            bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferCreateInfo.size = _createInfo.stagingSize;
+            bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VulkanMemoryAllocator::AllocationInfo allocationInfo;
+            allocationInfo.usage = VulkanMemoryUsage::CpuToGpu;
+            allocationInfo.dedicated = true;
+
+            auto allocation = _pAllocator->CreateBuffer(bufferCreateInfo, allocationInfo, _stagingBuffer);
+            if (!allocation)
+                return;
+
+            _stagingAllocation = *allocation;
+            if (_stagingAllocation.pMapped == nullptr)
+                return;
+        }
+
+        // Timeline
+        {
+            VkSemaphoreTypeCreateInfo typeCreateInfo {};
+            typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+            typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            typeCreateInfo.initialValue = 0;
+
+            VkSemaphoreCreateInfo semaphoreCreateInfo {};
+            semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            semaphoreCreateInfo.pNext = &typeCreateInfo;
+
+            if (_pDevice->vkCreateSemaphore(_pDevice->device, &semaphoreCreateInfo, nullptr, &_timeline) != VK_SUCCESS)
+            {
+                _timeline = VK_NULL_HANDLE;
+                return;
+            }
+        }
+
+        // Batches
+        _batches.resize(_createInfo.batchCount);
+        for (auto& batch : _batches)
+        {
+            VkCommandPoolCreateInfo poolCreateInfo {};
+            poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolCreateInfo.queueFamilyIndex = _createInfo.transferQueueFamilyIndex;
+
+            if (_pDevice->vkCreateCommandPool(_pDevice->device, &poolCreateInfo, nullptr, &batch.commandPool) != VK_SUCCESS)
+            {
+                batch.commandPool = VK_NULL_HANDLE;
+                return;
+            }
+
+            VkCommandBufferAllocateInfo allocateInfo {};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.commandPool = batch.commandPool;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocateInfo.commandBufferCount = 1;
+
+            if (_pDevice->vkAllocateCommandBuffers(_pDevice->device, &allocateInfo, &batch.commandBuffer) != VK_SUCCESS)
+                return;
+        }
+
+        _valid = true;
+    }
+
+    VulkanUploader::~VulkanUploader()
+    {
+        // A batch still being recorded is dropped, submitted ones are waited on
+        if (_timeline != VK_NULL_HANDLE && _submittedValue > 0)
+        {
+            VkSemaphoreWaitInfo waitInfo {};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &_timeline;
+            waitInfo.pValues = &_submittedValue;
+
+            _pDevice->vkWaitSemaphores(_pDevice->device, &waitInfo, UINT64_MAX);
+        }
+
+        for (auto& batch : _batches)
+        {
+            if (batch.commandPool != VK_NULL_HANDLE)
+                _pDevice->vkDestroyCommandPool(_pDevice->device, batch.commandPool, nullptr);
+        }
+
+        if (_timeline != VK_NULL_HANDLE)
+            _pDevice->vkDestroySemaphore(_pDevice->device, _timeline, nullptr);
+
+        if (_stagingBuffer != VK_NULL_HANDLE)
+            _pAllocator->DestroyBuffer(_stagingBuffer, _stagingAllocation);
+    }
+
+    auto VulkanUploader::FindTransferQueueFamily(const VulkanInstanceTable& instanceTable, VkPhysicalDevice physicalDevice) -> std::optional<uint32_t>
+    {
+        if (instanceTable.vkGetPhysicalDeviceQueueFamilyProperties == nullptr)
+            return std::nullopt;
+
+        uint32_t queueFamilyCount = 0;
+        instanceTable.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        instanceTable.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        for (uint32_t i = 0; i < queueFamilyCount; i++)
+        {
+            const VkQueueFlags flags = queueFamilies[i].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) != 0 && (flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0)
+                return i;
+        }
+
+        return std::nullopt;
+    }
+
+    auto VulkanUploader::IsValid() const -> bool
+    {
+        return _valid;
+    }
+
+    auto VulkanUploader::UploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* pData, VkDeviceSize size, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask) -> std::optional<uint64_t>
+    {
+        if (!_valid || buffer == VK_NULL_HANDLE || pData == nullptr || size == 0)
+            return std::nullopt;
+
+        // Chunks of half the ring, the next one is copied while the GPU reads the previous
+        const VkDeviceSize chunkSize = std::max(_createInfo.stagingSize / 2, STAGING_ALIGNMENT);
+        const auto* pBytes = static_cast<const std::byte*>(pData);
+
+        for (VkDeviceSize copied = 0; copied < size;)
+        {
+            const VkDeviceSize copySize = std::min(size - copied, chunkSize);
+
+            const auto stagingOffset = ReserveStaging(copySize, STAGING_ALIGNMENT);
+            if (!stagingOffset || !BeginBatch())
+                return std::nullopt;
+
+            std::memcpy(static_cast<std::byte*>(_stagingAllocation.pMapped) + *stagingOffset, pBytes + copied, static_cast<std::size_t>(copySize));
+
+            VkBufferCopy region {};
+            region.srcOffset = *stagingOffset;
+            region.dstOffset = offset + copied;
+            region.size = copySize;
+
+            _pDevice->vkCmdCopyBuffer(_batches[_batchIndex].commandBuffer, _stagingBuffer, buffer, 1, &region);
+
+            copied += copySize;
+        }
+
+        if (UsesOwnershipTransfer())
+        {
+            // Release covers the chunks of earlier batches too, they come first on the queue
+            VkBufferMemoryBarrier releaseBarrier {};
+            releaseBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            releaseBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            releaseBarrier.dstAccessMask = 0;
+            releaseBarrier.srcQueueFamilyIndex = _createInfo.transferQueueFamilyIndex;
+            releaseBarrier.dstQueueFamilyIndex = _createInfo.graphicsQueueFamilyIndex;
+            releaseBarrier.buffer = buffer;
+            releaseBarrier.offset = offset;
+            releaseBarrier.size = size;
+
+            _pDevice->vkCmdPipelineBarrier(_batches[_batchIndex].commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0, 0, nullptr, 1, &releaseBarrier, 0, nullptr);
+
+            PendingAcquire pendingAcquire {};
+            pendingAcquire.isImage = false;
+            pendingAcquire.bufferBarrier = releaseBarrier;
+            pendingAcquire.bufferBarrier.srcAccessMask = 0;
+            pendingAcquire.bufferBarrier.dstAccessMask = dstAccessMask;
+            pendingAcquire.value = GetRecordingValue();
+            _pendingAcquires.push_back(pendingAcquire);
+        }
+
+        _waitStageMask |= dstStageMask;
+        _uploadedBytes += size;
+        return GetRecordingValue();
+    }
+
+    auto VulkanUploader::UploadImage(const ImageUpload& upload, const void* pData, VkDeviceSize size) -> std::optional<uint64_t>
+    {
+        if (!_valid || upload.image == VK_NULL_HANDLE || pData == nullptr || size == 0 || size > _createInfo.stagingSize)
+            return std::nullopt;
+
+        const auto stagingOffset = ReserveStaging(size, STAGING_ALIGNMENT);
+        if (!stagingOffset || !BeginBatch())
+            return std::nullopt;
+
+        std::memcpy(static_cast<std::byte*>(_stagingAllocation.pMapped) + *stagingOffset, pData, static_cast<std::size_t>(size));
+
+        const VkCommandBuffer commandBuffer = _batches[_batchIndex].commandBuffer;
+
+        VkImageSubresourceRange subresourceRange {};
+        subresourceRange.aspectMask = upload.subresource.aspectMask;
+        subresourceRange.baseMipLevel = upload.subresource.mipLevel;
+        subresourceRange.levelCount = 1;
+        subresourceRange.baseArrayLayer = upload.subresource.baseArrayLayer;
+        subresourceRange.layerCount = upload.subresource.layerCount;
+
+        VkImageMemoryBarrier transferBarrier {};
+        transferBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        transferBarrier.srcAccessMask = 0;
+        transferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        transferBarrier.oldLayout = upload.oldLayout;
+        transferBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        transferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        transferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        transferBarrier.image = upload.image;
+        transferBarrier.subresourceRange = subresourceRange;
+
+        _pDevice->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &transferBarrier);
+
+        VkBufferImageCopy region {};
+        region.bufferOffset = *stagingOffset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource = upload.subresource;
+        region.imageOffset = upload.offset;
+        region.imageExtent = upload.extent;
+
+        _pDevice->vkCmdCopyBufferToImage(commandBuffer, _stagingBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        // Final layout here, and a release when the graphics queue is in another family
+        VkImageMemoryBarrier releaseBarrier {};
+        releaseBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        releaseBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        releaseBarrier.dstAccessMask = 0;
+        releaseBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        releaseBarrier.newLayout = upload.newLayout;
+        releaseBarrier.srcQueueFamilyIndex = UsesOwnershipTransfer() ? _createInfo.transferQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+        releaseBarrier.dstQueueFamilyIndex = UsesOwnershipTransfer() ? _createInfo.graphicsQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+        releaseBarrier.image = upload.image;
+        releaseBarrier.subresourceRange = subresourceRange;
+
+        _pDevice->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &releaseBarrier);
+
+        if (UsesOwnershipTransfer())
+        {
+            PendingAcquire pendingAcquire {};
+            pendingAcquire.isImage = true;
+            pendingAcquire.imageBarrier = releaseBarrier;
+            pendingAcquire.imageBarrier.srcAccessMask = 0;
+            pendingAcquire.imageBarrier.dstAccessMask = upload.dstAccessMask;
+            pendingAcquire.value = GetRecordingValue();
+            _pendingAcquires.push_back(pendingAcquire);
+        }
+
+        _waitStageMask |= upload.dstStageMask;
+        _uploadedBytes += size;
+        return GetRecordingValue();
+    }
+
+    auto VulkanUploader::Flush() -> bool
+    {
+        if (!_valid)
+            return false;
+
+        if (!_recording)
+            return true;
+
+        _recording = false;
+
+        Batch& batch = _batches[_batchIndex];
+        if (_pDevice->vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS)
+            return false;
+
+        const uint64_t value = _submittedValue + 1;
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo {};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.signalSemaphoreValueCount = 1;
+        timelineSubmitInfo.pSignalSemaphoreValues = &value;
+
+        VkSubmitInfo submitInfo {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &_timeline;
+
+        if (_pDevice->vkQueueSubmit(_createInfo.transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+            return false;
+
+        _submittedValue = value;
+        batch.value = value;
+
+        _stagingRegions.push_back({ _recordingStagingBytes, value });
+        _recordingStagingBytes = 0;
+
+        _batchIndex = (_batchIndex + 1) % _createInfo.batchCount;
+        return true;
+    }
+
+    auto VulkanUploader::AcquireUploads(VkCommandBuffer commandBuffer) -> std::optional<QueueWait>
+    {
+        if (!_valid || _submittedValue <= _acquiredValue)
+            return std::nullopt;
+
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+
+        // Uploads of the batch being recorded stay pending
+        auto itr = std::stable_partition(_pendingAcquires.begin(), _pendingAcquires.end(), [this](const PendingAcquire& pendingAcquire) -> bool
+        {
+            return pendingAcquire.value > _submittedValue;
+        });
+
+        for (auto readyItr = itr; readyItr != _pendingAcquires.end(); ++readyItr)
+        {
+            if (readyItr->isImage)
+                imageBarriers.push_back(readyItr->imageBarrier);
+            else
+                bufferBarriers.push_back(readyItr->bufferBarrier);
+        }
+
+        _pendingAcquires.erase(itr, _pendingAcquires.end());
+
+        const VkPipelineStageFlags stageMask = _waitStageMask != 0 ? _waitStageMask : VkPipelineStageFlags(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+        // Source stage matches the semaphore wait stage, the acquire is ordered after the wait
+        if (!bufferBarriers.empty() || !imageBarriers.empty())
+        {
+            _pDevice->vkCmdPipelineBarrier(commandBuffer, stageMask, stageMask, 0, 0, nullptr,
+                static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        }
+
+        _acquiredValue = _submittedValue;
+        _waitStageMask = 0;
+
+        return QueueWait { _timeline, _submittedValue, stageMask };
+    }
+
+    auto VulkanUploader::IsComplete(uint64_t value) const -> bool
+    {
+        return GetCompletedValue() >= value;
+    }
+
+    auto VulkanUploader::Wait(uint64_t value) -> bool
+    {
+        if (!_valid)
+            return false;
+
+        if (value > _submittedValue)
+        {
+            if (!_recording || value != GetRecordingValue() || !Flush())
+                return false;
+        }
+
+        VkSemaphoreWaitInfo waitInfo {};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &_timeline;
+        waitInfo.pValues = &value;
+
+        return _pDevice->vkWaitSemaphores(_pDevice->device, &waitInfo, UINT64_MAX) == VK_SUCCESS;
+    }
+
+    auto VulkanUploader::GetTimelineSemaphore() const -> VkSemaphore
+    {
+        return _timeline;
+    }
+
+    auto VulkanUploader::GetSubmittedValue() const -> uint64_t
+    {
+        return _submittedValue;
+    }
+
+    auto VulkanUploader::GetCompletedValue() const -> uint64_t
+    {
+        if (!_valid)
+            return 0;
+
+        uint64_t value = 0;
+        if (_pDevice->vkGetSemaphoreCounterValue(_pDevice->device, _timeline, &value) != VK_SUCCESS)
+            return 0;
+
+        return value;
+    }
+
+    auto VulkanUploader::UsesOwnershipTransfer() const -> bool
+    {
+        return _createInfo.transferQueueFamilyIndex != _createInfo.graphicsQueueFamilyIndex;
+    }
+
+    auto VulkanUploader::GetUploadedBytes() const -> uint64_t
+    {
+        return _uploadedBytes;
+    }
+
+    auto VulkanUploader::GetStallCount() const -> uint64_t
+    {
+        return _stallCount;
+    }
+
+    auto VulkanUploader::ReserveStaging(VkDeviceSize size, VkDeviceSize alignment) -> std::optional<VkDeviceSize>
+    {
+        const VkDeviceSize capacity = _createInfo.stagingSize;
+        if (size > capacity)
+            return std::nullopt;
+
+        bool stalled = false;
+
+        while (true)
+        {
+            ReclaimStaging();
+
+            if (_stagingUsed == 0)
+                _stagingHead = 0;
+
+            // The end of the ring is skipped when the data does not fit before it
+            VkDeviceSize offset = AlignUp(_stagingHead, alignment);
+            if (offset + size > capacity)
+                offset = 0;
+
+            const VkDeviceSize consumed = (offset >= _stagingHead ? offset - _stagingHead : capacity - _stagingHead + offset) + size;
+            if (consumed <= capacity - _stagingUsed)
+            {
+                _stagingHead = offset + size;
+                _stagingUsed += consumed;
+                _recordingStagingBytes += consumed;
+                return offset;
+            }
+
+            if (!stalled)
+            {
+                stalled = true;
+                _stallCount++;
+            }
+
+            // Ring is full: submit what is recorded, then wait for the oldest batch
+            if (_recording)
+            {
+                if (!Flush())
+                    return std::nullopt;
+
+                continue;
+            }
+
+            if (_stagingRegions.empty() || !Wait(_stagingRegions.front().value))
+                return std::nullopt;
+        }
+    }
+
+    auto VulkanUploader::ReclaimStaging() -> void
+    {
+        if (_stagingRegions.empty())
+            return;
+
+        const uint64_t completedValue = GetCompletedValue();
+
+        while (!_stagingRegions.empty() && _stagingRegions.front().value <= completedValue)
+        {
+            _stagingUsed -= _stagingRegions.front().size;
+            _stagingRegions.pop_front();
+        }
+    }
+
+    auto VulkanUploader::BeginBatch() -> bool
+    {
+        if (_recording)
+            return true;
+
+        // Command buffer of batchCount flushes ago, normally finished long ago
+        Batch& batch = _batches[_batchIndex];
+        if (batch.value > 0 && !Wait(batch.value))
+            return false;
+
+        if (_pDevice->vkResetCommandPool(_pDevice->device, batch.commandPool, 0) != VK_SUCCESS)
+            return false;
+
+        VkCommandBufferBeginInfo beginInfo {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (_pDevice->vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS)
+            return false;
+
+        _recording = true;
+        return true;
+    }
+
+    auto VulkanUploader::GetRecordingValue() const -> uint64_t
+    {
+        return _submittedValue + 1;
+    }
+}
@@ -2,6 +2,7 @@
 #include "NativeWinApp/WindowsInclude.h"
 #include "NativeWinApp/Utility.h"
 #include "NativeWinApp/Window.h"
+#include "NativeWinApp/GLProcLoader.h"
 
 #pragma comment(lib, "opengl32.lib")
 
@@ -131,7 +132,12 @@ namespace NWA
         , _mouseInsideWindow(false)
         , _hIcon(nullptr)
         , _hCursor(::LoadCursor(nullptr, IDC_ARROW))
+        , _eventCallbackDepth(0)
+        , _nextEventCallbackId(0)
         , _hGLContext(nullptr)
+        , _glPixelFormatSet(false)
+        , _swapBufferCallbackDepth(0)
+        , _nextSwapBufferCallbackId(0)
     {
         // Fix dpi
         Support::FixProcessDpi();
@@ -200,6 +206,7 @@ namespace NWA
         // Release openGL
         if (_hGLContext)
         {
+            GLProcLoader::ReleaseContext(_hGLContext);
             ::wglMakeCurrent(static_cast<HDC>(_hDeviceHandle), nullptr);
             ::wglDeleteContext(static_cast<HGLRC>(_hGLContext));
         }
@@ -441,9 +448,68 @@ namespace NWA
         return result;
     }
 
+    // Callbacks removed while the hooks ran are dropped, the ones added meanwhile join the list.
+    template<class Callback>
+    static auto ApplyCallbackChanges(std::vector<Callback>& callbacks, std::vector<Callback>& added) -> void
+    {
+        std::erase_if(callbacks, [](const Callback& callback) -> bool { return callback.removed; });
+
+        for (auto& callback : added)
+            callbacks.push_back(std::move(callback));
+
+        added.clear();
+    }
+
+    template<class Callback>
+    static auto RemoveCallback(std::vector<Callback>& callbacks, std::vector<Callback>& added, int callbackId, bool running) -> void
+    {
+        std::erase_if(added, [callbackId](const Callback& callback) -> bool { return callback.id == callbackId; });
+
+        // The list is being iterated, only mark it
+        if (running)
+        {
+            for (auto& callback : callbacks)
+            {
+                if (callback.id == callbackId)
+                    callback.removed = true;
+            }
+
+            return;
+        }
+
+        std::erase_if(callbacks, [callbackId](const Callback& callback) -> bool { return callback.id == callbackId; });
+    }
+
     auto Window::PushEvent(const WindowEvent& event) -> void
     {
         _eventQueue.push(event);
+
+        // Callbacks may add or remove callbacks, e.g. VulkanSwapchain::Attach
+        if (_eventCallbacks.empty())
+            return;
+
+        _eventCallbackDepth++;
+
+        for (const auto& callback : _eventCallbacks)
+        {
+            if (!callback.removed)
+                callback.func(event);
+        }
+
+        if (--_eventCallbackDepth == 0)
+            ApplyCallbackChanges(_eventCallbacks, _addedEventCallbacks);
+    }
+
+    auto Window::AddEventCallback(const std::function<void(const WindowEvent&)>& f) -> int
+    {
+        const int id = _nextEventCallbackId++;
+        (_eventCallbackDepth > 0 ? _addedEventCallbacks : _eventCallbacks).push_back({ id, f, false });
+        return id;
+    }
+
+    auto Window::RemoveEventCallback(int callbackId) -> void
+    {
+        RemoveCallback(_eventCallbacks, _addedEventCallbacks, callbackId, _eventCallbackDepth > 0);
     }
 
     auto Window::CaptureCursorInternal(bool doCapture) -> void
@@ -472,8 +538,12 @@ namespace NWA
     }
 
     // https://www.khronos.org/opengl/wiki/Creating_an_OpenGL_Context_(WGL)
-    auto Window::CreateOpenGLContext() -> void
+    auto Window::SetOpenGLPixelFormat() -> bool
     {
+        // Pixel format of a window can only be set once
+        if (_glPixelFormatSet)
+            return true;
+
         HDC hDeviceHandle = static_cast<HDC>(_hDeviceHandle);
 
         PIXELFORMATDESCRIPTOR pfd =
@@ -497,15 +567,74 @@ namespace NWA
         };
 
         const int letWindowsChooseThisPixelFormat = ::ChoosePixelFormat(hDeviceHandle, &pfd);
-        ::SetPixelFormat(hDeviceHandle, letWindowsChooseThisPixelFormat, &pfd);
+        _glPixelFormatSet = ::SetPixelFormat(hDeviceHandle, letWindowsChooseThisPixelFormat, &pfd) != FALSE;
+
+        return _glPixelFormatSet;
+    }
+
+    auto Window::CreateOpenGLContext() -> void
+    {
+        HDC hDeviceHandle = static_cast<HDC>(_hDeviceHandle);
+
+        SetOpenGLPixelFormat();
 
         _hGLContext = ::wglCreateContext(hDeviceHandle);
         ::wglMakeCurrent(hDeviceHandle, static_cast<HGLRC>(_hGLContext));
+
+        GLProcLoader::BindCurrentContext();
+    }
+
+    auto Window::GetDeviceContext() const -> DeviceContextHandle
+    {
+        return _hDeviceHandle;
+    }
+
+    auto Window::GetOpenGLProcAddress(const char* name) -> void*
+    {
+        void* proc = reinterpret_cast<void*>(::wglGetProcAddress(name));
+
+        // Some drivers return small integers instead of nullptr on failure,
+        // and OpenGL 1.1 functions can only be found in opengl32.dll.
+        const auto procValue = reinterpret_cast<std::intptr_t>(proc);
+        if (procValue == 0 || procValue == 1 || procValue == 2 || procValue == 3 || procValue == -1)
+            proc = reinterpret_cast<void*>(::GetProcAddress(::GetModuleHandleW(L"opengl32.dll"), name));
+
+        return proc;
     }
 
     auto Window::SwapBuffer() const -> void
     {
+        // Callbacks may add or remove callbacks, e.g. a FrameCapture destroyed from one
+        _swapBufferCallbackDepth++;
+
+        for (const auto& callback : _swapBufferCallbacks)
+        {
+            if (callback.stage == SwapBufferStage::BeforeSwap && !callback.removed)
+                callback.func();
+        }
+
         ::SwapBuffers(static_cast<HDC>(_hDeviceHandle));
+
+        for (const auto& callback : _swapBufferCallbacks)
+        {
+            if (callback.stage == SwapBufferStage::AfterSwap && !callback.removed)
+                callback.func();
+        }
+
+        if (--_swapBufferCallbackDepth == 0)
+            ApplyCallbackChanges(_swapBufferCallbacks, _addedSwapBufferCallbacks);
+    }
+
+    auto Window::AddSwapBufferCallback(SwapBufferStage stage, const std::function<void()>& f) -> int
+    {
+        const int id = _nextSwapBufferCallbackId++;
+        (_swapBufferCallbackDepth > 0 ? _addedSwapBufferCallbacks : _swapBufferCallbacks).push_back({ id, stage, f, false });
+        return id;
+    }
+
+    auto Window::RemoveSwapBufferCallback(int callbackId) -> void
+    {
+        RemoveCallback(_swapBufferCallbacks, _addedSwapBufferCallbacks, callbackId, _swapBufferCallbackDepth > 0);
     }
 
 }
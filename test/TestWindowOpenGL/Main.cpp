@@ -1,8 +1,16 @@
+#include <algorithm>
 #include <iostream>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <format>
+#include <memory>
+#include <vector>
 #include "NativeWinApp/Window.h"
-#include "glad/gl.h"
+#include "NativeWinApp/GLGpuProfiler.h"
+#include "NativeWinApp/FrameCapture.h"
+#include "NativeWinApp/GLContextManager.h"
+#include "NativeWinApp/GLProcLoader.h"
 
 const char* vertexShaderSource ="#version 330 core\n"
                                 "layout (location = 0) in vec3 aPos;\n"
@@ -29,7 +37,8 @@ const std::array<float, 18> vertices = {
         -0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 0.0f,
 };
 
-void DebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
+void APIENTRY DebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
+void RunContextManagerBenchmark();
 
 static char* infoLog = new char[1024];
 
@@ -38,94 +47,296 @@ int main()
     NWA::Window window(800, 600, "TestOpenGL");
     window.CreateOpenGLContext();
 
-    ::gladLoaderLoadGL();
+    // Resolved by CreateOpenGLContext, every call below goes through the context's table
+    const NWA::GLDispatchTable* pGL = NWA::GLProcLoader::Current();
+    if (pGL == nullptr)
+    {
+        std::cout << "OpenGL context creation failed" << std::endl;
+        return 1;
+    }
+
+    const NWA::GLDispatchTable& gl = *pGL;
+
+    gl.Viewport(0, 0, 800, 600);
 
-    ::glViewport(0, 0, 800, 600);
-    ::glEnable(GL_DEBUG_OUTPUT);
-    ::glDebugMessageCallback(&DebugMessageCallback, nullptr);
+    // Core since 4.3, older contexts leave it null
+    if (gl.DebugMessageCallback != nullptr)
+    {
+        gl.Enable(GL_DEBUG_OUTPUT);
+        gl.DebugMessageCallback(&DebugMessageCallback, nullptr);
+    }
 
-    unsigned int vertexShader = ::glCreateShader(GL_VERTEX_SHADER);
-    ::glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-    ::glCompileShader(vertexShader);
+    unsigned int vertexShader = gl.CreateShader(GL_VERTEX_SHADER);
+    gl.ShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
+    gl.CompileShader(vertexShader);
     {
         int success;
-        ::glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+        gl.GetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
         if (!success)
         {
-            ::glGetShaderInfoLog(vertexShader, 1024, nullptr, infoLog);
+            gl.GetShaderInfoLog(vertexShader, 1024, nullptr, infoLog);
             std::cout << "Vertex Shader Compile Error : " << infoLog << std::endl;
         }
     }
 
-    unsigned int fragmentShader = ::glCreateShader(GL_FRAGMENT_SHADER);
-    ::glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-    ::glCompileShader(fragmentShader);
+    unsigned int fragmentShader = gl.CreateShader(GL_FRAGMENT_SHADER);
+    gl.ShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
+    gl.CompileShader(fragmentShader);
     {
         int success;
-        ::glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+        gl.GetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
         if (!success)
         {
-            ::glGetShaderInfoLog(fragmentShader, 1024, nullptr, infoLog);
+            gl.GetShaderInfoLog(fragmentShader, 1024, nullptr, infoLog);
             std::cout << "Fragment Shader Compile Error : " << infoLog << std::endl;
         }
     }
 
-    unsigned int shaderProgram = ::glCreateProgram();
-    ::glAttachShader(shaderProgram, vertexShader);
-    ::glAttachShader(shaderProgram, fragmentShader);
-    ::glLinkProgram(shaderProgram);
+    unsigned int shaderProgram = gl.CreateProgram();
+    gl.AttachShader(shaderProgram, vertexShader);
+    gl.AttachShader(shaderProgram, fragmentShader);
+    gl.LinkProgram(shaderProgram);
     {
         int success;
-        ::glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+        gl.GetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
         if (!success)
         {
-            ::glGetProgramInfoLog(shaderProgram, 1024, nullptr, infoLog);
+            gl.GetProgramInfoLog(shaderProgram, 1024, nullptr, infoLog);
             std::cout << "Program Linking Error : " << infoLog << std::endl;
         }
     }
 
     unsigned int vertexArray;
-    ::glGenVertexArrays(1, &vertexArray);
-    ::glBindVertexArray(vertexArray);
+    gl.GenVertexArrays(1, &vertexArray);
+    gl.BindVertexArray(vertexArray);
 
     unsigned int vertexBuffer;
-    ::glGenBuffers(1, &vertexBuffer);
-    ::glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    ::glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    gl.GenBuffers(1, &vertexBuffer);
+    gl.BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    gl.BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+    gl.EnableVertexAttribArray(0);
+    gl.EnableVertexAttribArray(1);
+    gl.VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    gl.VertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+
+    NWA::GLGpuProfiler gpuProfiler;
+    gpuProfiler.Attach(window);
 
-    ::glEnableVertexAttribArray(0);
-    ::glEnableVertexAttribArray(1);
-    ::glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    ::glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    // C captures a run of frames, the consumer only touches every pixel on the worker thread
+    std::atomic<uint64_t> capturedChecksum = 0;
+    NWA::FrameCapture frameCapture([&capturedChecksum](const NWA::FrameCapture::Frame& frame) -> void
+    {
+        uint64_t checksum = 0;
+        for (int i = 0; i < frame.stride * frame.height; i++)
+            checksum += static_cast<uint8_t>(frame.pixels[i]);
+
+        capturedChecksum += checksum;
+    }, 3);
+
+    if (frameCapture.IsValid())
+        frameCapture.Attach(window);
+
+    // Render thread time of a frame: from its first call to the last BeforeSwap callback, so the
+    // capture's read back is included and the wait for vsync in SwapBuffers is not
+    const int captureBenchmarkFrames = 300;
+    int captureBenchmarkFrame = -1;
+    double baselineMs = 0;
+    double renderMs = 0;
+    uint64_t capturedBefore = 0;
+    uint64_t droppedBefore = 0;
+    auto frameStart = std::chrono::steady_clock::now();
+
+    window.AddSwapBufferCallback(NWA::SwapBufferStage::BeforeSwap, [&]() -> void
+    {
+        renderMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    });
 
     while (true)
     {
         window.EventLoop();
 
-        if (std::ranges::any_of(window.PopAllEvent(), [](const NWA::WindowEvent& event) -> bool { return event.type == NWA::WindowEvent::Type::Close; }))
+        bool shouldClose = false;
+        for (const auto& event : window.PopAllEvent())
+        {
+            if (event.type == NWA::WindowEvent::Type::Close)
+                shouldClose = true;
+
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::C
+                && frameCapture.IsValid() && captureBenchmarkFrame < 0)
+            {
+                std::cout << std::format("[Capture] measuring {} frames without capture, then {} with", captureBenchmarkFrames, captureBenchmarkFrames) << std::endl;
+                captureBenchmarkFrame = 0;
+                renderMs = 0;
+            }
+
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::W)
+                RunContextManagerBenchmark();
+        }
+
+        if (shouldClose)
             break;
 
-        ::glClearColor(0.7f, 0.7f, 0.7f, 1.0f);
-        ::glClear(GL_COLOR_BUFFER_BIT);
+        // Baseline run first, then the same number of frames captured
+        if (captureBenchmarkFrame == captureBenchmarkFrames)
+        {
+            baselineMs = renderMs;
+            renderMs = 0;
+            capturedBefore = frameCapture.GetCapturedFrameCount();
+            droppedBefore = frameCapture.GetDroppedFrameCount();
+            frameCapture.RequestCapture(captureBenchmarkFrames);
+        }
+        else if (captureBenchmarkFrame == captureBenchmarkFrames * 2)
+        {
+            // The last frames may still be on the GPU or in the callback
+            frameCapture.Poll();
+
+            std::cout << std::format("[Capture] render thread {:.3f} ms per frame without capture, {:.3f} ms with, {} captured, {} dropped",
+                baselineMs / captureBenchmarkFrames, renderMs / captureBenchmarkFrames, frameCapture.GetCapturedFrameCount() - capturedBefore,
+                frameCapture.GetDroppedFrameCount() - droppedBefore) << std::endl;
 
-        ::glBindVertexArray(vertexArray);
-        ::glUseProgram(shaderProgram);
-        ::glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-        ::glDrawArrays(GL_TRIANGLES, 0, 3);
+            captureBenchmarkFrame = -1;
+        }
+
+        if (captureBenchmarkFrame >= 0)
+            captureBenchmarkFrame++;
+
+        frameStart = std::chrono::steady_clock::now();
+
+        {
+            NWA::GLGpuProfiler::ScopeZone zone(gpuProfiler, "clear");
+            gl.ClearColor(0.7f, 0.7f, 0.7f, 1.0f);
+            gl.Clear(GL_COLOR_BUFFER_BIT);
+        }
+
+        {
+            NWA::GLGpuProfiler::ScopeZone zone(gpuProfiler, "triangle");
+            gl.BindVertexArray(vertexArray);
+            gl.UseProgram(shaderProgram);
+            gl.BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+            gl.DrawArrays(GL_TRIANGLES, 0, 3);
+        }
 
         window.SwapBuffer();
     }
 
-    ::glDeleteShader(vertexShader);
-    ::glDeleteShader(fragmentShader);
-    ::glDeleteVertexArrays(1, &vertexArray);
-    ::glDeleteBuffers(1, &vertexBuffer);
-    ::glDeleteProgram(shaderProgram);
+    for (const auto& stats : gpuProfiler.GetZoneStats())
+        std::cout << std::format("[GPU] {}: avg {:.3f} ms, min {:.3f} ms, max {:.3f} ms", stats.name, stats.averageMs, stats.minMs, stats.maxMs) << std::endl;
+
+    gl.DeleteShader(vertexShader);
+    gl.DeleteShader(fragmentShader);
+    gl.DeleteVertexArrays(1, &vertexArray);
+    gl.DeleteBuffers(1, &vertexBuffer);
+    gl.DeleteProgram(shaderProgram);
 
     return 0;
 }
 
-void DebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
+// W opens 1 to 16 extra windows and clears them for a while, once with a context per window
+// switched unconditionally, once through GLContextManager, and prints the switches and frame time.
+void RunContextManagerBenchmark()
+{
+    const int frameCount = 100;
+    const std::array<int, 5> windowCounts = { 1, 2, 4, 8, 16 };
+
+    // The sample's own context is restored afterwards
+    const HDC hMainDeviceContext = ::wglGetCurrentDC();
+    const HGLRC hMainContext = ::wglGetCurrentContext();
+
+    const auto clear = [](int windowIndex) -> void
+    {
+        const NWA::GLDispatchTable* pGL = NWA::GLProcLoader::Current();
+        if (pGL == nullptr)
+            return;
+
+        pGL->ClearColor(0.1f * static_cast<float>(windowIndex % 8), 0.3f, 0.5f, 1.0f);
+        pGL->Clear(GL_COLOR_BUFFER_BIT);
+    };
+
+    for (const int windowCount : windowCounts)
+    {
+        double baselineMs = 0;
+        uint64_t baselineSwitches = 0;
+
+        // Baseline: every window owns a context, made current before it is drawn and swapped
+        {
+            std::vector<std::unique_ptr<NWA::Window>> windows;
+            std::vector<HGLRC> contexts;
+            for (int i = 0; i < windowCount; i++)
+            {
+                windows.push_back(std::make_unique<NWA::Window>(256, 256, std::format("Context benchmark {}", i)));
+                windows.back()->CreateOpenGLContext();
+                contexts.push_back(::wglGetCurrentContext());
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frameCount; frame++)
+            {
+                for (int i = 0; i < windowCount; i++)
+                {
+                    windows[i]->EventLoop();
+                    windows[i]->PopAllEvent();
+
+                    ::wglMakeCurrent(static_cast<HDC>(windows[i]->GetDeviceContext()), contexts[i]);
+                    NWA::GLProcLoader::BindCurrentContext();
+                    baselineSwitches++;
+
+                    clear(i);
+                    windows[i]->SwapBuffer();
+                }
+            }
+
+            baselineMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        double managerMs = 0;
+        NWA::GLContextManager::Statistics managerStatistics {};
+
+        // One context for every window, switches skipped when the window is already current
+        {
+            std::vector<std::unique_ptr<NWA::Window>> windows;
+            NWA::GLContextManager manager;
+            for (int i = 0; i < windowCount; i++)
+            {
+                windows.push_back(std::make_unique<NWA::Window>(256, 256, std::format("Context benchmark {}", i)));
+                manager.AddWindow(*windows.back());
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frameCount; frame++)
+            {
+                for (int i = 0; i < windowCount; i++)
+                {
+                    windows[i]->EventLoop();
+                    windows[i]->PopAllEvent();
+
+                    if (!manager.MakeCurrent(*windows[i]))
+                        continue;
+
+                    clear(i);
+                    manager.EndWindow(*windows[i]);
+                }
+
+                manager.Present();
+            }
+
+            managerMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            managerStatistics = manager.GetStatistics();
+
+            for (auto& pWindow : windows)
+                manager.RemoveWindow(*pWindow);
+        }
+
+        std::cout << std::format("[Context] {} windows: per window contexts {:.3f} ms per frame, {} switches, manager {:.3f} ms per frame, {} switches, {} skipped",
+            windowCount, baselineMs / frameCount, baselineSwitches, managerMs / frameCount, managerStatistics.makeCurrentCalls,
+            managerStatistics.skippedMakeCurrentCalls) << std::endl;
+    }
+
+    ::wglMakeCurrent(hMainDeviceContext, hMainContext);
+    NWA::GLProcLoader::BindCurrentContext();
+}
+
+void APIENTRY DebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
 {
     std::string messageSource;
     switch (source)
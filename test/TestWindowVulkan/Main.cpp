@@ -1,22 +1,90 @@
 #include <vulkan/vulkan.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
 #include <vector>
 #include "NativeWinApp/Window.h"
+#include "NativeWinApp/FramePacer.h"
 #include "NativeWinApp/Vulkan.h"
-#include "vert.h"
-#include "frag.h"
+#include "NativeWinApp/VulkanSwapchain.h"
+#include "NativeWinApp/VulkanPipelineCache.h"
+#include "NativeWinApp/VulkanPipelineCompiler.h"
+#include "NativeWinApp/VulkanMemoryAllocator.h"
+#include "NativeWinApp/VulkanUploader.h"
+#include "NativeWinApp/VulkanGpuProfiler.h"
+#include "NativeWinApp/VulkanHostAllocator.h"
+#include "NativeWinApp/VulkanBootstrap.h"
+#include "NativeWinApp/VulkanCommandContext.h"
+#include "NativeWinApp/VulkanDescriptorAllocator.h"
+#include "NativeWinApp/VulkanFrameScheduler.h"
+#include "NativeWinApp/VulkanDebugMessenger.h"
+#include "NativeWinApp/VulkanMemoryMonitor.h"
+#include "NativeWinApp/VulkanShaderLibrary.h"
+#include "NativeWinApp/VulkanPresenter.h"
+#include "TestWindowVulkanShaders.h"
+
+void RunMemoryAllocatorBenchmark(NWA::VulkanMemoryAllocator&);
+void RunUploadBenchmark(NWA::VulkanUploader&, VkBuffer);
+void RunSurfaceQueryBenchmark(const NWA::VulkanInstanceTable&, VkPhysicalDevice, VkSurfaceKHR);
+void RunCommandRecordingBenchmark(const NWA::VulkanDeviceTable&, uint32_t, VkRenderPass, VkPipeline, VkExtent2D);
+void RunDispatchBenchmark(const NWA::VulkanDeviceTable&, uint32_t);
+void RunDescriptorAllocatorBenchmark(const NWA::VulkanDeviceTable&);
+void RunFrameSchedulerStressTest(const NWA::VulkanDeviceTable&, VkQueue, VkQueue);
+void PrintPresentLatency(NWA::VulkanSwapchain&);
+void PrintFramePacer(const NWA::FramePacer&);
+void RunFramePacerBenchmark();
+void RunDebugMessengerFloodTest(const NWA::VulkanInstanceTable&, NWA::VulkanDebugMessenger&);
+void RunMemoryMonitorTest(const NWA::VulkanInstanceTable&, VkPhysicalDevice, NWA::VulkanMemoryAllocator&, NWA::VulkanMemoryMonitor&);
+void RunPresenterBenchmark(const NWA::VulkanInstanceTable&, const NWA::VulkanDeviceTable&, VkPhysicalDevice, VkQueue, uint32_t, VkSurfaceFormatKHR, VkRenderPass, VkPipeline, const VkAllocationCallbacks*);
+
+// Variants of the triangle pipeline compiled in the background while the first frames render,
+// they differ in rasterizer and blend state. Everything their descriptions point to lives here
+// until the compiler is done with them.
+struct PipelineVariants
+{
+    static constexpr int COUNT = 500;
+
+    VkPipelineVertexInputStateCreateInfo vertexInput;
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly;
+    VkPipelineViewportStateCreateInfo viewportState;
+    VkPipelineMultisampleStateCreateInfo multisampling;
+    std::vector<VkDynamicState> dynamicStates;
+    VkPipelineDynamicStateCreateInfo dynamicState;
 
-VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT, VkDebugUtilsMessageTypeFlagsEXT, const VkDebugUtilsMessengerCallbackDataEXT*, void*);
+    std::vector<VkPipelineRasterizationStateCreateInfo> rasterizers;
+    std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments;
+    std::vector<VkPipelineColorBlendStateCreateInfo> colorBlendings;
 
-VkResult CreateDebugUtilsMessengerEXT(VkInstance, const VkDebugUtilsMessengerCreateInfoEXT*, const VkAllocationCallbacks*, VkDebugUtilsMessengerEXT*);
-void DestroyDebugUtilsMessengerEXT(VkInstance, VkDebugUtilsMessengerEXT, const VkAllocationCallbacks*);
+    std::vector<std::future<VkPipeline>> futures;
+    std::vector<VkPipeline> pipelines;
+    std::chrono::steady_clock::time_point startTime;
+};
 
-int main()
+int main(int argc, char** argv)
 {
     int windowWidth = 800;
     int windowHeight = 800;
 
-    NWA::Window window(windowWidth, windowHeight, "TestVulkan");
+    // --headless renders a fixed number of frames to a VK_EXT_headless_surface and prints the
+    // frame times, no window and no display needed
+    const bool headless = argc > 1 && std::strcmp(argv[1], "--headless") == 0;
+    const int headlessFrameCount = 1000;
+
+    if (headless && !NWA::Vulkan::IsHeadlessSurfaceSupported())
+        throw std::runtime_error("VK_EXT_headless_surface is not supported!");
+
+    std::unique_ptr<NWA::Window> pWindow;
+    if (!headless)
+        pWindow = std::make_unique<NWA::Window>(windowWidth, windowHeight, "TestVulkan");
+
+    // Driver host allocations of the instance, the device and their children, outlives them all
+    NWA::VulkanHostAllocator hostAllocator;
+    const VkAllocationCallbacks* pHostCallbacks = hostAllocator.GetCallbacks();
 
 #pragma region [Setup layers & extensions]
 
@@ -24,12 +92,18 @@ int main()
     std::vector<const char*> instanceLevelExtension;
     std::vector<const char*> deviceLevelExtension;
 
+    if (!NWA::VulkanLoader::Initialize())
+        throw std::runtime_error("failed to load the vulkan library!");
+
+    // Global functions come from the loaded library, like the instance and device tables
+    const NWA::VulkanGlobalTable& globalTable = NWA::VulkanLoader::GetGlobalTable();
+
     {
         // Get all layers
         uint32_t vkLayerPropertiesCount = 0;
-        ::vkEnumerateInstanceLayerProperties(&vkLayerPropertiesCount, nullptr);
+        globalTable.vkEnumerateInstanceLayerProperties(&vkLayerPropertiesCount, nullptr);
         std::vector<VkLayerProperties> supportedLayers(vkLayerPropertiesCount);
-        ::vkEnumerateInstanceLayerProperties(&vkLayerPropertiesCount, supportedLayers.data());
+        globalTable.vkEnumerateInstanceLayerProperties(&vkLayerPropertiesCount, supportedLayers.data());
 
         // Add validation layers
         const char* VALIDATION_LAYER_NAME = "VK_LAYER_KHRONOS_validation";
@@ -40,7 +114,7 @@ int main()
         }
 
         // Instance level extension
-        auto windowRequiredExtensions = NWA::Vulkan::GetRequiredInstanceExtensions();
+        auto windowRequiredExtensions = NWA::Vulkan::GetRequiredInstanceExtensions(headless ? NWA::VulkanSurfaceType::Headless : NWA::VulkanSurfaceType::Window);
         instanceLevelExtension.insert(instanceLevelExtension.end(), windowRequiredExtensions.begin(), windowRequiredExtensions.end());
         instanceLevelExtension.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
@@ -61,7 +135,8 @@ int main()
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // Timeline semaphores are core in 1.2
+        appInfo.apiVersion = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -71,7 +146,7 @@ int main()
         createInfo.enabledExtensionCount = instanceLevelExtension.size();
         createInfo.ppEnabledExtensionNames = instanceLevelExtension.data();
 
-        auto createInstanceRet = ::vkCreateInstance(&createInfo, nullptr, &vkInstance);
+        auto createInstanceRet = globalTable.vkCreateInstance(&createInfo, pHostCallbacks, &vkInstance);
         if (createInstanceRet != VK_SUCCESS)
             throw std::runtime_error("failed to create instance!");
     }
@@ -80,75 +155,52 @@ int main()
 
 #pragma region [Debug message]
 
-    VkDebugUtilsMessengerEXT vkDebugUtilExtHandle;
+    NWA::VulkanInstanceTable instanceTable;
+    if (!NWA::VulkanLoader::LoadInstanceTable(vkInstance, instanceTable))
+        throw std::runtime_error("failed to load vulkan functions!");
 
+    // Validation output is formatted on a background thread, floods are rate limited per id
+    NWA::VulkanDebugMessenger::CreateInfo messengerCreateInfo;
+    messengerCreateInfo.instance = vkInstance;
+    messengerCreateInfo.severities = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    messengerCreateInfo.sink = [](const NWA::VulkanDebugMessenger::Message& message) -> void
     {
-        VkDebugUtilsMessengerCreateInfoEXT createInfo {};
-        createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-        createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-        createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-        createInfo.pfnUserCallback = DebugCallback;
-
-        if (CreateDebugUtilsMessengerEXT(vkInstance, &createInfo, nullptr, &vkDebugUtilExtHandle) != VK_SUCCESS)
-            throw std::runtime_error("failed to set up debug messenger!");
-    }
+        std::cout << NWA::VulkanDebugMessenger::Format(message) << std::endl;
+    };
+    messengerCreateInfo.pAllocator = pHostCallbacks;
+
+    auto pDebugMessenger = std::make_unique<NWA::VulkanDebugMessenger>(instanceTable, messengerCreateInfo);
+    if (!pDebugMessenger->IsValid())
+        throw std::runtime_error("failed to set up debug messenger!");
 
 #pragma endregion
 
 #pragma region [Window surface]
 
     VkSurfaceKHR vkSurface;
-    if (!NWA::Vulkan::CreateVulkanSurface(vkInstance, window, vkSurface, nullptr))
+    if (headless ? !NWA::Vulkan::CreateHeadlessSurface(vkInstance, vkSurface, pHostCallbacks) : !NWA::Vulkan::CreateVulkanSurface(vkInstance, *pWindow, vkSurface, pHostCallbacks))
         throw std::runtime_error("failed to create window surface!");
 
 #pragma endregion
 
 #pragma region [Physical device]
 
-    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-
-    {
-        uint32_t deviceCount = 0;
-        ::vkEnumeratePhysicalDevices(vkInstance, &deviceCount, nullptr);
-        std::vector<VkPhysicalDevice> devices(deviceCount);
-        ::vkEnumeratePhysicalDevices(vkInstance, &deviceCount, devices.data());
-
-        for (const auto& device : devices)
-        {
-            VkPhysicalDeviceProperties deviceProperties;
-            ::vkGetPhysicalDeviceProperties(device, &deviceProperties);
-
-            uint32_t extensionCount = 0;
-            ::vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
-            std::vector<VkExtensionProperties> extensions(extensionCount);
-            ::vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+    // Later launches read the choice back instead of probing every device
+    NWA::VulkanBootstrap::CreateInfo bootstrapCreateInfo;
+    bootstrapCreateInfo.instance = vkInstance;
+    bootstrapCreateInfo.surface = vkSurface;
+    bootstrapCreateInfo.requiredExtensions = deviceLevelExtension;
+    bootstrapCreateInfo.cachePath = "TestWindowVulkan.device";
 
-            bool supportsSwapchain = false;
-            for (auto& extension: extensions)
-            {
-                if (std::strcmp(extension.extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
-                {
-                    supportsSwapchain = true;
-                    break;
-                }
-            }
-
-            if (!supportsSwapchain)
-                continue;
+    NWA::VulkanBootstrap bootstrap(instanceTable, bootstrapCreateInfo);
+    if (!bootstrap.IsValid())
+        throw std::runtime_error("failed to find a suitable GPU!");
 
-            if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
-                physicalDevice = device;
+    const NWA::VulkanBootstrap::Selection& deviceSelection = bootstrap.GetSelection();
+    VkPhysicalDevice physicalDevice = deviceSelection.physicalDevice;
 
-            if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-            {
-                physicalDevice = device;
-                break;
-            }
-        }
-    }
-
-    if (physicalDevice == VK_NULL_HANDLE)
-        throw std::runtime_error("failed to find a suitable GPU!");
+    std::cout << deviceSelection.properties.deviceName << " selected in " << bootstrap.GetSelectionTime().count() << " us ("
+        << (bootstrap.IsLoadedFromCache() ? "cached" : "probed") << ")" << std::endl;
 
 #pragma endregion
 
@@ -157,187 +209,228 @@ int main()
     VkDevice logicDevice;
     VkQueue deviceQueue;
     int queueFamilyIndex = -1;
+    VkQueue transferQueue;
+    int transferQueueFamilyIndex = -1;
+    bool presentWaitSupported = false;
+    bool memoryBudgetSupported = false;
 
     {
-        uint32_t queueFamilyCount = 0;
-        ::vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
-        std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
-        ::vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+        // The swapchain renders and presents on one queue
+        if (deviceSelection.presentQueueFamily != deviceSelection.graphicsQueueFamily)
+            throw std::runtime_error("failed to queue families!");
+
+        queueFamilyIndex = static_cast<int>(deviceSelection.graphicsQueueFamily);
 
-        for (std::size_t i = 0; i < queueFamilyProperties.size(); i++)
+        // Uploads go to the DMA queue when there is one
+        transferQueueFamilyIndex = static_cast<int>(deviceSelection.transferQueueFamily);
+
+        float queuePriority = 1.0f;
+
+        std::vector<VkDeviceQueueCreateInfo> deviceQueueCreateInfos;
+        for (uint32_t family : bootstrap.GetQueueFamilies())
         {
-            // Support graphics
-            bool supportGraphics = queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT;
+            VkDeviceQueueCreateInfo deviceQueueCreateInfo {};
+            deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            deviceQueueCreateInfo.queueCount = 1;
+            deviceQueueCreateInfo.queueFamilyIndex = family;
+            deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+            deviceQueueCreateInfos.push_back(deviceQueueCreateInfo);
+        }
 
-            // Support compute
-            bool supportCompute = queueFamilyProperties[i].queueFlags & VK_QUEUE_COMPUTE_BIT;
+        VkPhysicalDeviceFeatures physicalDeviceFeatures {};
+        physicalDeviceFeatures.samplerAnisotropy = VK_TRUE;
 
-            // Support surface
-            VkBool32 supportPresentation = false;
-            ::vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, vkSurface, &supportPresentation);
+        // Present ids and present wait time every present until it is shown, optional
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures {};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
 
-            // By vulkan spec, we can not assum that there will be one queue statisfy "graphics", "compute"
-            // and "Presentation" at the same time. But we just make this assumption, it's fine.
-            if (supportGraphics && supportCompute && supportPresentation)
-            {
-                queueFamilyIndex = static_cast<int>(i);
-                break;
-            }
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures {};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+
+        uint32_t deviceExtensionCount = 0;
+        ::vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &deviceExtensionCount, nullptr);
+        std::vector<VkExtensionProperties> deviceExtensions(deviceExtensionCount);
+        ::vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &deviceExtensionCount, deviceExtensions.data());
+
+        int presentTimingExtensionCount = 0;
+        for (const auto& extension : deviceExtensions)
+        {
+            if (std::strcmp(extension.extensionName, VK_KHR_PRESENT_ID_EXTENSION_NAME) == 0 || std::strcmp(extension.extensionName, VK_KHR_PRESENT_WAIT_EXTENSION_NAME) == 0)
+                presentTimingExtensionCount++;
+
+            // Heap usage and budget of the process, the memory monitor falls back to allocator tracking
+            if (std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+                memoryBudgetSupported = true;
         }
 
-        if (queueFamilyIndex < 0)
-            throw std::runtime_error("failed to queue families!");
+        if (presentTimingExtensionCount == 2)
+        {
+            VkPhysicalDeviceFeatures2 physicalDeviceFeatures2 {};
+            physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            physicalDeviceFeatures2.pNext = &presentIdFeatures;
+            ::vkGetPhysicalDeviceFeatures2(physicalDevice, &physicalDeviceFeatures2);
 
-        float queuePriority = 1.0f;
+            presentWaitSupported = presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+        }
 
-        VkDeviceQueueCreateInfo deviceQueueCreateInfo {};
-        deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        deviceQueueCreateInfo.queueCount = 1;
-        deviceQueueCreateInfo.queueFamilyIndex = static_cast<uint32_t>(queueFamilyIndex);
-        deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+        if (presentWaitSupported)
+        {
+            deviceLevelExtension.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            deviceLevelExtension.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        }
 
-        VkPhysicalDeviceFeatures physicalDeviceFeatures {};
-        physicalDeviceFeatures.samplerAnisotropy = VK_TRUE;
+        if (memoryBudgetSupported)
+            deviceLevelExtension.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures {};
+        timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        timelineSemaphoreFeatures.pNext = presentWaitSupported ? &presentIdFeatures : nullptr;
+        timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
 
         VkDeviceCreateInfo deviceCreateInfo {};
         deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceCreateInfo.pNext = &timelineSemaphoreFeatures;
         deviceCreateInfo.enabledExtensionCount = deviceLevelExtension.size();
         deviceCreateInfo.ppEnabledExtensionNames = deviceLevelExtension.data();
         deviceCreateInfo.enabledLayerCount = activeLayers.size();
         deviceCreateInfo.ppEnabledLayerNames = activeLayers.data();
-        deviceCreateInfo.queueCreateInfoCount = 1;
-        deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
+        deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(deviceQueueCreateInfos.size());
+        deviceCreateInfo.pQueueCreateInfos = deviceQueueCreateInfos.data();
         deviceCreateInfo.pEnabledFeatures = &physicalDeviceFeatures;
 
-        if (::vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &logicDevice) != VK_SUCCESS)
+        if (::vkCreateDevice(physicalDevice, &deviceCreateInfo, pHostCallbacks, &logicDevice) != VK_SUCCESS)
             throw std::runtime_error("failed to create logic device!");
 
         ::vkGetDeviceQueue(logicDevice, static_cast<uint32_t>(queueFamilyIndex), 0, &deviceQueue);
+        ::vkGetDeviceQueue(logicDevice, static_cast<uint32_t>(transferQueueFamilyIndex), 0, &transferQueue);
     }
 
 #pragma endregion
 
 #pragma region [Swapchain]
 
-    VkSurfaceFormatKHR swapchainFormat;
+    NWA::VulkanDeviceTable deviceTable;
 
-    {
-        // Foarmat -> find a format that supports RGBA
-        uint32_t surfaceFormatsCount = 0;
-        ::vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, vkSurface, &surfaceFormatsCount, nullptr);
-        std::vector<VkSurfaceFormatKHR> surfaceFormats(surfaceFormatsCount);
-        ::vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, vkSurface, &surfaceFormatsCount, surfaceFormats.data());
+    if (!NWA::VulkanLoader::LoadDeviceTable(instanceTable, logicDevice, deviceTable))
+        throw std::runtime_error("failed to load vulkan functions!");
 
-        for (auto& [format, colorSpace]: surfaceFormats)
-        {
-            if ((format == VK_FORMAT_B8G8R8A8_UNORM) && (colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR))
-            {
-                swapchainFormat.format = VK_FORMAT_B8G8R8A8_UNORM;
-                swapchainFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
-                break;
-            }
-        }
+    NWA::VulkanSwapchain::CreateInfo swapchainCreateInfo;
+    swapchainCreateInfo.physicalDevice = physicalDevice;
+    swapchainCreateInfo.surface = vkSurface;
+    swapchainCreateInfo.queue = deviceQueue;
+    swapchainCreateInfo.queueFamilyIndex = static_cast<uint32_t>(queueFamilyIndex);
+    swapchainCreateInfo.framesInFlight = 2;
+    swapchainCreateInfo.presentWait = presentWaitSupported;
+    swapchainCreateInfo.presentMode = NWA::VulkanPresentMode::Mailbox;
+    swapchainCreateInfo.width = static_cast<uint32_t>(windowWidth);
+    swapchainCreateInfo.height = static_cast<uint32_t>(windowHeight);
 
-        if (swapchainFormat.format == VK_FORMAT_UNDEFINED)
-            throw std::runtime_error("failed to find suitable color format!");
-    }
+    // Waited on right before every present, uncapped until F picks a frame rate
+    NWA::FramePacer framePacer(0.0);
+    swapchainCreateInfo.pFramePacer = &framePacer;
 
-    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    // Owns objects created on the device, released before the device in clean up
+    auto pSwapchain = std::make_unique<NWA::VulkanSwapchain>(instanceTable, deviceTable, swapchainCreateInfo);
+    NWA::VulkanSwapchain& swapchain = *pSwapchain;
+    if (!swapchain.IsValid())
+        throw std::runtime_error("failed to create swap chain!");
 
-    {
-        uint32_t presentModesCount;
-        ::vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, vkSurface, &presentModesCount, nullptr);
-        std::vector<VkPresentModeKHR> presentModes;
-        ::vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, vkSurface, &presentModesCount, presentModes.data());
+    // Recreated on the window's resize events
+    if (pWindow != nullptr)
+        swapchain.Attach(*pWindow);
 
-        for (auto mode: presentModes)
-        {
-            if (mode == VK_PRESENT_MODE_MAILBOX_KHR)    // Prefer mail box mode
-            {
-                presentMode = mode;
-                break;
-            }
-        }
-    }
+#pragma endregion
 
-    VkSurfaceCapabilitiesKHR surfaceCapabilities {};
+#pragma region [Pipeline cache]
 
-    {
-        if (::vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, vkSurface, &surfaceCapabilities) != VK_SUCCESS)
-            throw std::runtime_error("failed to query surface capabilities!");
-    }
+    // Written back on destruction, the second launch creates the pipeline from the cache
+    auto pPipelineCache = std::make_unique<NWA::VulkanPipelineCache>(instanceTable, deviceTable, physicalDevice, "TestWindowVulkan.pipelinecache");
+    if (!pPipelineCache->IsValid())
+        throw std::runtime_error("failed to create pipeline cache!");
 
-    VkExtent2D swapchainExtent;
-    VkSwapchainKHR swapchain;
+    // Workers compile into their own caches of the pipeline cache
+    auto pPipelineCompiler = std::make_unique<NWA::VulkanPipelineCompiler>(deviceTable, pPipelineCache.get());
+    if (!pPipelineCompiler->IsValid())
+        throw std::runtime_error("failed to create pipeline compiler!");
 
-    {
-        auto Clamp = [](uint32_t value, uint32_t min, uint32_t max) -> uint32_t
-        {
-            return (value <= min) ? min : ((value >= max) ? max : value);
-        };
+#pragma endregion
 
-        swapchainExtent.width  = Clamp(window.GetSize().first, surfaceCapabilities.minImageExtent.width,  surfaceCapabilities.maxImageExtent.width);
-        swapchainExtent.height = Clamp(window.GetSize().second, surfaceCapabilities.minImageExtent.height, surfaceCapabilities.maxImageExtent.height);
-
-        uint32_t imageCount = Clamp(2, surfaceCapabilities.minImageCount, surfaceCapabilities.maxImageCount);
-
-        VkSwapchainCreateInfoKHR swapchainCreateInfo {};
-        swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-        swapchainCreateInfo.surface = vkSurface;
-        swapchainCreateInfo.minImageCount = imageCount;
-        swapchainCreateInfo.imageFormat = swapchainFormat.format;
-        swapchainCreateInfo.imageColorSpace = swapchainFormat.colorSpace;
-        swapchainCreateInfo.imageExtent = swapchainExtent;
-        swapchainCreateInfo.imageArrayLayers = 1;
-        swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-        swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        swapchainCreateInfo.preTransform = surfaceCapabilities.currentTransform;
-        swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-        swapchainCreateInfo.presentMode = presentMode;
-        swapchainCreateInfo.clipped = VK_TRUE;
-        swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
-
-        if (::vkCreateSwapchainKHR(logicDevice, &swapchainCreateInfo, nullptr, &swapchain) != VK_SUCCESS)
-            throw std::runtime_error("failed to create swap chain!");
-    }
+#pragma region [Memory allocator]
+
+    NWA::VulkanMemoryAllocator::CreateInfo allocatorCreateInfo;
+    allocatorCreateInfo.physicalDevice = physicalDevice;
+
+    // Destroyed after every resource allocated from it
+    auto pMemoryAllocator = std::make_unique<NWA::VulkanMemoryAllocator>(instanceTable, deviceTable, allocatorCreateInfo);
+    if (!pMemoryAllocator->IsValid())
+        throw std::runtime_error("failed to create memory allocator!");
 
 #pragma endregion
 
-#pragma region [Swapchain image view]
+#pragma region [Memory monitor]
+
+    NWA::VulkanMemoryMonitor::CreateInfo memoryMonitorCreateInfo;
+    memoryMonitorCreateInfo.physicalDevice = physicalDevice;
+    memoryMonitorCreateInfo.memoryBudget = memoryBudgetSupported;
+    memoryMonitorCreateInfo.pAllocator = pMemoryAllocator.get();
 
-    std::vector<VkImage> swapchainImages;
-    std::vector<VkImageView> swapchainImageViews;
+    // Updated once per frame, a real streaming system would stop loading on Warning
+    auto pMemoryMonitor = std::make_unique<NWA::VulkanMemoryMonitor>(instanceTable, memoryMonitorCreateInfo);
+    if (!pMemoryMonitor->IsValid())
+        throw std::runtime_error("failed to create memory monitor!");
 
+    pMemoryMonitor->AddPressureCallback([](const NWA::VulkanMemoryMonitor::PressureEvent& event)
     {
-        uint32_t imageCount;
-        ::vkGetSwapchainImagesKHR(logicDevice, swapchain, &imageCount, nullptr);
-        swapchainImages.resize(imageCount);
-        ::vkGetSwapchainImagesKHR(logicDevice, swapchain, &imageCount, swapchainImages.data());
-
-        swapchainImageViews.resize(imageCount);
-
-        VkImageViewCreateInfo imageViewCreateInfo {};
-        imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        imageViewCreateInfo.format = swapchainFormat.format;
-        imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-        imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-        imageViewCreateInfo.subresourceRange.levelCount = 1;
-        imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
-        imageViewCreateInfo.subresourceRange.layerCount = 1;
-
-        for (std::size_t i = 0; i < swapchainImages.size(); i++)
-        {
-            imageViewCreateInfo.image = swapchainImages[i];
+        std::cout << "memory heap " << event.heapIndex << ": pressure " << static_cast<int>(event.previous) << " -> "
+            << static_cast<int>(event.heap.pressure) << ", " << (event.heap.usage >> 20) << " of " << (event.heap.budget >> 20) << " MiB" << std::endl;
+    });
 
-            if (::vkCreateImageView(logicDevice, &imageViewCreateInfo, nullptr, &swapchainImageViews[i]) != VK_SUCCESS)
-                throw std::runtime_error("failed to create swapchain image view!");
-        }
-    }
+#pragma endregion
+
+#pragma region [Uploader]
+
+    NWA::VulkanUploader::CreateInfo uploaderCreateInfo;
+    uploaderCreateInfo.transferQueue = transferQueue;
+    uploaderCreateInfo.transferQueueFamilyIndex = static_cast<uint32_t>(transferQueueFamilyIndex);
+    uploaderCreateInfo.graphicsQueueFamilyIndex = static_cast<uint32_t>(queueFamilyIndex);
+
+    // Flushed once per frame, the frame's submission waits on the uploads it uses
+    auto pUploader = std::make_unique<NWA::VulkanUploader>(deviceTable, *pMemoryAllocator, uploaderCreateInfo);
+    if (!pUploader->IsValid())
+        throw std::runtime_error("failed to create uploader!");
+
+    // Destination of the upload benchmark, created on first use
+    VkBuffer uploadBenchmarkBuffer = VK_NULL_HANDLE;
+    NWA::VulkanAllocation uploadBenchmarkAllocation;
+
+#pragma endregion
+
+#pragma region [Frame scheduler]
+
+    // Every frame's submission signals the graphics timeline, frames are paced on it
+    NWA::VulkanFrameScheduler::CreateInfo schedulerCreateInfo;
+    schedulerCreateInfo.queues = { deviceQueue, transferQueue };
+    schedulerCreateInfo.framesInFlight = swapchainCreateInfo.framesInFlight;
+
+    auto pFrameScheduler = std::make_unique<NWA::VulkanFrameScheduler>(deviceTable, schedulerCreateInfo);
+    if (!pFrameScheduler->IsValid())
+        throw std::runtime_error("failed to create frame scheduler!");
+
+#pragma endregion
+
+#pragma region [Gpu profiler]
+
+    // One more slot than frames in flight, results are read without waiting
+    auto pGpuProfiler = std::make_unique<NWA::VulkanGpuProfiler>(instanceTable, deviceTable, physicalDevice, static_cast<uint32_t>(queueFamilyIndex), 3);
+    if (pGpuProfiler->IsValid())
+        pGpuProfiler->SetTraceEnabled(true);
+    else
+        std::cout << "gpu profiler: no timestamp support on the graphics queue" << std::endl;
+
+    // CPU time spent recording and submitting, to check the profiler's overhead
+    double recordCpuMs = 0;
+    int recordCount = 0;
 
 #pragma endregion
 
@@ -347,7 +440,7 @@ int main()
 
     {
         VkAttachmentDescription colorAttachment {};
-        colorAttachment.format = swapchainFormat.format;
+        colorAttachment.format = swapchain.GetFormat().format;
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -378,42 +471,42 @@ int main()
 
 #pragma endregion
 
-#pragma region [Graphics pipeline]
+#pragma region [Shaders]
 
-    VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
+    // Embedded by nwa_embed_shaders, stripped and compressed, decompressed here on first use
+    NWA::VulkanShaderLibrary shaderLibrary(TestWindowVulkanShaders::BLOBS);
 
-    {
-        auto CreateShaderModule = [&logicDevice](const unsigned char* code, size_t size) -> VkShaderModule
-        {
-            VkShaderModuleCreateInfo createInfo {};
-            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-            createInfo.codeSize = size;
-            createInfo.pCode = reinterpret_cast<const uint32_t*>(code);
+    const auto shaderLoadStart = std::chrono::steady_clock::now();
+    const auto vertCode = shaderLibrary.GetCode(TestWindowVulkanShaders::shader_vert);
+    const auto fragCode = shaderLibrary.GetCode(TestWindowVulkanShaders::shader_frag);
+    const auto shaderLoadTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - shaderLoadStart);
 
-            VkShaderModule shaderModule;
-            if (::vkCreateShaderModule(logicDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-                throw std::runtime_error("failed to create shader module!");
+    if (vertCode.empty() || fragCode.empty())
+        throw std::runtime_error("failed to load shaders!");
 
-            return shaderModule;
-        };
+    std::cout << "shaders: " << shaderLibrary.GetBlobCount() << " blobs, " << shaderLibrary.GetStoredBytes() << " bytes embedded, "
+        << vertCode.size_bytes() + fragCode.size_bytes() << " bytes of SPIR-V, loaded in " << shaderLoadTime.count() << " us" << std::endl;
 
-        VkShaderModule vertShaderModule = CreateShaderModule(vert.data(), vert.size());
-        VkShaderModule fragShaderModule = CreateShaderModule(frag.data(), frag.size());
+#pragma endregion
 
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo {};
-        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
+#pragma region [Graphics pipeline]
 
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo {};
-        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
+    VkPipelineLayout pipelineLayout;
+    VkPipeline graphicsPipeline;
+    PipelineVariants pipelineVariants;
 
-        VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+    {
+        NWA::VulkanPipelineCompiler::GraphicsPipelineDesc pipelineDesc;
+        pipelineDesc.stages.resize(2);
+
+        // Shader modules are built on the workers
+        pipelineDesc.stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        pipelineDesc.stages[0].pCode = vertCode.data();
+        pipelineDesc.stages[0].codeSize = vertCode.size_bytes();
+
+        pipelineDesc.stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        pipelineDesc.stages[1].pCode = fragCode.data();
+        pipelineDesc.stages[1].codeSize = fragCode.size_bytes();
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -478,10 +571,8 @@ int main()
         if (::vkCreatePipelineLayout(logicDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
             throw std::runtime_error("failed to create pipeline layout!");
 
-        VkGraphicsPipelineCreateInfo pipelineInfo {};
+        VkGraphicsPipelineCreateInfo& pipelineInfo = pipelineDesc.createInfo;
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
         pipelineInfo.pVertexInputState = &vertexInputInfo;
         pipelineInfo.pInputAssemblyState = &inputAssembly;
         pipelineInfo.pViewportState = &viewportState;
@@ -494,126 +585,313 @@ int main()
         pipelineInfo.subpass = 0;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-        if (vkCreateGraphicsPipelines(logicDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+        // Background variants are queued first, the High priority pipeline still goes ahead of them
+        {
+            pipelineVariants.vertexInput = vertexInputInfo;
+            pipelineVariants.inputAssembly = inputAssembly;
+            pipelineVariants.viewportState = viewportState;
+            pipelineVariants.multisampling = multisampling;
+            pipelineVariants.dynamicStates = dynamicStates;
+            pipelineVariants.dynamicState = dynamicState;
+            pipelineVariants.dynamicState.pDynamicStates = pipelineVariants.dynamicStates.data();
+
+            pipelineVariants.rasterizers.resize(PipelineVariants::COUNT, rasterizer);
+            pipelineVariants.colorBlendAttachments.resize(PipelineVariants::COUNT, colorBlendAttachment);
+            pipelineVariants.colorBlendings.resize(PipelineVariants::COUNT, colorBlending);
+
+            std::vector<NWA::VulkanPipelineCompiler::GraphicsPipelineDesc> variantDescs(PipelineVariants::COUNT, pipelineDesc);
+
+            for (int i = 0; i < PipelineVariants::COUNT; i++)
+            {
+                VkPipelineRasterizationStateCreateInfo& variantRasterizer = pipelineVariants.rasterizers[i];
+                variantRasterizer.cullMode = static_cast<VkCullModeFlags>(i % 4);
+                variantRasterizer.frontFace = (i / 4) % 2 == 0 ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+                VkPipelineColorBlendAttachmentState& variantBlendAttachment = pipelineVariants.colorBlendAttachments[i];
+                variantBlendAttachment.colorWriteMask = static_cast<VkColorComponentFlags>((i / 8) % 16);
+                variantBlendAttachment.blendEnable = (i / 128) % 2 == 0 ? VK_FALSE : VK_TRUE;
+                variantBlendAttachment.srcColorBlendFactor = (i / 256) % 2 == 0 ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_SRC_ALPHA;
+                variantBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+                variantBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+                variantBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+                variantBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+                variantBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+                pipelineVariants.colorBlendings[i].pAttachments = &variantBlendAttachment;
+
+                VkGraphicsPipelineCreateInfo& variantInfo = variantDescs[i].createInfo;
+                variantInfo.pVertexInputState = &pipelineVariants.vertexInput;
+                variantInfo.pInputAssemblyState = &pipelineVariants.inputAssembly;
+                variantInfo.pViewportState = &pipelineVariants.viewportState;
+                variantInfo.pRasterizationState = &variantRasterizer;
+                variantInfo.pMultisampleState = &pipelineVariants.multisampling;
+                variantInfo.pColorBlendState = &pipelineVariants.colorBlendings[i];
+                variantInfo.pDynamicState = &pipelineVariants.dynamicState;
+            }
+
+            pipelineVariants.startTime = std::chrono::steady_clock::now();
+            pipelineVariants.futures = pPipelineCompiler->CompileGraphics(variantDescs, NWA::VulkanCompilePriority::Background);
+        }
+
+        const auto pipelineStart = std::chrono::steady_clock::now();
+
+        graphicsPipeline = pPipelineCompiler->CompileGraphics(pipelineDesc, NWA::VulkanCompilePriority::High).get();
+        if (graphicsPipeline == VK_NULL_HANDLE)
             throw std::runtime_error("failed to create graphics pipeline!");
 
-        ::vkDestroyShaderModule(logicDevice, fragShaderModule, nullptr);
-        ::vkDestroyShaderModule(logicDevice, vertShaderModule, nullptr);
+        const auto pipelineTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart);
+        std::cout << "Graphics pipeline created in " << pipelineTime.count() << " ms ("
+            << (pPipelineCache->IsLoadedFromDisk() ? "warm" : "cold") << " cache, " << pPipelineCache->GetLoadedSize() << " bytes loaded)" << std::endl;
     }
 
 #pragma endregion
 
 #pragma region [Frame buffer]
 
-    std::vector<VkFramebuffer> swapchainFramebuffers;
+    if (!swapchain.SetRenderPass(renderPass))
+        throw std::runtime_error("failed to create framebuffer!");
+
+#pragma endregion
 
-    swapchainFramebuffers.resize(swapchainImageViews.size());
+    // Press M to run the memory allocator benchmark
+    // Press U to run the upload benchmark
+    // Press G to print the GPU zones and write the trace, P to toggle the profiler
+    // Press H to print the driver's host allocations
+    // Press S to compare the surface queries of a recreation with and without the cache
+    // Press C to record 10k draws into secondary command buffers on 1 to 16 threads
+    // Press N to compare calls through the device table with the loader trampolines
+    // Press D to compare the per-frame descriptor allocator with freeing sets one by one
+    // Press T to stress the frame scheduler with cross-queue submissions and deferred deletions
+    // Press L to print the input and present latency
+    // Press V to flood the debug messenger from several threads
+    // Press B to print the memory budget of every heap and test the pressure events
+    // Press R to replay a resize storm, like dragging the window border for two seconds
+    // Press F to print the frame pacing and cycle the frame rate cap (uncapped, 60, 144)
+    // Press K to measure the frame pacer's wake up accuracy at several rates and spin thresholds
+    int resizeStormFrame = -1;
+    const int resizeStormLength = 120;
+
+    int headlessFrame = 0;
+    const auto headlessStart = std::chrono::steady_clock::now();
 
-    for (size_t i = 0; i < swapchainImageViews.size(); i++)
+    // Main loop
+    while (true)
     {
-        VkImageView attachments[] = { swapchainImageViews[i] };
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = renderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = swapchainExtent.width;
-        framebufferInfo.height = swapchainExtent.height;
-        framebufferInfo.layers = 1;
-
-        if (::vkCreateFramebuffer(logicDevice, &framebufferInfo, nullptr, &swapchainFramebuffers[i]) != VK_SUCCESS)
-            throw std::runtime_error("failed to create framebuffer!");
-    }
+        std::vector<NWA::WindowEvent> events;
+        if (pWindow != nullptr)
+        {
+            pWindow->EventLoop();
+            events = pWindow->PopAllEvent();
+        }
 
-#pragma endregion
+        bool shouldClose = false;
+        for (const auto& event : events)
+        {
+            if (event.type == NWA::WindowEvent::Type::Close)
+                shouldClose = true;
+
+            // The frame about to be rendered is the first one that can show the input
+            if (event.type == NWA::WindowEvent::Type::KeyPressed || event.type == NWA::WindowEvent::Type::MouseButtonPressed
+                || event.type == NWA::WindowEvent::Type::MouseMoved || event.type == NWA::WindowEvent::Type::MouseWheel)
+                swapchain.SetInputTime(event.timestamp);
 
-#pragma region [Command pool & buffer]
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::L)
+                PrintPresentLatency(swapchain);
 
-    VkCommandPool commandPool;
-    VkCommandBuffer commandBuffer;
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::F)
+            {
+                PrintFramePacer(framePacer);
 
-    VkCommandPoolCreateInfo poolInfo {};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    poolInfo.queueFamilyIndex = queueFamilyIndex;
+                const double targetFrameRate = framePacer.GetTargetFrameRate();
+                framePacer.SetTargetFrameRate(targetFrameRate == 0.0 ? 60.0 : targetFrameRate == 60.0 ? 144.0 : 0.0);
+                framePacer.ResetStatistics();
+            }
 
-    if (::vkCreateCommandPool(logicDevice, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
-        throw std::runtime_error("failed to create command pool!");
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::K)
+                RunFramePacerBenchmark();
 
-    VkCommandBufferAllocateInfo allocInfo {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::R && resizeStormFrame < 0)
+                resizeStormFrame = 0;
 
-    if (::vkAllocateCommandBuffers(logicDevice, &allocInfo, &commandBuffer) != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate command buffers!");
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::M)
+                RunMemoryAllocatorBenchmark(*pMemoryAllocator);
 
-#pragma endregion
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::U)
+            {
+                if (uploadBenchmarkBuffer == VK_NULL_HANDLE)
+                {
+                    VkBufferCreateInfo bufferCreateInfo {};
+                    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+                    bufferCreateInfo.size = VkDeviceSize(64) << 20;
+                    bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+                    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+                    if (auto allocation = pMemoryAllocator->CreateBuffer(bufferCreateInfo, NWA::VulkanMemoryAllocator::AllocationInfo(), uploadBenchmarkBuffer))
+                        uploadBenchmarkAllocation = *allocation;
+                }
 
-#pragma region [Sync objects]
+                if (uploadBenchmarkBuffer != VK_NULL_HANDLE)
+                    RunUploadBenchmark(*pUploader, uploadBenchmarkBuffer);
+            }
 
-    VkSemaphore imageAvailableSemaphore;
-    VkSemaphore renderFinishedSemaphore;
-    VkFence inFlightFence;
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::G)
+            {
+                for (const auto& zone : pGpuProfiler->GetZoneStats())
+                {
+                    std::cout << "gpu " << zone.name << ": " << zone.averageMs << " ms avg, " << zone.minMs << " min, "
+                        << zone.maxMs << " max over " << zone.sampleCount << " frames" << std::endl;
+                }
 
-    {
-        VkFenceCreateInfo fenceInfo {};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+                std::cout << "gpu profiler: " << pGpuProfiler->GetDroppedFrameCount() << " dropped frames, recording "
+                    << (recordCount > 0 ? recordCpuMs / recordCount : 0.0) << " ms cpu per frame" << std::endl;
 
-        VkSemaphoreCreateInfo semaphoreInfo {};
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+                pGpuProfiler->ExportTrace("TestWindowVulkan.gputrace.json");
+                recordCpuMs = 0;
+                recordCount = 0;
+            }
 
-        if (::vkCreateSemaphore(logicDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS)
-            throw std::runtime_error("failed to create semaphore!");
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::S)
+                RunSurfaceQueryBenchmark(instanceTable, physicalDevice, vkSurface);
 
-        if (::vkCreateSemaphore(logicDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS)
-            throw std::runtime_error("failed to create semaphore!");
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::C)
+                RunCommandRecordingBenchmark(deviceTable, static_cast<uint32_t>(queueFamilyIndex), renderPass, graphicsPipeline, swapchain.GetExtent());
 
-        if (::vkCreateFence(logicDevice, &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS)
-            throw std::runtime_error("failed to create fence!");
-    }
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::N)
+                RunDispatchBenchmark(deviceTable, static_cast<uint32_t>(queueFamilyIndex));
 
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::D)
+                RunDescriptorAllocatorBenchmark(deviceTable);
 
-#pragma endregion
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::T)
+                RunFrameSchedulerStressTest(deviceTable, deviceQueue, transferQueue);
 
-    // Main loop
-    while (true)
-    {
-        window.EventLoop();
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::V)
+                RunDebugMessengerFloodTest(instanceTable, *pDebugMessenger);
+
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::B)
+                RunMemoryMonitorTest(instanceTable, physicalDevice, *pMemoryAllocator, *pMemoryMonitor);
+
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::H)
+            {
+                static const char* SCOPE_NAMES[] = { "command", "object", "cache", "device", "instance" };
+
+                const auto hostStats = hostAllocator.GetStats();
+                for (std::size_t i = 0; i < NWA::VulkanHostAllocator::SCOPE_COUNT; i++)
+                {
+                    const auto& scope = hostStats.scopes[i];
+                    std::cout << "host " << SCOPE_NAMES[i] << ": " << scope.liveBytes << " bytes in " << scope.liveCount << " allocations, peak "
+                        << scope.peakBytes << ", " << scope.frameCount << " allocations last frame" << std::endl;
+                }
+
+                std::cout << "host command arena: peak " << hostStats.arenaPeakBytes << " of " << hostStats.arenaCapacity << " bytes, "
+                    << hostStats.arenaOverflowCount << " overflows" << std::endl;
+            }
+
+            if (event.type == NWA::WindowEvent::Type::KeyPressed && event.data.keyData.key == NWA::Keyboard::Key::P)
+            {
+                pGpuProfiler->SetEnabled(!pGpuProfiler->IsEnabled());
+                std::cout << "gpu profiler " << (pGpuProfiler->IsEnabled() ? "enabled" : "disabled") << std::endl;
+                recordCpuMs = 0;
+                recordCount = 0;
+            }
+        }
+
+        if (headless && headlessFrame++ == headlessFrameCount)
+        {
+            const auto time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - headlessStart);
+            std::cout << "headless: " << headlessFrameCount << " frames in " << time.count() << " ms, "
+                << time.count() / headlessFrameCount << " ms per frame, present mode " << swapchain.GetPresentMode() << std::endl;
+
+            for (const auto& zone : pGpuProfiler->GetZoneStats())
+                std::cout << "gpu " << zone.name << ": " << zone.averageMs << " ms avg" << std::endl;
+
+            RunSurfaceQueryBenchmark(instanceTable, physicalDevice, vkSurface);
+            RunCommandRecordingBenchmark(deviceTable, static_cast<uint32_t>(queueFamilyIndex), renderPass, graphicsPipeline, swapchain.GetExtent());
+            RunDispatchBenchmark(deviceTable, static_cast<uint32_t>(queueFamilyIndex));
+            RunDescriptorAllocatorBenchmark(deviceTable);
+            RunFrameSchedulerStressTest(deviceTable, deviceQueue, transferQueue);
+            PrintPresentLatency(swapchain);
+            PrintFramePacer(framePacer);
+            RunFramePacerBenchmark();
+            RunDebugMessengerFloodTest(instanceTable, *pDebugMessenger);
+            RunMemoryMonitorTest(instanceTable, physicalDevice, *pMemoryAllocator, *pMemoryMonitor);
+            RunPresenterBenchmark(instanceTable, deviceTable, physicalDevice, deviceQueue, static_cast<uint32_t>(queueFamilyIndex), swapchain.GetFormat(),
+                renderPass, graphicsPipeline, pHostCallbacks);
+
+            shouldClose = true;
+        }
 
-        if (std::ranges::any_of(window.PopAllEvent(), [](const NWA::WindowEvent& event) -> bool { return event.type == NWA::WindowEvent::Type::Close; }))
+        if (shouldClose)
             break;
 
-        ::vkWaitForFences(logicDevice, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-        ::vkResetFences(logicDevice, 1, &inFlightFence);
+        if (!pipelineVariants.futures.empty() && pPipelineCompiler->GetPendingCount() == 0)
+        {
+            for (auto& future : pipelineVariants.futures)
+                pipelineVariants.pipelines.push_back(future.get());
 
-        uint32_t imageIndex;
-        ::vkAcquireNextImageKHR(logicDevice, swapchain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+            pipelineVariants.futures.clear();
 
-        ::vkResetCommandBuffer(commandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
+            const auto variantTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineVariants.startTime);
+            std::cout << PipelineVariants::COUNT << " pipeline variants compiled in the background in " << variantTime.count()
+                << " ms on " << pPipelineCompiler->GetWorkerCount() << " workers" << std::endl;
+        }
 
-        // record command buffer
+        if (resizeStormFrame >= 0)
         {
-            VkCommandBufferBeginInfo beginInfo{};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            // One size step per frame, each one produces a Resize event
+            const int step = resizeStormFrame % 40;
+            const int offset = (step < 20 ? step : 40 - step) * 10;
+            pWindow->SetSize(windowWidth - offset, windowHeight - offset / 2);
+
+            if (++resizeStormFrame > resizeStormLength)
+            {
+                pWindow->SetSize(windowWidth, windowHeight);
+                resizeStormFrame = -1;
+
+                std::cout << "resize storm: " << swapchain.GetRecreateCount() << " recreations, "
+                    << swapchain.GetRetiredSwapchainCount() << " swapchains still retiring" << std::endl;
+            }
+        }
+
+        // Waits for the frame slot on every queue and runs the deletions it was holding back
+        if (!pFrameScheduler->BeginFrame())
+            throw std::runtime_error("failed to wait for frame!");
+
+        pMemoryMonitor->Update();
+
+        // Uploads recorded since the last frame go to the transfer queue
+        if (!pUploader->Flush())
+            throw std::runtime_error("failed to submit uploads!");
 
-            if (::vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
-                throw std::runtime_error("failed to begin recording command buffer!");
+        // Only waits when the GPU is two frames behind, recreation never idles the device
+        auto frame = swapchain.BeginFrame();
+        if (!frame)
+            continue;
+
+        VkCommandBuffer commandBuffer = frame->commandBuffer;
+        const auto recordStart = std::chrono::steady_clock::now();
+
+        pGpuProfiler->BeginFrame(commandBuffer);
+
+        if (auto uploadWait = pUploader->AcquireUploads(commandBuffer))
+            swapchain.AddWaitSemaphore(uploadWait->semaphore, uploadWait->value, uploadWait->stageMask);
+
+        // record command buffer
+        {
+            NWA::VulkanGpuProfiler::ScopeZone frameZone(*pGpuProfiler, "frame");
 
             VkRenderPassBeginInfo renderPassInfo{};
             renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
             renderPassInfo.renderPass = renderPass;
-            renderPassInfo.framebuffer = swapchainFramebuffers[imageIndex];
+            renderPassInfo.framebuffer = frame->framebuffer;
             renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = swapchainExtent;
+            renderPassInfo.renderArea.extent = frame->extent;
 
             VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
             renderPassInfo.clearValueCount = 1;
             renderPassInfo.pClearValues = &clearColor;
 
+            pGpuProfiler->BeginZone("triangle pass");
             ::vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
             ::vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
@@ -621,106 +899,810 @@ int main()
             VkViewport viewport{};
             viewport.x = 0.0f;
             viewport.y = 0.0f;
-            viewport.width = static_cast<float>(swapchainExtent.width);
-            viewport.height = static_cast<float>(swapchainExtent.height);
+            viewport.width = static_cast<float>(frame->extent.width);
+            viewport.height = static_cast<float>(frame->extent.height);
             viewport.minDepth = 0.0f;
             viewport.maxDepth = 1.0f;
             ::vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
             VkRect2D scissor{};
             scissor.offset = {0, 0};
-            scissor.extent = swapchainExtent;
+            scissor.extent = frame->extent;
             ::vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
             ::vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 
             ::vkCmdEndRenderPass(commandBuffer);
-
-            if (::vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
-                throw std::runtime_error("failed to record command buffer!");
+            pGpuProfiler->EndZone();
         }
 
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        pGpuProfiler->EndFrame();
 
-        VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
+        const auto framePoint = pFrameScheduler->Signal(0);
+        swapchain.AddSignalSemaphore(pFrameScheduler->GetSemaphore(0), framePoint.value);
 
-        VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
-
-        if (::vkQueueSubmit(deviceQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS)
+        if (!swapchain.EndFrame())
+        {
+            // The swapchain signals the point even then, unless the device refused every submission
+            pFrameScheduler->CancelSignal(framePoint);
             throw std::runtime_error("failed to submit draw command buffer!");
+        }
 
-        VkPresentInfoKHR presentInfo{};
-        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-        presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        pFrameScheduler->EndFrame();
 
-        VkSwapchainKHR swapChains[] = { swapchain };
-        presentInfo.swapchainCount = 1;
-        presentInfo.pSwapchains = swapChains;
-        presentInfo.pImageIndices = &imageIndex;
+        recordCpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+        recordCount++;
 
-        ::vkQueuePresentKHR(deviceQueue, &presentInfo);
+        hostAllocator.EndFrame();
     }
 
     ::vkDeviceWaitIdle(logicDevice);
 
     // Clean up
 
-    ::vkDestroySemaphore(logicDevice, imageAvailableSemaphore, nullptr);
-    ::vkDestroySemaphore(logicDevice, renderFinishedSemaphore, nullptr);
-    ::vkDestroyFence(logicDevice, inFlightFence, nullptr);
+    // Queued variants are cancelled, their futures hold null handles
+    pPipelineCompiler.reset();
 
-    ::vkDestroyCommandPool(logicDevice, commandPool, nullptr);
+    for (auto& future : pipelineVariants.futures)
+        pipelineVariants.pipelines.push_back(future.get());
 
-    for (auto framebuffer : swapchainFramebuffers)
-        ::vkDestroyFramebuffer(logicDevice, framebuffer, nullptr);
+    for (VkPipeline pipeline : pipelineVariants.pipelines)
+    {
+        if (pipeline != VK_NULL_HANDLE)
+            ::vkDestroyPipeline(logicDevice, pipeline, nullptr);
+    }
 
     ::vkDestroyPipeline(logicDevice, graphicsPipeline, nullptr);
     ::vkDestroyPipelineLayout(logicDevice, pipelineLayout, nullptr);
     ::vkDestroyRenderPass(logicDevice, renderPass, nullptr);
 
-    for (auto imageView : swapchainImageViews)
-        ::vkDestroyImageView(logicDevice, imageView, nullptr);
+    pSwapchain.reset();
+    pPipelineCache.reset();
+    pGpuProfiler.reset();
+    pUploader.reset();
+    pFrameScheduler.reset();
+
+    if (uploadBenchmarkBuffer != VK_NULL_HANDLE)
+        pMemoryAllocator->DestroyBuffer(uploadBenchmarkBuffer, uploadBenchmarkAllocation);
 
-    ::vkDestroySwapchainKHR(logicDevice, swapchain, nullptr);
+    pMemoryMonitor.reset();
+    pMemoryAllocator.reset();
 
-    ::vkDestroyDevice(logicDevice, nullptr);
+    ::vkDestroyDevice(logicDevice, pHostCallbacks);
 
-    DestroyDebugUtilsMessengerEXT(vkInstance, vkDebugUtilExtHandle, nullptr);
+    pDebugMessenger.reset();
 
-    ::vkDestroyInstance(vkInstance, nullptr);
+    ::vkDestroyInstance(vkInstance, pHostCallbacks);
 
     return 0;
 
 }
 
-VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData)
+void RunMemoryAllocatorBenchmark(NWA::VulkanMemoryAllocator& allocator)
 {
-    std::cout << "validation layer: " << pCallbackData->pMessage << std::endl;
-    return VK_FALSE;
+    // Random mix of small and large requests, slightly more allocations than frees
+    const int operationCount = 100000;
+    std::mt19937 random(42);
+    std::vector<NWA::VulkanAllocation> allocations;
+
+    NWA::VulkanMemoryAllocator::AllocationInfo allocationInfo;
+    allocationInfo.usage = NWA::VulkanMemoryUsage::GpuOnly;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < operationCount; i++)
+    {
+        if (allocations.empty() || random() % 100 < 55)
+        {
+            VkMemoryRequirements requirements {};
+            requirements.size = 256 + random() % (random() % 16 == 0 ? (1 << 20) : (64 << 10));
+            requirements.alignment = VkDeviceSize(256) << (random() % 4);
+            requirements.memoryTypeBits = ~0u;
+
+            allocationInfo.linear = random() % 2 == 0;
+
+            if (auto allocation = allocator.Allocate(requirements, allocationInfo))
+                allocations.push_back(*allocation);
+        }
+        else
+        {
+            const std::size_t index = random() % allocations.size();
+            allocator.Free(allocations[index]);
+            allocations[index] = allocations.back();
+            allocations.pop_back();
+        }
+    }
+
+    const auto time = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+    const auto stats = allocator.GetStats();
+
+    std::cout << "memory allocator: " << time.count() * 1000.0 / operationCount << " ns per operation, "
+        << stats.allocationCount << " allocations in " << stats.blockCount << " blocks, "
+        << stats.deviceAllocationCount << " device allocations, fragmentation " << stats.fragmentation << std::endl;
+
+    // Nothing is bound to the allocations, moves only update the list
+    for (std::size_t i = 0; i < allocations.size(); i += 2)
+    {
+        allocator.Free(allocations[i]);
+        allocations[i] = {};
+    }
+
+    const VkDeviceSize movedBytes = allocator.Defragment([&allocations](const NWA::VulkanAllocation& from, const NWA::VulkanAllocation& to) -> bool
+    {
+        for (auto& allocation : allocations)
+        {
+            if (allocation.memory == from.memory && allocation.offset == from.offset)
+            {
+                allocation = to;
+                return true;
+            }
+        }
+
+        return false;
+    });
+
+    const auto defragmentedStats = allocator.GetStats();
+    std::cout << "memory allocator: defragmentation moved " << movedBytes << " bytes, "
+        << defragmentedStats.blockCount << " blocks left, fragmentation " << defragmentedStats.fragmentation << std::endl;
+
+    for (const auto& allocation : allocations)
+        allocator.Free(allocation);
 }
 
-VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger)
+void RunUploadBenchmark(NWA::VulkanUploader& uploader, VkBuffer buffer)
 {
-    auto func = (PFN_vkCreateDebugUtilsMessengerEXT)::vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
-    if (func != nullptr)
-        return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
+    // 1 MiB uploads cycling through the 64 MiB buffer, the staging ring is reused four times
+    const VkDeviceSize chunkSize = VkDeviceSize(1) << 20;
+    const int chunkCount = 256;
+    std::vector<uint8_t> data(static_cast<std::size_t>(chunkSize), 0x5a);
+
+    const uint64_t stallCount = uploader.GetStallCount();
+    const auto start = std::chrono::steady_clock::now();
 
-    return VK_ERROR_EXTENSION_NOT_PRESENT;
+    uint64_t lastValue = 0;
+    for (int i = 0; i < chunkCount; i++)
+    {
+        const VkDeviceSize offset = (i % 64) * chunkSize;
+        if (auto value = uploader.UploadBuffer(buffer, offset, data.data(), chunkSize))
+            lastValue = *value;
+    }
+
+    if (lastValue == 0 || !uploader.Wait(lastValue))
+    {
+        std::cout << "upload benchmark failed" << std::endl;
+        return;
+    }
+
+    const auto time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    const double gigabytes = static_cast<double>(chunkSize * chunkCount) / (1024.0 * 1024.0 * 1024.0);
+
+    std::cout << "upload: " << chunkCount << " MiB in " << time.count() * 1000.0 << " ms, " << gigabytes / time.count() << " GiB/s, "
+        << uploader.GetStallCount() - stallCount << " staging stalls"
+        << (uploader.UsesOwnershipTransfer() ? ", dedicated transfer queue" : ", graphics queue") << std::endl;
+}
+
+void RunSurfaceQueryBenchmark(const NWA::VulkanInstanceTable& instanceTable, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
+{
+    const int recreateCount = 1000;
+
+    // Uncached: every recreation enumerates formats and present modes into new vectors
+    const auto uncachedStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < recreateCount; i++)
+    {
+        NWA::VulkanSurfaceCache surfaceCache(instanceTable, physicalDevice, surface);
+        if (!surfaceCache.IsValid())
+            return;
+    }
+
+    const auto uncachedTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - uncachedStart);
+
+    // Cached: capabilities only
+    NWA::VulkanSurfaceCache surfaceCache(instanceTable, physicalDevice, surface);
+
+    const auto cachedStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < recreateCount; i++)
+        surfaceCache.RefreshCapabilities();
+
+    const auto cachedTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - cachedStart);
+
+    std::cout << "surface queries per recreation: " << uncachedTime.count() / recreateCount << " us uncached, "
+        << cachedTime.count() / recreateCount << " us cached" << std::endl;
+}
+
+void RunCommandRecordingBenchmark(const NWA::VulkanDeviceTable& deviceTable, uint32_t queueFamilyIndex, VkRenderPass renderPass, VkPipeline pipeline, VkExtent2D extent)
+{
+    const uint32_t drawCount = 10000;
+    const uint32_t maxThreadCount = 16;
+    const int frameCount = 20;
+
+    NWA::VulkanCommandContext::CreateInfo contextCreateInfo;
+    contextCreateInfo.queueFamilyIndex = queueFamilyIndex;
+    contextCreateInfo.framesInFlight = 1;
+    contextCreateInfo.threadCount = maxThreadCount;
+
+    NWA::VulkanCommandContext context(deviceTable, contextCreateInfo);
+    if (!context.IsValid())
+        return;
+
+    // Nothing is submitted, the pools are reset right after recording
+    for (uint32_t threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            context.BeginFrame(0);
+
+            std::vector<std::thread> threads;
+            for (uint32_t threadIndex = 0; threadIndex < threadCount; threadIndex++)
+            {
+                threads.emplace_back([&, threadIndex]()
+                {
+                    VkCommandBuffer commandBuffer = context.BeginSecondary(threadIndex, renderPass, 0, VK_NULL_HANDLE);
+                    if (commandBuffer == VK_NULL_HANDLE)
+                        return;
+
+                    ::vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+                    VkViewport viewport{};
+                    viewport.width = static_cast<float>(extent.width);
+                    viewport.height = static_cast<float>(extent.height);
+                    viewport.maxDepth = 1.0f;
+                    ::vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+                    VkRect2D scissor{};
+                    scissor.extent = extent;
+                    ::vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+                    const uint32_t first = drawCount * threadIndex / threadCount;
+                    const uint32_t last = drawCount * (threadIndex + 1) / threadCount;
+                    for (uint32_t draw = first; draw < last; draw++)
+                        ::vkCmdDraw(commandBuffer, 3, 1, 0, draw);
+
+                    ::vkEndCommandBuffer(commandBuffer);
+                });
+            }
+
+            for (auto& thread : threads)
+                thread.join();
+        }
+
+        const auto time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+        std::cout << "command recording: " << drawCount << " draws on " << threadCount << " threads in "
+            << time.count() / frameCount << " ms per frame" << std::endl;
+    }
+
+    std::cout << "command recording: " << context.GetAllocatedCount() << " command buffers allocated" << std::endl;
+}
+
+void RunDispatchBenchmark(const NWA::VulkanDeviceTable& deviceTable, uint32_t queueFamilyIndex)
+{
+    const int callCount = 1000000;
+
+    // Throwaway command buffer, recorded into and never submitted
+    VkCommandPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    if (deviceTable.vkCreateCommandPool(deviceTable.device, &poolCreateInfo, nullptr, &commandPool) != VK_SUCCESS)
+        return;
+
+    VkCommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (deviceTable.vkAllocateCommandBuffers(deviceTable.device, &allocateInfo, &commandBuffer) != VK_SUCCESS
+        || deviceTable.vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        deviceTable.vkDestroyCommandPool(deviceTable.device, commandPool, nullptr);
+        return;
+    }
+
+    VkViewport viewport{};
+    viewport.width = 800.0f;
+    viewport.height = 800.0f;
+    viewport.maxDepth = 1.0f;
+
+    const auto measure = [&](const char* name, auto&& call)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < callCount; i++)
+            call();
+
+        const auto time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+        std::cout << "dispatch: " << name << " " << time.count() / callCount << " ns per call" << std::endl;
+    };
+
+    // The trampolines look the device's dispatch table up on every call, the table calls the driver directly
+    measure("vkCmdSetViewport table", [&]() { deviceTable.vkCmdSetViewport(commandBuffer, 0, 1, &viewport); });
+    measure("vkCmdSetViewport trampoline", [&]() { ::vkCmdSetViewport(commandBuffer, 0, 1, &viewport); });
+
+    VkQueue queue = VK_NULL_HANDLE;
+    measure("vkGetDeviceQueue table", [&]() { deviceTable.vkGetDeviceQueue(deviceTable.device, queueFamilyIndex, 0, &queue); });
+    measure("vkGetDeviceQueue trampoline", [&]() { ::vkGetDeviceQueue(deviceTable.device, queueFamilyIndex, 0, &queue); });
+
+    deviceTable.vkEndCommandBuffer(commandBuffer);
+    deviceTable.vkDestroyCommandPool(deviceTable.device, commandPool, nullptr);
+}
+
+void RunDescriptorAllocatorBenchmark(const NWA::VulkanDeviceTable& deviceTable)
+{
+    const int frameCount = 100;
+    const int setsPerFrame = 2000;
+    const uint32_t framesInFlight = 2;
+
+    NWA::VulkanDescriptorAllocator::CreateInfo allocatorCreateInfo;
+    allocatorCreateInfo.framesInFlight = framesInFlight;
+
+    NWA::VulkanDescriptorAllocator allocator(deviceTable, allocatorCreateInfo);
+    if (!allocator.IsValid())
+        return;
+
+    // A uniform buffer and two textures, the usual material set
+    std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = 2;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // Every draw asks for its layout, only the first lookup creates it
+    const auto layoutStart = std::chrono::steady_clock::now();
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    for (int i = 0; i < setsPerFrame; i++)
+        layout = allocator.GetLayout(bindings);
+
+    const auto layoutTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - layoutStart);
+    if (layout == VK_NULL_HANDLE)
+        return;
+
+    // Nothing is submitted, so a frame slot can be reset right away
+    const auto allocatorStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        allocator.BeginFrame(frame % framesInFlight);
+
+        for (int i = 0; i < setsPerFrame; i++)
+        {
+            if (allocator.Allocate(layout) == VK_NULL_HANDLE)
+                return;
+        }
+    }
+
+    const auto allocatorTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - allocatorStart);
+
+    // Baseline: one pool sized for the worst case, sets freed one by one
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, setsPerFrame * framesInFlight },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setsPerFrame * framesInFlight * 2 },
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = setsPerFrame * framesInFlight;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (::vkCreateDescriptorPool(deviceTable.device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        return;
+
+    std::vector<std::vector<VkDescriptorSet>> frameSets(framesInFlight, std::vector<VkDescriptorSet>(setsPerFrame, VK_NULL_HANDLE));
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    const auto baselineStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        auto& sets = frameSets[frame % framesInFlight];
+        for (VkDescriptorSet& set : sets)
+        {
+            if (set != VK_NULL_HANDLE)
+                ::vkFreeDescriptorSets(deviceTable.device, pool, 1, &set);
+
+            ::vkAllocateDescriptorSets(deviceTable.device, &allocInfo, &set);
+        }
+    }
+
+    const auto baselineTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - baselineStart);
+
+    ::vkDestroyDescriptorPool(deviceTable.device, pool, nullptr);
+
+    std::cout << "descriptors: " << setsPerFrame << " sets per frame in " << allocatorTime.count() / frameCount << " ms with per-frame pools, "
+        << baselineTime.count() / frameCount << " ms freeing one by one" << std::endl;
+    std::cout << "descriptors: " << allocator.GetPoolCount() << " pools, " << allocator.GetFullPoolCount() << " times grown, "
+        << layoutTime.count() / setsPerFrame << " us per layout lookup, " << allocator.GetLayoutCacheHitCount() << " cache hits" << std::endl;
+}
+
+void RunFrameSchedulerStressTest(const NWA::VulkanDeviceTable& deviceTable, VkQueue graphicsQueue, VkQueue transferQueue)
+{
+    const int frameCount = 500;
+    const int submitsPerFrame = 20;
+
+    NWA::VulkanFrameScheduler::CreateInfo schedulerCreateInfo;
+    schedulerCreateInfo.queues = { graphicsQueue, transferQueue };
+    schedulerCreateInfo.framesInFlight = 2;
+
+    int deferredCount = 0;
+    int deletedCount = 0;
+    int outOfOrderCount = 0;
+    uint64_t waitCount = 0;
+    uint64_t submitCount = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    {
+        NWA::VulkanFrameScheduler scheduler(deviceTable, schedulerCreateInfo);
+        if (!scheduler.IsValid())
+            return;
+
+        std::mt19937 random(7);
+        std::vector<NWA::VulkanFrameScheduler::SyncPoint> points;
+
+        // Empty submissions: only the semaphore waits and signals are exercised
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            if (!scheduler.BeginFrame())
+                return;
+
+            NWA::VulkanFrameScheduler::SyncPoint last[2] = {};
+            for (int i = 0; i < submitsPerFrame; i++)
+            {
+                // Alternate queues, each submission waits on the other queue's latest one
+                const uint32_t queueIndex = i % 2;
+                const NWA::VulkanFrameScheduler::Wait wait = { last[1 - queueIndex], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+
+                auto point = scheduler.Submit(queueIndex, {}, last[1 - queueIndex].value != 0 ? std::span(&wait, 1) : std::span<const NWA::VulkanFrameScheduler::Wait>());
+                if (!point)
+                    return;
+
+                last[queueIndex] = *point;
+                points.push_back(*point);
+
+                // A deletion keyed on a single point must never run before the point is reached
+                if (random() % 4 == 0)
+                {
+                    deferredCount++;
+                    scheduler.Defer(*point, [&, point = *point]()
+                    {
+                        if (!scheduler.IsComplete(point))
+                            outOfOrderCount++;
+
+                        deletedCount++;
+                    });
+                }
+            }
+
+            deferredCount++;
+            scheduler.Defer([&]() { deletedCount++; });
+
+            // Now and then the CPU needs a result from an earlier submission
+            if (random() % 8 == 0)
+            {
+                scheduler.WaitFor(points[random() % points.size()]);
+                waitCount++;
+            }
+
+            scheduler.EndFrame();
+        }
+
+        scheduler.WaitIdle();
+        scheduler.Collect();
+
+        submitCount = scheduler.GetSubmitCount();
+        if (scheduler.GetPendingDeletionCount() != 0)
+            outOfOrderCount++;
+    }
+
+    const auto time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    std::cout << "frame scheduler: " << submitCount << " submissions, " << waitCount << " cpu waits in " << time.count() << " ms, "
+        << deletedCount << "/" << deferredCount << " deletions, " << outOfOrderCount << " errors" << std::endl;
 }
 
-void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator)
+void PrintPresentLatency(NWA::VulkanSwapchain& swapchain)
 {
-    auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)::vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
-    if (func != nullptr)
-        func(instance, debugMessenger, pAllocator);
-}
\ No newline at end of file
+    const auto stats = swapchain.GetLatencyStatistics();
+    std::cout << "present: " << stats.presentCount << " presents, acquire to present " << stats.averageAcquireToPresentMs << " ms avg" << std::endl;
+
+    if (!swapchain.IsPresentWaitEnabled())
+    {
+        std::cout << "present: VK_KHR_present_wait unavailable, display times unknown" << std::endl;
+        return;
+    }
+
+    std::cout << "present: " << stats.displayedCount << " displayed, present to display " << stats.averagePresentToDisplayMs << " ms avg, "
+        << stats.maxPresentToDisplayMs << " ms max" << std::endl;
+
+    if (stats.inputCount > 0)
+    {
+        std::cout << "present: input to display " << stats.averageInputToDisplayMs << " ms avg, " << stats.maxInputToDisplayMs
+            << " ms max over " << stats.inputCount << " frames" << std::endl;
+    }
+}
+
+void PrintFramePacer(const NWA::FramePacer& framePacer)
+{
+    const auto stats = framePacer.GetStatistics();
+    std::cout << "frame pacer: " << stats.frameCount << " frames, target " << stats.targetMs << " ms, " << stats.averageMs << " ms avg, "
+        << stats.minMs << " min, " << stats.maxMs << " max, jitter " << stats.jitterMs << " ms, " << stats.missedDeadlines << " missed" << std::endl;
+}
+
+void RunFramePacerBenchmark()
+{
+    // Half a second per configuration with nothing else in the loop, only the wake up is measured
+    const double frameRates[] = { 60.0, 144.0, 240.0 };
+    const std::chrono::microseconds spinThresholds[] = { std::chrono::microseconds(0), std::chrono::microseconds(500), std::chrono::microseconds(1500) };
+
+    for (double frameRate : frameRates)
+    {
+        for (auto spinThreshold : spinThresholds)
+        {
+            NWA::FramePacer pacer(frameRate, spinThreshold);
+
+            // The first wait only starts the timeline
+            const int frameCount = static_cast<int>(frameRate / 2);
+            for (int frame = 0; frame <= frameCount; frame++)
+                pacer.Wait();
+
+            const auto stats = pacer.GetStatistics();
+            std::cout << "frame pacer " << frameRate << " Hz, spin " << spinThreshold.count() << " us: wake error " << stats.averageWakeErrorUs
+                << " us avg, " << stats.maxWakeErrorUs << " us max, jitter " << stats.jitterMs << " ms, " << stats.missedDeadlines
+                << " missed over " << stats.frameCount << " frames" << std::endl;
+        }
+    }
+}
+
+void RunDebugMessengerFloodTest(const NWA::VulkanInstanceTable& instanceTable, NWA::VulkanDebugMessenger& messenger)
+{
+    const int threadCount = 4;
+    const int messagesPerThread = 25000;
+    const int idCount = 8;
+
+    if (instanceTable.vkSubmitDebugUtilsMessageEXT == nullptr)
+        return;
+
+    const auto before = messenger.GetStatistics();
+
+    // Injected through the loader, they take the same path as validation layer messages
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int threadIndex = 0; threadIndex < threadCount; threadIndex++)
+    {
+        threads.emplace_back([&instanceTable, threadIndex]()
+        {
+            const char* idNames[idCount] = { "Flood-0", "Flood-1", "Flood-2", "Flood-3", "Flood-4", "Flood-5", "Flood-6", "Flood-7" };
+
+            for (int i = 0; i < messagesPerThread; i++)
+            {
+                const int id = (i + threadIndex) % idCount;
+
+                VkDebugUtilsMessengerCallbackDataEXT callbackData{};
+                callbackData.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CALLBACK_DATA_EXT;
+                callbackData.pMessageIdName = idNames[id];
+                callbackData.messageIdNumber = 0x7e570000 + id;
+                callbackData.pMessage = "Debug messenger flood test message, repeated with the same id";
+
+                instanceTable.vkSubmitDebugUtilsMessageEXT(instanceTable.instance, VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT,
+                    VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, &callbackData);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    const auto time = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+    messenger.Flush();
+
+    const auto after = messenger.GetStatistics();
+    const int messageCount = threadCount * messagesPerThread;
+
+    std::cout << "debug messenger: " << messageCount << " messages on " << threadCount << " threads, " << time.count() / messageCount
+        << " us per message, " << after.queuedCount - before.queuedCount << " printed, " << after.suppressedCount - before.suppressedCount
+        << " suppressed, " << after.droppedCount - before.droppedCount << " dropped" << std::endl;
+}
+
+void RunMemoryMonitorTest(const NWA::VulkanInstanceTable& instanceTable, VkPhysicalDevice physicalDevice, NWA::VulkanMemoryAllocator& allocator, NWA::VulkanMemoryMonitor& monitor)
+{
+    static const char* PRESSURE_NAMES[] = { "normal", "warning", "critical" };
+
+    const int updateCount = 1000;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < updateCount; i++)
+        monitor.Update();
+
+    const auto time = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+    std::cout << "memory monitor: " << (monitor.IsBudgetSupported() ? "VK_EXT_memory_budget" : "allocator tracking") << ", "
+        << time.count() / updateCount << " us per update" << std::endl;
+
+    const auto heaps = monitor.GetHeaps();
+    for (size_t i = 0; i < heaps.size(); i++)
+    {
+        const auto& heap = heaps[i];
+        std::cout << "memory heap " << i << ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0 ? " (device local): " : ": ") << (heap.usage >> 20)
+            << " of " << (heap.budget >> 20) << " MiB budget, " << heap.ratio * 100.0f << "%, " << (heap.size >> 20) << " MiB heap, "
+            << PRESSURE_NAMES[static_cast<int>(heap.pressure)] << std::endl;
+    }
+
+    // A second monitor with its warning threshold halfway through one allocation on the heap
+    // GpuOnly memory comes from: allocating it must raise the heap to warning, freeing it lower it back
+    const VkDeviceSize testSize = VkDeviceSize(64) << 20;
+    const auto memoryTypeIndex = allocator.FindMemoryType(~0u, NWA::VulkanMemoryUsage::GpuOnly);
+    if (!memoryTypeIndex)
+        return;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties {};
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    const uint32_t heapIndex = memoryProperties.memoryTypes[*memoryTypeIndex].heapIndex;
+
+    const auto& heap = heaps[heapIndex];
+    const float step = static_cast<float>(static_cast<double>(testSize) / static_cast<double>(heap.budget));
+
+    NWA::VulkanMemoryMonitor::CreateInfo createInfo;
+    createInfo.physicalDevice = physicalDevice;
+    createInfo.memoryBudget = monitor.IsBudgetSupported();
+    createInfo.pAllocator = &allocator;
+    createInfo.warningRatio = heap.ratio + step * 0.5f;
+    createInfo.criticalRatio = heap.ratio + step * 4.0f;
+    createInfo.hysteresis = step * 0.25f;
+
+    NWA::VulkanMemoryMonitor testMonitor(instanceTable, createInfo);
+    if (!testMonitor.IsValid())
+        return;
+
+    std::vector<NWA::VulkanMemoryMonitor::PressureEvent> events;
+    testMonitor.AddPressureCallback([&events, heapIndex](const NWA::VulkanMemoryMonitor::PressureEvent& event)
+    {
+        if (event.heapIndex == heapIndex)
+            events.push_back(event);
+    });
+
+    VkMemoryRequirements requirements {};
+    requirements.size = testSize;
+    requirements.alignment = 256;
+    requirements.memoryTypeBits = 1u << *memoryTypeIndex;
+
+    NWA::VulkanMemoryAllocator::AllocationInfo allocationInfo;
+    allocationInfo.dedicated = true;
+
+    auto allocation = allocator.Allocate(requirements, allocationInfo);
+    if (!allocation)
+        return;
+
+    testMonitor.Update();
+    allocator.Free(*allocation);
+    testMonitor.Update();
+
+    const bool passed = events.size() == 2 && events[0].heap.pressure == NWA::VulkanMemoryPressure::Warning
+        && events[1].heap.pressure == NWA::VulkanMemoryPressure::Normal;
+
+    std::cout << "memory monitor: heap " << heapIndex << ", " << events.size() << " pressure events for a " << (testSize >> 20)
+        << " MiB allocation, " << (passed ? "passed" : "FAILED") << std::endl;
+}
+
+void RunPresenterBenchmark(const NWA::VulkanInstanceTable& instanceTable, const NWA::VulkanDeviceTable& deviceTable, VkPhysicalDevice physicalDevice, VkQueue queue,
+    uint32_t queueFamilyIndex, VkSurfaceFormatKHR format, VkRenderPass renderPass, VkPipeline pipeline, const VkAllocationCallbacks* pHostCallbacks)
+{
+    const uint32_t maxViewCount = 16;
+    const uint32_t viewSize = 256;
+    const int frameCount = 200;
+
+    // Headless surfaces stand in for editor viewports, the main swapchain keeps its own
+    std::vector<VkSurfaceKHR> surfaces(maxViewCount, VK_NULL_HANDLE);
+    for (auto& surface : surfaces)
+    {
+        if (!NWA::Vulkan::CreateHeadlessSurface(instanceTable.instance, surface, pHostCallbacks))
+            surface = VK_NULL_HANDLE;
+    }
+
+    const uint32_t threadCount = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+
+    for (uint32_t viewCount = 1; viewCount <= maxViewCount; viewCount *= 2)
+    {
+        NWA::VulkanPresenter::CreateInfo presenterCreateInfo;
+        presenterCreateInfo.physicalDevice = physicalDevice;
+        presenterCreateInfo.queue = queue;
+        presenterCreateInfo.queueFamilyIndex = queueFamilyIndex;
+        presenterCreateInfo.framesInFlight = 2;
+        presenterCreateInfo.threadCount = threadCount;
+        presenterCreateInfo.presentMode = NWA::VulkanPresentMode::Mailbox;
+        presenterCreateInfo.preferredFormat = format;
+
+        NWA::VulkanPresenter presenter(instanceTable, deviceTable, presenterCreateInfo);
+        if (!presenter.IsValid())
+            break;
+
+        bool viewsAdded = true;
+        for (uint32_t i = 0; i < viewCount; i++)
+        {
+            auto viewId = surfaces[i] != VK_NULL_HANDLE ? presenter.AddView(surfaces[i], viewSize, viewSize) : std::nullopt;
+            if (!viewId || presenter.GetViewFormat(*viewId).format != format.format)
+                viewsAdded = false;
+        }
+
+        if (!viewsAdded || !presenter.SetRenderPass(renderPass))
+        {
+            std::cout << "presenter: cannot present to " << viewCount << " headless surfaces" << std::endl;
+            break;
+        }
+
+        const auto record = [&](const NWA::VulkanPresenter::ViewFrame& view, uint32_t)
+        {
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = renderPass;
+            renderPassInfo.framebuffer = view.framebuffer;
+            renderPassInfo.renderArea.extent = view.extent;
+
+            VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearColor;
+
+            ::vkCmdBeginRenderPass(view.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            ::vkCmdBindPipeline(view.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+            VkViewport viewport{};
+            viewport.width = static_cast<float>(view.extent.width);
+            viewport.height = static_cast<float>(view.extent.height);
+            viewport.maxDepth = 1.0f;
+            ::vkCmdSetViewport(view.commandBuffer, 0, 1, &viewport);
+
+            VkRect2D scissor{};
+            scissor.extent = view.extent;
+            ::vkCmdSetScissor(view.commandBuffer, 0, 1, &scissor);
+
+            ::vkCmdDraw(view.commandBuffer, 3, 1, 0, 0);
+            ::vkCmdEndRenderPass(view.commandBuffer);
+        };
+
+        // The first frames create the swapchain images, keep them out of the timing
+        int presentedFrames = 0;
+        uint64_t presentedViews = 0;
+        std::chrono::steady_clock::time_point start;
+
+        for (int frame = -2; frame < frameCount; frame++)
+        {
+            if (frame == 0)
+                start = std::chrono::steady_clock::now();
+
+            const uint32_t frameViewCount = presenter.BeginFrame();
+            if (!presenter.Record(record) || !presenter.EndFrame())
+                break;
+
+            if (frame >= 0 && frameViewCount > 0)
+            {
+                presentedFrames++;
+                presentedViews += frameViewCount;
+            }
+        }
+
+        presenter.WaitIdle();
+
+        const auto time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+        std::cout << "presenter: " << viewCount << " views on " << presenter.GetThreadCount() << " threads, " << time.count() / frameCount
+            << " ms per frame, " << time.count() / std::max<uint64_t>(presentedViews, 1) << " ms per view, " << presentedFrames << "/" << frameCount
+            << " frames presented" << std::endl;
+    }
+
+    for (VkSurfaceKHR surface : surfaces)
+    {
+        if (surface != VK_NULL_HANDLE)
+            instanceTable.vkDestroySurfaceKHR(instanceTable.instance, surface, pHostCallbacks);
+    }
+}
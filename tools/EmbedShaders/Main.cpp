@@ -0,0 +1,318 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Build step of nwa_embed_shaders (cmake/NwaEmbedShaders.cmake). Reads SPIR-V modules,
+// optionally strips their debug instructions and LZ compresses them, and writes a header with
+// one aligned array per module and a constexpr index of NWA::VulkanShaderBlob.
+//
+// EmbedShaders --output <header> --namespace <name> [--strip] [--compress] <name>=<spv> ...
+
+struct Shader
+{
+    std::string name;
+    std::string path;
+    std::vector<uint8_t> data;
+    uint32_t codeSize = 0;
+    uint32_t originalSize = 0;
+    std::string stages;
+    bool compressed = false;
+};
+
+static constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+static constexpr uint32_t SPIRV_HEADER_WORDS = 5;
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>& data)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static std::vector<uint32_t> ToWords(const std::vector<uint8_t>& bytes)
+{
+    std::vector<uint32_t> words(bytes.size() / 4);
+    std::memcpy(words.data(), bytes.data(), words.size() * 4);
+    return words;
+}
+
+static const char* StageName(uint32_t executionModel)
+{
+    switch (executionModel)
+    {
+        case 0: return "VK_SHADER_STAGE_VERTEX_BIT";
+        case 1: return "VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT";
+        case 2: return "VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT";
+        case 3: return "VK_SHADER_STAGE_GEOMETRY_BIT";
+        case 4: return "VK_SHADER_STAGE_FRAGMENT_BIT";
+        case 5: return "VK_SHADER_STAGE_COMPUTE_BIT";
+        case 5313: return "VK_SHADER_STAGE_RAYGEN_BIT_KHR";
+        case 5314: return "VK_SHADER_STAGE_INTERSECTION_BIT_KHR";
+        case 5315: return "VK_SHADER_STAGE_ANY_HIT_BIT_KHR";
+        case 5316: return "VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR";
+        case 5317: return "VK_SHADER_STAGE_MISS_BIT_KHR";
+        case 5318: return "VK_SHADER_STAGE_CALLABLE_BIT_KHR";
+        case 5364: return "VK_SHADER_STAGE_TASK_BIT_EXT";
+        case 5365: return "VK_SHADER_STAGE_MESH_BIT_EXT";
+        default: return nullptr;
+    }
+}
+
+// Walk the instructions: collect the stages of the entry points and, when stripping, drop the
+// debug instructions nothing else refers to. OpString stays, non-semantic instructions use it.
+static bool ProcessModule(std::vector<uint32_t>& words, bool strip, std::string& stages)
+{
+    if (words.size() < SPIRV_HEADER_WORDS || words[0] != SPIRV_MAGIC)
+        return false;
+
+    std::vector<uint32_t> result(words.begin(), words.begin() + SPIRV_HEADER_WORDS);
+    result.reserve(words.size());
+
+    size_t position = SPIRV_HEADER_WORDS;
+    while (position < words.size())
+    {
+        const uint32_t opcode = words[position] & 0xFFFF;
+        const uint32_t wordCount = words[position] >> 16;
+        if (wordCount == 0 || position + wordCount > words.size())
+            return false;
+
+        // OpEntryPoint
+        if (opcode == 15 && wordCount > 1)
+        {
+            const char* pStage = StageName(words[position + 1]);
+            if (pStage == nullptr)
+                return false;
+
+            if (stages.find(pStage) == std::string::npos)
+                stages += stages.empty() ? pStage : std::string(" | ") + pStage;
+        }
+
+        // OpSourceContinued, OpSource, OpSourceExtension, OpName, OpMemberName, OpLine,
+        // OpNoLine, OpModuleProcessed
+        const bool debug = opcode == 2 || opcode == 3 || opcode == 4 || opcode == 5 || opcode == 6 || opcode == 8 || opcode == 317 || opcode == 330;
+        if (!strip || !debug)
+            result.insert(result.end(), words.begin() + position, words.begin() + position + wordCount);
+
+        position += wordCount;
+    }
+
+    if (stages.empty())
+        return false;
+
+    words = std::move(result);
+    return true;
+}
+
+static void WriteLength(std::vector<uint8_t>& output, size_t length)
+{
+    while (length >= 255)
+    {
+        output.push_back(255);
+        length -= 255;
+    }
+
+    output.push_back(static_cast<uint8_t>(length));
+}
+
+static void WriteSequence(std::vector<uint8_t>& output, const uint8_t* pLiterals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    const size_t matchNibble = matchLength > 0 ? matchLength - 4 : 0;
+
+    output.push_back(static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4 | (matchNibble < 15 ? matchNibble : 15)));
+    if (literalLength >= 15)
+        WriteLength(output, literalLength - 15);
+
+    output.insert(output.end(), pLiterals, pLiterals + literalLength);
+
+    if (matchLength == 0)
+        return;
+
+    output.push_back(static_cast<uint8_t>(offset & 0xFF));
+    output.push_back(static_cast<uint8_t>(offset >> 8));
+
+    if (matchNibble >= 15)
+        WriteLength(output, matchNibble - 15);
+}
+
+// Greedy LZ with a hash table of 4 byte sequences, the format VulkanShaderLibrary::Decompress reads
+static std::vector<uint8_t> Compress(const std::vector<uint8_t>& input)
+{
+    constexpr size_t minMatch = 4;
+    constexpr size_t maxOffset = 65535;
+    constexpr uint32_t hashBits = 14;
+
+    std::vector<uint8_t> output;
+    std::vector<int64_t> table(size_t(1) << hashBits, -1);
+
+    const auto hash = [&input](size_t position) -> uint32_t
+    {
+        uint32_t value;
+        std::memcpy(&value, input.data() + position, 4);
+        return (value * 2654435761u) >> (32 - hashBits);
+    };
+
+    size_t anchor = 0;
+    size_t position = 0;
+    while (position + minMatch <= input.size())
+    {
+        const uint32_t h = hash(position);
+        const int64_t candidate = table[h];
+        table[h] = static_cast<int64_t>(position);
+
+        if (candidate < 0 || position - static_cast<size_t>(candidate) > maxOffset
+            || std::memcmp(input.data() + candidate, input.data() + position, minMatch) != 0)
+        {
+            position++;
+            continue;
+        }
+
+        size_t matchLength = minMatch;
+        while (position + matchLength < input.size() && input[candidate + matchLength] == input[position + matchLength])
+            matchLength++;
+
+        WriteSequence(output, input.data() + anchor, position - anchor, position - static_cast<size_t>(candidate), matchLength);
+
+        position += matchLength;
+        anchor = position;
+    }
+
+    if (anchor < input.size())
+        WriteSequence(output, input.data() + anchor, input.size() - anchor, 0, 0);
+
+    return output;
+}
+
+static std::string GenerateHeader(const std::string& namespaceName, const std::vector<Shader>& shaders)
+{
+    std::ostringstream header;
+    header << "#pragma once\n\n// Auto Generated File.\n// Generated by nwa_embed_shaders from:";
+    for (const auto& shader : shaders)
+        header << " " << shader.path.substr(shader.path.find_last_of("/\\") + 1);
+
+    header << "\n\n#include \"NativeWinApp/VulkanShaderLibrary.h\"\n\nnamespace " << namespaceName << "\n{\n";
+
+    for (const auto& shader : shaders)
+    {
+        header << "    // " << shader.originalSize << " bytes of SPIR-V, " << shader.codeSize << " after stripping, " << shader.data.size() << " embedded\n";
+        header << "    alignas(4) inline constexpr uint8_t " << shader.name << "_data[] =\n    {";
+
+        for (size_t i = 0; i < shader.data.size(); i++)
+        {
+            char byte[8];
+            std::snprintf(byte, sizeof(byte), "0x%02X,", shader.data[i]);
+            header << (i % 16 == 0 ? "\n        " : " ") << byte;
+        }
+
+        header << "\n    };\n\n";
+    }
+
+    header << "    inline constexpr NWA::VulkanShaderBlob BLOBS[] =\n    {\n";
+    for (const auto& shader : shaders)
+    {
+        header << "        { \"" << shader.name << "\", " << shader.stages << ", " << shader.name << "_data, sizeof(" << shader.name << "_data), "
+            << shader.codeSize << ", " << (shader.compressed ? "true" : "false") << " },\n";
+    }
+
+    header << "    };\n\n    // Index of every shader in BLOBS\n";
+    for (size_t i = 0; i < shaders.size(); i++)
+        header << "    inline constexpr uint32_t " << shaders[i].name << " = " << i << ";\n";
+
+    header << "}\n";
+    return header.str();
+}
+
+int main(int argc, char** argv)
+{
+    std::string outputPath;
+    std::string namespaceName = "Shaders";
+    bool strip = false;
+    bool compress = false;
+    std::vector<Shader> shaders;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--output" && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (argument == "--namespace" && i + 1 < argc)
+            namespaceName = argv[++i];
+        else if (argument == "--strip")
+            strip = true;
+        else if (argument == "--compress")
+            compress = true;
+        else if (const size_t separator = argument.find('='); separator != std::string::npos && separator > 0)
+        {
+            Shader shader;
+            shader.name = argument.substr(0, separator);
+            shader.path = argument.substr(separator + 1);
+            shaders.push_back(std::move(shader));
+        }
+        else
+        {
+            std::cerr << "EmbedShaders: unknown argument " << argument << std::endl;
+            return 1;
+        }
+    }
+
+    if (outputPath.empty() || shaders.empty())
+    {
+        std::cerr << "usage: EmbedShaders --output <header> --namespace <name> [--strip] [--compress] <name>=<spv> ..." << std::endl;
+        return 1;
+    }
+
+    size_t originalBytes = 0;
+    size_t embeddedBytes = 0;
+
+    for (auto& shader : shaders)
+    {
+        std::vector<uint8_t> bytes;
+        if (!ReadFile(shader.path, bytes) || bytes.size() % 4 != 0)
+        {
+            std::cerr << "EmbedShaders: cannot read " << shader.path << std::endl;
+            return 1;
+        }
+
+        std::vector<uint32_t> words = ToWords(bytes);
+        if (!ProcessModule(words, strip, shader.stages))
+        {
+            std::cerr << "EmbedShaders: " << shader.path << " is not a SPIR-V module with a known entry point" << std::endl;
+            return 1;
+        }
+
+        shader.originalSize = static_cast<uint32_t>(bytes.size());
+        shader.codeSize = static_cast<uint32_t>(words.size() * 4);
+
+        std::vector<uint8_t> code(shader.codeSize);
+        std::memcpy(code.data(), words.data(), code.size());
+
+        // Kept as is when compression does not pay off, it is then used in place
+        std::vector<uint8_t> compressed = compress ? Compress(code) : std::vector<uint8_t>();
+        shader.compressed = compress && compressed.size() < code.size();
+        shader.data = shader.compressed ? std::move(compressed) : std::move(code);
+
+        originalBytes += shader.originalSize;
+        embeddedBytes += shader.data.size();
+    }
+
+    const std::string header = GenerateHeader(namespaceName, shaders);
+
+    std::ofstream file(outputPath, std::ios::binary);
+    file << header;
+    if (!file)
+    {
+        std::cerr << "EmbedShaders: cannot write " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "EmbedShaders: " << shaders.size() << " shaders, " << originalBytes << " bytes of SPIR-V, " << embeddedBytes << " embedded" << std::endl;
+    return 0;
+}